@@ -13,6 +13,8 @@
 
 void sandbox_eth_disable_response(int index, bool disable);
 
+void sandbox_eth_disable_batch(int index, bool disable);
+
 void sandbox_eth_skip_timeout(void);
 
 /*
@@ -77,6 +79,7 @@ typedef int sandbox_eth_tx_hand_f(struct udevice *dev, void *pkt,
  * fake_host_hwaddr - MAC address of mocked machine
  * fake_host_ipaddr - IP address of mocked machine
  * disabled - Will not respond
+ * no_batch - recv_batch() is not available, so recv() is used
  * recv_packet_buffer - buffers of the packet returned as received
  * recv_packet_length - lengths of the packet returned as received
  * recv_packets - number of packets returned
@@ -87,6 +90,7 @@ struct eth_sandbox_priv {
 	uchar fake_host_hwaddr[ARP_HLEN];
 	struct in_addr fake_host_ipaddr;
 	bool disabled;
+	bool no_batch;
 	uchar * recv_packet_buffer[PKTBUFSRX];
 	int recv_packet_length[PKTBUFSRX];
 	int recv_packets;
@@ -38,6 +38,18 @@ size_t sandbox_serial_written(void);
  */
 void sandbox_serial_endisable(bool enabled);
 
+/**
+ * sandbox_serial_set_fifo() - Emulate a TX FIFO which empties at a given rate
+ *
+ * While the FIFO is full, putc() returns -EAGAIN and puts() writes fewer
+ * characters than it is given, as with a real UART. This allows tests to
+ * measure the time spent waiting for a slow serial line.
+ *
+ * @size: Number of characters the FIFO holds, 0 to stop emulating it
+ * @rate: Number of characters sent per second
+ */
+void sandbox_serial_set_fifo(uint size, ulong rate);
+
 /**
  * struct sandbox_serial_priv - Private data for this driver
  *
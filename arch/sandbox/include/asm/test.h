@@ -143,6 +143,35 @@ int sandbox_osd_get_mem(struct udevice *dev, u8 *buf, size_t buflen);
 int sandbox_pwm_get_config(struct udevice *dev, uint channel, uint *period_nsp,
 			   uint *duty_nsp, bool *enablep, bool *polarityp);
 
+/**
+ * sandbox_mmc_get_bus_time() - get the time a sandbox MMC spent on the bus
+ *
+ * This uses a timing model of the card and the bus, see sandbox_mmc.c
+ *
+ * @dev: MMC device
+ * Return: simulated time taken by all commands so far, in microseconds
+ */
+ulong sandbox_mmc_get_bus_time(struct udevice *dev);
+
+/**
+ * sandbox_mmc_set_emmc() - emulate an eMMC instead of an SD card
+ *
+ * The eMMC does not answer SD commands. After each CMD0 it answers CMD1 as
+ * busy @busy_polls times, to emulate its power-up.
+ *
+ * @dev: MMC device
+ * @busy_polls: number of CMD1 answered as busy after CMD0
+ */
+void sandbox_mmc_set_emmc(struct udevice *dev, uint busy_polls);
+
+/**
+ * sandbox_mmc_get_op_conds() - get the number of CMD1 received by the card
+ *
+ * @dev: MMC device
+ * Return: number of CMD1 since sandbox_mmc_set_emmc() was called
+ */
+uint sandbox_mmc_get_op_conds(struct udevice *dev);
+
 /**
  * sandbox_sf_set_block_protect() - Set the BP bits of the status register
  *
@@ -20,11 +20,14 @@
 #include <splash.h>
 #include <video.h>
 #include <asm/byteorder.h>
+#include <asm/unaligned.h>
+#include <u-boot/lz4.h>
 
 static int bmp_info (ulong addr);
 
 /*
- * Allocate and decompress a BMP image using gunzip().
+ * Allocate and decompress a BMP image using gunzip() or, for LZ4 frames,
+ * ulz4fn().
  *
  * Returns a pointer to the decompressed image data. This pointer is
  * aligned to 32-bit-aligned-address + 2.
@@ -36,13 +39,14 @@ static int bmp_info (ulong addr);
  * Returns NULL if decompression failed, or if the decompressed data
  * didn't contain a valid BMP signature.
  */
-#ifdef CONFIG_VIDEO_BMP_GZIP
+#if defined(CONFIG_VIDEO_BMP_GZIP) || defined(CONFIG_VIDEO_BMP_LZ4)
 struct bmp_image *gunzip_bmp(unsigned long addr, unsigned long *lenp,
 			     void **alloc_addr)
 {
-	void *dst;
+	void *dst, *src;
 	unsigned long len;
 	struct bmp_image *bmp;
+	int ret;
 
 	/*
 	 * Decompress bmp image
@@ -58,8 +62,19 @@ struct bmp_image *gunzip_bmp(unsigned long addr, unsigned long *lenp,
 	/* align to 32-bit-aligned-address + 2 */
 	bmp = dst + 2;
 
-	if (gunzip(bmp, CONFIG_VIDEO_LOGO_MAX_SIZE, map_sysmem(addr, 0),
-		   &len)) {
+	src = map_sysmem(addr, 0);
+	if (IS_ENABLED(CONFIG_VIDEO_BMP_LZ4) &&
+	    get_unaligned_le32(src) == LZ4F_MAGIC) {
+		size_t size = len;
+
+		ret = ulz4fn(src, CONFIG_VIDEO_LOGO_MAX_SIZE, bmp, &size);
+		len = size;
+	} else if (IS_ENABLED(CONFIG_VIDEO_BMP_GZIP)) {
+		ret = gunzip(bmp, CONFIG_VIDEO_LOGO_MAX_SIZE, src, &len);
+	} else {
+		ret = -EPROTONOSUPPORT;
+	}
+	if (ret) {
 		free(dst);
 		return NULL;
 	}
@@ -75,7 +90,7 @@ struct bmp_image *gunzip_bmp(unsigned long addr, unsigned long *lenp,
 		return NULL;
 	}
 
-	debug("Gzipped BMP image detected!\n");
+	debug("Compressed BMP image detected!\n");
 
 	*alloc_addr = dst;
 	return bmp;
@@ -227,6 +242,25 @@ int bmp_display(ulong addr, int x, int y)
 	struct bmp_image *bmp = map_sysmem(addr, 0);
 	void *bmp_alloc_addr = NULL;
 	unsigned long len;
+	bool align = false;
+
+	if (x == BMP_ALIGN_CENTER || y == BMP_ALIGN_CENTER)
+		align = true;
+
+	/*
+	 * Decompress a gzipped image straight into the frame buffer, falling
+	 * back to a buffer for images which cannot be drawn a row at a time
+	 */
+	if (IS_ENABLED(CONFIG_VIDEO_BMP_GZIP) &&
+	    bmp->header.signature[0] == 0x1f &&
+	    bmp->header.signature[1] == 0x8b &&
+	    !uclass_first_device_err(UCLASS_VIDEO, &dev)) {
+		ret = video_bmp_display_gzip(dev, addr,
+					     CONFIG_VIDEO_LOGO_MAX_SIZE, x, y,
+					     align);
+		if (ret != -EPROTONOSUPPORT)
+			return ret ? CMD_RET_FAILURE : 0;
+	}
 
 	if (!((bmp->header.signature[0]=='B') &&
 	      (bmp->header.signature[1]=='M')))
@@ -239,14 +273,8 @@ int bmp_display(ulong addr, int x, int y)
 	addr = map_to_sysmem(bmp);
 
 	ret = uclass_first_device_err(UCLASS_VIDEO, &dev);
-	if (!ret) {
-		bool align = false;
-
-		if (x == BMP_ALIGN_CENTER || y == BMP_ALIGN_CENTER)
-			align = true;
-
+	if (!ret)
 		ret = video_bmp_display(dev, addr, x, y, align);
-	}
 
 	if (bmp_alloc_addr)
 		free(bmp_alloc_addr);
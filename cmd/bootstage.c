@@ -6,6 +6,8 @@
 #include <common.h>
 #include <bootstage.h>
 #include <command.h>
+#include <env.h>
+#include <mapmem.h>
 
 static int do_bootstage_report(struct cmd_tbl *cmdtp, int flag, int argc,
 			       char *const argv[])
@@ -59,10 +61,33 @@ static int do_bootstage_stash(struct cmd_tbl *cmdtp, int flag, int argc,
 	return 0;
 }
 
+static int do_bootstage_trace(struct cmd_tbl *cmdtp, int flag, int argc,
+			      char *const argv[])
+{
+	ulong base, size;
+	void *buf;
+	int ret;
+
+	if (argc < 3 || get_base_size(argc, argv, &base, &size))
+		return CMD_RET_USAGE;
+
+	buf = map_sysmem(base, size);
+	ret = bootstage_export_trace(buf, size);
+	unmap_sysmem(buf);
+	if (ret < 0) {
+		printf("Not enough space for bootstage trace\n");
+		return CMD_RET_FAILURE;
+	}
+	env_set_hex("filesize", ret);
+
+	return 0;
+}
+
 static struct cmd_tbl cmd_bootstage_sub[] = {
 	U_BOOT_CMD_MKENT(report, 2, 1, do_bootstage_report, "", ""),
 	U_BOOT_CMD_MKENT(stash, 4, 0, do_bootstage_stash, "", ""),
 	U_BOOT_CMD_MKENT(unstash, 4, 0, do_bootstage_stash, "", ""),
+	U_BOOT_CMD_MKENT(trace, 4, 0, do_bootstage_trace, "", ""),
 };
 
 /*
@@ -92,5 +117,6 @@ U_BOOT_CMD(bootstage, 4, 1, do_boostage,
 	" - check boot progress and timing\n"
 	"report                      - Print a report\n"
 	"stash [<start> [<size>]]    - Stash data into memory\n"
-	"unstash [<start> [<size>]]  - Unstash data from memory"
+	"unstash [<start> [<size>]]  - Unstash data from memory\n"
+	"trace <start> <size>        - Write Chrome trace events to memory"
 );
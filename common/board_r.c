@@ -198,7 +198,11 @@ static int initr_malloc(void)
 {
 	ulong malloc_start;
 
-#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
+	/* Freed blocks lower malloc_ptr, so report the high-water mark */
+	debug("Pre-reloc malloc() used %#lx bytes (%ld KB)\n", gd->malloc_peak,
+	      gd->malloc_peak / 1024);
+#elif CONFIG_VAL(SYS_MALLOC_F_LEN)
 	debug("Pre-reloc malloc() used %#lx bytes (%ld KB)\n", gd->malloc_ptr,
 	      gd->malloc_ptr / 1024);
 #endif
@@ -241,6 +245,13 @@ static int initr_dm(void)
 	gd->dm_root = NULL;
 #ifdef CONFIG_TIMER
 	gd->timer = NULL;
+#endif
+	/* These were allocated in the pre-reloc heap, see dm_alloc_optional() */
+#if CONFIG_IS_ENABLED(OF_INDEX)
+	gd->of_index = NULL;
+#endif
+#if CONFIG_IS_ENABLED(DM_COMPAT_HASH)
+	gd->dm_compat = NULL;
 #endif
 	bootstage_start(BOOTSTAGE_ID_ACCUM_DM_R, "dm_r");
 	ret = dm_init_and_scan(false);
@@ -26,6 +26,9 @@ DECLARE_GLOBAL_DATA_PTR;
 
 enum {
 	RECORD_COUNT = CONFIG_VAL(BOOTSTAGE_RECORD_COUNT),
+	SPAN_COUNT = IS_ENABLED(CONFIG_SPL_BUILD) ? 0 :
+		CONFIG_BOOTSTAGE_SPAN_COUNT,
+	SPAN_NAME_LEN = 32,
 };
 
 struct bootstage_record {
@@ -36,10 +39,30 @@ struct bootstage_record {
 	enum bootstage_id id;
 };
 
+/**
+ * struct bootstage_span - A timed activity, possibly nested in another one
+ *
+ * @start_us: Time at which the span was opened
+ * @end_us: Time at which the span was closed, 0 while it is open
+ * @parent: Index of the enclosing span, -1 if none
+ * @cat: Category of the span, e.g. "dm" or "fs"
+ * @name: Name of the span
+ */
+struct bootstage_span {
+	ulong start_us;
+	ulong end_us;
+	int parent;
+	const char *cat;
+	char name[SPAN_NAME_LEN];
+};
+
 struct bootstage_data {
 	uint rec_count;
 	uint next_id;
 	struct bootstage_record record[RECORD_COUNT];
+	uint span_count;
+	int cur_span;			/* innermost open span, -1 if none */
+	struct bootstage_span *span;	/* allocated on first use */
 };
 
 enum {
@@ -218,6 +241,43 @@ uint32_t bootstage_accum(enum bootstage_id id)
 	return duration;
 }
 
+int bootstage_span_begin(const char *name, const char *cat)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_span *span;
+
+	if (!SPAN_COUNT || !data || !(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return -1;
+	if (!data->span) {
+		data->span = calloc(SPAN_COUNT, sizeof(*span));
+		if (!data->span)
+			return -1;
+	}
+	if (data->span_count >= SPAN_COUNT)
+		return -1;
+
+	span = &data->span[data->span_count];
+	span->start_us = timer_get_boot_us();
+	span->end_us = 0;
+	span->parent = data->cur_span;
+	span->cat = cat;
+	strlcpy(span->name, name, sizeof(span->name));
+	data->cur_span = data->span_count;
+
+	return data->span_count++;
+}
+
+void bootstage_span_end(int span)
+{
+	struct bootstage_data *data = gd->bootstage;
+
+	if (span < 0)
+		return;
+
+	data->span[span].end_us = timer_get_boot_us();
+	data->cur_span = data->span[span].parent;
+}
+
 /**
  * Get a record name as a printable string
  *
@@ -357,6 +417,22 @@ void bootstage_report(void)
 		if (rec->start_us)
 			prev = print_time_record(rec, -1);
 	}
+
+	if (data->span_count) {
+		printf("\nSpans (%d):\n", data->span_count);
+		printf("%11s%11s  %s\n", "Start", "Duration", "Activity");
+	}
+	for (i = 0; i < data->span_count; i++) {
+		struct bootstage_span *span = &data->span[i];
+		int depth, parent;
+
+		for (depth = 0, parent = span->parent; parent >= 0; depth++)
+			parent = data->span[parent].parent;
+		print_grouped_ull(span->start_us, BOOTSTAGE_DIGITS);
+		print_grouped_ull(span->end_us ? span->end_us - span->start_us :
+				  0, BOOTSTAGE_DIGITS);
+		printf("  %*s%s: %s\n", depth * 2, "", span->cat, span->name);
+	}
 }
 
 /**
@@ -381,6 +457,103 @@ static void append_data(char **ptrp, char *end, const void *data, int size)
 	memcpy(ptr, data, size);
 }
 
+/**
+ * Append formatted text to a memory buffer
+ *
+ * Like append_data() the buffer pointer is incremented even if there is no
+ * space.
+ *
+ * @param ptrp	Pointer to buffer, updated by this function
+ * @param end	Pointer to end of buffer
+ * @param fmt	printf() format string
+ */
+static void append_printf(char **ptrp, char *end, const char *fmt, ...)
+{
+	va_list args;
+	int len;
+
+	va_start(args, fmt);
+	len = vsnprintf(*ptrp, *ptrp < end ? end - *ptrp : 0, fmt, args);
+	va_end(args);
+	*ptrp += len;
+}
+
+/**
+ * Append a quoted JSON string to a memory buffer
+ *
+ * @param ptrp	Pointer to buffer, updated by this function
+ * @param end	Pointer to end of buffer
+ * @param str	String to quote
+ */
+static void append_json_string(char **ptrp, char *end, const char *str)
+{
+	append_data(ptrp, end, "\"", 1);
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			append_data(ptrp, end, "\\", 1);
+		append_data(ptrp, end, *str < ' ' ? "?" : str, 1);
+	}
+	append_data(ptrp, end, "\"", 1);
+}
+
+int bootstage_export_trace(char *buf, int size)
+{
+	const struct bootstage_data *data = gd->bootstage;
+	const struct bootstage_record *rec;
+	const char *sep = "";
+	char *ptr = buf, *end = buf + size;
+	char name[20];
+	ulong now = timer_get_boot_us();
+	int i;
+
+	append_printf(&ptr, end, "{\"traceEvents\":[\n");
+
+	/* Marks are instant events, accumulators have no position in time */
+	for (rec = data->record, i = 0; i < data->rec_count; i++, rec++) {
+		if (rec->start_us ||
+		    (rec->id != BOOTSTAGE_ID_AWAKE && !rec->time_us))
+			continue;
+		append_printf(&ptr, end, "%s{\"name\":", sep);
+		append_json_string(&ptr, end,
+				   get_record_name(name, sizeof(name), rec));
+		append_printf(&ptr, end,
+			      ",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"g\","
+			      "\"ts\":%lu,\"pid\":1,\"tid\":1}",
+			      rec->flags & BOOTSTAGEF_ERROR ? "error" : "mark",
+			      rec->time_us);
+		sep = ",\n";
+	}
+
+	/* Open spans end now */
+	for (i = 0; i < data->span_count; i++) {
+		const struct bootstage_span *span = &data->span[i];
+		ulong end_us = span->end_us ? span->end_us : now;
+
+		append_printf(&ptr, end, "%s{\"name\":", sep);
+		append_json_string(&ptr, end, span->name);
+		append_printf(&ptr, end,
+			      ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lu,"
+			      "\"dur\":%lu,\"pid\":1,\"tid\":1",
+			      span->cat, span->start_us, end_us - span->start_us);
+		if (span->parent >= 0) {
+			append_printf(&ptr, end, ",\"args\":{\"parent\":");
+			append_json_string(&ptr, end,
+					   data->span[span->parent].name);
+			append_printf(&ptr, end, "}");
+		}
+		append_printf(&ptr, end, "}");
+		sep = ",\n";
+	}
+	append_printf(&ptr, end, "\n]}\n");
+
+	if (ptr >= end) {
+		debug("%s: Not enough space for bootstage trace\n", __func__);
+		return -ENOSPC;
+	}
+
+	return ptr - buf;
+}
+
 int bootstage_stash(void *base, int size)
 {
 	const struct bootstage_data *data = gd->bootstage;
@@ -527,6 +700,7 @@ int bootstage_init(bool first)
 		return -ENOMEM;
 	data = gd->bootstage;
 	memset(data, '\0', size);
+	data->cur_span = -1;
 	if (first) {
 		data->next_id = BOOTSTAGE_ID_USER;
 		bootstage_add_record(BOOTSTAGE_ID_AWAKE, "reset", 0, 0);
@@ -1586,6 +1586,9 @@ static int run_pipe_real(struct pipe *pi)
 #endif
 		return rcode;
 	} else if (pi->num_progs == 1 && pi->progs[0].argv != NULL) {
+		/* The tree may be run again, so leave child->sp alone */
+		int sp = child->sp;
+
 		for (i=0; is_assignment(child->argv[i]); i++) { /* nothing */ }
 		if (i!=0 && child->argv[i]==NULL) {
 			/* assignments, but no command: set the local environment */
@@ -1624,11 +1627,11 @@ static int run_pipe_real(struct pipe *pi)
 			set_local_var(p, 0);
 #endif
 			if (p != child->argv[i]) {
-				child->sp--;
+				sp--;
 				free(p);
 			}
 		}
-		if (child->sp) {
+		if (sp) {
 			char * str = NULL;
 
 			str = make_string(child->argv + i,
@@ -1761,6 +1764,7 @@ static int run_list_real(struct pipe *pi)
 	char *save_name = NULL;
 	char **list = NULL;
 	char **save_list = NULL;
+	struct pipe *for_pipe = NULL;
 	struct pipe *rpipe;
 	int flag_rep = 0;
 #ifndef __U_BOOT__
@@ -1800,7 +1804,8 @@ static int run_list_real(struct pipe *pi)
 				/* check Ctrl-C */
 				ctrlc();
 				if ((had_ctrlc())) {
-					return 1;
+					rcode = 1;
+					goto out;
 				}
 #endif
 				flag_restore = 0;
@@ -1829,6 +1834,7 @@ static int run_list_real(struct pipe *pi)
 				list = make_list_in(pi->next->progs->argv,
 					pi->progs->argv[0]);
 				save_list = list;
+				for_pipe = pi;
 				save_name = pi->progs->argv[0];
 				pi->progs->argv[0] = NULL;
 				flag_rep = 1;
@@ -1899,7 +1905,8 @@ static int run_list_real(struct pipe *pi)
 #else
 		if (rcode < -1) {
 			last_return_code = -rcode - 2;
-			return -2;	/* exit */
+			rcode = -2;	/* exit */
+			goto out;
 		}
 		last_return_code = rcode;
 #endif
@@ -1919,6 +1926,15 @@ static int run_list_real(struct pipe *pi)
 		checkjobs(NULL);
 #endif
 	}
+out:
+	if (list) {
+		/* Left a "for" loop early: put the tree back as it was */
+		free(for_pipe->progs->argv[0]);
+		while (*list)
+			free(*list++);
+		free(save_list);
+		for_pipe->progs->argv[0] = save_name;
+	}
 	return rcode;
 }
 
@@ -3249,6 +3265,213 @@ static int parse_stream_outer(struct in_str *inp, int flag)
 #endif /* __U_BOOT__ */
 }
 
+#ifdef CONFIG_HUSH_PARSE_CACHE
+/* Number of parse trees kept */
+#define CACHE_ENTRIES	32
+
+/**
+ * struct hush_cached - parse tree of a script
+ *
+ * A tree depends only on the text of the script, the parser flags and IFS,
+ * so a script which is run again, e.g. by 'run' in a loop, can skip the
+ * parser. Running a tree leaves it as it was.
+ *
+ * @text:	text of the script, NULL if the entry is unused
+ * @hash:	hash of @text
+ * @flag:	flags passed to parse_string_outer()
+ * @list:	parse tree
+ * @busy:	number of runs of @list in progress
+ * @stale:	free the entry once @busy drops to zero
+ * @last_use:	value of cache_tick when @list was last run
+ */
+struct hush_cached {
+	char *text;
+	ulong hash;
+	int flag;
+	struct pipe *list;
+	int busy;
+	bool stale;
+	ulong last_use;
+};
+
+static struct hush_cached cache[CACHE_ENTRIES];
+static ulong cache_tick;
+/* IFS when the trees in the cache were parsed, NULL if unset */
+static char *cache_ifs;
+static bool cache_disabled;
+
+static ulong cache_hash(const char *s)
+{
+	ulong hash = 5381;
+
+	while (*s)
+		hash = hash * 33 + (uchar)*s++;
+
+	return hash;
+}
+
+static void cache_drop(struct hush_cached *ent)
+{
+	if (ent->busy) {
+		ent->stale = true;
+		return;
+	}
+	free_pipe_list(ent->list, 0);
+	free(ent->text);
+	memset(ent, '\0', sizeof(*ent));
+}
+
+static void cache_flush(void)
+{
+	int i;
+
+	for (i = 0; i < CACHE_ENTRIES; i++) {
+		if (cache[i].text)
+			cache_drop(&cache[i]);
+	}
+}
+
+/* Drop all trees if IFS changed since they were parsed */
+static void cache_check_ifs(void)
+{
+	const char *val = env_get("IFS");
+
+	if (!val == !cache_ifs && (!val || !strcmp(val, cache_ifs)))
+		return;
+	cache_flush();
+	free(cache_ifs);
+	cache_ifs = val ? strdup(val) : NULL;
+}
+
+/* Find an unused entry, dropping the least recently used tree if needed */
+static struct hush_cached *cache_alloc(void)
+{
+	struct hush_cached *ent, *lru = NULL;
+
+	for (ent = cache; ent < cache + CACHE_ENTRIES; ent++) {
+		if (!ent->text)
+			return ent;
+		if (!ent->busy && (!lru || ent->last_use < lru->last_use))
+			lru = ent;
+	}
+	if (lru)
+		cache_drop(lru);
+
+	return lru;
+}
+
+/**
+ * cache_parse() - Parse the first list of commands in a script
+ *
+ * This parses like parse_stream_outer() does before running the list.
+ *
+ * @s:		script
+ * @flag:	parser flags
+ * Return: parse tree, or NULL on a syntax error
+ */
+static struct pipe *cache_parse(const char *s, int flag)
+{
+	o_string temp = NULL_O_STRING;
+	struct p_context ctx;
+	struct in_str input;
+	char *p;
+	int rcode;
+
+	p = xmalloc(strlen(s) + 2);
+	strcpy(p, s);
+	s = strchr(s, '\n');
+	if (!s || s[1])
+		strcat(p, "\n");
+	setup_string_in_str(&input, p);
+
+	ctx.type = flag;
+	initialize_context(&ctx);
+	update_ifs_map();
+	if (!(flag & FLAG_PARSE_SEMICOLON))
+		mapset((uchar *)";$&|", 0);
+	input.promptmode = 1;
+	rcode = parse_stream(&temp, &ctx, &input,
+			     flag & FLAG_CONT_ON_NEWLINE ? -1 : '\n');
+	if (rcode != 1 && ctx.old_flag == 0) {
+		done_word(&temp, &ctx);
+		done_pipe(&ctx, PIPE_SEQ);
+	} else {
+		if (ctx.old_flag != 0)
+			free(ctx.stack);
+		free_pipe_list(ctx.list_head, 0);
+		ctx.list_head = NULL;
+	}
+	b_free(&temp);
+	free(p);
+
+	return ctx.list_head;
+}
+
+/**
+ * cache_get() - Get the parse tree of a script, parsing it if needed
+ *
+ * @s:		script
+ * @flag:	parser flags
+ * Return: entry holding the tree, or NULL if the script must be parsed and
+ *	run without the cache, i.e. on a syntax error, or if the tree is
+ *	already running or all trees are
+ */
+static struct hush_cached *cache_get(const char *s, int flag)
+{
+	ulong hash = cache_hash(s);
+	struct hush_cached *ent;
+	struct pipe *list;
+
+	cache_check_ifs();
+	for (ent = cache; ent < cache + CACHE_ENTRIES; ent++) {
+		if (ent->text && !ent->stale && ent->hash == hash &&
+		    ent->flag == flag && !strcmp(ent->text, s))
+			return ent->busy ? NULL : ent;
+	}
+
+	list = cache_parse(s, flag);
+	if (!list)
+		return NULL;
+	ent = cache_alloc();
+	if (ent)
+		ent->text = strdup(s);
+	if (!ent || !ent->text) {
+		free_pipe_list(list, 0);
+		return NULL;
+	}
+	ent->hash = hash;
+	ent->flag = flag;
+	ent->list = list;
+
+	return ent;
+}
+
+/* Run a tree from the cache, like parse_string_outer() */
+static int cache_run(struct hush_cached *ent)
+{
+	int code;
+
+	ent->busy++;
+	ent->last_use = ++cache_tick;
+	code = run_list_real(ent->list);
+	if (!--ent->busy && ent->stale)
+		cache_drop(ent);
+	if (code == -2)		/* exit */
+		return last_return_code;
+	if (code == -1)
+		flag_repeat = 0;
+
+	return code != 0 ? 1 : 0;
+}
+
+void hush_cache_enable(bool enable)
+{
+	cache_disabled = !enable;
+	if (!enable)
+		cache_flush();
+}
+#endif /* CONFIG_HUSH_PARSE_CACHE */
+
 #ifndef __U_BOOT__
 static int parse_string_outer(const char *s, int flag)
 #else
@@ -3263,6 +3486,19 @@ int parse_string_outer(const char *s, int flag)
 		return 1;
 	if (!*s)
 		return 0;
+#ifdef CONFIG_HUSH_PARSE_CACHE
+	/*
+	 * Without FLAG_EXIT_FROM_LOOP, e.g. from run_command_list(), each line
+	 * is run before the next one is parsed, so such scripts are not cached
+	 */
+	if ((flag & FLAG_EXIT_FROM_LOOP) && !(flag & FLAG_REPARSING) &&
+	    !cache_disabled) {
+		struct hush_cached *ent = cache_get(s, flag);
+
+		if (ent)
+			return cache_run(ent);
+	}
+#endif
 	if (!(p = strchr(s, '\n')) || *++p) {
 		p = xmalloc(strlen(s) + 2);
 		strcpy(p, s);
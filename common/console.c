@@ -5,6 +5,7 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <console.h>
 #include <debug_uart.h>
 #include <display_options.h>
@@ -685,8 +686,31 @@ static inline void pre_console_puts(const char *s) {}
 static inline void print_pre_console_buffer(int flushpoint) {}
 #endif
 
+/*
+ * Add up the time spent sending output to the console devices. This is only
+ * done once bootstage is set up, since bootstage_start() needs its records.
+ */
+static bool console_time_start(void)
+{
+#if CONFIG_IS_ENABLED(BOOTSTAGE_CONSOLE)
+	if (gd->bootstage) {
+		bootstage_start(BOOTSTAGE_ID_ACCUM_CONSOLE, "console");
+		return true;
+	}
+#endif
+	return false;
+}
+
+static void console_time_end(bool started)
+{
+	if (started)
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_CONSOLE);
+}
+
 void putc(const char c)
 {
+	bool timed;
+
 	if (!gd)
 		return;
 
@@ -716,6 +740,7 @@ void putc(const char c)
 	if (!gd->have_console)
 		return pre_console_putc(c);
 
+	timed = console_time_start();
 	if (gd->flags & GD_FLG_DEVINIT) {
 		/* Send to the standard output */
 		fputc(stdout, c);
@@ -724,10 +749,13 @@ void putc(const char c)
 		pre_console_putc(c);
 		serial_putc(c);
 	}
+	console_time_end(timed);
 }
 
 void puts(const char *s)
 {
+	bool timed;
+
 	if (!gd)
 		return;
 
@@ -760,6 +788,7 @@ void puts(const char *s)
 	if (!gd->have_console)
 		return pre_console_puts(s);
 
+	timed = console_time_start();
 	if (gd->flags & GD_FLG_DEVINIT) {
 		/* Send to the standard output */
 		fputs(stdout, s);
@@ -768,6 +797,7 @@ void puts(const char *s)
 		pre_console_puts(s);
 		serial_puts(s);
 	}
+	console_time_end(timed);
 }
 
 #ifdef CONFIG_CONSOLE_FLUSH_SUPPORT
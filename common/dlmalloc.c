@@ -18,6 +18,7 @@
 
 #include <malloc.h>
 #include <asm/io.h>
+#include <linux/list.h>
 #include <valgrind/memcheck.h>
 
 #ifdef DEBUG
@@ -599,6 +600,20 @@ ulong mem_malloc_brk = 0;
 static bool malloc_testing;	/* enable test mode */
 static int malloc_max_allocs;	/* return NULL after this many calls to malloc() */
 
+#if CONFIG_IS_ENABLED(UNIT_TEST)
+ulong malloc_bin_steps;
+
+static inline void malloc_count_bin_step(void)
+{
+	malloc_bin_steps++;
+}
+#else
+static inline void malloc_count_bin_step(void) {}
+#endif
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+static bool slab_ready;		/* slab_init() was run */
+#endif
+
 void *sbrk(ptrdiff_t increment)
 {
 	ulong old = mem_malloc_brk;
@@ -624,6 +639,9 @@ void mem_malloc_init(ulong start, ulong size)
 	mem_malloc_start = start;
 	mem_malloc_end = start + size;
 	mem_malloc_brk = start;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	slab_ready = false;
+#endif
 
 #ifdef CONFIG_SYS_MALLOC_DEFAULT_TO_INIT
 	malloc_init();
@@ -1222,6 +1240,248 @@ static void malloc_extend_top(nb) INTERNAL_SIZE_T nb;
 
 
 
+static Void_t* malloc_bins(size_t bytes);
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+/*
+  Slab front end
+
+    Small requests are served from pages of equally sized slots, with
+    one list of pages per size class. The pages are allocated from the
+    bins. malloc() takes the first free slot of the first page of the
+    class which has one, and free() puts the slot back on its page.
+    Both take constant time instead of scanning bins and coalescing
+    neighbouring chunks.
+
+    Each slot looks like an in-use chunk whose size field holds the
+    address of its page with IS_SLAB set. U-Boot has no mmap(), so this
+    bit is never set on chunks from the bins.
+
+    A page which becomes empty is given back to the bins, unless it is
+    the only page of its class with free slots.
+*/
+
+#define IS_SLAB			IS_MMAPPED
+#define chunk_is_slab(p)	((p)->size & IS_SLAB)
+
+/* Largest request served by the slabs */
+#define SLAB_MAX_REQUEST	2048
+
+/* A page holds at least this many bytes of slots, and at least 4 slots */
+#define SLAB_PAGE_BYTES		4096
+#define SLAB_PAGE_SLOTS		4
+
+/*
+ * Padded request sizes of the classes. These are multiples of
+ * MALLOC_ALIGNMENT and the last one is request2size(SLAB_MAX_REQUEST) on
+ * 64-bit machines.
+ */
+static const unsigned short slab_sizes[] = {
+	32, 48, 64, 80, 96, 128, 160, 192, 256, 320, 384, 512, 640, 768,
+	1024, 1280, 1536, 2064,
+};
+
+#define SLAB_CLASSES		ARRAY_SIZE(slab_sizes)
+
+/*
+ * struct slab_page - header of a page of slots
+ *
+ * @list:	link in the list of pages with free slots of the class
+ * @free:	first free slot, each free slot holds a pointer to the next
+ * @inuse:	number of allocated slots
+ * @cls:	size class
+ */
+struct slab_page {
+	struct list_head list;
+	void *free;
+	unsigned short inuse;
+	unsigned char cls;
+};
+
+/* Offset of the first slot, which is aligned like any chunk */
+#define SLAB_HDR	((sizeof(struct slab_page) + SIZE_SZ + \
+			  MALLOC_ALIGN_MASK) & ~MALLOC_ALIGN_MASK)
+
+/*
+ * struct slab_class - pages of one size class
+ *
+ * @partial:	pages with free slots
+ * @size:	size of each slot, including the chunk header
+ * @slots:	number of slots in each page
+ * @pages:	number of pages
+ * @held:	size of all pages, as chunks from the bins
+ * @inuse:	number of allocated slots
+ * @allocs:	number of allocations, for malloc_stats()
+ * @frees:	number of frees, for malloc_stats()
+ */
+struct slab_class {
+	struct list_head partial;
+	unsigned int size;
+	unsigned int slots;
+	unsigned long pages;
+	unsigned long held;
+	unsigned long inuse;
+	unsigned long allocs;
+	unsigned long frees;
+};
+
+static struct slab_class slab_classes[SLAB_CLASSES];
+/* Class of each padded request size, in units of 16 bytes rounded up */
+static unsigned char slab_index[2064 / 16 + 1];
+static bool slab_disabled;
+
+static void slab_init(void)
+{
+	struct slab_class *sc;
+	unsigned int i, cls;
+
+	for (cls = 0; cls < SLAB_CLASSES; cls++) {
+		sc = &slab_classes[cls];
+		memset(sc, '\0', sizeof(*sc));
+		INIT_LIST_HEAD(&sc->partial);
+		sc->size = slab_sizes[cls];
+		sc->slots = max(SLAB_PAGE_BYTES / sc->size,
+				(unsigned int)SLAB_PAGE_SLOTS);
+	}
+	for (i = 0, cls = 0; i < ARRAY_SIZE(slab_index); i++) {
+		while (slab_sizes[cls] < i * 16)
+			cls++;
+		slab_index[i] = cls;
+	}
+	slab_ready = true;
+}
+
+static struct slab_page *slab_page_of(Void_t *mem)
+{
+	return (struct slab_page *)(mem2chunk(mem)->size & ~SIZE_BITS);
+}
+
+static struct slab_page *slab_new_page(struct slab_class *sc)
+{
+	struct slab_page *page;
+	char *slot;
+	int i;
+
+	page = malloc_bins(SLAB_HDR + sc->slots * sc->size - SIZE_SZ);
+	if (!page)
+		return NULL;
+	/* Each slot is reported to valgrind as a block, not the whole page */
+	VALGRIND_FREELIKE_BLOCK(page, SIZE_SZ);
+	page->cls = sc - slab_classes;
+	page->inuse = 0;
+	page->free = NULL;
+
+	/* Chain the slots in address order */
+	for (i = sc->slots - 1; i >= 0; i--) {
+		slot = (char *)page + SLAB_HDR + i * sc->size;
+		mem2chunk(slot)->size = (INTERNAL_SIZE_T)page | IS_SLAB;
+		*(void **)slot = page->free;
+		page->free = slot;
+	}
+	list_add(&page->list, &sc->partial);
+	sc->pages++;
+	sc->held += chunksize(mem2chunk(page));
+
+	return page;
+}
+
+static Void_t* slab_alloc(size_t bytes)
+{
+	struct slab_class *sc;
+	struct slab_page *page;
+	void **slot;
+
+	if (!slab_ready)
+		slab_init();
+	sc = &slab_classes[slab_index[(request2size(bytes) + 15) / 16]];
+	if (list_empty(&sc->partial) && !slab_new_page(sc))
+		return NULL;
+
+	page = list_first_entry(&sc->partial, struct slab_page, list);
+	slot = page->free;
+	page->free = *slot;
+	if (!page->free)
+		list_del(&page->list);
+	page->inuse++;
+	sc->inuse++;
+	sc->allocs++;
+	VALGRIND_MALLOCLIKE_BLOCK(slot, bytes, SIZE_SZ, false);
+
+	return slot;
+}
+
+static void slab_free(Void_t *mem)
+{
+	struct slab_page *page = slab_page_of(mem);
+	struct slab_class *sc = &slab_classes[page->cls];
+
+	VALGRIND_FREELIKE_BLOCK(mem, SIZE_SZ);
+	if (!page->free)
+		list_add(&page->list, &sc->partial);
+	*(void **)mem = page->free;
+	page->free = mem;
+	page->inuse--;
+	sc->inuse--;
+	sc->frees++;
+
+	/* Keep the last page, so that churn at its boundary stays cheap */
+	if (!page->inuse && !list_is_singular(&sc->partial)) {
+		list_del(&page->list);
+		sc->pages--;
+		sc->held -= chunksize(mem2chunk(page));
+		VALGRIND_MALLOCLIKE_BLOCK(page, SLAB_HDR + sc->slots * sc->size -
+					  SIZE_SZ, SIZE_SZ, false);
+		fREe(page);
+	}
+}
+
+static size_t slab_usable_size(Void_t *mem)
+{
+	return slab_classes[slab_page_of(mem)->cls].size - SIZE_SZ;
+}
+
+static Void_t* slab_realloc(Void_t *oldmem, size_t bytes)
+{
+	size_t usable = slab_usable_size(oldmem);
+	Void_t *newmem;
+
+	if (bytes <= usable) {
+		VALGRIND_RESIZEINPLACE_BLOCK(oldmem, 0, bytes, SIZE_SZ);
+		VALGRIND_MAKE_MEM_DEFINED(oldmem, bytes);
+		return oldmem;
+	}
+	newmem = mALLOc(bytes);
+	if (!newmem)
+		return NULL;
+	memcpy(newmem, oldmem, usable);
+	slab_free(oldmem);
+
+	return newmem;
+}
+
+#ifdef DEBUG
+/* Bytes of slab pages which are not allocated to callers */
+static unsigned long slab_slack(void)
+{
+	unsigned long slack = 0;
+	int cls;
+
+	for (cls = 0; cls < SLAB_CLASSES; cls++)
+		slack += slab_classes[cls].held -
+			 slab_classes[cls].inuse * slab_classes[cls].size;
+
+	return slack;
+}
+#endif
+#endif /* SYS_MALLOC_SLAB */
+
+void malloc_enable_slab(bool enable)
+{
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	slab_disabled = !enable;
+#endif
+}
+
 /* Main public routines */
 
 
@@ -1289,6 +1549,31 @@ Void_t* mALLOc(size_t bytes)
 #else
 Void_t* mALLOc(bytes) size_t bytes;
 #endif
+{
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return malloc_simple_from(bytes, __builtin_return_address(0));
+#endif
+
+  if (CONFIG_IS_ENABLED(UNIT_TEST) && malloc_testing) {
+    if (--malloc_max_allocs < 0)
+      return NULL;
+  }
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  if (bytes <= SLAB_MAX_REQUEST && !slab_disabled && mem_malloc_end) {
+    Void_t *mem = slab_alloc(bytes);
+
+    if (mem)
+      return mem;
+  }
+#endif
+
+  return malloc_bins(bytes);
+}
+
+/* Allocate a chunk from the bins, see the algorithm above */
+static Void_t* malloc_bins(size_t bytes)
 {
   mchunkptr victim;                  /* inspected/selected chunk */
   INTERNAL_SIZE_T victim_size;       /* its size */
@@ -1305,16 +1590,6 @@ Void_t* mALLOc(bytes) size_t bytes;
 
   INTERNAL_SIZE_T nb;
 
-#if CONFIG_VAL(SYS_MALLOC_F_LEN)
-	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
-		return malloc_simple(bytes);
-#endif
-
-  if (CONFIG_IS_ENABLED(UNIT_TEST) && malloc_testing) {
-    if (--malloc_max_allocs < 0)
-      return NULL;
-  }
-
   /* check if mem_malloc_init() was run */
   if ((mem_malloc_start == 0) && (mem_malloc_end == 0)) {
     /* not initialized yet */
@@ -1324,6 +1599,7 @@ Void_t* mALLOc(bytes) size_t bytes;
   if ((long)bytes < 0) return NULL;
 
   nb = request2size(bytes);  /* padded request size; */
+  malloc_count_bin_step();
 
   /* Check for exact match in a bin */
 
@@ -1362,6 +1638,7 @@ Void_t* mALLOc(bytes) size_t bytes;
 
     for (victim = last(bin); victim != bin; victim = victim->bk)
     {
+      malloc_count_bin_step();
       victim_size = chunksize(victim);
       remainder_size = victim_size - nb;
 
@@ -1454,6 +1731,7 @@ Void_t* mALLOc(bytes) size_t bytes;
 
 	for (victim = last(bin); victim != bin; victim = victim->bk)
 	{
+	  malloc_count_bin_step();
 	  victim_size = chunksize(victim);
 	  remainder_size = victim_size - nb;
 
@@ -1587,9 +1865,9 @@ void fREe(mem) Void_t* mem;
   int       islr;      /* track whether merging with last_remainder */
 
 #if CONFIG_VAL(SYS_MALLOC_F_LEN)
-	/* free() is a no-op - all the memory will be freed on relocation */
+	/* All the memory will be freed on relocation */
 	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT)) {
-		VALGRIND_FREELIKE_BLOCK(mem, SIZE_SZ);
+		free_simple(mem);
 		return;
 	}
 #endif
@@ -1600,6 +1878,14 @@ void fREe(mem) Void_t* mem;
   p = mem2chunk(mem);
   hd = p->size;
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  if (chunk_is_slab(p))
+  {
+    slab_free(mem);
+    return;
+  }
+#endif
+
 #if HAVE_MMAP
   if (hd & IS_MMAPPED)                       /* release mmapped memory. */
   {
@@ -1756,6 +2042,11 @@ Void_t* rEALLOc(oldmem, bytes) Void_t* oldmem; size_t bytes;
 	}
 #endif
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  if (chunk_is_slab(mem2chunk(oldmem)))
+    return slab_realloc(oldmem, bytes);
+#endif
+
   newp    = oldp    = mem2chunk(oldmem);
   newsize = oldsize = chunksize(oldp);
 
@@ -1973,7 +2264,8 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
 
 #if CONFIG_VAL(SYS_MALLOC_F_LEN)
 	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT)) {
-		return memalign_simple(alignment, bytes);
+		return memalign_simple_from(alignment, bytes,
+					    __builtin_return_address(0));
 	}
 #endif
 
@@ -1981,6 +2273,11 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
 
   if (alignment <= MALLOC_ALIGNMENT) return mALLOc(bytes);
 
+  if (CONFIG_IS_ENABLED(UNIT_TEST) && malloc_testing) {
+    if (--malloc_max_allocs < 0)
+      return NULL;
+  }
+
   /* Otherwise, ensure that it is at least a minimum chunk size */
 
   if (alignment <  MINSIZE) alignment = MINSIZE;
@@ -1988,7 +2285,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
   /* Call malloc with worst case padding to hit alignment. */
 
   nb = request2size(bytes);
-  m  = (char*)(mALLOc(nb + alignment + MINSIZE));
+  m  = (char*)(malloc_bins(nb + alignment + MINSIZE));
 
   /*
   * The attempt to over-allocate (with a size large enough to guarantee the
@@ -2004,7 +2301,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
      * Use bytes not nb, since mALLOc internally calls request2size too, and
      * each call increases the size to allocate, to account for the header.
      */
-    m  = (char*)(mALLOc(bytes));
+    m  = (char*)(malloc_bins(bytes));
     /* Aligned -> return it */
     if ((((unsigned long)(m)) % alignment) == 0)
       return m;
@@ -2015,7 +2312,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
     fREe(m);
     /* Add in extra bytes to match misalignment of unexpanded allocation */
     extra = alignment - (((unsigned long)(m)) % alignment);
-    m  = (char*)(mALLOc(bytes + extra));
+    m  = (char*)(malloc_bins(bytes + extra));
     /*
      * m might not be the same as before. Validate that the previous value of
      * extra still works for the current value of m.
@@ -2159,22 +2456,34 @@ Void_t* cALLOc(n, elem_size) size_t n; size_t elem_size;
   INTERNAL_SIZE_T oldtopsize = chunksize(top);
 #endif
 #endif
-  Void_t* mem = mALLOc (sz);
+  Void_t* mem;
 
   if ((long)n < 0) return NULL;
 
-  if (mem == NULL)
-    return NULL;
-  else
-  {
 #if CONFIG_VAL(SYS_MALLOC_F_LEN)
 	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT)) {
-		memset(mem, 0, sz);
+		mem = malloc_simple_from(sz, __builtin_return_address(0));
+		if (mem)
+			memset(mem, 0, sz);
 		return mem;
 	}
 #endif
+
+  mem = mALLOc (sz);
+  if (mem == NULL)
+    return NULL;
+  else
+  {
     p = mem2chunk(mem);
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+    if (chunk_is_slab(p))
+    {
+      memset(mem, '\0', sz);
+      return mem;
+    }
+#endif
+
     /* Two optional cases in which clearing not necessary */
 
 
@@ -2324,6 +2633,10 @@ size_t malloc_usable_size(mem) Void_t* mem;
   else
   {
     p = mem2chunk(mem);
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+    if (chunk_is_slab(p))
+      return slab_usable_size(mem);
+#endif
     if(!chunk_is_mmapped(p))
     {
       if (!inuse(p)) return 0;
@@ -2376,6 +2689,12 @@ static void malloc_update_mallinfo()
   current_mallinfo.hblkhd = mmapped_mem;
   current_mallinfo.keepcost = chunksize(top);
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  /* Free slots are free memory, even though their pages are in use */
+  current_mallinfo.uordblks -= slab_slack();
+  current_mallinfo.fordblks += slab_slack();
+#endif
+
 }
 #endif	/* DEBUG */
 
@@ -2410,6 +2729,20 @@ void malloc_stats()
   printf("max mmap regions = %10u\n",
 	  (unsigned int)max_n_mmaps);
 #endif
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  {
+    int cls;
+
+    printf("slab  size  pages  in use      allocs       frees\n");
+    for (cls = 0; cls < SLAB_CLASSES; cls++) {
+      struct slab_class *sc = &slab_classes[cls];
+
+      if (sc->allocs)
+	printf("      %4u %6lu %7lu %11lu %11lu\n", sc->size, sc->pages,
+	       sc->inuse, sc->allocs, sc->frees);
+    }
+  }
+#endif
 }
 #endif	/* DEBUG */
 
@@ -2473,6 +2806,10 @@ int initf_malloc(void)
 	assert(gd->malloc_base);	/* Set up by crt0.S */
 	gd->malloc_limit = CONFIG_VAL(SYS_MALLOC_F_LEN);
 	gd->malloc_ptr = 0;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
+	gd->malloc_free = 0;
+	gd->malloc_peak = 0;
+#endif
 #endif
 
 	return 0;
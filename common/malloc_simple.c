@@ -17,31 +17,261 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
-static void *alloc_simple(size_t bytes, int align)
+/* Number of callers whose allocations are counted separately */
+#define SIMPLE_CALLERS	16
+
+/**
+ * struct simple_caller - allocations made by one caller
+ *
+ * The table of callers is at the start of the pool. The last entry counts
+ * the allocations of all callers which do not fit in the table.
+ *
+ * @caller:	return address of the call to malloc() etc., 0 if unused
+ * @bytes:	number of bytes allocated, including headers and padding
+ * @count:	number of allocations
+ */
+struct simple_caller {
+	ulong caller;
+	u32 bytes;
+	u32 count;
+};
+
+/**
+ * struct simple_hdr - header in front of each allocation
+ *
+ * @size:	size of the block, including the header and @lead
+ * @lead:	padding in front of the header, for alignment
+ */
+struct simple_hdr {
+	u32 size;
+	u32 lead;
+};
+
+/**
+ * struct simple_free - a free block
+ *
+ * Free blocks are in a list in address order and never border each other
+ * or the unused part of the pool, since they are merged on free().
+ *
+ * @size:	size of the block
+ * @next:	offset of the next free block plus one, 0 if none
+ */
+struct simple_free {
+	u32 size;
+	u32 next;
+};
+
+#define HDR_SIZE	sizeof(struct simple_hdr)
+/* Smallest block which is put on the free list when splitting */
+#define MIN_FREE	(HDR_SIZE + sizeof(struct simple_free))
+
+static void *pool_ptr(ulong offset, ulong size)
+{
+	return map_sysmem(gd->malloc_base + offset, size);
+}
+
+static void count_caller(ulong bytes, void *caller)
+{
+	struct simple_caller *tab;
+	int i;
+
+	if (!CONFIG_IS_ENABLED(SYS_MALLOC_F_STATS))
+		return;
+	tab = pool_ptr(0, sizeof(*tab) * SIMPLE_CALLERS);
+	for (i = 0; i < SIMPLE_CALLERS - 1; i++) {
+		if (!tab[i].caller)
+			tab[i].caller = (ulong)caller;
+		if (tab[i].caller == (ulong)caller)
+			break;
+	}
+	tab[i].bytes += bytes;
+	tab[i].count++;
+}
+
+/**
+ * reserve_callers() - set up the table of callers in an empty pool
+ *
+ * Return: 0 if OK, -ENOMEM if the pool is too small
+ */
+static int reserve_callers(void)
+{
+	ulong size = sizeof(struct simple_caller) * SIMPLE_CALLERS;
+
+	if (!CONFIG_IS_ENABLED(SYS_MALLOC_F_STATS) || gd->malloc_ptr)
+		return 0;
+	if (size > gd->malloc_limit)
+		return -ENOMEM;
+	memset(pool_ptr(0, size), '\0', size);
+	gd->malloc_ptr = size;
+
+	return 0;
+}
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
+static struct simple_free *free_at(ulong offset)
+{
+	return pool_ptr(offset, sizeof(struct simple_free));
+}
+
+/* Drop a free list left over from before the pool was reset */
+static void check_free_list(void)
+{
+	if (gd->malloc_free && gd->malloc_free - 1 >= gd->malloc_ptr)
+		gd->malloc_free = 0;
+}
+
+/**
+ * alloc_block() - allocate a block with a header
+ *
+ * This uses the first free block which is large enough, or else the unused
+ * part of the pool.
+ *
+ * @bytes:	number of bytes for the caller
+ * @align:	alignment of the returned address
+ * @sizep:	returns the size of the block
+ * Return:	offset of the memory for the caller, or 0 if there is no space
+ */
+static ulong alloc_block(size_t bytes, ulong align, ulong *sizep)
+{
+	ulong body = ALIGN(bytes, HDR_SIZE);
+	struct simple_free *blk, *prev = NULL;
+	ulong offset, user, size, link;
+	struct simple_hdr *hdr;
+
+	align = max(align, (ulong)HDR_SIZE);
+	check_free_list();
+	for (link = gd->malloc_free; link; prev = blk, link = blk->next) {
+		offset = link - 1;
+		blk = free_at(offset);
+		user = ALIGN(gd->malloc_base + offset + HDR_SIZE, align) -
+			gd->malloc_base;
+		size = user + body - offset;
+		if (size > blk->size)
+			continue;
+
+		if (blk->size - size >= MIN_FREE) {
+			struct simple_free *rest = free_at(offset + size);
+
+			rest->size = blk->size - size;
+			rest->next = blk->next;
+			link = offset + size + 1;
+		} else {
+			size = blk->size;
+			link = blk->next;
+		}
+		if (prev)
+			prev->next = link;
+		else
+			gd->malloc_free = link;
+		goto found;
+	}
+
+	offset = gd->malloc_ptr;
+	user = ALIGN(gd->malloc_base + offset + HDR_SIZE, align) -
+		gd->malloc_base;
+	size = user + body - offset;
+	if (user + body > gd->malloc_limit)
+		return 0;
+	gd->malloc_ptr = user + body;
+	gd->malloc_peak = max(gd->malloc_peak, gd->malloc_ptr);
+
+found:
+	hdr = pool_ptr(user - HDR_SIZE, HDR_SIZE);
+	hdr->size = size;
+	hdr->lead = user - HDR_SIZE - offset;
+	*sizep = size;
+
+	return user;
+}
+
+/**
+ * free_block() - free a block, merging it with its free neighbours
+ *
+ * @offset:	offset of the block
+ * @size:	size of the block
+ */
+static void free_block(ulong offset, ulong size)
+{
+	struct simple_free *blk, *prev = NULL, *pprev = NULL;
+	ulong link, prev_offset = 0;
+
+	check_free_list();
+	for (link = gd->malloc_free; link && link - 1 < offset;
+	     link = prev->next) {
+		pprev = prev;
+		prev_offset = link - 1;
+		prev = free_at(prev_offset);
+	}
+
+	/* Take a bordering block out of the list and merge it */
+	if (prev && prev_offset + prev->size == offset) {
+		offset = prev_offset;
+		size += prev->size;
+		prev = pprev;
+	}
+	if (link && offset + size == link - 1) {
+		blk = free_at(link - 1);
+		size += blk->size;
+		link = blk->next;
+	}
+
+	/* A block at the end goes back to the unused part of the pool */
+	if (offset + size == gd->malloc_ptr) {
+		gd->malloc_ptr = offset;
+	} else {
+		blk = free_at(offset);
+		blk->size = size;
+		blk->next = link;
+		link = offset + 1;
+	}
+	if (prev)
+		prev->next = link;
+	else
+		gd->malloc_free = link;
+}
+#endif
+
+static void *alloc_simple(size_t bytes, int align, void *caller)
 {
-	ulong addr, new_ptr;
+	ulong addr, size;
+	__maybe_unused ulong new_ptr;
 	void *ptr;
 
+	if (reserve_callers())
+		goto err;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
+	addr = alloc_block(bytes, align, &size);
+	log_debug("size=%lx, ptr=%lx, limit=%lx: ", (ulong)bytes,
+		  gd->malloc_ptr, gd->malloc_limit);
+	if (!addr)
+		goto err;
+	addr += gd->malloc_base;
+#else
 	addr = ALIGN(gd->malloc_base + gd->malloc_ptr, align);
 	new_ptr = addr + bytes - gd->malloc_base;
 	log_debug("size=%lx, ptr=%lx, limit=%lx: ", (ulong)bytes, new_ptr,
 		  gd->malloc_limit);
-	if (new_ptr > gd->malloc_limit) {
-		log_err("alloc space exhausted\n");
-		return NULL;
-	}
+	if (new_ptr > gd->malloc_limit)
+		goto err;
 
-	ptr = map_sysmem(addr, bytes);
+	size = ALIGN(new_ptr, sizeof(new_ptr)) - gd->malloc_ptr;
 	gd->malloc_ptr = ALIGN(new_ptr, sizeof(new_ptr));
+#endif
+	count_caller(size, caller);
+	ptr = map_sysmem(addr, bytes);
 
 	return ptr;
+
+err:
+	log_err("alloc space exhausted\n");
+	return NULL;
 }
 
-void *malloc_simple(size_t bytes)
+void *malloc_simple_from(size_t bytes, void *caller)
 {
 	void *ptr;
 
-	ptr = alloc_simple(bytes, 1);
+	ptr = alloc_simple(bytes, 1, caller);
 	if (!ptr)
 		return ptr;
 
@@ -51,11 +281,16 @@ void *malloc_simple(size_t bytes)
 	return ptr;
 }
 
-void *memalign_simple(size_t align, size_t bytes)
+void *malloc_simple(size_t bytes)
+{
+	return malloc_simple_from(bytes, __builtin_return_address(0));
+}
+
+void *memalign_simple_from(size_t align, size_t bytes, void *caller)
 {
 	void *ptr;
 
-	ptr = alloc_simple(bytes, align);
+	ptr = alloc_simple(bytes, align, caller);
 	if (!ptr)
 		return ptr;
 	log_debug("aligned to %lx\n", (ulong)ptr);
@@ -64,30 +299,102 @@ void *memalign_simple(size_t align, size_t bytes)
 	return ptr;
 }
 
+void *memalign_simple(size_t align, size_t bytes)
+{
+	return memalign_simple_from(align, bytes, __builtin_return_address(0));
+}
+
+void free_simple(void *ptr)
+{
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
+	struct simple_hdr *hdr;
+	ulong user, offset;
+
+	if (!ptr)
+		return;
+	user = map_to_sysmem(ptr) - gd->malloc_base;
+	/* Ignore memory which is not from the current pool */
+	if (user < HDR_SIZE || user > gd->malloc_ptr)
+		return;
+	hdr = pool_ptr(user - HDR_SIZE, HDR_SIZE);
+	if (hdr->lead > user - HDR_SIZE)
+		return;
+	offset = user - HDR_SIZE - hdr->lead;
+	if (offset + hdr->size > gd->malloc_ptr)
+		return;
+	free_block(offset, hdr->size);
+#endif
+	VALGRIND_FREELIKE_BLOCK(ptr, 0);
+}
+
 #if CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)
 void *calloc(size_t nmemb, size_t elem_size)
 {
 	size_t size = nmemb * elem_size;
 	void *ptr;
 
-	ptr = malloc(size);
+	ptr = malloc_simple_from(size, __builtin_return_address(0));
 	if (!ptr)
 		return ptr;
 	memset(ptr, '\0', size);
 
 	return ptr;
 }
+#endif
 
-#if IS_ENABLED(CONFIG_VALGRIND)
-void free_simple(void *ptr)
+ulong malloc_simple_avail(void)
 {
-	VALGRIND_FREELIKE_BLOCK(ptr, 0);
+	ulong ptr = gd->malloc_ptr;
+
+	/* The first allocation sets up the table of callers */
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_F_STATS) && !ptr)
+		ptr = sizeof(struct simple_caller) * SIMPLE_CALLERS;
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE))
+		ptr = ALIGN(gd->malloc_base + ptr + HDR_SIZE, HDR_SIZE) -
+			gd->malloc_base;
+	if (ptr >= gd->malloc_limit)
+		return 0;
+
+	/* Blocks are a multiple of the header size with SYS_MALLOC_F_FREE */
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE))
+		return (gd->malloc_limit - ptr) & ~(HDR_SIZE - 1);
+
+	return gd->malloc_limit - ptr;
 }
-#endif
-#endif
 
 void malloc_simple_info(void)
 {
 	log_info("malloc_simple: %lx bytes used, %lx remain\n", gd->malloc_ptr,
-		 CONFIG_VAL(SYS_MALLOC_F_LEN) - gd->malloc_ptr);
+		 malloc_simple_avail());
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
+	{
+		ulong link, free = 0;
+		struct simple_free *blk;
+
+		check_free_list();
+		for (link = gd->malloc_free; link; link = blk->next) {
+			blk = free_at(link - 1);
+			free += blk->size;
+		}
+		log_info("malloc_simple: %lx bytes peak, %lx free below top\n",
+			 gd->malloc_peak, free);
+	}
+#endif
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_F_STATS) && gd->malloc_ptr) {
+		struct simple_caller *tab;
+		int i;
+
+		tab = pool_ptr(0, sizeof(*tab) * SIMPLE_CALLERS);
+		for (i = 0; i < SIMPLE_CALLERS; i++) {
+			if (!tab[i].count)
+				continue;
+			if (i == SIMPLE_CALLERS - 1)
+				log_info("  others: %x bytes in %u calls\n",
+					 tab[i].bytes, tab[i].count);
+			else
+				log_info("  %08lx: %x bytes in %u calls\n",
+					 tab[i].caller, tab[i].bytes,
+					 tab[i].count);
+		}
+	}
 }
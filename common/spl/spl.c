@@ -532,6 +532,9 @@ static int spl_common_init(bool setup_malloc)
 #endif
 		gd->malloc_limit = CONFIG_VAL(SYS_MALLOC_F_LEN);
 		gd->malloc_ptr = 0;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
+		gd->malloc_peak = 0;
+#endif
 	}
 #endif
 	ret = bootstage_init(u_boot_first_phase());
@@ -881,8 +884,13 @@ void board_init_r(gd_t *dummy1, ulong dummy2)
 		debug("Unsupported OS image.. Jumping nevertheless..\n");
 	}
 #if CONFIG_VAL(SYS_MALLOC_F_LEN) && !defined(CONFIG_SYS_SPL_MALLOC_SIZE)
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
+	debug("SPL malloc() used 0x%lx bytes (%ld KB)\n", gd->malloc_peak,
+	      gd->malloc_peak / 1024);
+#else
 	debug("SPL malloc() used 0x%lx bytes (%ld KB)\n", gd->malloc_ptr,
 	      gd->malloc_ptr / 1024);
+#endif
 #endif
 	bootstage_mark_name(get_bootstage_id(false), "end phase");
 #ifdef CONFIG_BOOTSTAGE_STASH
@@ -970,12 +978,20 @@ ulong spl_relocate_stack_gd(void)
 
 #if defined(CONFIG_SPL_SYS_MALLOC_SIMPLE) && CONFIG_VAL(SYS_MALLOC_F_LEN)
 	if (CONFIG_SPL_STACK_R_MALLOC_SIMPLE_LEN) {
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
+		debug("SPL malloc() before relocation used 0x%lx bytes (%ld KB)\n",
+		      gd->malloc_peak, gd->malloc_peak / 1024);
+#else
 		debug("SPL malloc() before relocation used 0x%lx bytes (%ld KB)\n",
 		      gd->malloc_ptr, gd->malloc_ptr / 1024);
+#endif
 		ptr -= CONFIG_SPL_STACK_R_MALLOC_SIMPLE_LEN;
 		gd->malloc_base = ptr;
 		gd->malloc_limit = CONFIG_SPL_STACK_R_MALLOC_SIMPLE_LEN;
 		gd->malloc_ptr = 0;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
+		gd->malloc_peak = 0;
+#endif
 	}
 #endif
 	/* Get stack position: use 8-byte alignment for ABI compliance */
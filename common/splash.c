@@ -150,6 +150,7 @@ void splash_display_banner(void)
 	vidconsole_position_cursor(dev, col, 1);
 	vidconsole_put_string(dev, buf);
 	vidconsole_position_cursor(dev, 0, row);
+	video_sync(dev->parent, false);
 }
 #endif /* CONFIG_VIDEO && !CONFIG_HIDE_LOGO_VERSION */
 
@@ -29,6 +29,9 @@ struct block_cache_node {
 
 static LIST_HEAD(block_cache);
 
+/* Read-ahead window, see blkcache_fill_window() */
+static struct block_cache_node *window;
+
 static struct block_cache_stats _stats = {
 	.max_blocks_per_entry = 8,
 	.max_entries = 32
@@ -68,12 +71,28 @@ static struct block_cache_node *cache_find(int iftype, int devnum,
 	return 0;
 }
 
+static struct block_cache_node *window_find(int iftype, int devnum,
+					    lbaint_t start, lbaint_t blkcnt,
+					    unsigned long blksz)
+{
+	if (window &&
+	    (window->iftype == iftype) &&
+	    (window->devnum == devnum) &&
+	    (window->blksz == blksz) &&
+	    (window->start <= start) &&
+	    (window->start + window->blkcnt >= start + blkcnt))
+		return window;
+	return 0;
+}
+
 int blkcache_read(int iftype, int devnum,
 		  lbaint_t start, lbaint_t blkcnt,
 		  unsigned long blksz, void *buffer)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
+	struct block_cache_node *node = window_find(iftype, devnum, start,
+						    blkcnt, blksz);
+	if (!node)
+		node = cache_find(iftype, devnum, start, blkcnt, blksz);
 	if (node) {
 		const char *src = node->cache + (start - node->start) * blksz;
 		memcpy(buffer, src, blksz * blkcnt);
@@ -143,11 +162,44 @@ void blkcache_fill(int iftype, int devnum,
 	_stats.entries++;
 }
 
+int blkcache_fill_window(int iftype, int devnum,
+			 lbaint_t start, lbaint_t blkcnt,
+			 unsigned long blksz, void *buffer)
+{
+	if (!window) {
+		window = malloc(sizeof(*window));
+		if (!window)
+			return -ENOMEM;
+	} else {
+		free(window->cache);
+	}
+
+	debug("window: start " LBAF ", count " LBAFU "\n",
+	      start, blkcnt);
+
+	window->iftype = iftype;
+	window->devnum = devnum;
+	window->start = start;
+	window->blkcnt = blkcnt;
+	window->blksz = blksz;
+	window->cache = buffer;
+
+	return 0;
+}
+
 void blkcache_invalidate(int iftype, int devnum)
 {
 	struct list_head *entry, *n;
 	struct block_cache_node *node;
 
+	if (window && (iftype == -1 ||
+		       (window->iftype == iftype &&
+			window->devnum == devnum))) {
+		free(window->cache);
+		free(window);
+		window = NULL;
+	}
+
 	list_for_each_safe(entry, n, &block_cache) {
 		node = (struct block_cache_node *)entry;
 		if (iftype == -1 ||
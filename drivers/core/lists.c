@@ -11,6 +11,8 @@
 #include <common.h>
 #include <errno.h>
 #include <log.h>
+#include <malloc.h>
+#include <asm/global_data.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -19,6 +21,9 @@
 #include <dm/util.h>
 #include <fdtdec.h>
 #include <linux/compiler.h>
+#include <linux/log2.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -181,11 +186,149 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   struct driver *drv, bool pre_reloc_only)
+#if CONFIG_IS_ENABLED(DM_COMPAT_HASH)
+/**
+ * struct lists_compat_entry - a compatible string of a driver
+ *
+ * @compat:	compatible string
+ * @drv:	driver which has @compat in its of_match list
+ * @id:		entry of the of_match list
+ * @next:	position of the next entry in the same bucket, -1 if none
+ */
+struct lists_compat_entry {
+	const char *compat;
+	struct driver *drv;
+	const struct udevice_id *id;
+	int next;
+};
+
+/**
+ * struct lists_compat - hash table of the compatible strings of all drivers
+ *
+ * Each bucket lists its entries in the order of the driver linker list, so
+ * that the first match is the same as with a walk over all drivers.
+ *
+ * @bits:	number of bits of the hash
+ * @bucket:	position of the first entry of each bucket, -1 if empty
+ * @entry:	all compatible strings
+ */
+struct lists_compat {
+	uint bits;
+	int *bucket;
+	struct lists_compat_entry entry[];
+};
+
+static uint lists_compat_hash(const char *compat, uint bits)
+{
+	u32 hash = 2166136261;
+
+	/* FNV-1a, then the multiplication mixes the bits into the top */
+	while (*compat)
+		hash = (hash ^ (u8)*compat++) * 16777619;
+
+	return (hash * 0x61c88647) >> (32 - bits);
+}
+
+/**
+ * lists_compat_build() - build the compatible string hash table
+ *
+ * Return: table, or NULL if there is not enough memory
+ */
+static struct lists_compat *lists_compat_build(void)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct lists_compat *tbl;
+	struct driver *entry;
+	int count = 0, i, n;
+	uint bits, hash;
+	size_t size;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++)
+			count++;
+	}
+	bits = max(order_base_2(count), 4);
+	size = sizeof(*tbl) + count * sizeof(tbl->entry[0]) +
+	       (1 << bits) * sizeof(int);
+	tbl = dm_alloc_optional(size);
+	if (!tbl)
+		return NULL;
+	tbl->bits = bits;
+	tbl->bucket = (int *)&tbl->entry[count];
+	memset(tbl->bucket, 0xff, (1 << bits) * sizeof(int));
+
+	/* Add in reverse, so that each bucket ends up in list order */
+	i = count;
+	for (entry = driver + n_ents; entry-- != driver;) {
+		for (n = 0, id = entry->of_match; id && id->compatible; id++)
+			n++;
+		while (n--) {
+			struct lists_compat_entry *ent = &tbl->entry[--i];
+
+			ent->compat = entry->of_match[n].compatible;
+			ent->drv = entry;
+			ent->id = &entry->of_match[n];
+			hash = lists_compat_hash(ent->compat, bits);
+			ent->next = tbl->bucket[hash];
+			tbl->bucket[hash] = i;
+		}
+	}
+	log_debug("%d compatible strings in %d buckets\n", count, 1 << bits);
+
+	return tbl;
+}
+
+void lists_compat_reset(void)
+{
+	free(gd->dm_compat);
+	gd->dm_compat = NULL;
+}
+#endif
+
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+
+#if CONFIG_IS_ENABLED(DM_COMPAT_HASH)
+	struct lists_compat *tbl = gd->dm_compat;
+
+	if (!tbl)
+		tbl = gd->dm_compat = lists_compat_build();
+	if (tbl) {
+		int i = tbl->bucket[lists_compat_hash(compat, tbl->bits)];
+
+		for (; i != -1; i = tbl->entry[i].next) {
+			if (!strcmp(tbl->entry[i].compat, compat)) {
+				*idp = tbl->entry[i].id;
+				return tbl->entry[i].drv;
+			}
+		}
+
+		return NULL;
+	}
+#endif
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		const struct udevice_id *id;
+
+		for (id = entry->of_match; id && id->compatible; id++) {
+			if (!strcmp(id->compatible, compat)) {
+				*idp = id;
+				return entry;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   struct driver *drv, bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -223,19 +366,18 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 			  compat);
 
 		id = NULL;
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			if (drv) {
-				if (drv != entry)
-					continue;
-				if (!entry->of_match)
-					break;
-			}
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
+		if (drv) {
+			entry = drv;
+			/* A driver without a match list binds to any node */
+			ret = 0;
+			if (entry->of_match)
+				ret = driver_check_compatible(entry->of_match,
+							      &id, compat);
+		} else {
+			entry = lists_driver_lookup_compat(compat, &id);
+			ret = entry ? 0 : -ENOENT;
 		}
-		if (entry == driver + n_ents)
+		if (ret)
 			continue;
 
 		if (pre_reloc_only) {
@@ -26,6 +26,7 @@
 #include <linux/bug.h>
 #include <linux/libfdt.h>
 #include <dm/of_access.h>
+#include <dm/of_index.h>
 #include <linux/ctype.h>
 #include <linux/err.h>
 #include <linux/ioport.h>
@@ -453,9 +454,12 @@ struct device_node *of_find_node_by_phandle(struct device_node *root,
 	if (!handle)
 		return NULL;
 
-	for_each_of_allnodes_from(root, np)
-		if (np->phandle == handle)
-			break;
+	np = of_index_find_node_by_phandle(root, handle);
+	if (!np) {
+		for_each_of_allnodes_from(root, np)
+			if (np->phandle == handle)
+				break;
+	}
 	(void)of_node_get(np);
 
 	return np;
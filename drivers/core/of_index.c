@@ -0,0 +1,362 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Index of the control devicetree
+ *
+ * Finding a node by phandle scans the whole tree and reading a property
+ * walks all properties of the node. Both happen many times while devices are
+ * bound and probed, also before relocation. A single walk over the tree at
+ * dm_init() records the node of each phandle and, for a flat tree, where the
+ * most frequently read properties of each node are.
+ */
+
+#define LOG_CATEGORY	LOGC_DT
+
+#include <common.h>
+#include <log.h>
+#include <malloc.h>
+#include <asm/global_data.h>
+#include <dm/of.h>
+#include <dm/of_access.h>
+#include <dm/of_index.h>
+#include <dm/util.h>
+#include <linux/libfdt.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Larger phandles are not indexed, to bound the size of the table */
+#define OF_INDEX_MAX_PHANDLE	0x10000
+
+/* Properties whose location is recorded for each node of a flat tree */
+enum of_index_prop {
+	OF_INDEX_COMPATIBLE,
+	OF_INDEX_STATUS,
+	OF_INDEX_REG,
+	OF_INDEX_CLOCKS,
+
+	OF_INDEX_PROPS,
+};
+
+static const char *const of_index_prop_names[OF_INDEX_PROPS] = {
+	[OF_INDEX_COMPATIBLE]	= "compatible",
+	[OF_INDEX_STATUS]	= "status",
+	[OF_INDEX_REG]		= "reg",
+	[OF_INDEX_CLOCKS]	= "clocks",
+};
+
+/**
+ * struct of_index - index of the control devicetree
+ *
+ * @blob:	flat tree which is indexed, NULL for a live tree
+ * @size_struct: size of the structure block of @blob when it was indexed,
+ *		which changes when nodes or properties are added or removed
+ * @root:	live tree which is indexed, NULL for a flat tree
+ * @complete:	all phandles of the tree are in the table
+ * @max_phandle: largest phandle in the table
+ * @phandle_offset: offset of the node with each phandle, -1 if none
+ * @phandle_np:	node with each phandle in the live tree
+ * @node_count:	number of entries in @node_offset
+ * @node_offset: offsets of all nodes of @blob, ascending
+ * @prop_offset: offsets of the properties in of_index_prop_names for each
+ *		node in @node_offset, -1 if the node does not have it
+ * @last:	position in @node_offset of the node last looked up
+ */
+struct of_index {
+	const void *blob;
+	int size_struct;
+	struct device_node *root;
+	bool complete;
+	u32 max_phandle;
+	int *phandle_offset;
+	struct device_node **phandle_np;
+	int node_count;
+	int *node_offset;
+	int *prop_offset;
+	int last;
+};
+
+static int of_index_build_flat(const void *blob)
+{
+	struct of_index *idx;
+	int count, offset, prop, i, k;
+	bool complete = true;
+	u32 phandle, max = 0;
+	size_t size;
+
+	count = 0;
+	for (offset = 0; offset >= 0; offset = fdt_next_node(blob, offset,
+							      NULL)) {
+		phandle = fdt_get_phandle(blob, offset);
+		if (phandle > OF_INDEX_MAX_PHANDLE)
+			complete = false;
+		else if (phandle > max)
+			max = phandle;
+		count++;
+	}
+
+	size = sizeof(*idx) + (max + 1 + count +
+			       count * OF_INDEX_PROPS) * sizeof(int);
+	idx = dm_alloc_optional(size);
+	if (!idx)
+		return -ENOMEM;
+	idx->blob = blob;
+	idx->size_struct = fdt_size_dt_struct(blob);
+	idx->complete = complete;
+	idx->max_phandle = max;
+	idx->phandle_offset = (int *)(idx + 1);
+	idx->node_offset = idx->phandle_offset + max + 1;
+	idx->prop_offset = idx->node_offset + count;
+	memset(idx->phandle_offset, 0xff, (max + 1) * sizeof(int));
+	memset(idx->prop_offset, 0xff, count * OF_INDEX_PROPS * sizeof(int));
+
+	i = 0;
+	for (offset = 0; offset >= 0 && i < count;
+	     offset = fdt_next_node(blob, offset, NULL), i++) {
+		int *props = &idx->prop_offset[i * OF_INDEX_PROPS];
+
+		idx->node_offset[i] = offset;
+		phandle = fdt_get_phandle(blob, offset);
+		/* Like fdt_node_offset_by_phandle(), the first node wins */
+		if (phandle && phandle <= max &&
+		    idx->phandle_offset[phandle] < 0)
+			idx->phandle_offset[phandle] = offset;
+
+		fdt_for_each_property_offset(prop, blob, offset) {
+			const char *name;
+
+			if (!fdt_getprop_by_offset(blob, prop, &name, NULL))
+				continue;
+			for (k = 0; k < OF_INDEX_PROPS; k++) {
+				if (props[k] < 0 &&
+				    !strcmp(name, of_index_prop_names[k])) {
+					props[k] = prop;
+					break;
+				}
+			}
+		}
+	}
+	idx->node_count = i;
+	gd->of_index = idx;
+	log_debug("indexed %d nodes, %u phandles\n", count, max);
+
+	return 0;
+}
+
+static int of_index_build_live(struct device_node *root)
+{
+	struct of_index *idx;
+	struct device_node *np;
+	bool complete = true;
+	u32 max = 0;
+
+	for_each_of_allnodes_from(root, np) {
+		if (np->phandle > OF_INDEX_MAX_PHANDLE)
+			complete = false;
+		else if (np->phandle > max)
+			max = np->phandle;
+	}
+
+	idx = dm_alloc_optional(sizeof(*idx) + (max + 1) * sizeof(np));
+	if (!idx)
+		return -ENOMEM;
+	idx->root = root;
+	idx->complete = complete;
+	idx->max_phandle = max;
+	idx->phandle_np = (struct device_node **)(idx + 1);
+	/* Like of_find_node_by_phandle(), the first node wins */
+	for_each_of_allnodes_from(root, np) {
+		if (np->phandle && np->phandle <= max &&
+		    !idx->phandle_np[np->phandle])
+			idx->phandle_np[np->phandle] = np;
+	}
+	gd->of_index = idx;
+	log_debug("indexed %u phandles\n", max);
+
+	return 0;
+}
+
+int of_index_init(void)
+{
+	free(gd->of_index);
+	gd->of_index = NULL;
+
+	if (of_live_active())
+		return of_index_build_live(gd_of_root());
+	if (!gd->fdt_blob)
+		return 0;
+
+	return of_index_build_flat(gd->fdt_blob);
+}
+
+void of_index_drop(const void *blob)
+{
+	struct of_index *idx = gd->of_index;
+
+	if (idx && idx->blob == blob) {
+		free(idx);
+		gd->of_index = NULL;
+	}
+}
+
+/**
+ * of_index_prop_in_node() - check that a property belongs to a node
+ *
+ * Writes which move some properties forward and others back keep the size
+ * of the tree, so the index may point to a property of another node with
+ * the same name. This walks the tags of the node, which is much cheaper
+ * than comparing property names.
+ *
+ * @blob:	flat tree
+ * @offset:	offset of the node
+ * @prop:	offset of the property
+ * Return:	true if @prop is a property of the node at @offset
+ */
+static bool of_index_prop_in_node(const void *blob, int offset, int prop)
+{
+	int pos;
+
+	fdt_for_each_property_offset(pos, blob, offset) {
+		if (pos >= prop)
+			return pos == prop;
+	}
+
+	return false;
+}
+
+/**
+ * of_index_flat() - get the index for a flat tree
+ *
+ * @blob:	flat tree
+ * Return:	index, or NULL if @blob is not indexed or was changed since
+ */
+static struct of_index *of_index_flat(const void *blob)
+{
+	struct of_index *idx = gd->of_index;
+
+	if (!idx || idx->blob != blob ||
+	    fdt_size_dt_struct(blob) != idx->size_struct)
+		return NULL;
+
+	return idx;
+}
+
+static int of_index_prop_id(const char *name)
+{
+	int k;
+
+	/* Keep other property names cheap */
+	switch (*name) {
+	case 'c':
+	case 'r':
+	case 's':
+		break;
+	default:
+		return -1;
+	}
+	for (k = 0; k < OF_INDEX_PROPS; k++) {
+		if (!strcmp(name, of_index_prop_names[k]))
+			return k;
+	}
+
+	return -1;
+}
+
+/**
+ * of_index_find_node() - get the position of a node in the index
+ *
+ * Several properties of a node are usually read in a row, so the last
+ * node is checked before searching.
+ *
+ * @idx:	index of a flat tree
+ * @offset:	offset of the node
+ * Return:	position in @idx->node_offset, or -1 if not found
+ */
+static int of_index_find_node(struct of_index *idx, int offset)
+{
+	int lo = 0, hi = idx->node_count;
+
+	if (idx->node_offset[idx->last] == offset)
+		return idx->last;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (idx->node_offset[mid] < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == idx->node_count || idx->node_offset[lo] != offset)
+		return -1;
+	idx->last = lo;
+
+	return lo;
+}
+
+const void *of_index_getprop(const void *blob, int offset, const char *name,
+			     int *lenp)
+{
+	struct of_index *idx = of_index_flat(blob);
+	const char *pname;
+	const void *val;
+	int id, pos, prop;
+
+	if (!idx)
+		goto fallback;
+	id = of_index_prop_id(name);
+	if (id < 0)
+		goto fallback;
+	pos = of_index_find_node(idx, offset);
+	if (pos < 0)
+		goto fallback;
+
+	prop = idx->prop_offset[pos * OF_INDEX_PROPS + id];
+	if (prop < 0) {
+		if (lenp)
+			*lenp = -FDT_ERR_NOTFOUND;
+		return NULL;
+	}
+	if (!of_index_prop_in_node(blob, offset, prop))
+		goto fallback;
+	val = fdt_getprop_by_offset(blob, prop, &pname, lenp);
+	/* Properties may have been replaced by others of the same size */
+	if (val && !strcmp(pname, name))
+		return val;
+
+fallback:
+	return fdt_getprop(blob, offset, name, lenp);
+}
+
+int of_index_node_offset_by_phandle(const void *blob, u32 phandle)
+{
+	struct of_index *idx = of_index_flat(blob);
+	int offset;
+
+	if (!idx || !phandle || phandle == (u32)-1)
+		return fdt_node_offset_by_phandle(blob, phandle);
+	if (phandle > idx->max_phandle)
+		return idx->complete ? -FDT_ERR_NOTFOUND :
+			fdt_node_offset_by_phandle(blob, phandle);
+	offset = idx->phandle_offset[phandle];
+	if (offset < 0)
+		return -FDT_ERR_NOTFOUND;
+	if (fdt_get_phandle(blob, offset) != phandle)
+		return fdt_node_offset_by_phandle(blob, phandle);
+
+	return offset;
+}
+
+struct device_node *of_index_find_node_by_phandle(struct device_node *root,
+						  u32 phandle)
+{
+	struct of_index *idx = gd->of_index;
+	struct device_node *np;
+
+	if (!idx || !idx->root || idx->root != (root ?: gd_of_root()) ||
+	    phandle > idx->max_phandle)
+		return NULL;
+	np = idx->phandle_np[phandle];
+	/* Nodes may be added to a live tree, so check before trusting it */
+	if (!np || np->phandle != phandle)
+		return NULL;
+
+	return np;
+}
@@ -15,6 +15,7 @@
 #include <linux/libfdt.h>
 #include <dm/of_access.h>
 #include <dm/of_addr.h>
+#include <dm/of_index.h>
 #include <dm/ofnode.h>
 #include <linux/err.h>
 #include <linux/ioport.h>
@@ -224,8 +225,8 @@ int ofnode_read_u8(ofnode node, const char *propname, u8 *outp)
 	if (ofnode_is_np(node))
 		return of_read_u8(ofnode_to_np(node), propname, outp);
 
-	cell = fdt_getprop(gd->fdt_blob, ofnode_to_offset(node), propname,
-			   &len);
+	cell = of_index_getprop(gd->fdt_blob, ofnode_to_offset(node),
+				propname, &len);
 	if (!cell || len < sizeof(*cell)) {
 		debug("(not found)\n");
 		return -EINVAL;
@@ -255,8 +256,8 @@ int ofnode_read_u16(ofnode node, const char *propname, u16 *outp)
 	if (ofnode_is_np(node))
 		return of_read_u16(ofnode_to_np(node), propname, outp);
 
-	cell = fdt_getprop(gd->fdt_blob, ofnode_to_offset(node), propname,
-			   &len);
+	cell = of_index_getprop(gd->fdt_blob, ofnode_to_offset(node),
+				propname, &len);
 	if (!cell || len < sizeof(*cell)) {
 		debug("(not found)\n");
 		return -EINVAL;
@@ -301,8 +302,8 @@ int ofnode_read_u32_index(ofnode node, const char *propname, int index,
 		return of_read_u32_index(ofnode_to_np(node), propname, index,
 					 outp);
 
-	cell = fdt_getprop(ofnode_to_fdt(node), ofnode_to_offset(node),
-			   propname, &len);
+	cell = of_index_getprop(ofnode_to_fdt(node), ofnode_to_offset(node),
+				propname, &len);
 	if (!cell) {
 		debug("(not found)\n");
 		return -EINVAL;
@@ -347,8 +348,8 @@ int ofnode_read_u64(ofnode node, const char *propname, u64 *outp)
 	if (ofnode_is_np(node))
 		return of_read_u64(ofnode_to_np(node), propname, outp);
 
-	cell = fdt_getprop(ofnode_to_fdt(node), ofnode_to_offset(node),
-			   propname, &len);
+	cell = of_index_getprop(ofnode_to_fdt(node), ofnode_to_offset(node),
+				propname, &len);
 	if (!cell || len < sizeof(*cell)) {
 		debug("(not found)\n");
 		return -EINVAL;
@@ -399,8 +400,8 @@ const void *ofnode_read_prop(ofnode node, const char *propname, int *sizep)
 			len = prop->length;
 		}
 	} else {
-		val = fdt_getprop(ofnode_to_fdt(node), ofnode_to_offset(node),
-				  propname, &len);
+		val = of_index_getprop(ofnode_to_fdt(node),
+				       ofnode_to_offset(node), propname, &len);
 	}
 	if (!val) {
 		debug("<not found>\n");
@@ -586,8 +587,8 @@ ofnode ofnode_get_by_phandle(uint phandle)
 	if (of_live_active())
 		node = np_to_ofnode(of_find_node_by_phandle(NULL, phandle));
 	else
-		node.of_offset = fdt_node_offset_by_phandle(gd->fdt_blob,
-							    phandle);
+		node.of_offset = of_index_node_offset_by_phandle(gd->fdt_blob,
+								 phandle);
 
 	return node;
 }
@@ -600,8 +601,8 @@ ofnode oftree_get_by_phandle(oftree tree, uint phandle)
 		node = np_to_ofnode(of_find_node_by_phandle(tree.np, phandle));
 	else
 		node = ofnode_from_tree_offset(tree,
-			fdt_node_offset_by_phandle(oftree_lookup_fdt(tree),
-						   phandle));
+			of_index_node_offset_by_phandle(oftree_lookup_fdt(tree),
+							phandle));
 
 	return node;
 }
@@ -996,8 +997,9 @@ const void *ofnode_get_property(ofnode node, const char *propname, int *lenp)
 	if (ofnode_is_np(node))
 		return of_get_property(ofnode_to_np(node), propname, lenp);
 	else
-		return fdt_getprop(ofnode_to_fdt(node), ofnode_to_offset(node),
-				   propname, lenp);
+		return of_index_getprop(ofnode_to_fdt(node),
+					ofnode_to_offset(node), propname,
+					lenp);
 }
 
 int ofnode_first_property(ofnode node, struct ofprop *prop)
@@ -1406,6 +1408,7 @@ int ofnode_write_prop(ofnode node, const char *propname, const void *value,
 			free(newval);
 		return ret;
 	} else {
+		of_index_drop(ofnode_to_fdt(node));
 		return fdt_setprop(ofnode_to_fdt(node), ofnode_to_offset(node),
 				   propname, value, len);
 	}
@@ -1543,6 +1546,7 @@ int ofnode_add_subnode(ofnode node, const char *name, ofnode *subnodep)
 		int poffset = ofnode_to_offset(node);
 		int offset;
 
+		of_index_drop(fdt);
 		offset = fdt_add_subnode(fdt, poffset, name);
 		if (offset == -FDT_ERR_EXISTS) {
 			offset = fdt_subnode_offset(fdt, poffset, name);
@@ -9,6 +9,7 @@
 #define LOG_CATEGORY UCLASS_ROOT
 
 #include <common.h>
+#include <bootstage.h>
 #include <errno.h>
 #include <fdtdec.h>
 #include <log.h>
@@ -22,6 +23,7 @@
 #include <dm/lists.h>
 #include <dm/of.h>
 #include <dm/of_access.h>
+#include <dm/of_index.h>
 #include <dm/platdata.h>
 #include <dm/read.h>
 #include <dm/root.h>
@@ -187,6 +189,12 @@ int dm_init(bool of_live)
 		fix_devices();
 	}
 
+	/* The index is optional, lookups work without it */
+	ret = of_index_init();
+	if (ret)
+		log_debug("of_index_init() failed: %d\n", ret);
+	lists_compat_reset();
+
 	if (CONFIG_IS_ENABLED(OF_PLATDATA_INST)) {
 		ret = dm_setup_inst();
 		if (ret) {
@@ -428,7 +436,10 @@ int dm_init_and_scan(bool pre_reloc_only)
 		return ret;
 	}
 	if (!CONFIG_IS_ENABLED(OF_PLATDATA_INST)) {
+		int span = bootstage_span_begin("dm_scan", "dm");
+
 		ret = dm_scan(pre_reloc_only);
+		bootstage_span_end(span);
 		if (ret) {
 			log_debug("dm_scan() failed: %d\n", ret);
 			return ret;
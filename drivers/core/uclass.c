@@ -42,6 +42,217 @@ struct uclass *uclass_find(enum uclass_id key)
 	return NULL;
 }
 
+#if IS_ENABLED(CONFIG_UNIT_TEST)
+ulong uclass_find_compares;
+
+static inline void uclass_count_compare(void)
+{
+	uclass_find_compares++;
+}
+#else
+static inline void uclass_count_compare(void) {}
+#endif
+
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+/* Number of devices from which a uclass gets an index */
+#define UCLASS_INDEX_MIN	8
+/* Number of buckets in each hash table, as a power of two */
+#define UCLASS_INDEX_BITS	5
+
+/* Hash tables in struct uclass->index */
+enum uclass_index_table {
+	UCLASS_INDEX_SEQ,
+	UCLASS_INDEX_OFNODE,
+	UCLASS_INDEX_PHANDLE,
+
+	UCLASS_INDEX_COUNT,
+};
+
+/**
+ * uclass_index_head() - get the hash bucket for a key
+ *
+ * @uc:		uclass with an index
+ * @table:	hash table to use
+ * @key:	sequence number, ofnode or phandle
+ * Return:	bucket to search or add to
+ */
+static struct hlist_head *uclass_index_head(struct uclass *uc,
+					    enum uclass_index_table table,
+					    ulong key)
+{
+	uint hash = ((u32)key * 0x61c88647) >> (32 - UCLASS_INDEX_BITS);
+
+	return &uc->index[table << UCLASS_INDEX_BITS | hash];
+}
+
+static void uclass_index_add(struct uclass *uc, struct udevice *dev)
+{
+	ofnode node = dev_ofnode(dev);
+	int phandle;
+
+	if (dev->seq_ != -1)
+		hlist_add_head(&dev->seq_node,
+			       uclass_index_head(uc, UCLASS_INDEX_SEQ,
+						 dev->seq_));
+	if (!ofnode_valid(node))
+		return;
+	hlist_add_head(&dev->ofnode_node,
+		       uclass_index_head(uc, UCLASS_INDEX_OFNODE,
+					 node.of_offset));
+	phandle = dev_read_phandle(dev);
+	if (phandle > 0)
+		hlist_add_head(&dev->phandle_node,
+			       uclass_index_head(uc, UCLASS_INDEX_PHANDLE,
+						 phandle));
+}
+
+static void uclass_index_del(struct udevice *dev)
+{
+	hlist_del_init(&dev->seq_node);
+	hlist_del_init(&dev->ofnode_node);
+	hlist_del_init(&dev->phandle_node);
+}
+
+/**
+ * uclass_index_bind() - add a newly bound device to the index
+ *
+ * Small uclasses are searched by walking the list. The index is created when
+ * the uclass reaches UCLASS_INDEX_MIN devices. If that fails, lookups keep
+ * walking the list.
+ *
+ * @uc:		uclass of the device
+ * @dev:	device which was added to @uc->dev_head
+ */
+static void uclass_index_bind(struct uclass *uc, struct udevice *dev)
+{
+	struct udevice *pos;
+
+	uc->dev_count++;
+	if (uc->index) {
+		uclass_index_add(uc, dev);
+		return;
+	}
+	if (uc->dev_count < UCLASS_INDEX_MIN)
+		return;
+
+	uc->index = calloc(UCLASS_INDEX_COUNT << UCLASS_INDEX_BITS,
+			   sizeof(struct hlist_head));
+	if (!uc->index)
+		return;
+	uclass_foreach_dev(pos, uc)
+		uclass_index_add(uc, pos);
+}
+
+static void uclass_index_unbind(struct uclass *uc, struct udevice *dev)
+{
+	uc->dev_count--;
+	uclass_index_del(dev);
+}
+
+void uclass_reindex_device(struct udevice *dev)
+{
+	struct uclass *uc = dev->uclass;
+
+	if (!uc->index)
+		return;
+	uclass_index_del(dev);
+	uclass_index_add(uc, dev);
+}
+
+/*
+ * A uclass with an index holds every device in it under its current keys,
+ * so a miss is final. Code which changes the sequence number or ofnode of a
+ * bound device must call uclass_reindex_device().
+ *
+ * These return 0 and set *devp if found, -ENODEV if not, or -ENOSYS if the
+ * uclass has no index and its list must be walked.
+ */
+static int uclass_index_find_seq(struct uclass *uc, int seq,
+				 struct udevice **devp)
+{
+	struct udevice *dev;
+
+	if (!uc->index)
+		return -ENOSYS;
+	hlist_for_each_entry(dev, uclass_index_head(uc, UCLASS_INDEX_SEQ, seq),
+			     seq_node) {
+		uclass_count_compare();
+		if (dev->seq_ == seq) {
+			*devp = dev;
+			return 0;
+		}
+	}
+
+	return -ENODEV;
+}
+
+static int uclass_index_find_ofnode(struct uclass *uc, ofnode node,
+				    struct udevice **devp)
+{
+	struct udevice *dev;
+
+	if (!uc->index)
+		return -ENOSYS;
+	hlist_for_each_entry(dev, uclass_index_head(uc, UCLASS_INDEX_OFNODE,
+						    node.of_offset),
+			     ofnode_node) {
+		uclass_count_compare();
+		if (ofnode_equal(dev_ofnode(dev), node)) {
+			*devp = dev;
+			return 0;
+		}
+	}
+
+	return -ENODEV;
+}
+
+static int uclass_index_find_phandle(struct uclass *uc, uint phandle,
+				     struct udevice **devp)
+{
+	struct udevice *dev;
+
+	if (!uc->index)
+		return -ENOSYS;
+	hlist_for_each_entry(dev, uclass_index_head(uc, UCLASS_INDEX_PHANDLE,
+						    phandle),
+			     phandle_node) {
+		uclass_count_compare();
+		if (dev_read_phandle(dev) == phandle) {
+			*devp = dev;
+			return 0;
+		}
+	}
+
+	return -ENODEV;
+}
+#else
+static inline void uclass_index_bind(struct uclass *uc, struct udevice *dev)
+{
+}
+
+static inline void uclass_index_unbind(struct uclass *uc, struct udevice *dev)
+{
+}
+
+static inline int uclass_index_find_seq(struct uclass *uc, int seq,
+					struct udevice **devp)
+{
+	return -ENOSYS;
+}
+
+static inline int uclass_index_find_ofnode(struct uclass *uc, ofnode node,
+					   struct udevice **devp)
+{
+	return -ENOSYS;
+}
+
+static inline int uclass_index_find_phandle(struct uclass *uc, uint phandle,
+					    struct udevice **devp)
+{
+	return -ENOSYS;
+}
+#endif
+
 /**
  * uclass_add() - Create new uclass in list
  * @id: Id number to create
@@ -137,6 +348,9 @@ int uclass_destroy(struct uclass *uc)
 	list_del(&uc->sibling_node);
 	if (uc_drv->priv_auto)
 		free(uclass_get_priv(uc));
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	free(uc->index);
+#endif
 	free(uc);
 
 	return 0;
@@ -342,8 +556,12 @@ int uclass_find_device_by_seq(enum uclass_id id, int seq, struct udevice **devp)
 	if (ret)
 		return ret;
 
+	ret = uclass_index_find_seq(uc, seq, devp);
+	if (ret != -ENOSYS)
+		return ret;
 	uclass_foreach_dev(dev, uc) {
 		log_debug("   - %d '%s'\n", dev->seq_, dev->name);
+		uclass_count_compare();
 		if (dev->seq_ == seq) {
 			*devp = dev;
 			log_debug("   - found\n");
@@ -394,9 +612,14 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 	if (ret)
 		return ret;
 
+	ret = uclass_index_find_ofnode(uc, node, devp);
+	if (ret != -ENOSYS)
+		goto done;
+	ret = 0;
 	uclass_foreach_dev(dev, uc) {
 		log(LOGC_DM, LOGL_DEBUG_CONTENT, "      - checking %s\n",
 		    dev->name);
+		uclass_count_compare();
 		if (ofnode_equal(dev_ofnode(dev), node)) {
 			*devp = dev;
 			goto done;
@@ -414,25 +637,40 @@ done:
 int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
 				  const char *name, struct udevice **devp)
 {
-	struct udevice *dev;
-	struct uclass *uc;
 	int find_phandle;
-	int ret;
 
 	*devp = NULL;
 	find_phandle = dev_read_u32_default(parent, name, -1);
 	if (find_phandle <= 0)
 		return -ENOENT;
+
+	return uclass_find_device_by_phandle_id(id, find_phandle, devp);
+}
+#endif
+
+#if CONFIG_IS_ENABLED(OF_CONTROL)
+int uclass_find_device_by_phandle_id(enum uclass_id id, uint phandle_id,
+				     struct udevice **devp)
+{
+	struct udevice *dev;
+	struct uclass *uc;
+	int ret;
+
+	*devp = NULL;
 	ret = uclass_get(id, &uc);
 	if (ret)
 		return ret;
 
+	ret = uclass_index_find_phandle(uc, phandle_id, devp);
+	if (ret != -ENOSYS)
+		return ret;
 	uclass_foreach_dev(dev, uc) {
 		uint phandle;
 
+		uclass_count_compare();
 		phandle = dev_read_phandle(dev);
 
-		if (phandle == find_phandle) {
+		if (phandle == phandle_id) {
 			*devp = dev;
 			return 0;
 		}
@@ -540,26 +778,11 @@ int uclass_get_device_by_phandle_id(enum uclass_id id, uint phandle_id,
 				    struct udevice **devp)
 {
 	struct udevice *dev;
-	struct uclass *uc;
 	int ret;
 
 	*devp = NULL;
-	ret = uclass_get(id, &uc);
-	if (ret)
-		return ret;
-
-	uclass_foreach_dev(dev, uc) {
-		uint phandle;
-
-		phandle = dev_read_phandle(dev);
-
-		if (phandle == phandle_id) {
-			*devp = dev;
-			return uclass_get_device_tail(dev, ret, devp);
-		}
-	}
-
-	return -ENODEV;
+	ret = uclass_find_device_by_phandle_id(id, phandle_id, &dev);
+	return uclass_get_device_tail(dev, ret, devp);
 }
 
 int uclass_get_device_by_phandle(enum uclass_id id, struct udevice *parent,
@@ -694,6 +917,7 @@ int uclass_bind_device(struct udevice *dev)
 
 	uc = dev->uclass;
 	list_add_tail(&dev->uclass_node, &uc->dev_head);
+	uclass_index_bind(uc, dev);
 
 	if (dev->parent) {
 		struct uclass_driver *uc_drv = dev->parent->uclass->uc_drv;
@@ -708,6 +932,7 @@ int uclass_bind_device(struct udevice *dev)
 	return 0;
 err:
 	/* There is no need to undo the parent's post_bind call */
+	uclass_index_unbind(uc, dev);
 	list_del(&dev->uclass_node);
 
 	return ret;
@@ -731,6 +956,7 @@ int uclass_pre_unbind_device(struct udevice *dev)
 
 int uclass_unbind_device(struct udevice *dev)
 {
+	uclass_index_unbind(dev->uclass, dev);
 	list_del(&dev->uclass_node);
 
 	return 0;
@@ -4,6 +4,8 @@
  */
 
 #include <common.h>
+#include <malloc.h>
+#include <asm/global_data.h>
 #include <dm/device.h>
 #include <dm/ofnode.h>
 #include <dm/read.h>
@@ -11,6 +13,8 @@
 #include <linux/libfdt.h>
 #include <vsprintf.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 int list_count_items(struct list_head *head)
 {
 	struct list_head *node;
@@ -22,6 +26,17 @@ int list_count_items(struct list_head *head)
 	return count;
 }
 
+void *dm_alloc_optional(size_t size)
+{
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT) &&
+	    size > (gd->malloc_limit - gd->malloc_ptr) / 2)
+		return NULL;
+#endif
+
+	return calloc(1, size);
+}
+
 #if CONFIG_IS_ENABLED(OF_REAL)
 int pci_get_devfn(struct udevice *dev)
 {
@@ -128,6 +128,36 @@ int mmc_execute_tuning(struct mmc *mmc, uint opcode)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+static int dm_mmc_get_tuning(struct udevice *dev, void *buf, int size)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(dev);
+
+	if (!ops->get_tuning)
+		return -ENOSYS;
+	return ops->get_tuning(dev, buf, size);
+}
+
+int mmc_get_tuning(struct mmc *mmc, void *buf, int size)
+{
+	return dm_mmc_get_tuning(mmc->dev, buf, size);
+}
+
+static int dm_mmc_set_tuning(struct udevice *dev, const void *buf, int size)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(dev);
+
+	if (!ops->set_tuning)
+		return -ENOSYS;
+	return ops->set_tuning(dev, buf, size);
+}
+
+int mmc_set_tuning(struct mmc *mmc, const void *buf, int size)
+{
+	return dm_mmc_set_tuning(mmc->dev, buf, size);
+}
+#endif
+
 #if CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
 static int dm_mmc_set_enhanced_strobe(struct udevice *dev)
 {
@@ -360,7 +390,7 @@ void mmc_do_preinit(void)
 
 		m->user_speed_mode = MMC_MODES_END;  /* Initialising user set speed mode */
 
-		if (m->preinit)
+		if (m->preinit || CONFIG_IS_ENABLED(MMC_DEFERRED_INIT))
 			mmc_start_init(m);
 	}
 }
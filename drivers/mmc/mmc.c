@@ -10,8 +10,11 @@
 #include <config.h>
 #include <common.h>
 #include <blk.h>
+#include <bootstage.h>
 #include <command.h>
 #include <dm.h>
+#include <env.h>
+#include <hexdump.h>
 #include <log.h>
 #include <dm/device-internal.h>
 #include <errno.h>
@@ -24,8 +27,11 @@
 #include <memalign.h>
 #include <linux/list.h>
 #include <div64.h>
+#include <asm/global_data.h>
 #include "mmc_private.h"
 
+DECLARE_GLOBAL_DATA_PTR;
+
 #define DEFAULT_CMD6_TIMEOUT_MS  500
 
 static int mmc_set_signal_voltage(struct mmc *mmc, uint signal_voltage);
@@ -398,11 +404,35 @@ int mmc_send_tuning(struct mmc *mmc, u32 opcode, int *cmd_error)
 }
 #endif
 
+/**
+ * mmc_can_cmd23() - check if transfers can be pre-defined with CMD23
+ *
+ * @mmc:	MMC device
+ * Return:	true if the card and the host support SET_BLOCK_COUNT
+ */
+static bool mmc_can_cmd23(struct mmc *mmc)
+{
+	return mmc->card_caps & mmc->host_caps & MMC_CAP_CMD23;
+}
+
 static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 			   lbaint_t blkcnt)
 {
 	struct mmc_cmd cmd;
 	struct mmc_data data;
+	bool sbc = blkcnt > 1 && mmc_can_cmd23(mmc);
+
+	/*
+	 * A transfer with a pre-defined block count ends on its own, which
+	 * saves the STOP_TRANSMISSION command and its busy wait.
+	 */
+	if (sbc) {
+		cmd.cmdidx = MMC_CMD_SET_BLOCK_COUNT;
+		cmd.cmdarg = blkcnt;
+		cmd.resp_type = MMC_RSP_R1;
+		if (mmc_send_cmd(mmc, &cmd, NULL))
+			return 0;
+	}
 
 	if (blkcnt > 1)
 		cmd.cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
@@ -424,7 +454,7 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 	if (mmc_send_cmd(mmc, &cmd, &data))
 		return 0;
 
-	if (blkcnt > 1) {
+	if (blkcnt > 1 && !sbc) {
 		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
 		cmd.cmdarg = 0;
 		cmd.resp_type = MMC_RSP_R1b;
@@ -493,6 +523,9 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 	}
 
 	b_max = mmc_get_b_max(mmc, dst, blkcnt);
+	/* The block count of SET_BLOCK_COUNT has 16 bits */
+	if (mmc_can_cmd23(mmc))
+		b_max = min_t(uint, b_max, 0xffff);
 
 	do {
 		cur = (blocks_todo > b_max) ? b_max : blocks_todo;
@@ -712,6 +745,14 @@ static int mmc_send_op_cond(struct mmc *mmc)
 		if (mmc->ocr & OCR_BUSY)
 			break;
 
+		/*
+		 * The card accepted the voltage window and is powering up.
+		 * Leave the busy polling to mmc_complete_op_cond() so that
+		 * a deferred init can do other work meanwhile.
+		 */
+		if (i)
+			break;
+
 		if (get_timer(start) > timeout)
 			return -ETIMEDOUT;
 		udelay(100);
@@ -729,9 +770,10 @@ static int mmc_complete_op_cond(struct mmc *mmc)
 
 	mmc->op_cond_pending = 0;
 	if (!(mmc->ocr & OCR_BUSY)) {
-		/* Some cards seem to need this */
-		mmc_go_idle(mmc);
-
+		/*
+		 * Keep polling where mmc_send_op_cond() stopped. Going idle
+		 * here would restart the power-up of the card.
+		 */
 		start = get_timer(0);
 		while (1) {
 			err = mmc_send_op_cond_iter(mmc, 1);
@@ -982,7 +1024,7 @@ static int mmc_get_capabilities(struct mmc *mmc)
 		return -ENOTSUPP;
 	}
 
-	mmc->card_caps |= MMC_MODE_4BIT | MMC_MODE_8BIT;
+	mmc->card_caps |= MMC_MODE_4BIT | MMC_MODE_8BIT | MMC_CAP_CMD23;
 
 	cardtype = ext_csd[EXT_CSD_CARD_TYPE];
 	mmc->cardtype = cardtype;
@@ -1371,6 +1413,8 @@ static int sd_get_capabilities(struct mmc *mmc)
 
 	if (mmc->scr[0] & SD_DATA_4BIT)
 		mmc->card_caps |= MMC_MODE_4BIT;
+	if (mmc->scr[0] & SD_CMD23_SUPPORT)
+		mmc->card_caps |= MMC_CAP_CMD23;
 
 	/* Version 1.0 doesn't support switching */
 	if (mmc->version == SD_VERSION_1_0)
@@ -1994,6 +2038,120 @@ static const struct ext_csd_bus_width {
 	{MMC_MODE_1BIT, false, EXT_CSD_BUS_WIDTH_1},
 };
 
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+/* Largest host specific tuning result which can be cached */
+#define MMC_TUNING_MAX	16
+
+/**
+ * struct mmc_tuning_rec - bus configuration remembered across boots
+ *
+ * @cid:	CID of the card the record belongs to
+ * @caps:	selected bus mode and width, MMC_CAP() | MMC_MODE_xBIT
+ * @len:	number of bytes used in @data
+ * @data:	host specific tuning result, see dm_mmc_ops.get_tuning()
+ */
+struct mmc_tuning_rec {
+	u32 cid[4];
+	u32 caps;
+	u32 len;
+	u8 data[MMC_TUNING_MAX];
+};
+
+static void mmc_tuning_name(struct mmc *mmc, char *name, int size)
+{
+	snprintf(name, size, "mmc%d_tuning", mmc_get_blk_desc(mmc)->devnum);
+}
+
+/**
+ * mmc_tuning_load() - Read the bus configuration cached for this card
+ *
+ * @mmc:	MMC device, with the CID already read from the card
+ * @rec:	Returns the record
+ * Return: 0 if a record for this card was found, -ve on error
+ */
+static int mmc_tuning_load(struct mmc *mmc, struct mmc_tuning_rec *rec)
+{
+	char name[20];
+	const char *val;
+
+	if (!(gd->flags & GD_FLG_ENV_READY))
+		return -EAGAIN;
+
+	mmc_tuning_name(mmc, name, sizeof(name));
+	val = env_get(name);
+	if (!val || strlen(val) != 2 * sizeof(*rec) ||
+	    hex2bin((u8 *)rec, val, sizeof(*rec)))
+		return -ENOENT;
+	if (memcmp(rec->cid, mmc->cid, sizeof(rec->cid)) ||
+	    rec->len > sizeof(rec->data))
+		return -ESTALE;
+
+	return 0;
+}
+
+/**
+ * mmc_tuning_save() - Cache the bus configuration selected for this card
+ *
+ * The environment variable is only updated if the configuration changed,
+ * so that an unchanged environment does not need to be saved again.
+ *
+ * @mmc:	MMC device, after a tuned bus mode was selected
+ */
+static void mmc_tuning_save(struct mmc *mmc)
+{
+	char name[20], val[2 * sizeof(struct mmc_tuning_rec) + 1];
+	struct mmc_tuning_rec rec;
+	const char *old;
+	int len;
+
+	if (!(gd->flags & GD_FLG_ENV_READY) ||
+	    (mmc->selected_mode != MMC_HS_200 &&
+	     mmc->selected_mode != MMC_HS_400))
+		return;
+
+	memset(&rec, '\0', sizeof(rec));
+	len = mmc_get_tuning(mmc, rec.data, sizeof(rec.data));
+	if (len < 0)
+		return;
+	memcpy(rec.cid, mmc->cid, sizeof(rec.cid));
+	rec.caps = MMC_CAP(mmc->selected_mode);
+	rec.caps |= mmc->bus_width == 8 ? MMC_MODE_8BIT : MMC_MODE_4BIT;
+	rec.len = len;
+	*bin2hex(val, &rec, sizeof(rec)) = '\0';
+
+	mmc_tuning_name(mmc, name, sizeof(name));
+	old = env_get(name);
+	if (!old || strcmp(old, val))
+		env_set(name, val);
+}
+#endif
+
+#ifdef MMC_SUPPORTS_TUNING
+/**
+ * mmc_tune() - Tune the sampling point of the host for the current mode
+ *
+ * A cached tuning result is applied and checked with a single tuning block
+ * before falling back to the full tuning procedure of the host.
+ *
+ * @mmc:	MMC device
+ * @opcode:	Tuning command to use
+ * Return: 0 if OK, -ve on error
+ */
+static int mmc_tune(struct mmc *mmc, uint opcode)
+{
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+	if (mmc->tuning_data) {
+		if (!mmc_set_tuning(mmc, mmc->tuning_data, mmc->tuning_len) &&
+		    !mmc_send_tuning(mmc, opcode, NULL))
+			return 0;
+		pr_debug("cached tuning failed, tuning again\n");
+	}
+#endif
+
+	return mmc_execute_tuning(mmc, opcode);
+}
+#endif
+
 #if CONFIG_IS_ENABLED(MMC_HS400_SUPPORT)
 static int mmc_select_hs400(struct mmc *mmc)
 {
@@ -2010,7 +2168,7 @@ static int mmc_select_hs400(struct mmc *mmc)
 
 	/* execute tuning if needed */
 	mmc->hs400_tuning = 1;
-	err = mmc_execute_tuning(mmc, MMC_CMD_SEND_TUNING_BLOCK_HS200);
+	err = mmc_tune(mmc, MMC_CMD_SEND_TUNING_BLOCK_HS200);
 	mmc->hs400_tuning = 0;
 	if (err) {
 		debug("tuning failed\n");
@@ -2094,7 +2252,7 @@ static int mmc_select_hs400es(struct mmc *mmc)
 	    ecbv++) \
 		if ((ddr == ecbv->is_ddr) && (caps & ecbv->cap))
 
-static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps)
+static int mmc_try_mode_and_width(struct mmc *mmc, uint card_caps)
 {
 	int err = 0;
 	const struct mode_width_tuning *mwt;
@@ -2203,8 +2361,7 @@ static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps)
 
 				/* execute tuning if needed */
 				if (mwt->tuning) {
-					err = mmc_execute_tuning(mmc,
-								 mwt->tuning);
+					err = mmc_tune(mmc, mwt->tuning);
 					if (err) {
 						pr_debug("tuning failed : %d\n", err);
 						goto error;
@@ -2227,10 +2384,45 @@ error:
 		}
 	}
 
-	pr_err("unable to select a mode : %d\n", err);
+	pr_debug("no working mode : %d\n", err);
 
 	return -ENOTSUPP;
 }
+
+static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps)
+{
+	int err, span;
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+	struct mmc_tuning_rec rec;
+
+	/* Try the mode which worked last time with the same tuning first */
+	if (!mmc_host_is_spi(mmc) && !mmc_tuning_load(mmc, &rec) &&
+	    (card_caps & mmc->host_caps & rec.caps) == rec.caps) {
+		span = bootstage_span_begin("mmc_cached_mode", "mmc");
+		mmc->tuning_data = rec.data;
+		mmc->tuning_len = rec.len;
+		err = mmc_try_mode_and_width(mmc, rec.caps);
+		mmc->tuning_data = NULL;
+		bootstage_span_end(span);
+		if (!err)
+			return 0;
+		pr_debug("cached mode failed : %d\n", err);
+	}
+#endif
+
+	span = bootstage_span_begin("mmc_select_mode", "mmc");
+	err = mmc_try_mode_and_width(mmc, card_caps);
+	bootstage_span_end(span);
+	if (err) {
+		pr_err("unable to select a mode : %d\n", err);
+		return err;
+	}
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+	mmc_tuning_save(mmc);
+#endif
+
+	return 0;
+}
 #endif
 
 #if CONFIG_IS_ENABLED(MMC_TINY)
@@ -2890,7 +3082,11 @@ retry:
 int mmc_start_init(struct mmc *mmc)
 {
 	bool no_card;
-	int err = 0;
+	int err = 0, span;
+
+	/* A card started early may have been initialised fully since */
+	if (mmc->has_init)
+		return 0;
 
 	/*
 	 * all hosts are capable of 1 bit bus-width and able to use the legacy
@@ -2931,12 +3127,18 @@ int mmc_start_init(struct mmc *mmc)
 	if (no_card) {
 		mmc->has_init = 0;
 #if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBCOMMON_SUPPORT)
-		pr_err("MMC: no card present\n");
+		/* Deferred init starts every slot, whether in use or not */
+		if (CONFIG_IS_ENABLED(MMC_DEFERRED_INIT))
+			debug("MMC: no card present\n");
+		else
+			pr_err("MMC: no card present\n");
 #endif
 		return -ENOMEDIUM;
 	}
 
+	span = bootstage_span_begin("mmc_start_init", "mmc");
 	err = mmc_get_op_cond(mmc, false);
+	bootstage_span_end(span);
 
 	if (!err)
 		mmc->init_in_progress = 1;
@@ -2963,7 +3165,7 @@ static int mmc_complete_init(struct mmc *mmc)
 
 int mmc_init(struct mmc *mmc)
 {
-	int err = 0;
+	int err = 0, span;
 	__maybe_unused ulong start;
 #if CONFIG_IS_ENABLED(DM_MMC)
 	struct mmc_uclass_priv *upriv = dev_get_uclass_priv(mmc->dev);
@@ -2974,12 +3176,14 @@ int mmc_init(struct mmc *mmc)
 		return 0;
 
 	start = get_timer(0);
+	span = bootstage_span_begin("mmc_init", "mmc");
 
 	if (!mmc->init_in_progress)
 		err = mmc_start_init(mmc);
 
 	if (!err)
 		err = mmc_complete_init(mmc);
+	bootstage_span_end(span);
 	if (err)
 		pr_info("%s: %d, time %lu\n", __func__, err, get_timer(start));
 
@@ -3119,7 +3323,7 @@ int mmc_init_device(int num)
 	/* Initialising user set speed mode */
 	m->user_speed_mode = MMC_MODES_END;
 
-	if (m->preinit)
+	if (m->preinit || CONFIG_IS_ENABLED(MMC_DEFERRED_INIT))
 		mmc_start_init(m);
 
 	return 0;
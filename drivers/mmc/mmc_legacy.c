@@ -24,7 +24,7 @@ struct mmc *find_mmc_device(int dev_num)
 void mmc_do_preinit(void)
 {
 	struct mmc *m = &mmc_static;
-	if (m->preinit)
+	if (m->preinit || CONFIG_IS_ENABLED(MMC_DEFERRED_INIT))
 		mmc_start_init(m);
 }
 
@@ -75,7 +75,7 @@ void mmc_do_preinit(void)
 	list_for_each(entry, &mmc_devices) {
 		m = list_entry(entry, struct mmc, link);
 
-		if (m->preinit)
+		if (m->preinit || CONFIG_IS_ENABLED(MMC_DEFERRED_INIT))
 			mmc_start_init(m);
 	}
 }
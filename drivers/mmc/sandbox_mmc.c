@@ -27,10 +27,27 @@ struct sandbox_mmc_plat {
 /* Granularity of priv->csize - this is 1MB */
 #define SIZE_MULTIPLE		((1 << (MMC_CMULT + 2)) * MMC_BL_LEN)
 
+/*
+ * Timing model of the emulated card, used to compare command sequences:
+ * each command takes a fixed time on the bus, each data transfer waits for
+ * the card to access its memory before the data is sent with 25MB/s, and
+ * STOP_TRANSMISSION is followed by a busy period.
+ */
+#define SANDBOX_MMC_CMD_NS	20000
+#define SANDBOX_MMC_ACCESS_NS	100000
+#define SANDBOX_MMC_BYTE_NS	40
+#define SANDBOX_MMC_BUSY_NS	50000
+
 struct sandbox_mmc_priv {
 	char *buf;
 	int csize;	/* CSIZE value to report */
 	int size;
+	u64 bus_time_ns;	/* time spent on the bus, see timing model */
+	uint block_count;	/* block count set by CMD23, 0 if none */
+	bool emmc;		/* emulate an eMMC instead of an SD card */
+	uint busy_polls;	/* CMD1 answered as busy after CMD0 (eMMC) */
+	uint power_up;		/* CMD1 still to be answered as busy (eMMC) */
+	uint op_conds;		/* number of CMD1 received */
 };
 
 /**
@@ -38,6 +55,10 @@ struct sandbox_mmc_priv {
  *
  * This emulate an SD card version 2. Single-block reads result in zero data.
  * Multiple-block reads return a test string.
+ *
+ * With sandbox_mmc_set_emmc() an eMMC version 1.2 is emulated instead. It
+ * does not answer SD commands and is busy powering up for a number of CMD1
+ * after each CMD0.
  */
 static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 				struct mmc_data *data)
@@ -45,15 +66,35 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
 	static ulong erase_start, erase_end;
 
+	priv->bus_time_ns += SANDBOX_MMC_CMD_NS;
+	if (data)
+		priv->bus_time_ns += SANDBOX_MMC_ACCESS_NS +
+			(u64)data->blocks * data->blocksize * SANDBOX_MMC_BYTE_NS;
+
 	switch (cmd->cmdidx) {
 	case MMC_CMD_ALL_SEND_CID:
 		memset(cmd->response, '\0', sizeof(cmd->response));
 		break;
 	case SD_CMD_SEND_RELATIVE_ADDR:
 		cmd->response[0] = 0 << 16; /* mmc->rca */
+		break;
 	case MMC_CMD_GO_IDLE_STATE:
+		/* This restarts the power-up of an eMMC */
+		priv->power_up = priv->busy_polls;
+		break;
+	case MMC_CMD_SEND_OP_COND:
+		priv->op_conds++;
+		if (!priv->emmc)
+			return -ETIMEDOUT;
+		cmd->response[0] = OCR_HCS | MMC_VDD_32_33 | MMC_VDD_33_34;
+		if (priv->power_up)
+			priv->power_up--;
+		else
+			cmd->response[0] |= OCR_BUSY;
 		break;
 	case SD_CMD_SEND_IF_COND:
+		if (priv->emmc)
+			return -ETIMEDOUT;
 		cmd->response[0] = 0xaa;
 		break;
 	case MMC_CMD_SEND_STATUS:
@@ -78,8 +119,18 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 			resp[4] = (cmd->cmdarg & 0xF) << 24;
 		break;
 	}
-	case MMC_CMD_READ_SINGLE_BLOCK:
+	case MMC_CMD_SET_BLOCK_COUNT:
+		priv->block_count = cmd->cmdarg & 0xffff;
+		break;
 	case MMC_CMD_READ_MULTIPLE_BLOCK:
+		/* A pre-defined transfer must match the block count */
+		if (priv->block_count && priv->block_count != data->blocks) {
+			priv->block_count = 0;
+			return -EIO;
+		}
+		priv->block_count = 0;
+		fallthrough;
+	case MMC_CMD_READ_SINGLE_BLOCK:
 		memcpy(data->dest, &priv->buf[cmd->cmdarg * data->blocksize],
 		       data->blocks * data->blocksize);
 		break;
@@ -89,6 +140,7 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 		       data->blocks * data->blocksize);
 		break;
 	case MMC_CMD_STOP_TRANSMISSION:
+		priv->bus_time_ns += SANDBOX_MMC_BUSY_NS;
 		break;
 	case SD_CMD_ERASE_WR_BLK_START:
 		erase_start = cmd->cmdarg;
@@ -111,6 +163,8 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 		cmd->response[2] = 0;
 		break;
 	case MMC_CMD_APP_CMD:
+		if (priv->emmc)
+			return -ETIMEDOUT;
 		break;
 	case MMC_CMD_SET_BLOCKLEN:
 		debug("block len %d\n", cmd->cmdarg);
@@ -118,7 +172,8 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	case SD_CMD_APP_SEND_SCR: {
 		u32 *scr = (u32 *)data->dest;
 
-		scr[0] = cpu_to_be32(2 << 24 | 1 << 15);  /* SD version 3 */
+		/* SD version 3 with CMD23 support */
+		scr[0] = cpu_to_be32(2 << 24 | 1 << 15 | SD_CMD23_SUPPORT);
 		break;
 	}
 	default:
@@ -129,6 +184,29 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	return 0;
 }
 
+ulong sandbox_mmc_get_bus_time(struct udevice *dev)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	return priv->bus_time_ns / 1000;
+}
+
+void sandbox_mmc_set_emmc(struct udevice *dev, uint busy_polls)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	priv->emmc = true;
+	priv->busy_polls = busy_polls;
+	priv->op_conds = 0;
+}
+
+uint sandbox_mmc_get_op_conds(struct udevice *dev)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	return priv->op_conds;
+}
+
 static int sandbox_mmc_set_ios(struct udevice *dev)
 {
 	return 0;
@@ -213,7 +291,8 @@ static int sandbox_mmc_bind(struct udevice *dev)
 	struct mmc_config *cfg = &plat->cfg;
 
 	cfg->name = dev->name;
-	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT;
+	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT |
+			 MMC_CAP_CMD23;
 	cfg->voltages = MMC_VDD_165_195 | MMC_VDD_32_33 | MMC_VDD_33_34;
 	cfg->f_min = 1000000;
 	cfg->f_max = 52000000;
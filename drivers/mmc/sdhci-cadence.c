@@ -243,6 +243,32 @@ static int __maybe_unused sdhci_cdns_execute_tuning(struct udevice *dev,
 	return sdhci_cdns_set_tune_val(plat, end_of_streak - max_streak / 2);
 }
 
+static int __maybe_unused sdhci_cdns_get_tuning(struct udevice *dev,
+						void *buf, int size)
+{
+	struct sdhci_cdns_plat *plat = dev_get_plat(dev);
+	u8 *val = buf;
+
+	if (size < 1)
+		return -ENOSPC;
+	*val = FIELD_GET(SDHCI_CDNS_HRS06_TUNE,
+			 readl(plat->hrs_addr + SDHCI_CDNS_HRS06));
+
+	return 1;
+}
+
+static int __maybe_unused sdhci_cdns_set_tuning(struct udevice *dev,
+						const void *buf, int size)
+{
+	struct sdhci_cdns_plat *plat = dev_get_plat(dev);
+	const u8 *val = buf;
+
+	if (size != 1)
+		return -EINVAL;
+
+	return sdhci_cdns_set_tune_val(plat, *val);
+}
+
 static struct dm_mmc_ops sdhci_cdns_mmc_ops;
 
 static int sdhci_cdns_bind(struct udevice *dev)
@@ -277,6 +303,10 @@ static int sdhci_cdns_probe(struct udevice *dev)
 #ifdef MMC_SUPPORTS_TUNING
 	sdhci_cdns_mmc_ops.execute_tuning = sdhci_cdns_execute_tuning;
 #endif
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+	sdhci_cdns_mmc_ops.get_tuning = sdhci_cdns_get_tuning;
+	sdhci_cdns_mmc_ops.set_tuning = sdhci_cdns_set_tuning;
+#endif
 
 	ret = mmc_of_parse(dev, &plat->cfg);
 	if (ret)
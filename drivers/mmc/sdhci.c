@@ -110,8 +110,14 @@ static void sdhci_prepare_dma(struct sdhci_host *host, struct mmc_data *data,
 	}
 #if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
 	else if (host->flags & (USE_ADMA | USE_ADMA64)) {
-		sdhci_prepare_adma_table(host->adma_desc_table, data,
-					 host->start_addr);
+		/* The table is only rebuilt if the transfer is different */
+		if (host->adma_table_start != host->start_addr ||
+		    host->adma_table_bytes != trans_bytes) {
+			sdhci_prepare_adma_table(host->adma_desc_table, data,
+						 host->start_addr);
+			host->adma_table_start = host->start_addr;
+			host->adma_table_bytes = trans_bytes;
+		}
 
 		sdhci_writel(host, lower_32_bits(host->adma_addr),
 			     SDHCI_ADMA_ADDRESS);
@@ -872,6 +878,7 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 	}
 	host->adma_desc_table = sdhci_adma_init();
 	host->adma_addr = (dma_addr_t)host->adma_desc_table;
+	host->adma_table_bytes = 0;
 
 #ifdef CONFIG_DMA_ADDR_T_64BIT
 	host->flags |= USE_ADMA64;
@@ -982,9 +989,14 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 	if (caps_1 & SDHCI_SUPPORT_DDR50)
 		cfg->host_caps |= MMC_CAP(UHS_DDR50);
 
+	/* Drivers may also opt in by setting MMC_CAP_CMD23 in host_caps */
+	if (IS_ENABLED(CONFIG_MMC_SDHCI_CMD23))
+		cfg->host_caps |= MMC_CAP_CMD23;
+
 	if (host->host_caps)
 		cfg->host_caps |= host->host_caps;
 
+	/* The ADMA table is sized for transfers of this many blocks */
 	cfg->b_max = CONFIG_SYS_MMC_MAX_BLK_COUNT;
 
 	return 0;
@@ -39,6 +39,26 @@ void sandbox_eth_disable_response(int index, bool disable)
 	priv->disabled = disable;
 }
 
+/*
+ * sandbox_eth_disable_batch()
+ *
+ * index - The alias index (also DM seq number)
+ * disable - If non-zero, receive packets one at a time with recv()
+ */
+void sandbox_eth_disable_batch(int index, bool disable)
+{
+	struct udevice *dev;
+	struct eth_sandbox_priv *priv;
+	int ret;
+
+	ret = uclass_get_device(UCLASS_ETH, index, &dev);
+	if (ret)
+		return;
+
+	priv = dev_get_priv(dev);
+	priv->no_batch = disable;
+}
+
 /*
  * sandbox_eth_skip_timeout()
  *
@@ -367,6 +387,39 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 	return 0;
 }
 
+static int sb_eth_recv_batch(struct udevice *dev, int flags,
+			     struct eth_rx_pkt *pkts, int count)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int hdr_len;
+	int i;
+
+	if (priv->no_batch)
+		return -ENOSYS;
+	if (skip_timeout) {
+		timer_test_add_offset(11000UL);
+		skip_timeout = false;
+	}
+
+	count = min(count, priv->recv_packets);
+	for (i = 0; i < count; i++) {
+		pkts[i].packet = priv->recv_packet_buffer[i];
+		pkts[i].length = priv->recv_packet_length[i];
+		pkts[i].csum_ok = false;
+
+		/* Mimic a device writing the payload to its destination */
+		pkts[i].payload = net_rx_dest(pkts[i].packet, pkts[i].length,
+					      false, &hdr_len);
+		if (pkts[i].payload)
+			memcpy(pkts[i].payload, pkts[i].packet + hdr_len,
+			       pkts[i].length - hdr_len);
+	}
+	debug("eth_sandbox: received %d packets, %d waiting\n", count,
+	      priv->recv_packets - count);
+
+	return count;
+}
+
 static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -407,6 +460,7 @@ static const struct eth_ops sb_eth_ops = {
 	.start			= sb_eth_start,
 	.send			= sb_eth_send,
 	.recv			= sb_eth_recv,
+	.recv_batch		= sb_eth_recv_batch,
 	.free_pkt		= sb_eth_free_pkt,
 	.stop			= sb_eth_stop,
 	.write_hwaddr		= sb_eth_write_hwaddr,
@@ -17,15 +17,14 @@
 #include <linux/compat.h>
 #include "nvme.h"
 
-#define NVME_Q_DEPTH		2
+#define NVME_Q_DEPTH		CONFIG_NVME_IO_QUEUE_DEPTH
 #define NVME_AQ_DEPTH		2
 #define NVME_SQ_SIZE(depth)	(depth * sizeof(struct nvme_command))
 #define NVME_CQ_SIZE(depth)	(depth * sizeof(struct nvme_completion))
-#define NVME_CQ_ALLOCATION	ALIGN(NVME_CQ_SIZE(NVME_Q_DEPTH), \
-				      ARCH_DMA_MINALIGN)
+#define NVME_CQ_ALLOCATION(depth) ALIGN(NVME_CQ_SIZE(depth), \
+					ARCH_DMA_MINALIGN)
 #define ADMIN_TIMEOUT		60
 #define IO_TIMEOUT		30
-#define MAX_PRP_POOL		512
 
 static int nvme_wait_csts(struct nvme_dev *dev, u32 mask, u32 val)
 {
@@ -44,12 +43,53 @@ static int nvme_wait_csts(struct nvme_dev *dev, u32 mask, u32 val)
 	return -ETIME;
 }
 
-static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
+/**
+ * nvme_alloc_prp_pool() - allocate the PRP lists of the I/O queue
+ *
+ * Each slot of the I/O queue gets a PRP list large enough for the maximum
+ * transfer size, so that commands can be outstanding at the same time and
+ * no allocation is needed per command.
+ *
+ * @dev:	NVMe controller
+ * Return:	0 if OK, -ENOMEM if out of memory
+ */
+static int nvme_alloc_prp_pool(struct nvme_dev *dev)
+{
+	u32 page_size = dev->page_size;
+	u32 prps_per_page = page_size >> 3;
+	u32 nprps = max_t(u32, (1U << dev->max_transfer_shift) / page_size, 2);
+	u32 num_pages = DIV_ROUND_UP(nprps - 1, prps_per_page - 1);
+
+	free(dev->prp_pool);
+	dev->prp_pool = memalign(page_size,
+				 dev->q_depth * num_pages * page_size);
+	if (!dev->prp_pool) {
+		dev->prp_entry_num = 0;
+		return -ENOMEM;
+	}
+	dev->prp_entry_num = num_pages * prps_per_page;
+
+	return 0;
+}
+
+/**
+ * nvme_prp_list() - get the PRP list of an I/O queue slot
+ *
+ * @dev:	NVMe controller
+ * @slot:	slot of the I/O queue
+ * Return:	PRP list of the slot
+ */
+static u64 *nvme_prp_list(struct nvme_dev *dev, int slot)
+{
+	return dev->prp_pool + slot * dev->prp_entry_num;
+}
+
+static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp_list, u64 *prp2,
 			   int total_len, u64 dma_addr)
 {
 	u32 page_size = dev->page_size;
 	int offset = dma_addr & (page_size - 1);
-	u64 *prp_pool;
+	u64 *prp_pool = prp_list;
 	int length = total_len;
 	int i, nprps;
 	u32 prps_per_page = page_size >> 3;
@@ -73,36 +113,26 @@ static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
 	nprps = DIV_ROUND_UP(length, page_size);
 	num_pages = DIV_ROUND_UP(nprps - 1, prps_per_page - 1);
 
-	if (nprps > dev->prp_entry_num) {
-		free(dev->prp_pool);
-		/*
-		 * Always increase in increments of pages.  It doesn't waste
-		 * much memory and reduces the number of allocations.
-		 */
-		dev->prp_pool = memalign(page_size, num_pages * page_size);
-		if (!dev->prp_pool) {
-			printf("Error: malloc prp_pool fail\n");
-			return -ENOMEM;
-		}
-		dev->prp_entry_num = num_pages * (prps_per_page - 1) + 1;
+	if (num_pages * prps_per_page > dev->prp_entry_num) {
+		printf("Error: transfer too large for PRP list\n");
+		return -EINVAL;
 	}
 
-	prp_pool = dev->prp_pool;
 	i = 0;
 	while (nprps) {
 		if ((i == (prps_per_page - 1)) && nprps > 1) {
 			*(prp_pool + i) = cpu_to_le64((ulong)prp_pool +
 					page_size);
 			i = 0;
-			prp_pool += page_size;
+			prp_pool += prps_per_page;
 		}
 		*(prp_pool + i++) = cpu_to_le64(dma_addr);
 		dma_addr += page_size;
 		nprps--;
 	}
-	*prp2 = (ulong)dev->prp_pool;
+	*prp2 = (ulong)prp_list;
 
-	flush_dcache_range((ulong)dev->prp_pool, (ulong)dev->prp_pool +
+	flush_dcache_range((ulong)prp_list, (ulong)prp_list +
 			   num_pages * page_size);
 
 	return 0;
@@ -124,7 +154,7 @@ static u16 nvme_read_completion_status(struct nvme_queue *nvmeq, u16 index)
 	 * as the cache line should never become dirty.
 	 */
 	ulong start = (ulong)&nvmeq->cqes[0];
-	ulong stop = start + NVME_CQ_ALLOCATION;
+	ulong stop = start + NVME_CQ_ALLOCATION(nvmeq->q_depth);
 
 	invalidate_dcache_range(start, stop);
 
@@ -158,9 +188,19 @@ static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 	nvmeq->sq_tail = tail;
 }
 
-static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
-				struct nvme_command *cmd,
-				u32 *result, unsigned timeout)
+/**
+ * nvme_wait_cmd() - wait for the next completion of a queue
+ *
+ * @nvmeq:	The queue to poll
+ * @cmd:	The command passed to the complete_cmd() operation
+ * @cmdid:	Returns the id of the completed command if not NULL
+ * @result:	Returns the result of the completed command if not NULL
+ * @timeout:	Timeout in units of 100 milliseconds
+ * Return:	0 if the command succeeded, -EIO if it failed, -ETIMEDOUT if
+ *		no command completed in time
+ */
+static int nvme_wait_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd,
+			 u16 *cmdid, u32 *result, unsigned timeout)
 {
 	struct nvme_ops *ops;
 	u16 head = nvmeq->cq_head;
@@ -169,9 +209,6 @@ static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 	ulong start_time;
 	ulong timeout_us = timeout * 100000;
 
-	cmd->common.command_id = nvme_get_cmd_id();
-	nvme_submit_cmd(nvmeq, cmd);
-
 	start_time = timer_get_us();
 
 	for (;;) {
@@ -187,6 +224,9 @@ static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 	if (ops && ops->complete_cmd)
 		ops->complete_cmd(nvmeq, cmd);
 
+	if (cmdid)
+		*cmdid = readw(&(nvmeq->cqes[head].command_id));
+
 	status >>= 1;
 	if (status) {
 		printf("ERROR: status = %x, phase = %d, head = %d\n",
@@ -217,6 +257,16 @@ static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 	return status;
 }
 
+static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
+				struct nvme_command *cmd,
+				u32 *result, unsigned timeout)
+{
+	cmd->common.command_id = nvme_get_cmd_id();
+	nvme_submit_cmd(nvmeq, cmd);
+
+	return nvme_wait_cmd(nvmeq, cmd, NULL, result, timeout);
+}
+
 static int nvme_submit_admin_cmd(struct nvme_dev *dev, struct nvme_command *cmd,
 				 u32 *result)
 {
@@ -233,7 +283,7 @@ static struct nvme_queue *nvme_alloc_queue(struct nvme_dev *dev,
 		return NULL;
 	memset(nvmeq, 0, sizeof(*nvmeq));
 
-	nvmeq->cqes = (void *)memalign(4096, NVME_CQ_ALLOCATION);
+	nvmeq->cqes = (void *)memalign(4096, NVME_CQ_ALLOCATION(depth));
 	if (!nvmeq->cqes)
 		goto free_nvmeq;
 	memset((void *)nvmeq->cqes, 0, NVME_CQ_SIZE(depth));
@@ -344,7 +394,8 @@ static void nvme_init_queue(struct nvme_queue *nvmeq, u16 qid)
 	nvmeq->q_db = &dev->dbs[qid * 2 * dev->db_stride];
 	memset((void *)nvmeq->cqes, 0, NVME_CQ_SIZE(nvmeq->q_depth));
 	flush_dcache_range((ulong)nvmeq->cqes,
-			   (ulong)nvmeq->cqes + NVME_CQ_ALLOCATION);
+			   (ulong)nvmeq->cqes +
+			   NVME_CQ_ALLOCATION(nvmeq->q_depth));
 	dev->online_queues++;
 }
 
@@ -641,15 +692,13 @@ static int nvme_get_info_from_identify(struct nvme_dev *dev)
 		 * and is reported as a power of two (2^n).
 		 *
 		 * The spec also says: a value of 0h indicates no restrictions
-		 * on transfer size. But in nvme_blk_read/write() below we have
-		 * the following algorithm for maximum number of logic blocks
-		 * per transfer:
-		 *
-		 * u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
-		 *
-		 * In order for lbas not to overflow, the maximum number is 15
-		 * which means dev->max_transfer_shift = 15 + 9 (ns->lba_shift).
-		 * Let's use 20 which provides 1MB size.
+		 * on transfer size. But nvme_blk_rw() splits a request into
+		 * commands of at most 1 << max_transfer_shift bytes, and each
+		 * slot of the I/O queue gets a PRP list large enough for such
+		 * a command (see nvme_alloc_prp_pool()). A command must also
+		 * fit the 16-bit block count of the read/write command.
+		 * Let's use 20 which provides 1MB per command, a single PRP
+		 * page per slot with 4KB pages.
 		 */
 		dev->max_transfer_shift = 20;
 	}
@@ -727,65 +776,104 @@ static int nvme_blk_probe(struct udevice *udev)
 	return 0;
 }
 
+/**
+ * nvme_io_depth() - get the number of I/O commands which may be outstanding
+ *
+ * A queue with N slots holds at most N - 1 commands. Controllers with their
+ * own submission operation only support a single outstanding command.
+ *
+ * @dev:	NVMe controller
+ * Return:	maximum number of outstanding I/O commands
+ */
+static int nvme_io_depth(struct nvme_dev *dev)
+{
+	struct nvme_ops *ops = (struct nvme_ops *)dev->udev->driver->ops;
+
+	if (ops && ops->submit_cmd)
+		return 1;
+
+	return dev->queues[NVME_IO_Q]->q_depth - 1;
+}
+
 static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 			 lbaint_t blkcnt, void *buffer, bool read)
 {
 	struct nvme_ns *ns = dev_get_priv(udev);
 	struct nvme_dev *dev = ns->dev;
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
 	struct nvme_command c;
 	struct blk_desc *desc = dev_get_uclass_plat(udev);
+	int depth = nvme_io_depth(dev);
+	u64 chunk[NVME_Q_DEPTH];
+	u64 total_len = blkcnt << desc->log2blksz;
+	u64 max_len = 1ULL << dev->max_transfer_shift;
+	u64 done_len = total_len;
+	u64 offset = 0;
+	ulong busy = 0;
+	int inflight = 0;
 	int status;
 	u64 prp2;
-	u64 total_len = blkcnt << desc->log2blksz;
-	u64 temp_len = total_len;
-	uintptr_t temp_buffer = (uintptr_t)buffer;
-
-	u64 slba = blknr;
-	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
-	u64 total_lbas = blkcnt;
+	u16 slot;
 
 	flush_dcache_range((unsigned long)buffer,
 			   (unsigned long)buffer + total_len);
 
+	memset(&c, 0, sizeof(c));
 	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
-	c.rw.flags = 0;
 	c.rw.nsid = cpu_to_le32(ns->ns_id);
-	c.rw.control = 0;
-	c.rw.dsmgmt = 0;
-	c.rw.reftag = 0;
-	c.rw.apptag = 0;
-	c.rw.appmask = 0;
-	c.rw.metadata = 0;
-
-	while (total_lbas) {
-		if (total_lbas < lbas) {
-			lbas = (u16)total_lbas;
-			total_lbas = 0;
-		} else {
-			total_lbas -= lbas;
+
+	/*
+	 * Keep up to depth commands outstanding. The first failing command
+	 * stops the submission, the outstanding ones are reaped anyway.
+	 */
+	while (offset < total_len || inflight) {
+		while (offset < total_len && inflight < depth &&
+		       done_len == total_len) {
+			u64 len = min(total_len - offset, max_len);
+			uintptr_t addr = (uintptr_t)buffer + offset;
+
+			slot = ffz(busy);
+			if (nvme_setup_prps(dev, nvme_prp_list(dev, slot),
+					    &prp2, len, addr)) {
+				done_len = offset;
+				break;
+			}
+			c.rw.command_id = cpu_to_le16(slot);
+			c.rw.slba = cpu_to_le64(blknr +
+						(offset >> ns->lba_shift));
+			c.rw.length = cpu_to_le16((len >> ns->lba_shift) - 1);
+			c.rw.prp1 = cpu_to_le64(addr);
+			c.rw.prp2 = cpu_to_le64(prp2);
+			nvme_submit_cmd(nvmeq, &c);
+
+			chunk[slot] = offset;
+			busy |= BIT(slot);
+			inflight++;
+			offset += len;
 		}
+		if (!inflight)
+			break;
 
-		if (nvme_setup_prps(dev, &prp2,
-				    lbas << ns->lba_shift, temp_buffer))
-			return -EIO;
-		c.rw.slba = cpu_to_le64(slba);
-		slba += lbas;
-		c.rw.length = cpu_to_le16(lbas - 1);
-		c.rw.prp1 = cpu_to_le64(temp_buffer);
-		c.rw.prp2 = cpu_to_le64(prp2);
-		status = nvme_submit_sync_cmd(dev->queues[NVME_IO_Q],
-				&c, NULL, IO_TIMEOUT);
-		if (status)
+		status = nvme_wait_cmd(nvmeq, &c, &slot, NULL, IO_TIMEOUT);
+		if (status == -ETIMEDOUT || slot >= depth ||
+		    !(busy & BIT(slot))) {
+			/* Nothing outstanding can be trusted any more */
+			for (slot = 0; slot < depth; slot++)
+				if (busy & BIT(slot))
+					done_len = min(done_len, chunk[slot]);
 			break;
-		temp_len -= (u32)lbas << ns->lba_shift;
-		temp_buffer += lbas << ns->lba_shift;
+		}
+		busy &= ~BIT(slot);
+		inflight--;
+		if (status)
+			done_len = min(done_len, chunk[slot]);
 	}
 
 	if (read)
 		invalidate_dcache_range((unsigned long)buffer,
 					(unsigned long)buffer + total_len);
 
-	return (total_len - temp_len) >> desc->log2blksz;
+	return done_len >> desc->log2blksz;
 }
 
 static ulong nvme_blk_read(struct udevice *udev, lbaint_t blknr,
@@ -844,21 +932,19 @@ int nvme_init(struct udevice *udev)
 	if (ret)
 		goto free_queue;
 
-	/* Allocate after the page size is known */
-	ndev->prp_pool = memalign(ndev->page_size, MAX_PRP_POOL);
-	if (!ndev->prp_pool) {
-		ret = -ENOMEM;
-		printf("Error: %s: Out of memory!\n", udev->name);
-		goto free_nvme;
-	}
-	ndev->prp_entry_num = MAX_PRP_POOL >> 3;
-
 	ret = nvme_setup_io_queues(ndev);
 	if (ret)
 		goto free_queue;
 
 	nvme_get_info_from_identify(ndev);
 
+	/* Allocate after the page and maximum transfer size are known */
+	ret = nvme_alloc_prp_pool(ndev);
+	if (ret) {
+		printf("Error: %s: Out of memory!\n", udev->name);
+		goto free_queue;
+	}
+
 	/* Create a blk device for each namespace */
 
 	id = memalign(ndev->page_size, sizeof(struct nvme_id_ns));
@@ -1102,6 +1102,7 @@ static int pci_uclass_pre_probe(struct udevice *bus)
 		if (ret)
 			return ret;
 		bus->seq_ = uclass_find_next_free_seq(uc);
+		uclass_reindex_device(bus);
 	}
 
 	/* For bridges, use the top-level PCI controller */
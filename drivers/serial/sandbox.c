@@ -14,6 +14,7 @@
 #include <dm.h>
 #include <os.h>
 #include <serial.h>
+#include <time.h>
 #include <video.h>
 #include <asm/global_data.h>
 #include <linux/compiler.h>
@@ -25,6 +26,12 @@ DECLARE_GLOBAL_DATA_PTR;
 static size_t _sandbox_serial_written = 1;
 static bool sandbox_serial_enabled = true;
 
+/* Emulated TX FIFO: size (0 for none), rate, level and when it was updated */
+static uint sandbox_serial_fifo_size;
+static ulong sandbox_serial_fifo_rate;
+static uint sandbox_serial_fifo_level;
+static ulong sandbox_serial_fifo_us;
+
 size_t sandbox_serial_written(void)
 {
 	return _sandbox_serial_written;
@@ -35,6 +42,36 @@ void sandbox_serial_endisable(bool enabled)
 	sandbox_serial_enabled = enabled;
 }
 
+void sandbox_serial_set_fifo(uint size, ulong rate)
+{
+	sandbox_serial_fifo_size = size;
+	sandbox_serial_fifo_rate = rate;
+	sandbox_serial_fifo_level = 0;
+	sandbox_serial_fifo_us = timer_get_us();
+}
+
+/* Update the level of the emulated FIFO and return the room left in it */
+static uint sandbox_serial_fifo_room(void)
+{
+	ulong now = timer_get_us();
+	ulong sent;
+
+	if (!sandbox_serial_fifo_size)
+		return UINT_MAX;
+	sent = (now - sandbox_serial_fifo_us) * sandbox_serial_fifo_rate /
+		1000000;
+	if (sent >= sandbox_serial_fifo_level) {
+		sandbox_serial_fifo_level = 0;
+		sandbox_serial_fifo_us = now;
+	} else if (sent) {
+		sandbox_serial_fifo_level -= sent;
+		sandbox_serial_fifo_us += sent * 1000000 /
+			sandbox_serial_fifo_rate;
+	}
+
+	return sandbox_serial_fifo_size - sandbox_serial_fifo_level;
+}
+
 /**
  * output_ansi_colour() - Output an ANSI colour code
  *
@@ -96,6 +133,10 @@ static int sandbox_serial_putc(struct udevice *dev, const char ch)
 {
 	struct sandbox_serial_priv *priv = dev_get_priv(dev);
 
+	if (!sandbox_serial_fifo_room())
+		return -EAGAIN;
+	if (sandbox_serial_fifo_size)
+		sandbox_serial_fifo_level++;
 	if (ch == '\n')
 		priv->start_of_line = true;
 
@@ -113,6 +154,9 @@ static ssize_t sandbox_serial_puts(struct udevice *dev, const char *s,
 	struct sandbox_serial_priv *priv = dev_get_priv(dev);
 	ssize_t ret;
 
+	len = min_t(size_t, len, sandbox_serial_fifo_room());
+	if (sandbox_serial_fifo_size)
+		sandbox_serial_fifo_level += len;
 	if (len && s[len - 1] == '\n')
 		priv->start_of_line = true;
 
@@ -135,8 +179,11 @@ static int sandbox_serial_pending(struct udevice *dev, bool input)
 	char *data;
 	int avail;
 
-	if (!input)
-		return 0;
+	if (!input) {
+		if (!sandbox_serial_fifo_size)
+			return 0;
+		return sandbox_serial_fifo_size - sandbox_serial_fifo_room();
+	}
 
 	os_usleep(100);
 	if (IS_ENABLED(CONFIG_VIDEO) && !IS_ENABLED(CONFIG_SPL_BUILD))
@@ -6,6 +6,7 @@
 #define LOG_CATEGORY UCLASS_SERIAL
 
 #include <common.h>
+#include <cyclic.h>
 #include <dm.h>
 #include <env_internal.h>
 #include <errno.h>
@@ -185,11 +186,220 @@ int serial_initialize(void)
 	return serial_init();
 }
 
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+/* Interval at which buffered output is sent while U-Boot is busy elsewhere */
+#define SERIAL_TX_POLL_US	1000
+
+static bool serial_tx_buffered(struct udevice *dev)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+
+	return upriv->txbuf.start;
+}
+
+/**
+ * serial_tx_send() - Send output from the TX buffer
+ *
+ * This gives the driver as much output as it takes at once, so a driver
+ * which returns -EAGAIN (or a short count from puts()) when its FIFO is full
+ * is filled in bursts instead of being waited for after each character.
+ *
+ * @dev:	Serial device
+ * @wait:	true to wait until the buffer is empty, false to stop as soon as
+ *		the UART cannot take more
+ */
+static void serial_tx_send(struct udevice *dev, bool wait)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	int len, sent;
+	char *data;
+
+	/* A driver may call schedule(), which runs serial_tx_poll() */
+	if (upriv->tx_busy)
+		return;
+	upriv->tx_busy = true;
+	while ((len = membuff_getraw(&upriv->txbuf, -1, false, &data))) {
+		if (CONFIG_IS_ENABLED(SERIAL_PUTS) && ops->puts) {
+			sent = ops->puts(dev, data, len);
+			if (sent == -EAGAIN) {
+				sent = 0;
+			} else if (sent < 0) {
+				/* Drop the output, as _serial_puts() does */
+				membuff_purge(&upriv->txbuf);
+				break;
+			}
+		} else {
+			for (sent = 0; sent < len; sent++) {
+				if (ops->putc(dev, data[sent]) == -EAGAIN)
+					break;
+			}
+		}
+		membuff_getraw(&upriv->txbuf, sent, true, &data);
+		if (sent < len && !wait)
+			break;
+	}
+	upriv->tx_busy = false;
+}
+
+/* Add output to the TX buffer, waiting for room if it is full */
+static void serial_tx_add(struct udevice *dev, const char *str, int len)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	char *data;
+	int done;
+
+	while (len) {
+		done = membuff_put(&upriv->txbuf, str, len);
+		str += done;
+		len -= done;
+		if (!len)
+			break;
+		if (upriv->tx_hold || upriv->tx_busy)
+			/* Keep the most recent output */
+			membuff_getraw(&upriv->txbuf, len, true, &data);
+		else
+			serial_tx_send(dev, false);
+	}
+}
+
+static void serial_tx_putc(struct udevice *dev, char ch)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+
+	if (ch == '\n')
+		serial_tx_add(dev, "\r\n", 2);
+	else
+		serial_tx_add(dev, &ch, 1);
+	if (!upriv->tx_hold)
+		serial_tx_send(dev, false);
+}
+
+static void serial_tx_puts(struct udevice *dev, const char *str)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+
+	do {
+		const char *newline = strchrnul(str, '\n');
+
+		serial_tx_add(dev, str, newline - str);
+		if (*newline)
+			serial_tx_add(dev, "\r\n", 2);
+		str = newline + !!*newline;
+	} while (*str);
+	if (!upriv->tx_hold)
+		serial_tx_send(dev, false);
+}
+
+/* Send all buffered output, unless it is held */
+static void serial_tx_flush(struct udevice *dev)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+
+	if (serial_tx_buffered(dev) && !upriv->tx_hold)
+		serial_tx_send(dev, true);
+}
+
+/* Someone is typing, so show them the held output */
+static void serial_tx_input(struct udevice *dev)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+
+	if (serial_tx_buffered(dev) && upriv->tx_hold) {
+		upriv->tx_hold = false;
+		serial_tx_send(dev, false);
+	}
+}
+
+static void serial_tx_poll(void *ctx)
+{
+	struct udevice *dev = ctx;
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+
+	if (!upriv->tx_hold)
+		serial_tx_send(dev, false);
+}
+
+static int serial_tx_init(struct udevice *dev)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	int ret;
+
+	ret = membuff_new(&upriv->txbuf, CONFIG_SERIAL_TX_BUFFER_SIZE);
+	if (ret)
+		return ret;
+	upriv->tx_hold = IS_ENABLED(CONFIG_SERIAL_TX_HOLD);
+	upriv->tx_cyclic = cyclic_register(serial_tx_poll, SERIAL_TX_POLL_US,
+					   dev->name, dev);
+
+	return 0;
+}
+
+static void serial_tx_uninit(struct udevice *dev)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+
+	if (!serial_tx_buffered(dev))
+		return;
+	serial_tx_flush(dev);
+	if (upriv->tx_cyclic)
+		cyclic_unregister(upriv->tx_cyclic);
+	upriv->tx_cyclic = NULL;
+	membuff_dispose(&upriv->txbuf);
+}
+
+void serial_tx_hold(bool hold)
+{
+	struct serial_dev_priv *upriv;
+	struct udevice *dev;
+	struct uclass *uc;
+
+	uclass_id_foreach_dev(UCLASS_SERIAL, dev, uc) {
+		if (!device_active(dev) || !serial_tx_buffered(dev))
+			continue;
+		upriv = dev_get_uclass_priv(dev);
+		upriv->tx_hold = hold;
+		if (!hold)
+			serial_tx_send(dev, false);
+	}
+}
+
+void serial_tx_stop(void)
+{
+	struct serial_dev_priv *upriv;
+	struct udevice *dev;
+	struct uclass *uc;
+
+	uclass_id_foreach_dev(UCLASS_SERIAL, dev, uc) {
+		if (!device_active(dev) || !serial_tx_buffered(dev))
+			continue;
+		upriv = dev_get_uclass_priv(dev);
+		upriv->tx_hold = false;
+		/* Without a buffer, output goes straight to the driver */
+		serial_tx_uninit(dev);
+	}
+}
+#else
+static inline bool serial_tx_buffered(struct udevice *dev)
+{
+	return false;
+}
+
+static inline void serial_tx_putc(struct udevice *dev, char ch) {}
+static inline void serial_tx_puts(struct udevice *dev, const char *str) {}
+static inline void serial_tx_flush(struct udevice *dev) {}
+static inline void serial_tx_input(struct udevice *dev) {}
+#endif /* CONFIG_IS_ENABLED(SERIAL_TX_BUFFER) */
+
 static void _serial_putc(struct udevice *dev, char ch)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 	int err;
 
+	if (serial_tx_buffered(dev)) {
+		serial_tx_putc(dev, ch);
+		return;
+	}
 	if (ch == '\n')
 		_serial_putc(dev, '\r');
 
@@ -218,6 +428,10 @@ static void _serial_puts(struct udevice *dev, const char *str)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 
+	if (serial_tx_buffered(dev)) {
+		serial_tx_puts(dev, str);
+		return;
+	}
 	if (!CONFIG_IS_ENABLED(SERIAL_PUTS) || !ops->puts) {
 		while (*str)
 			_serial_putc(dev, *str++);
@@ -243,6 +457,7 @@ static void _serial_flush(struct udevice *dev)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 
+	serial_tx_flush(dev);
 	if (!ops->pending)
 		return;
 	while (ops->pending(dev, false) > 0)
@@ -260,6 +475,8 @@ static int __serial_getc(struct udevice *dev)
 		if (err == -EAGAIN)
 			schedule();
 	} while (err == -EAGAIN);
+	if (err >= 0)
+		serial_tx_input(dev);
 
 	return err >= 0 ? err : 0;
 }
@@ -540,6 +757,14 @@ static int serial_post_probe(struct udevice *dev)
 			return ret;
 	}
 
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+	if (gd->flags & GD_FLG_RELOC) {
+		ret = serial_tx_init(dev);
+		if (ret)
+			return ret;
+	}
+#endif
+
 #if CONFIG_IS_ENABLED(DM_STDIO)
 	if (!(gd->flags & GD_FLG_RELOC))
 		return 0;
@@ -572,6 +797,9 @@ static int serial_pre_remove(struct udevice *dev)
 	if (stdio_deregister_dev(upriv->sdev, true))
 		return -EPERM;
 #endif
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+	serial_tx_uninit(dev);
+#endif
 
 	return 0;
 }
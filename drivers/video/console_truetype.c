@@ -9,6 +9,7 @@
 #include <malloc.h>
 #include <video.h>
 #include <video_console.h>
+#include <linux/list.h>
 
 /* Functions needed by stb_truetype.h */
 static int tt_floor(double val)
@@ -121,6 +122,37 @@ struct console_tt_metrics {
 	double scale;
 };
 
+/* Number of hash chains in the glyph cache, a power of two */
+#define GLYPH_HASH_SIZE		64
+
+/**
+ * struct console_tt_glyph - A rendered character in the glyph cache
+ *
+ * @sibling:	Node in the list of cached glyphs, most recently used first
+ * @hash:	Node in the hash chain
+ * @met:	Metrics (font and size) used to render the glyph
+ * @ch:		Character
+ * @x_shift:	Horizontal sub-pixel shift used to render the glyph
+ * @width:	Width of the bitmap in pixels
+ * @height:	Height of the bitmap in pixels
+ * @xoff:	X offset of the bitmap from the cursor position in pixels
+ * @yoff:	Y offset of the bitmap from the baseline in pixels
+ * @bits:	8-bit alpha value for each pixel, NULL for an empty character
+ *		such as a space
+ */
+struct console_tt_glyph {
+	struct list_head sibling;
+	struct hlist_node hash;
+	struct console_tt_metrics *met;
+	int ch;
+	double x_shift;
+	int width;
+	int height;
+	int xoff;
+	int yoff;
+	u8 *bits;
+};
+
 /**
  * struct console_tt_priv - Private data for this driver
  *
@@ -133,6 +165,18 @@ struct console_tt_metrics {
  *		last character. We record enough characters to go back to the
  *		start of the current command line.
  * @pos_ptr:	Current position in the position history
+ * @glyphs:	Entries of the glyph cache, NULL if not allocated yet
+ * @glyph_lru:	Glyphs in the cache, most recently used first
+ * @glyph_hash:	Hash chains of glyphs in the cache
+ * @glyph_count: Number of entries of @glyphs in use
+ * @glyph_off:	true if the glyph cache is disabled
+ * @glyph_hits:	Number of characters drawn from the cache
+ * @glyph_misses: Number of characters rendered
+ * @alpha_lut:	Pixel value to combine with the frame buffer for each alpha
+ *		value, for a 16bpp or 32bpp display
+ * @lut_bpix:	Display depth used to set up @alpha_lut, VIDEO_BPP1 if not
+ *		set up
+ * @lut_invert:	true if @alpha_lut is set up for a non-black background
  */
 struct console_tt_priv {
 	struct console_tt_metrics *cur_met;
@@ -140,6 +184,16 @@ struct console_tt_priv {
 	int num_metrics;
 	struct pos_info pos[POS_HISTORY_SIZE];
 	int pos_ptr;
+	struct console_tt_glyph *glyphs;
+	struct list_head glyph_lru;
+	struct hlist_head glyph_hash[GLYPH_HASH_SIZE];
+	int glyph_count;
+	bool glyph_off;
+	ulong glyph_hits;
+	ulong glyph_misses;
+	u32 alpha_lut[256];
+	enum video_log2_bpp lut_bpix;
+	bool lut_invert;
 };
 
 static int console_truetype_set_row(struct udevice *dev, uint row, int clr)
@@ -184,6 +238,8 @@ static int console_truetype_set_row(struct udevice *dev, uint row, int clr)
 	default:
 		return -ENOSYS;
 	}
+	video_damage(dev->parent, 0, met->font_size * row, vid_priv->xsize,
+		     met->font_size);
 	ret = vidconsole_sync_copy(dev, line, end);
 	if (ret)
 		return ret;
@@ -203,6 +259,8 @@ static int console_truetype_move_rows(struct udevice *dev, uint rowdst,
 
 	dst = vid_priv->fb + rowdst * met->font_size * vid_priv->line_length;
 	src = vid_priv->fb + rowsrc * met->font_size * vid_priv->line_length;
+	video_damage(dev->parent, 0, met->font_size * rowdst, vid_priv->xsize,
+		     met->font_size * count);
 	ret = vidconsole_memmove(dev, dst, src, met->font_size *
 				 vid_priv->line_length * count);
 	if (ret)
@@ -216,6 +274,136 @@ static int console_truetype_move_rows(struct udevice *dev, uint rowdst,
 	return 0;
 }
 
+static void render_glyph(struct console_tt_metrics *met, int ch,
+			 double x_shift, struct console_tt_glyph *glyph)
+{
+	glyph->met = met;
+	glyph->ch = ch;
+	glyph->x_shift = x_shift;
+	glyph->bits = stbtt_GetCodepointBitmapSubpixel(&met->font, met->scale,
+						       met->scale, x_shift, 0,
+						       ch, &glyph->width,
+						       &glyph->height,
+						       &glyph->xoff,
+						       &glyph->yoff);
+}
+
+static void glyph_cache_drop(struct console_tt_priv *priv)
+{
+	int i;
+
+	for (i = 0; i < priv->glyph_count; i++)
+		free(priv->glyphs[i].bits);
+	free(priv->glyphs);
+	priv->glyphs = NULL;
+	priv->glyph_count = 0;
+}
+
+/**
+ * get_glyph() - Get the rendered bitmap of a character
+ *
+ * Rasterising a character is slow, particularly without hardware floating
+ * point, and menus draw the same characters over and over. So rendered
+ * characters are kept in a cache, dropping the least recently used one
+ * when it is full. The bitmap depends on the sub-pixel position, so this is
+ * part of the key.
+ *
+ * @priv:	Private data
+ * @met:	Metrics to use
+ * @ch:		Character to render
+ * @x_shift:	Horizontal sub-pixel shift, from 0 to 1
+ * @tmp:	Place to render the glyph if it cannot be cached
+ * Return: cached glyph, or @tmp, in which case the caller must free
+ *	tmp->bits
+ */
+static struct console_tt_glyph *get_glyph(struct console_tt_priv *priv,
+					  struct console_tt_metrics *met,
+					  int ch, double x_shift,
+					  struct console_tt_glyph *tmp)
+{
+	struct hlist_head *head;
+	struct console_tt_glyph *glyph;
+	int i;
+
+	if (!CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE || priv->glyph_off)
+		goto uncached;
+	if (!priv->glyphs) {
+		priv->glyphs = calloc(CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE,
+				      sizeof(*glyph));
+		if (!priv->glyphs)
+			goto uncached;
+		INIT_LIST_HEAD(&priv->glyph_lru);
+		for (i = 0; i < GLYPH_HASH_SIZE; i++)
+			INIT_HLIST_HEAD(&priv->glyph_hash[i]);
+	}
+
+	head = &priv->glyph_hash[(ch * 31 + (met - priv->metrics)) &
+				 (GLYPH_HASH_SIZE - 1)];
+	hlist_for_each_entry(glyph, head, hash) {
+		if (glyph->ch == ch && glyph->met == met &&
+		    glyph->x_shift == x_shift) {
+			list_move(&glyph->sibling, &priv->glyph_lru);
+			priv->glyph_hits++;
+			return glyph;
+		}
+	}
+
+	if (priv->glyph_count < CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE) {
+		glyph = &priv->glyphs[priv->glyph_count++];
+	} else {
+		glyph = list_last_entry(&priv->glyph_lru,
+					struct console_tt_glyph, sibling);
+		list_del(&glyph->sibling);
+		hlist_del(&glyph->hash);
+		free(glyph->bits);
+	}
+	render_glyph(met, ch, x_shift, glyph);
+	list_add(&glyph->sibling, &priv->glyph_lru);
+	hlist_add_head(&glyph->hash, head);
+	priv->glyph_misses++;
+
+	return glyph;
+
+uncached:
+	render_glyph(met, ch, x_shift, tmp);
+	priv->glyph_misses++;
+
+	return tmp;
+}
+
+/**
+ * get_alpha_lut() - Get the pixel value for each alpha value
+ *
+ * Only white-on-black and the reverse are supported, so each alpha value
+ * maps to a grey which is ORed into (or ANDed with) the frame buffer.
+ *
+ * @priv:	Private data
+ * @vid_priv:	Video device, which must be 16bpp or 32bpp
+ * Return: table of 256 pixel values
+ */
+static const u32 *get_alpha_lut(struct console_tt_priv *priv,
+				struct video_priv *vid_priv)
+{
+	bool invert = vid_priv->colour_bg;
+	int i, val;
+
+	if (priv->lut_bpix == vid_priv->bpix && priv->lut_invert == invert)
+		return priv->alpha_lut;
+
+	for (i = 0; i < 256; i++) {
+		val = invert ? 255 - i : i;
+		if (vid_priv->bpix == VIDEO_BPP16)
+			priv->alpha_lut[i] = val >> 3 | (val >> 2) << 5 |
+				(val >> 3) << 11;
+		else
+			priv->alpha_lut[i] = val | val << 8 | val << 16;
+	}
+	priv->lut_bpix = vid_priv->bpix;
+	priv->lut_invert = invert;
+
+	return priv->alpha_lut;
+}
+
 static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 				    char ch)
 {
@@ -225,15 +413,18 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	struct console_tt_priv *priv = dev_get_priv(dev);
 	struct console_tt_metrics *met = priv->cur_met;
 	stbtt_fontinfo *font = &met->font;
+	struct console_tt_glyph *glyph, tmp;
 	int width, height, xoff, yoff;
 	double xpos, x_shift;
 	int lsb;
 	int width_frac, linenum;
 	struct pos_info *pos;
-	u8 *bits, *data;
+	const u32 *lut = NULL;
+	u8 *bits;
 	int advance;
-	void *start, *end, *line;
+	void *start, *line;
 	int row, ret;
+	u32 skip;
 
 	/* First get some basic metrics about this character */
 	stbtt_GetCodepointHMetrics(font, ch, &advance, &lsb);
@@ -269,31 +460,37 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	}
 
 	/*
-	 * Figure out how much past the start of a pixel we are, and pass this
-	 * information into the render, which will return a 8-bit-per-pixel
-	 * image of the character. For empty characters, like ' ', data will
-	 * return NULL;
+	 * Figure out how much past the start of a pixel we are, and use this
+	 * to get a 8-bit-per-pixel image of the character. For empty
+	 * characters, like ' ', there is no image.
 	 */
-	data = stbtt_GetCodepointBitmapSubpixel(font, met->scale, met->scale,
-						x_shift, 0, ch, &width, &height,
-						&xoff, &yoff);
-	if (!data)
+	glyph = get_glyph(priv, met, ch, x_shift, &tmp);
+	if (!glyph->bits)
 		return width_frac;
+	width = glyph->width;
+	height = glyph->height;
+	xoff = glyph->xoff;
+	yoff = glyph->yoff;
 
 	/* Figure out where to write the character in the frame buffer */
-	bits = data;
+	bits = glyph->bits;
 	start = vid_priv->fb + y * vid_priv->line_length +
 		VID_TO_PIXEL(x) * VNBYTES(vid_priv->bpix);
 	linenum = met->baseline + yoff;
 	if (linenum > 0)
 		start += linenum * vid_priv->line_length;
 	line = start;
+	if (vid_priv->bpix == VIDEO_BPP16 || vid_priv->bpix == VIDEO_BPP32)
+		lut = get_alpha_lut(priv, vid_priv);
 
 	/*
 	 * Write a row at a time, converting the 8bpp image into the colour
 	 * depth of the display. We only expect white-on-black or the reverse
-	 * so the code only handles this simple case.
+	 * so the code only handles this simple case: pixel values are ORed
+	 * into a black background or ANDed with a white one. Pixels where
+	 * this changes nothing are skipped.
 	 */
+	skip = vid_priv->colour_fg ? 0 : ~0U;
 	for (row = 0; row < height; row++) {
 		switch (vid_priv->bpix) {
 		case VIDEO_BPP8:
@@ -314,30 +511,25 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 						*dst++ &= out;
 					bits++;
 				}
-				end = dst;
 			}
 			break;
 #ifdef CONFIG_VIDEO_BPP16
 		case VIDEO_BPP16: {
 			uint16_t *dst = (uint16_t *)line + xoff;
+			u16 skip16 = skip;
 			int i;
 
 			for (i = 0; i < width; i++) {
-				int val = *bits;
-				int out;
-
-				if (vid_priv->colour_bg)
-					val = 255 - val;
-				out = val >> 3 |
-					(val >> 2) << 5 |
-					(val >> 3) << 11;
+				u16 out = lut[bits[i]];
+
+				if (out == skip16)
+					continue;
 				if (vid_priv->colour_fg)
-					*dst++ |= out;
+					dst[i] |= out;
 				else
-					*dst++ &= out;
-				bits++;
+					dst[i] &= out;
 			}
-			end = dst;
+			bits += width;
 			break;
 		}
 #endif
@@ -347,35 +539,36 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 			int i;
 
 			for (i = 0; i < width; i++) {
-				int val = *bits;
-				int out;
+				u32 out = lut[bits[i]];
 
-				if (vid_priv->colour_bg)
-					val = 255 - val;
-				out = val | val << 8 | val << 16;
+				if (out == skip)
+					continue;
 				if (vid_priv->colour_fg)
-					*dst++ |= out;
+					dst[i] |= out;
 				else
-					*dst++ &= out;
-				bits++;
+					dst[i] &= out;
 			}
-			end = dst;
+			bits += width;
 			break;
 		}
 #endif
 		default:
-			free(data);
-			return -ENOSYS;
+			ret = -ENOSYS;
+			goto done;
 		}
 
 		line += vid_priv->line_length;
 	}
+	video_damage(vid, VID_TO_PIXEL(x) + xoff, y + max(linenum, 0), width,
+		     height);
 	ret = vidconsole_sync_copy(dev, start, line);
-	if (ret)
-		return ret;
-	free(data);
+	if (!ret)
+		ret = width_frac;
+done:
+	if (glyph == &tmp)
+		free(tmp.bits);
 
-	return width_frac;
+	return ret;
 }
 
 /**
@@ -437,6 +630,7 @@ static int console_truetype_erase(struct udevice *dev, int xstart, int ystart,
 		}
 		line += vid_priv->line_length;
 	}
+	video_damage(dev->parent, xstart, ystart, xend - xstart, yend - ystart);
 	ret = vidconsole_sync_copy(dev, start, line);
 	if (ret)
 		return ret;
@@ -757,12 +951,45 @@ static int console_truetype_probe(struct udevice *dev)
 	return 0;
 }
 
+static int console_truetype_set_glyph_cache(struct udevice *dev, bool enable)
+{
+	struct console_tt_priv *priv = dev_get_priv(dev);
+
+	priv->glyph_off = !enable;
+	if (!enable)
+		glyph_cache_drop(priv);
+
+	return 0;
+}
+
+static int console_truetype_get_glyph_stats(struct udevice *dev, ulong *hitsp,
+					    ulong *missesp)
+{
+	struct console_tt_priv *priv = dev_get_priv(dev);
+
+	*hitsp = priv->glyph_hits;
+	*missesp = priv->glyph_misses;
+
+	return 0;
+}
+
+static int console_truetype_remove(struct udevice *dev)
+{
+	struct console_tt_priv *priv = dev_get_priv(dev);
+
+	glyph_cache_drop(priv);
+
+	return 0;
+}
+
 struct vidconsole_ops console_truetype_ops = {
 	.putc_xy	= console_truetype_putc_xy,
 	.move_rows	= console_truetype_move_rows,
 	.set_row	= console_truetype_set_row,
 	.backspace	= console_truetype_backspace,
 	.entry_start	= console_truetype_entry_start,
+	.set_glyph_cache = console_truetype_set_glyph_cache,
+	.get_glyph_stats = console_truetype_get_glyph_stats,
 };
 
 U_BOOT_DRIVER(vidconsole_truetype) = {
@@ -770,5 +997,6 @@ U_BOOT_DRIVER(vidconsole_truetype) = {
 	.id	= UCLASS_VIDEO_CONSOLE,
 	.ops	= &console_truetype_ops,
 	.probe	= console_truetype_probe,
+	.remove	= console_truetype_remove,
 	.priv_auto	= sizeof(struct console_tt_priv),
 };
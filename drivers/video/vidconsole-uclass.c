@@ -52,6 +52,25 @@ int vidconsole_set_row(struct udevice *dev, uint row, int clr)
 	return ops->set_row(dev, row, clr);
 }
 
+int vidconsole_set_glyph_cache(struct udevice *dev, bool enable)
+{
+	struct vidconsole_ops *ops = vidconsole_get_ops(dev);
+
+	if (!ops->set_glyph_cache)
+		return -ENOSYS;
+	return ops->set_glyph_cache(dev, enable);
+}
+
+int vidconsole_get_glyph_stats(struct udevice *dev, ulong *hitsp,
+			       ulong *missesp)
+{
+	struct vidconsole_ops *ops = vidconsole_get_ops(dev);
+
+	if (!ops->get_glyph_stats)
+		return -ENOSYS;
+	return ops->get_glyph_stats(dev, hitsp, missesp);
+}
+
 static int vidconsole_entry_start(struct udevice *dev)
 {
 	struct vidconsole_ops *ops = vidconsole_get_ops(dev);
@@ -154,6 +154,7 @@ int video_fill(struct udevice *dev, u32 colour)
 		memset(priv->fb, colour, priv->fb_size);
 		break;
 	}
+	video_damage(dev, 0, 0, priv->xsize, priv->ysize);
 	ret = video_sync_copy(dev, priv->fb, priv->fb + priv->fb_size);
 	if (ret)
 		return ret;
@@ -254,12 +255,155 @@ void video_set_default_colors(struct udevice *dev, bool invert)
 	priv->colour_bg = video_index_to_colour(priv, back);
 }
 
+#ifdef CONFIG_VIDEO_DAMAGE
+/* Check whether two rectangles overlap or touch */
+static bool vid_rect_touch(const struct vid_rect *a, const struct vid_rect *b)
+{
+	return a->xstart <= b->xend && b->xstart <= a->xend &&
+	       a->ystart <= b->yend && b->ystart <= a->yend;
+}
+
+/* Grow a rectangle to include another */
+static void vid_rect_add(struct vid_rect *rect, const struct vid_rect *other)
+{
+	rect->xstart = min(rect->xstart, other->xstart);
+	rect->ystart = min(rect->ystart, other->ystart);
+	rect->xend = max(rect->xend, other->xend);
+	rect->yend = max(rect->yend, other->yend);
+}
+
+static ulong vid_rect_area(const struct vid_rect *rect)
+{
+	return (ulong)(rect->xend - rect->xstart) * (rect->yend - rect->ystart);
+}
+
+void video_damage(struct udevice *vid, int x, int y, int width, int height)
+{
+	struct video_priv *priv = dev_get_uclass_priv(vid);
+	ulong grow, best_grow = ULONG_MAX;
+	struct vid_rect rect, merged;
+	int i, best = 0;
+
+	rect.xstart = max(x, 0);
+	rect.ystart = max(y, 0);
+	rect.xend = min(x + width, (int)priv->xsize);
+	rect.yend = min(y + height, (int)priv->ysize);
+	if (rect.xstart >= rect.xend || rect.ystart >= rect.yend)
+		return;
+
+	/*
+	 * Absorb the rectangles which this one touches, such as the previous
+	 * character on a line, starting again each time since it grows
+	 */
+	for (i = 0; i < priv->damage_count;) {
+		if (vid_rect_touch(&priv->damage[i], &rect)) {
+			vid_rect_add(&rect, &priv->damage[i]);
+			priv->damage[i] = priv->damage[--priv->damage_count];
+			i = 0;
+		} else {
+			i++;
+		}
+	}
+	if (priv->damage_count < VIDEO_DAMAGE_RECTS) {
+		priv->damage[priv->damage_count++] = rect;
+		return;
+	}
+
+	/* Otherwise add it to the rectangle which grows the least */
+	for (i = 0; i < VIDEO_DAMAGE_RECTS; i++) {
+		merged = priv->damage[i];
+		vid_rect_add(&merged, &rect);
+		grow = vid_rect_area(&merged) - vid_rect_area(&priv->damage[i]);
+		if (grow < best_grow) {
+			best_grow = grow;
+			best = i;
+		}
+	}
+	vid_rect_add(&priv->damage[best], &rect);
+}
+
+/**
+ * video_damage_span() - Get the bytes in each line of a damaged rectangle
+ *
+ * @priv:	Device information
+ * @rect:	Damaged rectangle
+ * @offsetp:	Returns the offset of the first byte in the frame buffer
+ * Return: number of bytes to sync in each line of @rect
+ */
+static ulong video_damage_span(struct video_priv *priv,
+			       const struct vid_rect *rect, ulong *offsetp)
+{
+	ulong start = rect->xstart * VNBITS(priv->bpix) / 8;
+	ulong end = DIV_ROUND_UP(rect->xend * VNBITS(priv->bpix), 8);
+
+	*offsetp = rect->ystart * priv->line_length + start;
+
+	return end - start;
+}
+
+/* Copy the damaged parts of the frame buffer to the copy frame buffer */
+static void video_copy_damage(struct video_priv *priv)
+{
+	ulong offset, len;
+	int i, y;
+
+	for (i = 0; i < priv->damage_count; i++) {
+		const struct vid_rect *rect = &priv->damage[i];
+
+		len = video_damage_span(priv, rect, &offset);
+		priv->sync_bytes += len * (rect->yend - rect->ystart);
+		if (!IS_ENABLED(CONFIG_VIDEO_COPY) || !priv->copy_fb)
+			continue;
+		for (y = rect->ystart; y < rect->yend; y++) {
+			memcpy(priv->copy_fb + offset, priv->fb + offset, len);
+			offset += priv->line_length;
+		}
+	}
+}
+
+#if defined(CONFIG_ARM) && !CONFIG_IS_ENABLED(SYS_DCACHE_OFF)
+/* Flush the damaged parts of the frame buffer from the data cache */
+static void video_flush_damage(struct video_priv *priv)
+{
+	ulong start, offset, len;
+	int i, y, lines;
+
+	for (i = 0; i < priv->damage_count; i++) {
+		const struct vid_rect *rect = &priv->damage[i];
+
+		len = video_damage_span(priv, rect, &offset);
+		lines = rect->yend - rect->ystart;
+		/* Whole lines are contiguous, so flush them in one go */
+		if (len == priv->line_length) {
+			len *= lines;
+			lines = 1;
+		}
+		for (y = 0; y < lines; y++) {
+			start = (ulong)priv->fb + offset;
+			flush_dcache_range(ALIGN_DOWN(start,
+						      CONFIG_SYS_CACHELINE_SIZE),
+					   ALIGN(start + len,
+						 CONFIG_SYS_CACHELINE_SIZE));
+			offset += priv->line_length;
+		}
+	}
+}
+#endif
+#endif /* CONFIG_VIDEO_DAMAGE */
+
 /* Flush video activity to the caches */
 int video_sync(struct udevice *vid, bool force)
 {
 	struct video_ops *ops = video_get_ops(vid);
+	struct video_priv *__maybe_unused priv = dev_get_uclass_priv(vid);
 	int ret;
 
+#ifdef CONFIG_VIDEO_DAMAGE
+	/* The frame buffer may have been written directly, e.g. by EFI */
+	if (force)
+		video_damage(vid, 0, 0, priv->xsize, priv->ysize);
+	video_copy_damage(priv);
+#endif
 	if (ops && ops->video_sync) {
 		ret = ops->video_sync(vid);
 		if (ret)
@@ -272,21 +416,25 @@ int video_sync(struct udevice *vid, bool force)
 	 * out whether it exists? For now, ARM is safe.
 	 */
 #if defined(CONFIG_ARM) && !CONFIG_IS_ENABLED(SYS_DCACHE_OFF)
-	struct video_priv *priv = dev_get_uclass_priv(vid);
-
 	if (priv->flush_dcache) {
+#ifdef CONFIG_VIDEO_DAMAGE
+		video_flush_damage(priv);
+#else
 		flush_dcache_range((ulong)priv->fb,
 				   ALIGN((ulong)priv->fb + priv->fb_size,
 					 CONFIG_SYS_CACHELINE_SIZE));
+#endif
 	}
 #elif defined(CONFIG_VIDEO_SANDBOX_SDL)
-	struct video_priv *priv = dev_get_uclass_priv(vid);
 	static ulong last_sync;
 
 	if (force || get_timer(last_sync) > 100) {
 		sandbox_sdl_sync(priv->fb);
 		last_sync = get_timer(0);
 	}
+#endif
+#ifdef CONFIG_VIDEO_DAMAGE
+	priv->damage_count = 0;
 #endif
 	return 0;
 }
@@ -381,7 +529,9 @@ int video_sync_copy(struct udevice *dev, void *from, void *to)
 			offset = 0;
 		}
 
-		memcpy(priv->copy_fb + offset, priv->fb + offset, size);
+		/* With damage tracking, video_sync() makes the copy */
+		if (!IS_ENABLED(CONFIG_VIDEO_DAMAGE))
+			memcpy(priv->copy_fb + offset, priv->fb + offset, size);
 	}
 
 	return 0;
@@ -391,7 +541,8 @@ int video_sync_copy_all(struct udevice *dev)
 {
 	struct video_priv *priv = dev_get_uclass_priv(dev);
 
-	video_sync_copy(dev, priv->fb, priv->fb + priv->fb_size);
+	if (priv->copy_fb)
+		memcpy(priv->copy_fb, priv->fb, priv->fb_size);
 
 	return 0;
 }
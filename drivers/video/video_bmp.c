@@ -6,12 +6,15 @@
 #include <common.h>
 #include <bmp_layout.h>
 #include <dm.h>
+#include <gzip.h>
 #include <log.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <splash.h>
 #include <video.h>
 #include <watchdog.h>
 #include <asm/unaligned.h>
+#include <u-boot/zlib.h>
 
 #define BMP_RLE8_ESCAPE		0
 #define BMP_RLE8_EOL		0
@@ -80,48 +83,185 @@ static void write_pix8(u8 *fb, uint bpix, enum video_format eformat,
 	}
 }
 
-static void draw_unencoded_bitmap(u8 **fbp, uint bpix,
-				  enum video_format eformat, uchar *bmap,
-				  struct bmp_color_table_entry *palette,
-				  int cnt)
+/**
+ * struct bmp_draw - Information for drawing a BMP image
+ *
+ * @bpix:	Frame buffer bits per pixel
+ * @bmp_bpix:	Image bits per pixel
+ * @eformat:	Frame buffer format
+ * @palette:	Image palette
+ * @x:		X position of the image on the display
+ * @y:		Y position of the image on the display
+ * @width:	Number of pixels drawn from each row, after clipping
+ * @height:	Number of rows drawn, after clipping
+ * @stride:	Number of bytes in each row of the image
+ * @lut:	Frame-buffer value for each palette entry, used for images
+ *		with a palette on 16bpp and 32bpp displays
+ */
+struct bmp_draw {
+	uint bpix;
+	uint bmp_bpix;
+	enum video_format eformat;
+	struct bmp_color_table_entry *palette;
+	int x;
+	int y;
+	ulong width;
+	ulong height;
+	ulong stride;
+	u32 lut[256];
+};
+
+/**
+ * bmp_setup_lut() - Convert the palette into frame-buffer values
+ *
+ * Looking up each pixel in a table of ready-made values avoids converting
+ * the same palette entry over and over.
+ *
+ * @draw:	Drawing information, with @bpix, @eformat and @palette set up
+ * @colours:	Number of entries in the palette
+ */
+static void bmp_setup_lut(struct bmp_draw *draw, uint colours)
 {
-	u8 *fb = *fbp;
+	struct bmp_color_table_entry *cte;
+	uint i;
+
+	memset(draw->lut, '\0', sizeof(draw->lut));
+	for (i = 0; i < min(colours, 256U); i++) {
+		cte = &draw->palette[i];
+		if (draw->bpix == 16)
+			draw->lut[i] = get_bmp_col_16bpp(*cte);
+		else if (draw->eformat == VIDEO_X2R10G10B10)
+			draw->lut[i] = get_bmp_col_x2r10g10b10(cte);
+		else
+			draw->lut[i] = cpu_to_le32(cte->blue | cte->green << 8 |
+						   cte->red << 16);
+	}
+}
+
+/**
+ * bmp_draw_row() - Draw pixels from a row of a BMP image
+ *
+ * Each combination of formats has its own loop, storing a whole pixel at a
+ * time, and rows in the frame-buffer format are copied directly.
+ *
+ * @draw:	Drawing information
+ * @fb:		Place in the frame buffer for the first pixel
+ * @bmap:	First pixel of the image to draw
+ * @width:	Number of pixels to draw
+ * Return: place in the frame buffer after the last pixel
+ */
+static u8 *bmp_draw_row(const struct bmp_draw *draw, u8 *fb, const u8 *bmap,
+			ulong width)
+{
+	ulong j;
 
-	while (cnt > 0) {
-		write_pix8(fb, bpix, eformat, palette, bmap++);
-		fb += bpix / 8;
-		cnt--;
+	switch (draw->bmp_bpix) {
+	case 1:
+	case 8:
+		if (draw->bpix == 16) {
+			u16 *dst = (u16 *)fb;
+
+			for (j = 0; j < width; j++)
+				dst[j] = draw->lut[bmap[j]];
+		} else if (draw->bpix == 32) {
+			u32 *dst = (u32 *)fb;
+
+			for (j = 0; j < width; j++)
+				dst[j] = draw->lut[bmap[j]];
+		} else if (draw->bpix == 8) {
+			memcpy(fb, bmap, width);
+		} else {
+			for (j = 0; j < width; j++) {
+				write_pix8(fb, draw->bpix, draw->eformat,
+					   draw->palette, (u8 *)bmap + j);
+				fb += draw->bpix / 8;
+			}
+			return fb;
+		}
+		break;
+	case 16:
+		memcpy(fb, bmap, width * 2);
+		break;
+	case 24:
+		if (draw->bpix == 16) {
+			u16 *dst = (u16 *)fb;
+
+			/* 16bit 565RGB format */
+			for (j = 0; j < width; j++, bmap += 3)
+				dst[j] = (bmap[2] >> 3) << 11 |
+					(bmap[1] >> 2) << 5 | bmap[0] >> 3;
+		} else if (draw->eformat == VIDEO_X2R10G10B10) {
+			u32 *dst = (u32 *)fb;
+
+			for (j = 0; j < width; j++, bmap += 3)
+				dst[j] = cpu_to_le32(bmap[0] << 2U |
+						     bmap[1] << 12U |
+						     bmap[2] << 22U);
+		} else {
+			u32 *dst = (u32 *)fb;
+
+			for (j = 0; j < width; j++, bmap += 3)
+				dst[j] = cpu_to_le32(bmap[0] | bmap[1] << 8 |
+						     bmap[2] << 16);
+		}
+		break;
+	case 32:
+		if (draw->eformat == VIDEO_X2R10G10B10) {
+			u32 *dst = (u32 *)fb;
+
+			for (j = 0; j < width; j++, bmap += 4)
+				dst[j] = cpu_to_le32(bmap[0] << 2U |
+						     bmap[1] << 12U |
+						     bmap[2] << 22U |
+						     (bmap[3] >> 6) << 30U);
+		} else {
+			memcpy(fb, bmap, width * 4);
+		}
+		break;
 	}
-	*fbp = fb;
+
+	return fb + width * draw->bpix / 8;
 }
 
-static void draw_encoded_bitmap(u8 **fbp, uint bpix, enum video_format eformat,
-				struct bmp_color_table_entry *palette, u8 *bmap,
-				int cnt)
+/* Draw a run of pixels which all have the same palette entry */
+static u8 *bmp_fill_run(const struct bmp_draw *draw, u8 *fb, u8 idx,
+			ulong count)
 {
-	u8 *fb = *fbp;
+	ulong j;
+
+	if (draw->bpix == 16) {
+		u16 *dst = (u16 *)fb;
+
+		for (j = 0; j < count; j++)
+			dst[j] = draw->lut[idx];
+	} else if (draw->bpix == 32) {
+		u32 *dst = (u32 *)fb;
 
-	while (cnt > 0) {
-		write_pix8(fb, bpix, eformat, palette, bmap);
-		fb += bpix / 8;
-		cnt--;
+		for (j = 0; j < count; j++)
+			dst[j] = draw->lut[idx];
+	} else {
+		for (j = 0; j < count; j++) {
+			write_pix8(fb, draw->bpix, draw->eformat,
+				   draw->palette, &idx);
+			fb += draw->bpix / 8;
+		}
+		return fb;
 	}
-	*fbp = fb;
+
+	return fb + count * draw->bpix / 8;
 }
 
 static void video_display_rle8_bitmap(struct udevice *dev,
-				      struct bmp_image *bmp, uint bpix,
-				      struct bmp_color_table_entry *palette,
-				      uchar *fb, int x_off, int y_off,
-				      ulong width, ulong height)
+				      struct bmp_image *bmp,
+				      const struct bmp_draw *draw, uchar *fb)
 {
 	struct video_priv *priv = dev_get_uclass_priv(dev);
+	ulong width = draw->width, height = draw->height;
 	uchar *bmap;
 	ulong cnt, runlen;
 	int x, y;
 	int decode = 1;
-	uint bytes_per_pixel = bpix / 8;
-	enum video_format eformat = priv->format;
+	uint bytes_per_pixel = draw->bpix / 8;
 
 	debug("%s\n", __func__);
 	bmap = (uchar *)bmp + get_unaligned_le32(&bmp->header.data_offset);
@@ -149,8 +289,8 @@ static void video_display_rle8_bitmap(struct udevice *dev,
 				x += bmap[2];
 				y -= bmap[3];
 				fb = (uchar *)(priv->fb +
-					(y + y_off - 1) * priv->line_length +
-					(x + x_off) * bytes_per_pixel);
+					(y + draw->y - 1) * priv->line_length +
+					(x + draw->x) * bytes_per_pixel);
 				bmap += 4;
 				break;
 			default:
@@ -163,9 +303,8 @@ static void video_display_rle8_bitmap(struct udevice *dev,
 							cnt = width - x;
 						else
 							cnt = runlen;
-						draw_unencoded_bitmap(
-							&fb, bpix, eformat,
-							bmap, palette, cnt);
+						fb = bmp_draw_row(draw, fb,
+								  bmap, cnt);
 					}
 					x += runlen;
 				}
@@ -189,9 +328,8 @@ static void video_display_rle8_bitmap(struct udevice *dev,
 						cnt = width - x;
 					else
 						cnt = runlen;
-					draw_encoded_bitmap(&fb, bpix, eformat,
-							    palette, &bmap[1],
-							    cnt);
+					fb = bmp_fill_run(draw, fb, bmap[1],
+							  cnt);
 				}
 				x += runlen;
 			}
@@ -239,39 +377,34 @@ void video_bmp_get_info(void *bmp_image, ulong *widthp, ulong *heightp,
 	*bpixp = get_unaligned_le16(&bmp->header.bit_count);
 }
 
-int video_bmp_display(struct udevice *dev, ulong bmp_image, int x, int y,
-		      bool align)
+/**
+ * bmp_setup() - Check a BMP image and work out how to draw it
+ *
+ * @priv:	Video device to draw on
+ * @bmp:	Image header, followed by the palette
+ * @x:		X position in pixels from the left, see video_bmp_display()
+ * @y:		Y position in pixels from the top, see video_bmp_display()
+ * @align:	true to adjust the coordinates, see video_bmp_display()
+ * @draw:	Returns the information for drawing the image
+ * Return: 0 if OK, -EINVAL if the display depth is not supported, -EPERM
+ *	if the image cannot be shown at this depth
+ */
+static int bmp_setup(struct video_priv *priv, struct bmp_image *bmp,
+		     int x, int y, bool align, struct bmp_draw *draw)
 {
-	struct video_priv *priv = dev_get_uclass_priv(dev);
-	int i, j;
-	uchar *start, *fb;
-	struct bmp_image *bmp = map_sysmem(bmp_image, 0);
-	uchar *bmap;
-	ushort padded_width;
-	unsigned long width, height, byte_width;
-	unsigned long pwidth = priv->xsize;
-	unsigned colours, bpix, bmp_bpix;
-	enum video_format eformat;
-	struct bmp_color_table_entry *palette;
+	ulong width, height, data_offset;
+	uint bpix, bmp_bpix;
 	int hdr_size;
-	int ret;
-
-	if (!bmp || !(bmp->header.signature[0] == 'B' &&
-	    bmp->header.signature[1] == 'M')) {
-		printf("Error: no valid bmp image at %lx\n", bmp_image);
-
-		return -EINVAL;
-	}
 
 	video_bmp_get_info(bmp, &width, &height, &bmp_bpix);
 	hdr_size = get_unaligned_le16(&bmp->header.size);
 	debug("hdr_size=%d, bmp_bpix=%d\n", hdr_size, bmp_bpix);
-	palette = (void *)bmp + 14 + hdr_size;
-
-	colours = 1 << bmp_bpix;
+	draw->palette = (void *)bmp + 14 + hdr_size;
 
 	bpix = VNBITS(priv->bpix);
-	eformat = priv->format;
+	draw->bpix = bpix;
+	draw->bmp_bpix = bmp_bpix;
+	draw->eformat = priv->format;
 
 	if (bpix != 1 && bpix != 8 && bpix != 16 && bpix != 32) {
 		printf("Error: %d bit/pixel mode, but BMP has %d bit/pixel\n",
@@ -291,144 +424,237 @@ int video_bmp_display(struct udevice *dev, ulong bmp_image, int x, int y,
 	    !(bmp_bpix == 24 && bpix == 16) &&
 	    !(bmp_bpix == 24 && bpix == 32)) {
 		printf("Error: %d bit/pixel mode, but BMP has %d bit/pixel\n",
-		       bpix, colours);
+		       bpix, 1 << bmp_bpix);
 		return -EPERM;
 	}
 
 	debug("Display-bmp: %d x %d  with %d colours, display %d\n",
-	      (int)width, (int)height, (int)colours, 1 << bpix);
+	      (int)width, (int)height, 1 << bmp_bpix, 1 << bpix);
 
-	padded_width = (width & 0x3 ? (width & ~0x3) + 4 : width);
+	/* Rows of 1bpp and 8bpp images are handled a byte per pixel */
+	if (bmp_bpix <= 8)
+		draw->stride = ALIGN(width, BMP_DATA_ALIGN);
+	else
+		draw->stride = ALIGN(width * (bmp_bpix / 8), BMP_DATA_ALIGN);
 
 	if (align) {
 		video_splash_align_axis(&x, priv->xsize, width);
 		video_splash_align_axis(&y, priv->ysize, height);
 	}
 
-	if ((x + width) > pwidth)
-		width = pwidth - x;
+	if ((x + width) > priv->xsize)
+		width = priv->xsize - x;
 	if ((y + height) > priv->ysize)
 		height = priv->ysize - y;
+	draw->x = x;
+	draw->y = y;
+	draw->width = width;
+	draw->height = height;
+
+	/* The palette lies between the header and the image data */
+	data_offset = get_unaligned_le32(&bmp->header.data_offset);
+	if (bmp_bpix <= 8 && (bpix == 16 || bpix == 32)) {
+		uint colours = 0;
+
+		if (data_offset > 14 + hdr_size)
+			colours = (data_offset - 14 - hdr_size) /
+				sizeof(struct bmp_color_table_entry);
+		bmp_setup_lut(draw, colours);
+	}
 
-	bmap = (uchar *)bmp + get_unaligned_le32(&bmp->header.data_offset);
-	start = (uchar *)(priv->fb +
-		(y + height) * priv->line_length + x * bpix / 8);
-
-	/* Move back to the final line to be drawn */
-	fb = start - priv->line_length;
+	return 0;
+}
 
+/* Check if this build can draw images with this many bits per pixel */
+static bool bmp_bpix_enabled(uint bmp_bpix)
+{
 	switch (bmp_bpix) {
 	case 1:
 	case 8:
-		if (IS_ENABLED(CONFIG_VIDEO_BMP_RLE8)) {
-			u32 compression = get_unaligned_le32(
-				&bmp->header.compression);
-			debug("compressed %d %d\n", compression, BMP_BI_RLE8);
-			if (compression == BMP_BI_RLE8) {
-				video_display_rle8_bitmap(dev, bmp, bpix, palette, fb,
-							  x, y, width, height);
-				break;
-			}
-		}
-
-		/* Not compressed */
-		byte_width = width * (bpix / 8);
-		if (!byte_width)
-			byte_width = width;
-
-		for (i = 0; i < height; ++i) {
-			schedule();
-			for (j = 0; j < width; j++) {
-				write_pix8(fb, bpix, eformat, palette, bmap);
-				bmap++;
-				fb += bpix / 8;
-			}
-			bmap += (padded_width - width);
-			fb -= byte_width + priv->line_length;
-		}
-		break;
+		return true;
 	case 16:
-		if (IS_ENABLED(CONFIG_BMP_16BPP)) {
-			for (i = 0; i < height; ++i) {
-				schedule();
-				for (j = 0; j < width; j++) {
-					*fb++ = *bmap++;
-					*fb++ = *bmap++;
-				}
-				bmap += (padded_width - width);
-				fb -= width * 2 + priv->line_length;
-			}
-		}
-		break;
+		return IS_ENABLED(CONFIG_BMP_16BPP);
 	case 24:
-		if (IS_ENABLED(CONFIG_BMP_24BPP)) {
-			for (i = 0; i < height; ++i) {
-				for (j = 0; j < width; j++) {
-					if (bpix == 16) {
-						/* 16bit 565RGB format */
-						*(u16 *)fb = ((bmap[2] >> 3)
-							<< 11) |
-							((bmap[1] >> 2) << 5) |
-							(bmap[0] >> 3);
-						bmap += 3;
-						fb += 2;
-					} else if (eformat == VIDEO_X2R10G10B10) {
-						u32 pix;
-
-						pix = *bmap++ << 2U;
-						pix |= *bmap++ << 12U;
-						pix |= *bmap++ << 22U;
-						*fb++ = pix & 0xff;
-						*fb++ = (pix >> 8) & 0xff;
-						*fb++ = (pix >> 16) & 0xff;
-						*fb++ = pix >> 24;
-					} else {
-						*fb++ = *bmap++;
-						*fb++ = *bmap++;
-						*fb++ = *bmap++;
-						*fb++ = 0;
-					}
-				}
-				fb -= priv->line_length + width * (bpix / 8);
-				bmap += (padded_width - width);
-			}
-		}
-		break;
+		return IS_ENABLED(CONFIG_BMP_24BPP);
 	case 32:
-		if (IS_ENABLED(CONFIG_BMP_32BPP)) {
-			for (i = 0; i < height; ++i) {
-				for (j = 0; j < width; j++) {
-					if (eformat == VIDEO_X2R10G10B10) {
-						u32 pix;
-
-						pix = *bmap++ << 2U;
-						pix |= *bmap++ << 12U;
-						pix |= *bmap++ << 22U;
-						pix |= (*bmap++ >> 6) << 30U;
-						*fb++ = pix & 0xff;
-						*fb++ = (pix >> 8) & 0xff;
-						*fb++ = (pix >> 16) & 0xff;
-						*fb++ = pix >> 24;
-					} else {
-						*fb++ = *bmap++;
-						*fb++ = *bmap++;
-						*fb++ = *bmap++;
-						*fb++ = *bmap++;
-					}
-				}
-				fb -= priv->line_length + width * (bpix / 8);
-			}
-		}
-		break;
-	default:
-		break;
-	};
+		return IS_ENABLED(CONFIG_BMP_32BPP);
+	}
+
+	return false;
+}
+
+/* Get the frame-buffer position of the bottom left of the image */
+static uchar *bmp_last_line(struct video_priv *priv,
+			    const struct bmp_draw *draw)
+{
+	return priv->fb + (draw->y + draw->height - 1) * priv->line_length +
+		draw->x * draw->bpix / 8;
+}
+
+/* Sync the area of the display where the image was drawn */
+static int bmp_sync(struct udevice *dev, const struct bmp_draw *draw)
+{
+	struct video_priv *priv = dev_get_uclass_priv(dev);
+	uchar *start, *fb;
+	int ret;
+
+	video_damage(dev, draw->x, draw->y, draw->width, draw->height);
 
 	/* Find the position of the top left of the image in the framebuffer */
-	fb = (uchar *)(priv->fb + y * priv->line_length + x * bpix / 8);
+	start = bmp_last_line(priv, draw) + priv->line_length;
+	fb = (uchar *)(priv->fb + draw->y * priv->line_length +
+		       draw->x * draw->bpix / 8);
 	ret = video_sync_copy(dev, start, fb);
 	if (ret)
 		return log_ret(ret);
 
 	return video_sync(dev, false);
 }
+
+int video_bmp_display(struct udevice *dev, ulong bmp_image, int x, int y,
+		      bool align)
+{
+	struct video_priv *priv = dev_get_uclass_priv(dev);
+	struct bmp_image *bmp = map_sysmem(bmp_image, 0);
+	struct bmp_draw draw;
+	uchar *bmap, *fb;
+	int ret;
+	ulong i;
+
+	if (!bmp || !(bmp->header.signature[0] == 'B' &&
+	    bmp->header.signature[1] == 'M')) {
+		printf("Error: no valid bmp image at %lx\n", bmp_image);
+
+		return -EINVAL;
+	}
+
+	ret = bmp_setup(priv, bmp, x, y, align, &draw);
+	if (ret)
+		return ret;
+
+	bmap = (uchar *)bmp + get_unaligned_le32(&bmp->header.data_offset);
+
+	/* Move back to the final line to be drawn */
+	fb = bmp_last_line(priv, &draw);
+
+	if (draw.bmp_bpix <= 8 && IS_ENABLED(CONFIG_VIDEO_BMP_RLE8) &&
+	    get_unaligned_le32(&bmp->header.compression) == BMP_BI_RLE8) {
+		debug("compressed %d\n", BMP_BI_RLE8);
+		video_display_rle8_bitmap(dev, bmp, &draw, fb);
+	} else if (bmp_bpix_enabled(draw.bmp_bpix)) {
+		for (i = 0; i < draw.height; i++) {
+			schedule();
+			bmp_draw_row(&draw, fb, bmap, draw.width);
+			bmap += draw.stride;
+			fb -= priv->line_length;
+		}
+	}
+
+	return bmp_sync(dev, &draw);
+}
+
+#ifdef CONFIG_VIDEO_BMP_GZIP
+/* Largest header and palette accepted in a compressed image */
+#define BMP_MAX_HDR_SIZE	(sizeof(struct bmp_header) + 0x100 + 256 * 4)
+
+/* Decompress exactly @len bytes */
+static int bmp_inflate(z_stream *s, void *dst, ulong len)
+{
+	int r;
+
+	s->next_out = dst;
+	s->avail_out = len;
+	do {
+		r = inflate(s, Z_SYNC_FLUSH);
+	} while (r == Z_OK && s->avail_out);
+	if (s->avail_out)
+		return log_msg_ret("inf", -EINVAL);
+
+	return 0;
+}
+
+int video_bmp_display_gzip(struct udevice *dev, ulong addr, ulong size, int x,
+			   int y, bool align)
+{
+	struct video_priv *priv = dev_get_uclass_priv(dev);
+	uchar *src = map_sysmem(addr, size);
+	struct bmp_image *bmp = NULL;
+	struct bmp_header hdr;
+	struct bmp_draw draw;
+	uchar *row = NULL, *fb;
+	ulong data_offset, i;
+	int offset, ret;
+	z_stream s;
+
+	if (size < 10 || src[0] != 0x1f || src[1] != 0x8b)
+		return log_msg_ret("gz", -EINVAL);
+	offset = gzip_parse_header(src, size);
+	if (offset < 0)
+		return log_msg_ret("hdr", -EINVAL);
+	memset(&s, '\0', sizeof(s));
+	s.zalloc = gzalloc;
+	s.zfree = gzfree;
+	if (inflateInit2(&s, -MAX_WBITS) != Z_OK)
+		return log_msg_ret("init", -EIO);
+	s.next_in = src + offset;
+	s.avail_in = size - offset;
+
+	ret = bmp_inflate(&s, &hdr, sizeof(hdr));
+	if (ret)
+		goto err;
+	data_offset = get_unaligned_le32(&hdr.data_offset);
+	if (hdr.signature[0] != 'B' || hdr.signature[1] != 'M' ||
+	    data_offset < sizeof(hdr) || data_offset > BMP_MAX_HDR_SIZE) {
+		ret = -EINVAL;
+		goto err;
+	}
+	/* Run-length-encoded images cannot be drawn a line at a time */
+	if (get_unaligned_le32(&hdr.compression) == BMP_BI_RLE8) {
+		ret = -EPROTONOSUPPORT;
+		goto err;
+	}
+
+	bmp = malloc(data_offset);
+	if (!bmp) {
+		ret = -ENOMEM;
+		goto err;
+	}
+	bmp->header = hdr;
+	ret = bmp_inflate(&s, (void *)bmp + sizeof(hdr),
+			  data_offset - sizeof(hdr));
+	if (ret)
+		goto err;
+	ret = bmp_setup(priv, bmp, x, y, align, &draw);
+	if (ret)
+		goto err;
+	if (!bmp_bpix_enabled(draw.bmp_bpix)) {
+		ret = -EPROTONOSUPPORT;
+		goto err;
+	}
+
+	row = malloc(draw.stride);
+	if (!row) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	/* Decompress each line straight into the frame buffer */
+	fb = bmp_last_line(priv, &draw);
+	for (i = 0; i < draw.height; i++) {
+		schedule();
+		ret = bmp_inflate(&s, row, draw.stride);
+		if (ret)
+			break;
+		bmp_draw_row(&draw, fb, row, draw.width);
+		fb -= priv->line_length;
+	}
+	if (!ret)
+		ret = bmp_sync(dev, &draw);
+err:
+	inflateEnd(&s);
+	free(row);
+	free(bmp);
+
+	return ret;
+}
+#endif
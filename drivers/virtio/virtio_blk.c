@@ -7,52 +7,153 @@
 #include <common.h>
 #include <blk.h>
 #include <dm.h>
+#include <malloc.h>
 #include <part.h>
 #include <virtio_types.h>
 #include <virtio.h>
 #include <virtio_ring.h>
 #include "virtio_blk.h"
 
+/**
+ * struct virtio_blk_req - a request queued to the device
+ *
+ * @out_hdr:	request header read by the device
+ * @status:	status written by the device
+ * @next:	next free request
+ * @start:	first block of the request, relative to the transfer
+ */
+struct virtio_blk_req {
+	struct virtio_blk_outhdr out_hdr;
+	u8 status;
+	struct virtio_blk_req *next;
+	lbaint_t start;
+};
+
+/**
+ * struct virtio_blk_priv - private data of a virtio block device
+ *
+ * @vq:		request virtqueue
+ * @reqs:	one request per descriptor of the virtqueue
+ * @free_reqs:	list of requests not queued to the device
+ * @sg:		scatter-gather entries of a request
+ * @sgs:	pointers to @sg passed to virtqueue_add()
+ * @size_max:	maximum size of a data segment in bytes
+ * @seg_max:	maximum number of data segments of a request
+ */
 struct virtio_blk_priv {
 	struct virtqueue *vq;
+	struct virtio_blk_req *reqs;
+	struct virtio_blk_req *free_reqs;
+	struct virtio_sg *sg;
+	struct virtio_sg **sgs;
+	u32 size_max;
+	u32 seg_max;
 };
 
-static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
-			       lbaint_t blkcnt, void *buffer, u32 type)
+static const u32 feature[] = {
+	VIRTIO_BLK_F_SIZE_MAX,
+	VIRTIO_BLK_F_SEG_MAX,
+};
+
+/**
+ * virtio_blk_add_req() - queue a request for part of a transfer
+ *
+ * The data is split into segments of at most size_max bytes.
+ *
+ * @dev:	virtio block device
+ * @req:	request to queue
+ * @sector:	first sector of the request
+ * @blkcnt:	number of blocks of the request
+ * @buffer:	data of the request
+ * @type:	VIRTIO_BLK_T_IN or VIRTIO_BLK_T_OUT
+ * Return:	0 if OK, -ENOSPC if the virtqueue is full
+ */
+static int virtio_blk_add_req(struct udevice *dev, struct virtio_blk_req *req,
+			      u64 sector, lbaint_t blkcnt, void *buffer,
+			      u32 type)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
-	unsigned int num_out = 0, num_in = 0;
-	struct virtio_sg *sgs[3];
-	u8 status;
-	int ret;
+	unsigned int num_out = 0, num_in = 0, n = 0;
+	size_t len = blkcnt * 512;
 
-	struct virtio_blk_outhdr out_hdr = {
-		.type = cpu_to_virtio32(dev, type),
-		.sector = cpu_to_virtio64(dev, sector),
-	};
-	struct virtio_sg hdr_sg = { &out_hdr, sizeof(out_hdr) };
-	struct virtio_sg data_sg = { buffer, blkcnt * 512 };
-	struct virtio_sg status_sg = { &status, sizeof(status) };
+	req->out_hdr.type = cpu_to_virtio32(dev, type);
+	req->out_hdr.ioprio = 0;
+	req->out_hdr.sector = cpu_to_virtio64(dev, sector);
 
-	sgs[num_out++] = &hdr_sg;
+	priv->sg[n].addr = &req->out_hdr;
+	priv->sg[n++].length = sizeof(req->out_hdr);
+	while (len) {
+		priv->sg[n].addr = buffer;
+		priv->sg[n].length = min_t(size_t, len, priv->size_max);
+		buffer += priv->sg[n].length;
+		len -= priv->sg[n++].length;
+	}
+	priv->sg[n].addr = &req->status;
+	priv->sg[n++].length = sizeof(req->status);
 
-	if (type & VIRTIO_BLK_T_OUT)
-		sgs[num_out++] = &data_sg;
-	else
-		sgs[num_out + num_in++] = &data_sg;
+	if (type & VIRTIO_BLK_T_OUT) {
+		num_out = n - 1;
+		num_in = 1;
+	} else {
+		num_out = 1;
+		num_in = n - 1;
+	}
 
-	sgs[num_out + num_in++] = &status_sg;
+	return virtqueue_add(priv->vq, priv->sgs, num_out, num_in);
+}
 
-	ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
-	if (ret)
-		return ret;
+/*
+ * Split the transfer into requests which respect the segment limits of the
+ * device and queue as many of them as the virtqueue takes before kicking
+ * the device once. Completed requests make room for the remaining ones.
+ */
+static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
+			       lbaint_t blkcnt, void *buffer, u32 type)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	lbaint_t max_blks = max_t(u64, (u64)priv->seg_max * priv->size_max /
+				  512, 1);
+	struct virtio_blk_req *req;
+	lbaint_t done = blkcnt;
+	lbaint_t pos = 0;
+	int inflight = 0;
+
+	while (pos < blkcnt || inflight) {
+		bool added = false;
 
-	virtqueue_kick(priv->vq);
+		while (pos < blkcnt && done == blkcnt && priv->free_reqs) {
+			lbaint_t n = min(blkcnt - pos, max_blks);
 
-	while (!virtqueue_get_buf(priv->vq, NULL))
-		;
+			req = priv->free_reqs;
+			if (virtio_blk_add_req(dev, req, sector + pos, n,
+					       buffer + pos * 512, type))
+				break;
+			priv->free_reqs = req->next;
+			req->start = pos;
+			pos += n;
+			inflight++;
+			added = true;
+		}
+		if (added)
+			virtqueue_kick(priv->vq);
+		if (!inflight) {
+			/* Nothing fits into an empty virtqueue */
+			done = min(done, pos);
+			break;
+		}
 
-	return status == VIRTIO_BLK_S_OK ? blkcnt : -EIO;
+		while (!(req = virtqueue_get_buf(priv->vq, NULL)))
+			;
+		do {
+			if (req->status != VIRTIO_BLK_S_OK)
+				done = min(done, req->start);
+			req->next = priv->free_reqs;
+			priv->free_reqs = req;
+			inflight--;
+		} while (inflight && (req = virtqueue_get_buf(priv->vq, NULL)));
+	}
+
+	return done;
 }
 
 static ulong virtio_blk_read(struct udevice *dev, lbaint_t start,
@@ -98,7 +199,8 @@ static int virtio_blk_bind(struct udevice *dev)
 	desc->bdev = dev;
 
 	/* Indicate what driver features we support */
-	virtio_driver_features_init(uc_priv, NULL, 0, NULL, 0);
+	virtio_driver_features_init(uc_priv, feature, ARRAY_SIZE(feature),
+				    NULL, 0);
 
 	return 0;
 }
@@ -107,6 +209,7 @@ static int virtio_blk_probe(struct udevice *dev)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	unsigned int num, i;
 	u64 cap;
 	int ret;
 
@@ -114,6 +217,37 @@ static int virtio_blk_probe(struct udevice *dev)
 	if (ret)
 		return ret;
 
+	/* Without indirect descriptors a request takes 2 + seg_max of them */
+	num = virtqueue_get_vring_size(priv->vq);
+	priv->seg_max = num - 2;
+	if (!virtio_cread_feature(dev, VIRTIO_BLK_F_SEG_MAX,
+				  struct virtio_blk_config, seg_max,
+				  &priv->seg_max))
+		priv->seg_max = clamp_t(u32, priv->seg_max, 1, num - 2);
+	priv->size_max = U32_MAX & ~511;
+	if (!virtio_cread_feature(dev, VIRTIO_BLK_F_SIZE_MAX,
+				  struct virtio_blk_config, size_max,
+				  &priv->size_max))
+		priv->size_max = max_t(u32, priv->size_max & ~511, 512);
+
+	priv->reqs = calloc(num, sizeof(*priv->reqs));
+	priv->sg = calloc(priv->seg_max + 2, sizeof(*priv->sg));
+	priv->sgs = calloc(priv->seg_max + 2, sizeof(*priv->sgs));
+	if (!priv->reqs || !priv->sg || !priv->sgs) {
+		free(priv->reqs);
+		free(priv->sg);
+		free(priv->sgs);
+		virtio_del_vqs(dev);
+		return -ENOMEM;
+	}
+	for (i = 0; i < priv->seg_max + 2; i++)
+		priv->sgs[i] = &priv->sg[i];
+	priv->free_reqs = NULL;
+	for (i = 0; i < num; i++) {
+		priv->reqs[i].next = priv->free_reqs;
+		priv->free_reqs = &priv->reqs[i];
+	}
+
 	desc->blksz = 512;
 	desc->log2blksz = 9;
 	virtio_cread(dev, struct virtio_blk_config, capacity, &cap);
@@ -122,6 +256,19 @@ static int virtio_blk_probe(struct udevice *dev)
 	return 0;
 }
 
+static int virtio_blk_remove(struct udevice *dev)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	int ret;
+
+	ret = virtio_reset(dev);
+	free(priv->reqs);
+	free(priv->sg);
+	free(priv->sgs);
+
+	return ret;
+}
+
 static const struct blk_ops virtio_blk_ops = {
 	.read	= virtio_blk_read,
 	.write	= virtio_blk_write,
@@ -133,7 +280,7 @@ U_BOOT_DRIVER(virtio_blk) = {
 	.ops	= &virtio_blk_ops,
 	.bind	= virtio_blk_bind,
 	.probe	= virtio_blk_probe,
-	.remove	= virtio_reset,
+	.remove	= virtio_blk_remove,
 	.priv_auto	= sizeof(struct virtio_blk_priv),
 	.flags	= DM_FLAG_ACTIVE_DMA,
 };
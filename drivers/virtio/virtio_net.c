@@ -6,14 +6,21 @@
 
 #include <common.h>
 #include <dm.h>
+#include <malloc.h>
 #include <net.h>
 #include <virtio_types.h>
 #include <virtio.h>
 #include <virtio_ring.h>
 #include "virtio_net.h"
 
-/* Amount of buffers to keep in the RX virtqueue */
-#define VIRTIO_NET_NUM_RX_BUFS	32
+/*
+ * Minimum amount of buffers to keep in the RX virtqueue. The ring is made
+ * deeper if more receive buffers are configured with SYS_RX_ETH_BUFFER.
+ */
+#define VIRTIO_NET_NUM_RX_BUFS	64
+
+/* Amount of packets which may be in flight in the TX virtqueue */
+#define VIRTIO_NET_NUM_TX_BUFS	16
 
 /*
  * This value comes from the VirtIO spec: 1500 for maximum packet size,
@@ -30,22 +37,35 @@ struct virtio_net_priv {
 		};
 	};
 
-	char rx_buff[VIRTIO_NET_NUM_RX_BUFS][VIRTIO_NET_RX_BUF_SIZE];
+	char *rx_buff;
+	int rx_num;
+	char *tx_buff;
+	int tx_num;
+	int tx_free[VIRTIO_NET_NUM_TX_BUFS];
+	int tx_free_num;
 	bool rx_running;
 	int net_hdr_len;
 };
 
 /*
- * For simplicity, the driver only negotiates the VIRTIO_NET_F_MAC feature.
+ * The driver negotiates the VIRTIO_NET_F_MAC feature and lets the device
+ * validate the checksum of received packets (VIRTIO_NET_F_GUEST_CSUM).
+ *
  * For the VIRTIO_NET_F_STATUS feature, we don't negotiate it, hence per spec
  * we should assume the link is always active.
+ *
+ * VIRTIO_NET_F_MRG_RXBUF is not negotiated: as no segmentation offload is
+ * enabled, each receive buffer holds a complete frame and the device never
+ * needs to merge several buffers for one packet.
  */
 static const u32 feature[] = {
-	VIRTIO_NET_F_MAC
+	VIRTIO_NET_F_MAC,
+	VIRTIO_NET_F_GUEST_CSUM,
 };
 
 static const u32 feature_legacy[] = {
-	VIRTIO_NET_F_MAC
+	VIRTIO_NET_F_MAC,
+	VIRTIO_NET_F_GUEST_CSUM,
 };
 
 static int virtio_net_start(struct udevice *dev)
@@ -60,8 +80,8 @@ static int virtio_net_start(struct udevice *dev)
 		sg.length = VIRTIO_NET_RX_BUF_SIZE;
 
 		/* setup the receive buffer address */
-		for (i = 0; i < VIRTIO_NET_NUM_RX_BUFS; i++) {
-			sg.addr = priv->rx_buff[i];
+		for (i = 0; i < priv->rx_num; i++) {
+			sg.addr = priv->rx_buff + i * VIRTIO_NET_RX_BUF_SIZE;
 			virtqueue_add(priv->rx_vq, sgs, 0, 1);
 		}
 
@@ -74,35 +94,61 @@ static int virtio_net_start(struct udevice *dev)
 	return 0;
 }
 
+/**
+ * virtio_net_tx_reclaim() - reclaim transmit buffers the device is done with
+ *
+ * @priv:	driver private data
+ * @wait:	true to wait until at least one transmit buffer is free
+ */
+static void virtio_net_tx_reclaim(struct virtio_net_priv *priv, bool wait)
+{
+	void *buf;
+
+	do {
+		while ((buf = virtqueue_get_buf(priv->tx_vq, NULL))) {
+			priv->tx_free[priv->tx_free_num++] =
+				(buf - (void *)priv->tx_buff) /
+				VIRTIO_NET_RX_BUF_SIZE;
+		}
+	} while (wait && !priv->tx_free_num);
+}
+
 static int virtio_net_send(struct udevice *dev, void *packet, int length)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
-	struct virtio_net_hdr hdr;
-	struct virtio_net_hdr_v1 hdr_v1;
 	struct virtio_sg hdr_sg;
-	struct virtio_sg data_sg = { packet, length };
+	struct virtio_sg data_sg;
 	struct virtio_sg *sgs[] = { &hdr_sg, &data_sg };
+	char *buf;
 	int ret;
 
-	if (priv->net_hdr_len == sizeof(struct virtio_net_hdr))
-		hdr_sg.addr = &hdr;
-	else
-		hdr_sg.addr = &hdr_v1;
-	hdr_sg.length = priv->net_hdr_len;
+	if (length > VIRTIO_NET_RX_BUF_SIZE - priv->net_hdr_len)
+		return -EINVAL;
 
+	/*
+	 * The packet is copied to a transmit buffer owned by the driver so
+	 * that we do not need to wait for the device to consume it. Completed
+	 * buffers are reclaimed in a batch when the next packet is sent.
+	 */
+	virtio_net_tx_reclaim(priv, true);
+	buf = priv->tx_buff +
+	      priv->tx_free[--priv->tx_free_num] * VIRTIO_NET_RX_BUF_SIZE;
+
+	hdr_sg.addr = buf;
+	hdr_sg.length = priv->net_hdr_len;
 	memset(hdr_sg.addr, 0, priv->net_hdr_len);
+	data_sg.addr = buf + priv->net_hdr_len;
+	data_sg.length = length;
+	memcpy(data_sg.addr, packet, length);
 
 	ret = virtqueue_add(priv->tx_vq, sgs, 2, 0);
-	if (ret)
+	if (ret) {
+		priv->tx_free_num++;
 		return ret;
+	}
 
 	virtqueue_kick(priv->tx_vq);
 
-	while (1) {
-		if (virtqueue_get_buf(priv->tx_vq, NULL))
-			break;
-	}
-
 	return 0;
 }
 
@@ -113,8 +159,24 @@ static int virtio_net_recv(struct udevice *dev, int flags, uchar **packetp)
 	void *buf;
 
 	buf = virtqueue_get_buf(priv->rx_vq, &len);
-	if (!buf)
+	if (!buf) {
+		/*
+		 * Notify the device about all buffers put back meanwhile. Skip
+		 * this if there are none, since the notification is an MMIO or
+		 * port write that traps to the hypervisor.
+		 */
+		if (priv->rx_vq->num_added)
+			virtqueue_kick(priv->rx_vq);
 		return -EAGAIN;
+	}
+
+	/*
+	 * Both the legacy and the v1 header start with the flags. A partial
+	 * checksum comes from a local sender which did not compute it.
+	 */
+	if (((struct virtio_net_hdr *)buf)->flags &
+	    (VIRTIO_NET_HDR_F_DATA_VALID | VIRTIO_NET_HDR_F_NEEDS_CSUM))
+		net_rx_csum_ok = true;
 
 	*packetp = buf + priv->net_hdr_len;
 	return len - priv->net_hdr_len;
@@ -127,7 +189,10 @@ static int virtio_net_free_pkt(struct udevice *dev, uchar *packet, int length)
 	struct virtio_sg sg = { buf, VIRTIO_NET_RX_BUF_SIZE };
 	struct virtio_sg *sgs[] = { &sg };
 
-	/* Put the buffer back to the rx ring */
+	/*
+	 * Put the buffer back to the rx ring. The device is notified once
+	 * the ring has been drained, see virtio_net_recv().
+	 */
 	virtqueue_add(priv->rx_vq, sgs, 0, 1);
 
 	return 0;
@@ -196,11 +261,31 @@ static int virtio_net_probe(struct udevice *dev)
 	struct virtio_net_priv *priv = dev_get_priv(dev);
 	struct virtio_dev_priv *uc_priv = dev_get_uclass_priv(dev->parent);
 	int ret;
+	int i;
 
 	ret = virtio_find_vqs(dev, 2, priv->vqs);
 	if (ret < 0)
 		return ret;
 
+	priv->rx_num = min_t(int, max(VIRTIO_NET_NUM_RX_BUFS, PKTBUFSRX),
+			     virtqueue_get_vring_size(priv->rx_vq));
+	priv->rx_buff = memalign(ARCH_DMA_MINALIGN,
+				 priv->rx_num * VIRTIO_NET_RX_BUF_SIZE);
+	/* Each packet takes a descriptor for the header and for the data */
+	priv->tx_num = min_t(int, VIRTIO_NET_NUM_TX_BUFS,
+			     virtqueue_get_vring_size(priv->tx_vq) / 2);
+	priv->tx_buff = memalign(ARCH_DMA_MINALIGN,
+				 priv->tx_num * VIRTIO_NET_RX_BUF_SIZE);
+	if (!priv->rx_buff || !priv->tx_buff) {
+		free(priv->rx_buff);
+		free(priv->tx_buff);
+		virtio_del_vqs(dev);
+		return -ENOMEM;
+	}
+	for (i = 0; i < priv->tx_num; i++)
+		priv->tx_free[i] = i;
+	priv->tx_free_num = priv->tx_num;
+
 	/*
 	 * For v1.0 compliant device, it always assumes the member
 	 * 'num_buffers' exists in the struct virtio_net_hdr while
@@ -216,6 +301,19 @@ static int virtio_net_probe(struct udevice *dev)
 	return 0;
 }
 
+static int virtio_net_remove(struct udevice *dev)
+{
+	struct virtio_net_priv *priv = dev_get_priv(dev);
+	int ret;
+
+	/* The device must not access the buffers once they are freed */
+	ret = virtio_reset(dev);
+	free(priv->rx_buff);
+	free(priv->tx_buff);
+
+	return ret;
+}
+
 static const struct eth_ops virtio_net_ops = {
 	.start = virtio_net_start,
 	.send = virtio_net_send,
@@ -231,7 +329,7 @@ U_BOOT_DRIVER(virtio_net) = {
 	.id	= UCLASS_ETH,
 	.bind	= virtio_net_bind,
 	.probe	= virtio_net_probe,
-	.remove = virtio_reset,
+	.remove = virtio_net_remove,
 	.ops	= &virtio_net_ops,
 	.priv_auto	= sizeof(struct virtio_net_priv),
 	.plat_auto	= sizeof(struct eth_pdata),
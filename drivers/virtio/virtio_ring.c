@@ -36,10 +36,46 @@ static unsigned int virtqueue_attach_desc(struct virtqueue *vq, unsigned int i,
 	return desc_shadow->next;
 }
 
+/**
+ * virtqueue_alloc_indirect() - set up an indirect descriptor table
+ *
+ * @vq:		the struct virtqueue we're talking about
+ * @sgs:	array of scatterlists
+ * @out_sgs:	the number of scatterlists readable by other side
+ * @in_sgs:	the number of scatterlists which are writable
+ * Return:	descriptor table, NULL if out of memory
+ */
+static struct vring_desc *virtqueue_alloc_indirect(struct virtqueue *vq,
+						   struct virtio_sg *sgs[],
+						   unsigned int out_sgs,
+						   unsigned int in_sgs)
+{
+	unsigned int n, total = out_sgs + in_sgs;
+	struct vring_desc *desc;
+
+	desc = memalign(VRING_DESC_ALIGN_SIZE, total * sizeof(*desc));
+	if (!desc)
+		return NULL;
+
+	for (n = 0; n < total; n++) {
+		u16 flags = n + 1 < total ? VRING_DESC_F_NEXT : 0;
+
+		if (n >= out_sgs)
+			flags |= VRING_DESC_F_WRITE;
+		desc[n].addr = cpu_to_virtio64(vq->vdev,
+					       (u64)(uintptr_t)sgs[n]->addr);
+		desc[n].len = cpu_to_virtio32(vq->vdev, sgs[n]->length);
+		desc[n].flags = cpu_to_virtio16(vq->vdev, flags);
+		desc[n].next = cpu_to_virtio16(vq->vdev, n + 1);
+	}
+
+	return desc;
+}
+
 int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		  unsigned int out_sgs, unsigned int in_sgs)
 {
-	struct vring_desc *desc;
+	struct vring_desc *desc, *indir = NULL;
 	unsigned int descs_used = out_sgs + in_sgs;
 	unsigned int i, n, avail, uninitialized_var(prev);
 	int head;
@@ -51,7 +87,19 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 	desc = vq->vring.desc;
 	i = head;
 
-	if (vq->num_free < descs_used) {
+	/* Chains of two buffers are not worth an allocation */
+	if (vq->indirect && descs_used > 2 && vq->num_free)
+		indir = virtqueue_alloc_indirect(vq, sgs, out_sgs, in_sgs);
+
+	if (indir) {
+		struct virtio_sg sg = { indir, descs_used * sizeof(*indir) };
+
+		i = virtqueue_attach_desc(vq, i, &sg, VRING_DESC_F_INDIRECT);
+		vq->vring_desc_shadow[head].indir = indir;
+		vq->vring_desc_shadow[head].indir_addr =
+			(u64)(uintptr_t)sgs[0]->addr;
+		descs_used = 1;
+	} else if (vq->num_free < descs_used) {
 		debug("Can't add buf len %i - avail = %i\n",
 		      descs_used, vq->num_free);
 		/*
@@ -62,20 +110,21 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		if (out_sgs)
 			virtio_notify(vq->vdev, vq);
 		return -ENOSPC;
+	} else {
+		for (n = 0; n < descs_used; n++) {
+			u16 flags = VRING_DESC_F_NEXT;
+
+			if (n >= out_sgs)
+				flags |= VRING_DESC_F_WRITE;
+			prev = i;
+			i = virtqueue_attach_desc(vq, i, sgs[n], flags);
+		}
+		/* Last one doesn't continue */
+		vq->vring_desc_shadow[prev].flags &= ~VRING_DESC_F_NEXT;
+		desc[prev].flags = cpu_to_virtio16(vq->vdev,
+				vq->vring_desc_shadow[prev].flags);
 	}
 
-	for (n = 0; n < descs_used; n++) {
-		u16 flags = VRING_DESC_F_NEXT;
-
-		if (n >= out_sgs)
-			flags |= VRING_DESC_F_WRITE;
-		prev = i;
-		i = virtqueue_attach_desc(vq, i, sgs[n], flags);
-	}
-	/* Last one doesn't continue */
-	vq->vring_desc_shadow[prev].flags &= ~VRING_DESC_F_NEXT;
-	desc[prev].flags = cpu_to_virtio16(vq->vdev, vq->vring_desc_shadow[prev].flags);
-
 	/* We're using some buffers from the free list. */
 	vq->num_free -= descs_used;
 
@@ -150,6 +199,12 @@ static void detach_buf(struct virtqueue *vq, unsigned int head)
 	/* Unmark the descriptor as the head of a chain. */
 	vq->vring_desc_shadow[head].chain_head = false;
 
+	/* An indirect table takes a single descriptor of the ring */
+	if (vq->vring_desc_shadow[head].indir) {
+		free(vq->vring_desc_shadow[head].indir);
+		vq->vring_desc_shadow[head].indir = NULL;
+	}
+
 	/* Put back on free list: unmap first-level descriptors and find end */
 	i = head;
 
@@ -175,6 +230,7 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 {
 	unsigned int i;
 	u16 last_used;
+	u64 addr;
 
 	if (!more_used(vq)) {
 		debug("(%s.%d): No more buffers in queue\n",
@@ -206,6 +262,11 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 		return NULL;
 	}
 
+	if (vq->vring_desc_shadow[i].indir)
+		addr = vq->vring_desc_shadow[i].indir_addr;
+	else
+		addr = vq->vring_desc_shadow[i].addr;
+
 	detach_buf(vq, i);
 	vq->last_used_idx++;
 	/*
@@ -217,7 +278,7 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 		virtio_store_mb(&vring_used_event(&vq->vring),
 				cpu_to_virtio16(vq->vdev, vq->last_used_idx));
 
-	return (void *)(uintptr_t)vq->vring_desc_shadow[i].addr;
+	return (void *)(uintptr_t)addr;
 }
 
 static struct virtqueue *__vring_new_virtqueue(unsigned int index,
@@ -252,6 +313,7 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	list_add_tail(&vq->list, &uc_priv->vqs);
 
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC);
 
 	/* Tell other side not to bother us */
 	vq->avail_flags_shadow |= VRING_AVAIL_F_NO_INTERRUPT;
@@ -314,6 +376,10 @@ struct virtqueue *vring_create_virtqueue(unsigned int index, unsigned int num,
 
 void vring_del_virtqueue(struct virtqueue *vq)
 {
+	unsigned int i;
+
+	for (i = 0; i < vq->vring.num; i++)
+		free(vq->vring_desc_shadow[i].indir);
 	free(vq->vring.desc);
 	free(vq->vring_desc_shadow);
 	list_del(&vq->list);
@@ -0,0 +1,555 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Environment stored as a log of changes
+ *
+ * Rewriting the whole environment to change one variable is slow on SPI
+ * flash and wears out its sectors. Instead, each copy of the environment
+ * area holds a full record with all variables, followed by delta records
+ * with the variables changed by each save. Records are only ever appended,
+ * so SPI flash is erased only when the log is compacted into a new full
+ * record.
+ *
+ * Each record has its own CRC and a sequence number one more than that of
+ * the record before it. Loading replays the copy with the latest record and
+ * stops at the first record which is not intact, so a save which is cut
+ * short by a power loss is dropped as a whole. With two copies, full records
+ * go to the copy which is not in use, so that the other one survives an
+ * interrupted compaction, as with CONFIG_SYS_REDUNDAND_ENVIRONMENT.
+ */
+
+#include <common.h>
+#include <env.h>
+#include <env_internal.h>
+#include <errno.h>
+#include <log.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <search.h>
+#include <asm/byteorder.h>
+#include <asm/global_data.h>
+#include <u-boot/crc.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define ENV_LOG_MAGIC	0x474f4c45	/* "ELOG" */
+
+enum env_log_type {
+	ENV_LOG_FULL	= 1,	/* all variables */
+	ENV_LOG_DELTA,		/* variables changed by one save */
+};
+
+/**
+ * struct env_log_hdr - header of a record, followed by its data
+ *
+ * The data is a list of "name=value" strings sorted by name, like the one
+ * in env_t, which ends with an empty string. In a delta record, "name="
+ * means that the variable was deleted.
+ *
+ * @magic:	ENV_LOG_MAGIC
+ * @crc:	CRC32 of the rest of the header and the data
+ * @seq:	sequence number of the record
+ * @type:	enum env_log_type
+ * @len:	length of the data in bytes
+ */
+struct env_log_hdr {
+	__le32 magic;
+	__le32 crc;
+	__le32 seq;
+	__le32 type;
+	__le32 len;
+};
+
+#define HDR_SIZE	sizeof(struct env_log_hdr)
+
+/**
+ * struct env_log_pos - records found in a copy
+ *
+ * @end:	offset after the last intact record
+ * @seq:	sequence number of the last intact record
+ * @base_len:	length of the data of the full record
+ * @delta_len:	total length of the data of the delta records
+ */
+struct env_log_pos {
+	ulong end;
+	u32 seq;
+	ulong base_len;
+	ulong delta_len;
+};
+
+static u32 env_log_crc(const struct env_log_hdr *hdr)
+{
+	u32 crc;
+
+	crc = crc32(0, (const u8 *)&hdr->seq,
+		    HDR_SIZE - offsetof(struct env_log_hdr, seq));
+
+	return crc32(crc, (const u8 *)(hdr + 1), le32_to_cpu(hdr->len));
+}
+
+/**
+ * env_log_record() - check a record in a copy
+ *
+ * @buf:	contents of the copy, CONFIG_ENV_SIZE bytes
+ * @offset:	offset of the record
+ * @type:	expected type of the record
+ * @seq:	expected sequence number, ignored for a full record
+ * Return:	header of the record, or NULL if it is not intact
+ */
+static const struct env_log_hdr *env_log_record(const char *buf, ulong offset,
+						enum env_log_type type,
+						u32 seq)
+{
+	const struct env_log_hdr *hdr = (const void *)(buf + offset);
+	const char *data = (const char *)(hdr + 1);
+	ulong len;
+
+	if (offset + HDR_SIZE > CONFIG_ENV_SIZE ||
+	    le32_to_cpu(hdr->magic) != ENV_LOG_MAGIC ||
+	    le32_to_cpu(hdr->type) != type)
+		return NULL;
+	if (type == ENV_LOG_DELTA && le32_to_cpu(hdr->seq) != seq)
+		return NULL;
+	len = le32_to_cpu(hdr->len);
+	if (!len || len > CONFIG_ENV_SIZE - offset - HDR_SIZE)
+		return NULL;
+	/* The list must end with an empty string */
+	if (data[len - 1] || (len > 1 && data[len - 2]))
+		return NULL;
+	if (env_log_crc(hdr) != le32_to_cpu(hdr->crc))
+		return NULL;
+
+	return hdr;
+}
+
+static ulong env_log_rec_size(struct env_log *elog, ulong len)
+{
+	return ALIGN(HDR_SIZE + len, elog->align);
+}
+
+/**
+ * env_log_scan() - find the intact records in a copy
+ *
+ * @elog:	log
+ * @buf:	contents of the copy, CONFIG_ENV_SIZE bytes
+ * @pos:	returns the records found
+ * Return:	true if the copy starts with an intact full record
+ */
+static bool env_log_scan(struct env_log *elog, const char *buf,
+			 struct env_log_pos *pos)
+{
+	const struct env_log_hdr *hdr;
+	ulong len;
+
+	hdr = env_log_record(buf, 0, ENV_LOG_FULL, 0);
+	if (!hdr)
+		return false;
+	pos->seq = le32_to_cpu(hdr->seq);
+	pos->base_len = le32_to_cpu(hdr->len);
+	pos->delta_len = 0;
+	pos->end = env_log_rec_size(elog, pos->base_len);
+
+	while ((hdr = env_log_record(buf, pos->end, ENV_LOG_DELTA,
+				     pos->seq + 1))) {
+		len = le32_to_cpu(hdr->len);
+		pos->seq++;
+		pos->delta_len += len;
+		pos->end += env_log_rec_size(elog, len);
+	}
+	pos->end = min_t(ulong, pos->end, CONFIG_ENV_SIZE);
+
+	return true;
+}
+
+/* Compare the names of two "name=value" strings, like strcmp() */
+static int env_log_keycmp(const char *a, const char *b)
+{
+	int ca, cb;
+
+	while (*a && *a != '=' && *a == *b) {
+		a++;
+		b++;
+	}
+	ca = *a == '=' ? 0 : (unsigned char)*a;
+	cb = *b == '=' ? 0 : (unsigned char)*b;
+
+	return ca - cb;
+}
+
+/* Get the length of a list of "name=value" strings, with its terminator */
+static ulong env_log_list_len(const char *list)
+{
+	const char *p;
+
+	for (p = list; *p; p += strlen(p) + 1)
+		;
+
+	return p + 1 - list;
+}
+
+/**
+ * env_log_merge() - apply the changes of a delta record to a list
+ *
+ * @dst:	returns the new list, ENV_SIZE bytes
+ * @base:	list of variables
+ * @delta:	changes to make to @base
+ * Return:	length of @dst, or -ENOSPC if it does not fit
+ */
+static int env_log_merge(char *dst, const char *base, const char *delta)
+{
+	char *p = dst, *end = dst + ENV_SIZE - 1;
+	const char *src;
+	ulong len;
+	int cmp;
+
+	while (*base || *delta) {
+		if (!*delta)
+			cmp = -1;
+		else if (!*base)
+			cmp = 1;
+		else
+			cmp = env_log_keycmp(base, delta);
+		src = cmp < 0 ? base : delta;
+		len = strlen(src) + 1;
+		if (cmp <= 0)
+			base += strlen(base) + 1;
+		if (cmp >= 0)
+			delta += len;
+
+		/* A variable without a value was deleted */
+		if (strchr(src, '=') == src + len - 2)
+			continue;
+		if (len > end - p)
+			return -ENOSPC;
+		memcpy(p, src, len);
+		p += len;
+	}
+	*p++ = '\0';
+
+	return p - dst;
+}
+
+/**
+ * env_log_diff() - list the variables which differ between two lists
+ *
+ * @dst:	returns the changes to make to @old to get @cur
+ * @size:	size of @dst in bytes
+ * @old:	old list of variables
+ * @cur:	current list of variables
+ * Return:	length of @dst, which is 1 if nothing changed, or -ENOSPC if
+ *		it does not fit
+ */
+static int env_log_diff(char *dst, ulong size, const char *old,
+			const char *cur)
+{
+	char *p = dst, *end = dst + size - 1;
+	ulong len;
+	int cmp;
+
+	while (*old || *cur) {
+		if (!*cur)
+			cmp = -1;
+		else if (!*old)
+			cmp = 1;
+		else
+			cmp = env_log_keycmp(old, cur);
+
+		if (cmp < 0) {
+			/* Deleted, so write "name=" */
+			len = strcspn(old, "=") + 1;
+			if (len + 1 > end - p)
+				return -ENOSPC;
+			memcpy(p, old, len - 1);
+			p[len - 1] = '=';
+			p[len] = '\0';
+			p += len + 1;
+		} else if (cmp > 0 || strcmp(old, cur)) {
+			len = strlen(cur) + 1;
+			if (len > end - p)
+				return -ENOSPC;
+			memcpy(p, cur, len);
+			p += len;
+		}
+		if (cmp <= 0)
+			old += strlen(old) + 1;
+		if (cmp >= 0)
+			cur += strlen(cur) + 1;
+	}
+	*p++ = '\0';
+
+	return p - dst;
+}
+
+/**
+ * env_log_replay() - get the list of variables from the records of a copy
+ *
+ * @elog:	log
+ * @buf:	contents of the copy, CONFIG_ENV_SIZE bytes
+ * @pos:	records found by env_log_scan()
+ * @textp:	buffer of ENV_SIZE bytes, which may be swapped with @tmpp;
+ *		returns the list, padded with '\0'
+ * @tmpp:	another buffer of ENV_SIZE bytes
+ * Return:	0 if OK, -ENOSPC if the list is too large
+ */
+static int env_log_replay(struct env_log *elog, const char *buf,
+			  struct env_log_pos *pos, char **textp, char **tmpp)
+{
+	const struct env_log_hdr *hdr = (const void *)buf;
+	ulong offset, len;
+	char *swap;
+	int ret;
+
+	len = le32_to_cpu(hdr->len);
+	if (len > ENV_SIZE)
+		return -ENOSPC;
+	memcpy(*textp, hdr + 1, len);
+
+	for (offset = env_log_rec_size(elog, len); offset < pos->end;
+	     offset += env_log_rec_size(elog, le32_to_cpu(hdr->len))) {
+		hdr = (const void *)(buf + offset);
+		ret = env_log_merge(*tmpp, *textp, (const char *)(hdr + 1));
+		if (ret < 0)
+			return ret;
+		len = ret;
+		swap = *textp;
+		*textp = *tmpp;
+		*tmpp = swap;
+	}
+	memset(*textp + len, '\0', ENV_SIZE - len);
+
+	return 0;
+}
+
+static bool env_log_erased(const char *buf, ulong size)
+{
+	while (size--) {
+		if ((u8)*buf++ != 0xff)
+			return false;
+	}
+
+	return true;
+}
+
+/* Load an environment which was saved without CONFIG_ENV_LOG */
+static int env_log_load_legacy(struct env_log *elog, char *const buf[],
+			       const int read_fail[], int flags)
+{
+	int ret;
+
+	if (IS_ENABLED(CONFIG_SYS_REDUNDAND_ENVIRONMENT) && elog->copies > 1) {
+		ret = env_import_redund(buf[0], read_fail[0], buf[1],
+					read_fail[1], flags);
+	} else if (read_fail[0]) {
+		env_set_default("read failed", 0);
+		ret = -EIO;
+	} else {
+		ret = env_import(buf[0], 1, flags);
+		if (!ret)
+			gd->env_valid = ENV_VALID;
+	}
+
+	/* The first full record goes to the copy which was not loaded */
+	elog->copy = !ret && gd->env_valid == ENV_REDUND ? 1 : 0;
+	if (ret && elog->copies > 1)
+		elog->copy = 1;
+
+	return ret;
+}
+
+void env_log_reset(struct env_log *elog)
+{
+	free(elog->saved);
+	elog->saved = NULL;
+	elog->compact = true;
+}
+
+int env_log_load(struct env_log *elog, int flags)
+{
+	struct env_log_pos pos[2], *best = NULL;
+	char *buf[2] = { NULL, NULL };
+	int read_fail[2] = { -EIO, -EIO };
+	char *text = NULL, *tmp = NULL;
+	int copy, ret;
+
+	env_log_reset(elog);
+	elog->seq = 0;
+
+	for (copy = 0; copy < elog->copies; copy++) {
+		buf[copy] = memalign(ARCH_DMA_MINALIGN, CONFIG_ENV_SIZE);
+		if (!buf[copy]) {
+			env_set_default("malloc() failed", 0);
+			ret = -ENOMEM;
+			goto out;
+		}
+		read_fail[copy] = elog->read(elog, copy, 0, CONFIG_ENV_SIZE,
+					     buf[copy]);
+		if (read_fail[copy] || !env_log_scan(elog, buf[copy], &pos[copy]))
+			continue;
+		if (!best || (s32)(pos[copy].seq - best->seq) > 0) {
+			best = &pos[copy];
+			elog->copy = copy;
+		}
+	}
+
+	if (!best) {
+		ret = env_log_load_legacy(elog, buf, read_fail, flags);
+		goto out;
+	}
+
+	text = malloc(ENV_SIZE);
+	tmp = malloc(ENV_SIZE);
+	if (!text || !tmp) {
+		env_set_default("malloc() failed", 0);
+		ret = -ENOMEM;
+		goto out;
+	}
+	ret = env_log_replay(elog, buf[elog->copy], best, &text, &tmp);
+	if (ret) {
+		env_set_default("log too large", 0);
+		goto out;
+	}
+	if (!himport_r(&env_htab, text, ENV_SIZE, '\0', flags, 0, 0, NULL)) {
+		pr_err("Cannot import environment: errno = %d\n", errno);
+		env_set_default("import failed", 0);
+		ret = -EIO;
+		goto out;
+	}
+	gd->flags |= GD_FLG_ENV_READY;
+	gd->env_valid = elog->copy ? ENV_REDUND : ENV_VALID;
+
+	elog->offset = best->end;
+	elog->seq = best->seq;
+	elog->base_len = best->base_len;
+	elog->delta_len = best->delta_len;
+	elog->saved = text;
+	text = NULL;
+	/*
+	 * A write cut short may have left bits programmed after the log,
+	 * which cannot be appended to before the copy is erased
+	 */
+	elog->compact = elog->erase &&
+		!env_log_erased(buf[elog->copy] + best->end,
+				CONFIG_ENV_SIZE - best->end);
+	log_debug("copy %d: seq %u, %lu bytes, %lu in deltas\n", elog->copy,
+		  elog->seq, elog->offset, elog->delta_len);
+
+out:
+	free(tmp);
+	free(text);
+	free(buf[1]);
+	free(buf[0]);
+
+	return ret;
+}
+
+/**
+ * env_log_write() - write a record
+ *
+ * @elog:	log
+ * @copy:	copy to write to
+ * @offset:	offset of the record
+ * @rec:	record with the data already after the header, with room to
+ *		pad it to a multiple of @elog->align
+ * @type:	type of the record
+ * @seq:	sequence number of the record
+ * @len:	length of the data
+ * Return:	0 if OK, -ve on error
+ */
+static int env_log_write(struct env_log *elog, int copy, ulong offset,
+			 char *rec, enum env_log_type type, u32 seq, ulong len)
+{
+	struct env_log_hdr *hdr = (struct env_log_hdr *)rec;
+	ulong size = env_log_rec_size(elog, len);
+
+	hdr->magic = cpu_to_le32(ENV_LOG_MAGIC);
+	hdr->seq = cpu_to_le32(seq);
+	hdr->type = cpu_to_le32(type);
+	hdr->len = cpu_to_le32(len);
+	hdr->crc = cpu_to_le32(env_log_crc(hdr));
+	/* Leave the padding erased */
+	memset(rec + HDR_SIZE + len, 0xff, size - HDR_SIZE - len);
+
+	return elog->write(elog, copy, offset, size, rec);
+}
+
+int env_log_save(struct env_log *elog)
+{
+	char *text, *rec, *data;
+	int copy, ret;
+	ulong len;
+
+	if (!elog->write)
+		return -ENOSYS;
+
+	text = malloc(ENV_SIZE);
+	rec = memalign(ARCH_DMA_MINALIGN, CONFIG_ENV_SIZE);
+	if (!text || !rec) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	data = rec + HDR_SIZE;
+	if (hexport_r(&env_htab, '\0', 0, &text, ENV_SIZE, 0, NULL) < 0) {
+		pr_err("Cannot export environment: errno = %d\n", errno);
+		ret = -EIO;
+		goto out;
+	}
+
+	if (elog->saved && !elog->compact) {
+		ret = env_log_diff(data, CONFIG_ENV_SIZE - HDR_SIZE, elog->saved,
+				   text);
+		if (ret == 1) {
+			ret = 0;
+			goto out;
+		}
+		len = ret;
+		/* Compact once replaying would take longer than the full list */
+		if (ret > 0 && elog->delta_len + len <= elog->base_len &&
+		    elog->offset + env_log_rec_size(elog, len) <=
+		    CONFIG_ENV_SIZE) {
+			ret = env_log_write(elog, elog->copy, elog->offset, rec,
+					    ENV_LOG_DELTA, elog->seq + 1, len);
+			if (!ret) {
+				elog->offset += env_log_rec_size(elog, len);
+				elog->seq++;
+				elog->delta_len += len;
+				goto done;
+			}
+			log_debug("Cannot append to copy %d (err=%d)\n",
+				  elog->copy, ret);
+		}
+	}
+
+	len = env_log_list_len(text);
+	if (len > CONFIG_ENV_SIZE - HDR_SIZE) {
+		ret = -ENOSPC;
+		goto out;
+	}
+	memcpy(data, text, len);
+	copy = elog->copies > 1 ? !elog->copy : 0;
+	elog->compact = true;
+	if (elog->erase) {
+		ret = elog->erase(elog, copy);
+		if (ret)
+			goto out;
+	}
+	ret = env_log_write(elog, copy, 0, rec, ENV_LOG_FULL, elog->seq + 1,
+			    len);
+	if (ret)
+		goto out;
+	elog->copy = copy;
+	elog->offset = env_log_rec_size(elog, len);
+	elog->seq++;
+	elog->base_len = len;
+	elog->delta_len = 0;
+	elog->compact = false;
+
+done:
+	free(elog->saved);
+	elog->saved = text;
+	text = NULL;
+	gd->env_valid = elog->copy ? ENV_REDUND : ENV_VALID;
+out:
+	free(rec);
+	free(text);
+
+	return ret;
+}
@@ -245,6 +245,7 @@ static inline int write_env(struct mmc *mmc, unsigned long size,
 	return (n == blk_cnt) ? 0 : -1;
 }
 
+#if !defined(CONFIG_ENV_LOG)
 static int env_mmc_save(void)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(env_t, env_new, 1);
@@ -297,6 +298,7 @@ fini:
 
 	return ret;
 }
+#endif /* !CONFIG_ENV_LOG */
 
 static inline int erase_env(struct mmc *mmc, unsigned long size,
 			    unsigned long offset)
@@ -316,6 +318,10 @@ static inline int erase_env(struct mmc *mmc, unsigned long size,
 	return (n == blk_cnt) ? 0 : 1;
 }
 
+#if defined(CONFIG_ENV_LOG) && !defined(ENV_IS_EMBEDDED)
+static struct env_log env_mmc_log;
+#endif
+
 static int env_mmc_erase(void)
 {
 	int dev = mmc_get_env_dev();
@@ -356,6 +362,9 @@ static int env_mmc_erase(void)
 	}
 
 fini:
+#if defined(CONFIG_ENV_LOG) && !defined(ENV_IS_EMBEDDED)
+	env_log_reset(&env_mmc_log);
+#endif
 	fini_mmc_for_env(mmc);
 	return ret;
 }
@@ -380,6 +389,113 @@ static int env_mmc_load(void)
 {
 	return 0;
 }
+#elif defined(CONFIG_ENV_LOG)
+static struct mmc *env_log_mmc;
+static u32 env_log_offset[2];
+
+static int env_mmc_log_part(int copy)
+{
+	if (IS_ENABLED(ENV_MMC_HWPART_REDUND))
+		return mmc_set_env_part(env_log_mmc, copy + 1);
+
+	return 0;
+}
+
+static int env_mmc_log_read(struct env_log *elog, int copy, ulong offset,
+			    ulong size, void *buf)
+{
+	int ret;
+
+	ret = env_mmc_log_part(copy);
+	if (ret)
+		return ret;
+
+	return read_env(env_log_mmc, size, env_log_offset[copy] + offset, buf);
+}
+
+#if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
+static int env_mmc_log_write(struct env_log *elog, int copy, ulong offset,
+			     ulong size, const void *buf)
+{
+	int ret;
+
+	ret = env_mmc_log_part(copy);
+	if (ret)
+		return ret;
+
+	return write_env(env_log_mmc, size, env_log_offset[copy] + offset, buf);
+}
+#endif
+
+static struct env_log env_mmc_log = {
+	.read	= env_mmc_log_read,
+#if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
+	.write	= env_mmc_log_write,
+#endif
+	.copies	= IS_ENABLED(CONFIG_SYS_REDUNDAND_ENVIRONMENT) ? 2 : 1,
+};
+
+/* Set up the MMC device and the location of each copy */
+static const char *env_mmc_log_init(void)
+{
+	const char *errmsg;
+	int copy;
+
+	env_log_mmc = find_mmc_device(mmc_get_env_dev());
+	errmsg = init_mmc_for_env(env_log_mmc);
+	if (errmsg)
+		return errmsg;
+
+	for (copy = 0; copy < env_mmc_log.copies; copy++) {
+		if (mmc_get_env_addr(env_log_mmc, copy,
+				     &env_log_offset[copy])) {
+			fini_mmc_for_env(env_log_mmc);
+			return "!invalid offset";
+		}
+	}
+	/* Each record is written with whole blocks */
+	env_mmc_log.align = env_log_mmc->write_bl_len;
+
+	return NULL;
+}
+
+static int env_mmc_load(void)
+{
+	const char *errmsg;
+	int ret;
+
+	mmc_initialize(NULL);
+
+	errmsg = env_mmc_log_init();
+	if (errmsg) {
+		env_set_default(errmsg, 0);
+		return -EIO;
+	}
+
+	ret = env_log_load(&env_mmc_log, H_EXTERNAL);
+	fini_mmc_for_env(env_log_mmc);
+
+	return ret;
+}
+
+#if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
+static int env_mmc_save(void)
+{
+	const char *errmsg;
+	int ret;
+
+	errmsg = env_mmc_log_init();
+	if (errmsg) {
+		printf("%s\n", errmsg);
+		return 1;
+	}
+
+	ret = env_log_save(&env_mmc_log);
+	fini_mmc_for_env(env_log_mmc);
+
+	return ret;
+}
+#endif
 #elif defined(CONFIG_SYS_REDUNDAND_ENVIRONMENT)
 static int env_mmc_load(void)
 {
@@ -28,9 +28,6 @@
 #ifdef CONFIG_ENV_OFFSET_REDUND
 #define ENV_OFFSET_REDUND	CONFIG_ENV_OFFSET_REDUND
 
-static ulong env_offset		= CONFIG_ENV_OFFSET;
-static ulong env_new_offset	= CONFIG_ENV_OFFSET_REDUND;
-
 #else
 
 #define ENV_OFFSET_REDUND	OFFSET_INVALID
@@ -65,7 +62,103 @@ static int setup_flash_device(struct spi_flash **env_flash)
 	return 0;
 }
 
-#if defined(CONFIG_ENV_OFFSET_REDUND)
+#if defined(CONFIG_ENV_LOG)
+static struct spi_flash *env_log_flash;
+
+static ulong env_sf_log_offset(int copy)
+{
+	return copy ? ENV_OFFSET_REDUND : CONFIG_ENV_OFFSET;
+}
+
+static int env_sf_log_read(struct env_log *elog, int copy, ulong offset,
+			   ulong size, void *buf)
+{
+	return spi_flash_read(env_log_flash, env_sf_log_offset(copy) + offset,
+			      size, buf);
+}
+
+static int env_sf_log_write(struct env_log *elog, int copy, ulong offset,
+			    ulong size, const void *buf)
+{
+	return spi_flash_write(env_log_flash, env_sf_log_offset(copy) + offset,
+			       size, buf);
+}
+
+static int env_sf_log_erase(struct env_log *elog, int copy)
+{
+	ulong offset = env_sf_log_offset(copy);
+	u32 sect_size = CONFIG_ENV_SECT_SIZE;
+	char *saved_buffer = NULL;
+	u32 saved_size = 0;
+	int ret;
+
+	if (IS_ENABLED(CONFIG_ENV_SECT_SIZE_AUTO))
+		sect_size = env_log_flash->mtd.erasesize;
+
+	/* Is the sector larger than the env (i.e. embedded) */
+	if (sect_size > CONFIG_ENV_SIZE) {
+		saved_size = sect_size - CONFIG_ENV_SIZE;
+		saved_buffer = memalign(ARCH_DMA_MINALIGN, saved_size);
+		if (!saved_buffer)
+			return -ENOMEM;
+		ret = spi_flash_read(env_log_flash, offset + CONFIG_ENV_SIZE,
+				     saved_size, saved_buffer);
+		if (ret)
+			goto done;
+	}
+
+	ret = spi_flash_erase(env_log_flash, offset,
+			      roundup(CONFIG_ENV_SIZE, sect_size));
+	if (!ret && saved_size)
+		ret = spi_flash_write(env_log_flash, offset + CONFIG_ENV_SIZE,
+				      saved_size, saved_buffer);
+
+done:
+	free(saved_buffer);
+
+	return ret;
+}
+
+static struct env_log env_sf_log = {
+	.read	= env_sf_log_read,
+	.write	= env_sf_log_write,
+	.erase	= env_sf_log_erase,
+	.copies	= ENV_OFFSET_REDUND != OFFSET_INVALID ? 2 : 1,
+	/* Keep records in separate flash words */
+	.align	= 16,
+};
+
+static int env_sf_save(void)
+{
+	int ret;
+
+	ret = setup_flash_device(&env_log_flash);
+	if (ret)
+		return ret;
+
+	ret = env_log_save(&env_sf_log);
+	spi_flash_free(env_log_flash);
+
+	return ret;
+}
+
+static int env_sf_load(void)
+{
+	int ret;
+
+	ret = setup_flash_device(&env_log_flash);
+	if (ret)
+		return ret;
+
+	ret = env_log_load(&env_sf_log, H_EXTERNAL);
+	spi_flash_free(env_log_flash);
+
+	return ret;
+}
+#elif defined(CONFIG_ENV_OFFSET_REDUND)
+static ulong env_offset		= CONFIG_ENV_OFFSET;
+static ulong env_new_offset	= CONFIG_ENV_OFFSET_REDUND;
+
 static int env_sf_save(void)
 {
 	env_t	env_new;
@@ -311,6 +404,9 @@ static int env_sf_erase(void)
 		ret = spi_flash_write(env_flash, ENV_OFFSET_REDUND, CONFIG_ENV_SIZE, &env);
 
 done:
+#if defined(CONFIG_ENV_LOG)
+	env_log_reset(&env_sf_log);
+#endif
 	spi_flash_free(env_flash);
 
 	return ret;
@@ -429,7 +525,13 @@ out:
 
 static int env_sf_init(void)
 {
-	int ret = env_sf_init_addr();
+	int ret;
+
+	/* A log cannot be checked in place, so it is only loaded later */
+	if (IS_ENABLED(CONFIG_ENV_LOG))
+		return -ENOENT;
+
+	ret = env_sf_init_addr();
 	if (ret != -ENOENT)
 		return ret;
 #ifdef CONFIG_ENV_SPI_EARLY
@@ -10,6 +10,7 @@
 #include <display_options.h>
 #include <errno.h>
 #include <common.h>
+#include <bootstage.h>
 #include <env.h>
 #include <lmb.h>
 #include <log.h>
@@ -580,6 +581,7 @@ static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 	void *buf;
+	int span;
 	int ret;
 
 #ifdef CONFIG_LMB
@@ -595,7 +597,9 @@ static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	 * means read the whole file.
 	 */
 	buf = map_sysmem(addr, len);
+	span = bootstage_span_begin(filename, "fs");
 	ret = info->read(filename, buf, offset, len, actread);
+	bootstage_span_end(span);
 	unmap_sysmem(buf);
 
 	/* If we requested a specific number of bytes, check we got it */
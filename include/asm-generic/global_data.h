@@ -260,6 +260,19 @@ struct global_data {
 	 */
 	struct device_node *of_root;
 #endif
+#if CONFIG_IS_ENABLED(OF_INDEX)
+	/**
+	 * @of_index: index of the control devicetree, see of_index_init()
+	 */
+	struct of_index *of_index;
+#endif
+#if CONFIG_IS_ENABLED(DM_COMPAT_HASH)
+	/**
+	 * @dm_compat: compatible strings of all drivers, see
+	 * lists_driver_lookup_compat()
+	 */
+	struct lists_compat *dm_compat;
+#endif
 
 #if CONFIG_IS_ENABLED(MULTI_DTB_FIT)
 	/**
@@ -314,6 +327,17 @@ struct global_data {
 	 * @malloc_ptr: current address of early malloc()
 	 */
 	unsigned long malloc_ptr;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
+	/**
+	 * @malloc_free: offset of the first free block of early malloc()
+	 * plus one, 0 if none
+	 */
+	unsigned long malloc_free;
+	/**
+	 * @malloc_peak: highest value of @malloc_ptr
+	 */
+	unsigned long malloc_peak;
+#endif
 #endif
 #ifdef CONFIG_PCI
 	/**
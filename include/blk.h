@@ -9,6 +9,7 @@
 
 #include <dm/uclass-id.h>
 #include <efi.h>
+#include <linux/errno.h>
 
 #ifdef CONFIG_SYS_64BIT_LBA
 typedef uint64_t lbaint_t;
@@ -143,6 +144,27 @@ void blkcache_fill(int iftype, int dev,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer);
 
+/**
+ * blkcache_fill_window() - make a read-ahead window available to the
+ * block cache
+ *
+ * Unlike blkcache_fill() the size of the window is not limited by the cache
+ * configuration and the data is not copied. Only one window is kept, it is
+ * replaced by the next one and discarded like all other cache entries.
+ *
+ * @param iftype - uclass_id_x for type of device
+ * @param dev - device index of particular type
+ * @param start - starting block number
+ * @param blkcnt - number of blocks available
+ * @param blksz - size in bytes of each block
+ * @param buffer - buffer allocated with malloc() containing data to cache
+ *
+ * Return: 0 if the cache took ownership of @buffer, -ve on error
+ */
+int blkcache_fill_window(int iftype, int dev,
+			 lbaint_t start, lbaint_t blkcnt,
+			 unsigned long blksz, void *buffer);
+
 /**
  * blkcache_invalidate() - discard the cache for a set of blocks
  * because of a write or device (re)initialization.
@@ -194,6 +216,13 @@ static inline void blkcache_fill(int iftype, int dev,
 				 lbaint_t start, lbaint_t blkcnt,
 				 unsigned long blksz, void const *buffer) {}
 
+static inline int blkcache_fill_window(int iftype, int dev,
+				       lbaint_t start, lbaint_t blkcnt,
+				       unsigned long blksz, void *buffer)
+{
+	return -ENOSYS;
+}
+
 static inline void blkcache_invalidate(int iftype, int dev) {}
 
 static inline void blkcache_free(void) {}
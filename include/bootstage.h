@@ -211,6 +211,7 @@ enum bootstage_id {
 	BOOTSTAGE_ID_ACCUM_FSP_M,
 	BOOTSTAGE_ID_ACCUM_FSP_S,
 	BOOTSTAGE_ID_ACCUM_MMAP_SPI,
+	BOOTSTAGE_ID_ACCUM_CONSOLE,
 
 	/* a few spare for the user, from here */
 	BOOTSTAGE_ID_USER,
@@ -331,6 +332,43 @@ uint32_t bootstage_start(enum bootstage_id id, const char *name);
  */
 uint32_t bootstage_accum(enum bootstage_id id);
 
+/**
+ * bootstage_span_begin() - Mark the start of a nested activity
+ *
+ * A span records the start and end time of an activity. Spans opened while
+ * another span is open are nested inside it, so that the export shows where
+ * the time of e.g. a device probe is spent. Spans are only recorded once
+ * full malloc() is available.
+ *
+ * @name: Name of the activity, copied and truncated if needed
+ * @cat: Category of the activity (e.g. "dm"), must be a static string
+ * Return: span number to pass to bootstage_span_end(), -1 if not recorded
+ */
+int bootstage_span_begin(const char *name, const char *cat);
+
+/**
+ * bootstage_span_end() - Mark the end of a nested activity
+ *
+ * @span: Span number returned by bootstage_span_begin(), -1 is ignored
+ */
+void bootstage_span_end(int span);
+
+/**
+ * bootstage_export_trace() - Export bootstage data as Chrome trace events
+ *
+ * Marks are written as instant events and spans as complete events in the
+ * JSON trace event format understood by chrome://tracing and Perfetto. The
+ * first line opens the event array, each following line holds one event
+ * and the last line closes the array, so that other traces can be merged
+ * easily (see 'proftool dump-chrome').
+ *
+ * @buf: Buffer to write to
+ * @size: Size of buffer
+ * Return: number of bytes written excluding the terminating nul, -ENOSPC if
+ *	the buffer is too small
+ */
+int bootstage_export_trace(char *buf, int size);
+
 /* Print a report about boot time */
 void bootstage_report(void);
 
@@ -430,6 +468,15 @@ static inline uint32_t bootstage_accum(enum bootstage_id id)
 	return 0;
 }
 
+static inline int bootstage_span_begin(const char *name, const char *cat)
+{
+	return -1;
+}
+
+static inline void bootstage_span_end(int span)
+{
+}
+
 static inline int bootstage_stash(void *base, int size)
 {
 	return 0;	/* Pretend to succeed */
@@ -20,6 +20,17 @@ int set_local_var(const char *s, int flg_export);
 void unset_local_var(const char *name);
 char *get_local_var(const char *s);
 
+/**
+ * hush_cache_enable() - Enable or disable the cache of parse trees
+ *
+ * With CONFIG_HUSH_PARSE_CACHE, the parse trees of scripts are kept so that
+ * running a script again skips the parser. Disabling the cache drops the
+ * trees, which allows comparing the two.
+ *
+ * @enable: true to keep parse trees
+ */
+void hush_cache_enable(bool enable);
+
 #if defined(CONFIG_HUSH_INIT_VAR)
 extern int hush_init_var (void);
 #endif
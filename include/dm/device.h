@@ -165,6 +165,9 @@ enum {
  *		automatically when the device is removed / unbound
  * @dma_offset: Offset between the physical address space (CPU's) and the
  *		device's bus address space
+ * @seq_node: Used by the uclass index to find the device by @seq_
+ * @ofnode_node: Used by the uclass index to find the device by @node_
+ * @phandle_node: Used by the uclass index to find the device by phandle
  */
 struct udevice {
 	const struct driver *driver;
@@ -194,6 +197,11 @@ struct udevice {
 #if CONFIG_IS_ENABLED(DM_DMA)
 	ulong dma_offset;
 #endif
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	struct hlist_node seq_node;
+	struct hlist_node ofnode_node;
+	struct hlist_node phandle_node;
+#endif
 };
 
 static inline int dm_udevice_size(void)
@@ -64,6 +64,34 @@ int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		   struct driver *drv, bool pre_reloc_only);
 
+/**
+ * lists_driver_lookup_compat() - find the driver for a compatible string
+ *
+ * This returns the first driver in the linker list with @compat in its
+ * of_match list. With CONFIG_DM_COMPAT_HASH this uses a hash table which
+ * is built on the first call.
+ *
+ * @compat: compatible string to look up
+ * @idp: returns the matching entry of the of_match list of the driver
+ * Return: driver, or NULL if no driver is compatible
+ */
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **idp);
+
+#if CONFIG_IS_ENABLED(DM_COMPAT_HASH)
+/**
+ * lists_compat_reset() - drop the compatible string hash table
+ *
+ * The table holds pointers to the drivers, so it must be dropped when they
+ * move, i.e. on relocation. It is built again when it is next needed.
+ */
+void lists_compat_reset(void);
+#else
+static inline void lists_compat_reset(void)
+{
+}
+#endif
+
 /**
  * device_bind_driver() - bind a device to a driver
  *
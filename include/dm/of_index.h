@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Index of the control devicetree
+ *
+ * The index maps phandles to nodes and records where frequently read
+ * properties are located in each node of a flat tree. It is built once by
+ * dm_init() and used by the ofnode and fdtdec functions. Lookups fall back
+ * to libfdt or the live tree when there is no index or it does not match
+ * the tree.
+ *
+ * Writes to the control FDT move nodes and properties, so the functions
+ * which change it call of_index_drop(). Code which changes the control FDT
+ * with libfdt directly must do the same.
+ */
+
+#ifndef _DM_OF_INDEX_H
+#define _DM_OF_INDEX_H
+
+#include <linux/libfdt.h>
+#include <linux/types.h>
+
+struct device_node;
+
+#if CONFIG_IS_ENABLED(OF_INDEX)
+/**
+ * of_index_init() - Build the index of the control devicetree
+ *
+ * This indexes the live tree if there is one, otherwise the flat tree. Any
+ * previous index is dropped.
+ *
+ * Return: 0 if OK, -ENOMEM if there is not enough memory
+ */
+int of_index_init(void);
+
+/**
+ * of_index_drop() - Drop the index of a flat tree which is being changed
+ *
+ * Lookups fall back to libfdt until of_index_init() is called again.
+ *
+ * @blob:	Flat tree which is changed; nothing is done if it is not the
+ *		indexed tree
+ */
+void of_index_drop(const void *blob);
+
+/**
+ * of_index_getprop() - Get a property of a node in a flat tree
+ *
+ * This is a replacement for fdt_getprop() which uses the index for
+ * frequently read properties of the control devicetree.
+ *
+ * @blob:	Flat tree
+ * @offset:	Offset of the node
+ * @name:	Name of the property
+ * @lenp:	If not NULL, returns the length of the property value, or a
+ *		negative libfdt error if it is not found
+ * Return: pointer to the property value, or NULL if not found
+ */
+const void *of_index_getprop(const void *blob, int offset, const char *name,
+			     int *lenp);
+
+/**
+ * of_index_node_offset_by_phandle() - Find a node of a flat tree by phandle
+ *
+ * This is a replacement for fdt_node_offset_by_phandle().
+ *
+ * @blob:	Flat tree
+ * @phandle:	Phandle to look up
+ * Return: offset of the node, or a negative libfdt error
+ */
+int of_index_node_offset_by_phandle(const void *blob, u32 phandle);
+
+/**
+ * of_index_find_node_by_phandle() - Find a node of the live tree by phandle
+ *
+ * @root:	Root of the tree to search, NULL for the control tree
+ * @phandle:	Phandle to look up
+ * Return: the node, or NULL if the index cannot answer the query; the caller
+ *	must then search the tree
+ */
+struct device_node *of_index_find_node_by_phandle(struct device_node *root,
+						  u32 phandle);
+#else
+static inline int of_index_init(void)
+{
+	return 0;
+}
+
+static inline void of_index_drop(const void *blob)
+{
+}
+
+static inline const void *of_index_getprop(const void *blob, int offset,
+					   const char *name, int *lenp)
+{
+	return fdt_getprop(blob, offset, name, lenp);
+}
+
+static inline int of_index_node_offset_by_phandle(const void *blob,
+						  u32 phandle)
+{
+	return fdt_node_offset_by_phandle(blob, phandle);
+}
+
+static inline struct device_node *
+of_index_find_node_by_phandle(struct device_node *root, u32 phandle)
+{
+	return NULL;
+}
+#endif
+
+#endif
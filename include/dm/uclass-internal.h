@@ -249,6 +249,21 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
 				  const char *name, struct udevice **devp);
 
+/**
+ * uclass_find_device_by_phandle_id() - Find a uclass device by phandle ID
+ *
+ * This searches the devices in the uclass for one with the given phandle.
+ *
+ * The device is NOT probed, it is merely returned.
+ *
+ * @id: ID to look up
+ * @phandle_id: Phandle of the device's devicetree node
+ * @devp: Returns pointer to device (there is only one for each node)
+ * Return: 0 if OK, -ve on error
+ */
+int uclass_find_device_by_phandle_id(enum uclass_id id, uint phandle_id,
+				     struct udevice **devp);
+
 /**
  * uclass_bind_device() - Associate device with a uclass
  *
@@ -259,6 +274,29 @@ int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
  */
 int uclass_bind_device(struct udevice *dev);
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+/**
+ * uclass_reindex_device() - Update the uclass index for a device
+ *
+ * Call this after changing the sequence number or devicetree node of a
+ * device which is already bound. Lookups trust the index, so the device is
+ * not found under its new keys until this is done.
+ *
+ * @dev:	Pointer to the device
+ */
+void uclass_reindex_device(struct udevice *dev);
+#else
+static inline void uclass_reindex_device(struct udevice *dev) {}
+#endif
+
+#if IS_ENABLED(CONFIG_UNIT_TEST)
+/*
+ * Number of devices compared by uclass_find_device_by_seq(),
+ * uclass_find_device_by_ofnode() and the phandle lookups, used by tests
+ */
+extern ulong uclass_find_compares;
+#endif
+
 #if CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)
 /**
  * uclass_pre_unbind_device() - Prepare to deassociate device with a uclass
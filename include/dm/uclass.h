@@ -30,12 +30,19 @@
  * @dev_head: List of devices in this uclass (devices are attached to their
  * uclass when their bind method is called)
  * @sibling_node: Next uclass in the linked list of uclasses
+ * @index: Hash tables to find devices by sequence number, ofnode and phandle,
+ * NULL until the uclass has enough devices to make an index worthwhile
+ * @dev_count: Number of devices in @dev_head
  */
 struct uclass {
 	void *priv_;
 	struct uclass_driver *uc_drv;
 	struct list_head dev_head;
 	struct list_head sibling_node;
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	struct hlist_head *index;
+	int dev_count;
+#endif
 };
 
 struct driver;
@@ -26,6 +26,18 @@ struct list_head;
  */
 int list_count_items(struct list_head *head);
 
+/**
+ * dm_alloc_optional() - Allocate a table which driver model can do without
+ *
+ * Before relocation this fails unless the table fits in half of the remaining
+ * early heap, which is needed to bind and probe devices. Tables allocated
+ * then are dropped at relocation, so they must not be freed afterwards.
+ *
+ * @size:	number of bytes to allocate
+ * Return: zeroed memory, or NULL if there is not enough
+ */
+void *dm_alloc_optional(size_t size);
+
 /* Dump out a tree of all devices */
 void dm_dump_tree(void);
 
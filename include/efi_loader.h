@@ -269,6 +269,7 @@ extern const efi_guid_t efi_guid_host_dev;
 #endif
 /* GUID of the EFI_BLOCK_IO_PROTOCOL */
 extern const efi_guid_t efi_block_io_guid;
+extern const efi_guid_t efi_block_io2_guid;
 extern const efi_guid_t efi_global_variable_guid;
 extern const efi_guid_t efi_guid_console_control;
 extern const efi_guid_t efi_guid_device_path;
@@ -357,12 +358,18 @@ struct efi_open_protocol_info_item {
  * @guid:		GUID of the protocol
  * @protocol_interface:	protocol interface
  * @open_infos:		link to the list of open protocol info items
+ * @index_link:		link to the list of handlers in the protocol index
+ * @handle:		handle on which the protocol is installed
+ * @hash:		hash of @guid, see efi_guid_hash()
  */
 struct efi_handler {
 	struct list_head link;
 	const efi_guid_t guid;
 	void *protocol_interface;
 	struct list_head open_infos;
+	struct list_head index_link;
+	efi_handle_t handle;
+	u32 hash;
 };
 
 /**
@@ -390,6 +397,9 @@ enum efi_object_type {
  *		handle
  * @type:	image type if the handle relates to an image
  * @dev:	pointer to the DM device which is associated with this EFI handle
+ * @hash_link:	link in the hash table used to validate handles
+ * @seq:	creation sequence number, keeps the protocol index in the order
+ *		of the object list
  *
  * UEFI offers a flexible and expandable object model. The objects in the UEFI
  * API are devices, drivers, and loaded images. struct efi_object is our storage
@@ -408,6 +418,8 @@ struct efi_object {
 	struct list_head protocols;
 	enum efi_object_type type;
 	struct udevice *dev;
+	struct hlist_node hash_link;
+	ulong seq;
 };
 
 enum efi_image_auth_status {
@@ -470,6 +482,10 @@ struct efi_event {
 
 /* This list contains all UEFI objects we know of */
 extern struct list_head efi_obj_list;
+#ifdef CONFIG_CMD_BOOTEFI_SELFTEST
+/* Number of protocol GUID comparisons, read by the protocol index selftest */
+extern ulong efi_protocol_compares;
+#endif
 /* List of all events */
 extern struct list_head efi_events;
 
@@ -136,6 +136,30 @@ struct efi_var_file {
 	struct efi_var_entry var[];
 };
 
+#define EFI_VAR_RECORD_MAGIC 0x64724556 /* VErd */
+
+/**
+ * struct efi_var_record - journal record in the UEFI variables file
+ *
+ * Changes of non-volatile variables are appended to the variables file as
+ * journal records following the struct efi_var_file snapshot. Records are
+ * replayed in order when the file is read. A record with @var.length == 0
+ * deletes the variable.
+ *
+ * @magic:	identifies a record, takes value %EFI_VAR_RECORD_MAGIC
+ * @length:	length of the record including header, multiple of 8
+ * @crc32:	CRC32 of @var and the variable data
+ * @reserved:	reserved, must be zero
+ * @var:	variable
+ */
+struct efi_var_record {
+	u32 magic;
+	u32 length;
+	u32 crc32;
+	u32 reserved;
+	struct efi_var_entry var;
+};
+
 /**
  * efi_var_to_file() - save non-volatile variables as file
  *
@@ -161,6 +185,36 @@ efi_status_t efi_var_to_file(void);
 efi_status_t __maybe_unused efi_var_collect(struct efi_var_file **bufp, loff_t *lenp,
 					    u32 check_attr_mask);
 
+/**
+ * efi_var_journal() - persist the change of a non-volatile variable
+ *
+ * A journal record with the current value of the variable is appended to
+ * the file ubootefi.var. If the variable does not exist anymore, a deletion
+ * record is written. The file is compacted via efi_var_to_file() if the
+ * journal is full or appending fails.
+ *
+ * @name:	name of the changed variable
+ * @guid:	vendor GUID of the changed variable
+ * Return:	status code
+ */
+efi_status_t efi_var_journal(const u16 *name, const efi_guid_t *guid);
+
+/**
+ * efi_var_replay() - restore EFI variables from a file with journal
+ *
+ * The snapshot at the start of @buf is restored with efi_var_restore().
+ * Then the journal records following it are applied in order. Replay stops
+ * at the first record that is truncated or has an invalid checksum, e.g.
+ * due to a power loss while writing it.
+ *
+ * @buf:	file contents
+ * @len:	length of the file contents
+ * @validp:	on success, length of the valid part of the file
+ * Return:	status code
+ */
+efi_status_t efi_var_replay(struct efi_var_file *buf, loff_t len,
+			    loff_t *validp);
+
 /**
  * efi_var_restore() - restore EFI variables from buffer
  *
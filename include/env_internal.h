@@ -193,6 +193,90 @@ struct env_driver {
 
 extern struct hsearch_data env_htab;
 
+/**
+ * struct env_log - Environment stored as a log of changes
+ *
+ * Each copy of the environment area is CONFIG_ENV_SIZE bytes. It holds a
+ * record with all variables, followed by records with the variables changed
+ * by each save (see env/log.c).
+ *
+ * The driver sets up these members:
+ *
+ * @read:	Read from a copy of the environment area
+ * @write:	Write to a copy of the environment area, NULL if the
+ *		environment cannot be saved
+ * @erase:	Erase a copy of the environment area, so that it can be
+ *		written again; NULL if the medium can be overwritten
+ * @copies:	Number of copies, 2 for a redundant environment
+ * @align:	Records start at a multiple of this number of bytes, which
+ *		must be a power of two and at least 4
+ *
+ * The rest is set up by env_log_load() and updated by env_log_save():
+ *
+ * @copy:	Copy holding the latest records
+ * @offset:	Offset in @copy where the next record goes
+ * @seq:	Sequence number of the latest record
+ * @base_len:	Length of the data of the full record in @copy
+ * @delta_len:	Total length of the data of the following records
+ * @saved:	List of variables in @copy, ENV_SIZE bytes, or NULL if the
+ *		environment was not loaded from a log
+ * @compact:	The next save must write a full record
+ */
+struct env_log {
+	int (*read)(struct env_log *elog, int copy, ulong offset, ulong size,
+		    void *buf);
+	int (*write)(struct env_log *elog, int copy, ulong offset, ulong size,
+		     const void *buf);
+	int (*erase)(struct env_log *elog, int copy);
+	int copies;
+	uint align;
+
+	int copy;
+	ulong offset;
+	u32 seq;
+	ulong base_len;
+	ulong delta_len;
+	char *saved;
+	bool compact;
+};
+
+/**
+ * env_log_load() - Load the environment from a log
+ *
+ * This replays the records of the copy with the latest intact record. If
+ * neither copy holds a log, the environment is loaded from the format used
+ * without CONFIG_ENV_LOG and converted by the next save. If that fails too,
+ * the default environment is used.
+ *
+ * @elog:	Log to load, with the driver members set up
+ * @flags:	Flags for himport_r(), e.g. H_EXTERNAL
+ * Return: 0 if OK, -ve on error
+ */
+int env_log_load(struct env_log *elog, int flags);
+
+/**
+ * env_log_reset() - Forget what the log holds
+ *
+ * Call this when the environment area was changed other than by
+ * env_log_save(), e.g. erased. The next save then writes a full record.
+ *
+ * @elog:	Log to reset
+ */
+void env_log_reset(struct env_log *elog);
+
+/**
+ * env_log_save() - Save the environment to a log
+ *
+ * This appends the variables which changed since the environment was loaded
+ * or last saved. If they do not fit, or the log has grown larger than the
+ * variables it describes, all variables are written in a new full record
+ * instead, to the other copy if there are two.
+ *
+ * @elog:	Log loaded by env_log_load()
+ * Return: 0 if OK, -ve on error
+ */
+int env_log_save(struct env_log *elog);
+
 /**
  * env_ext4_get_intf() - Provide the interface for env in EXT4
  *
@@ -895,11 +895,30 @@ void malloc_enable_testing(int max_allocs);
 /** malloc_disable_testing() - Put malloc() into normal mode */
 void malloc_disable_testing(void);
 
+/**
+ * malloc_enable_slab() - Enable or disable the slab front end of malloc()
+ *
+ * With CONFIG_SYS_MALLOC_SLAB, small requests are served from size-class
+ * slabs. When disabled, new requests go to the bins, which allows comparing
+ * the two. Existing allocations can still be freed.
+ *
+ * @enable: true to serve small requests from the slabs
+ */
+void malloc_enable_slab(bool enable);
+
+#if CONFIG_IS_ENABLED(UNIT_TEST)
+/*
+ * Number of requests to the dlmalloc bins plus the number of free chunks
+ * they inspected, used by tests
+ */
+extern ulong malloc_bin_steps;
+#endif
+
 #if CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)
 #define malloc malloc_simple
 #define realloc realloc_simple
 #define memalign memalign_simple
-#if IS_ENABLED(CONFIG_VALGRIND)
+#if IS_ENABLED(CONFIG_VALGRIND) || CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
 #define free free_simple
 #else
 static inline void free(void *ptr) {}
@@ -956,6 +975,49 @@ int initf_malloc(void);
 void *malloc_simple(size_t size);
 void *memalign_simple(size_t alignment, size_t bytes);
 
+/**
+ * malloc_simple_from() - allocate from the simple pool for a caller
+ *
+ * With CONFIG_SYS_MALLOC_F_STATS the allocation is counted for @caller,
+ * which is used by malloc() to count it for its own caller.
+ *
+ * @size: number of bytes to allocate
+ * @caller: return address of the call which needs the memory
+ * Return: allocated memory, or NULL if the pool is full
+ */
+void *malloc_simple_from(size_t size, void *caller);
+
+/**
+ * malloc_simple_avail() - get the largest block left in the simple pool
+ *
+ * This is the size of the unused part of the pool at its top, less the
+ * header of the block with CONFIG_SYS_MALLOC_F_FREE and the table of
+ * callers with CONFIG_SYS_MALLOC_F_STATS. Freed blocks below the top are
+ * not included.
+ *
+ * Return: largest number of bytes which malloc() can allocate at the top
+ */
+ulong malloc_simple_avail(void);
+
+/**
+ * memalign_simple_from() - allocate aligned memory for a caller
+ *
+ * @alignment: alignment of the memory
+ * @bytes: number of bytes to allocate
+ * @caller: return address of the call which needs the memory
+ * Return: allocated memory, or NULL if the pool is full
+ */
+void *memalign_simple_from(size_t alignment, size_t bytes, void *caller);
+
+/**
+ * free_simple() - free memory from the simple pool
+ *
+ * The memory is only reused with CONFIG_SYS_MALLOC_F_FREE.
+ *
+ * @ptr: memory to free, may be NULL
+ */
+void free_simple(void *ptr);
+
 #pragma GCC visibility push(hidden)
 # if __STD_C
 
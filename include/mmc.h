@@ -74,6 +74,7 @@ struct bd_info;
 #define MMC_CAP_NONREMOVABLE	BIT(14)
 #define MMC_CAP_NEEDS_POLL	BIT(15)
 #define MMC_CAP_CD_ACTIVE_HIGH  BIT(16)
+#define MMC_CAP_CMD23		BIT(17)	/* Supports SET_BLOCK_COUNT */
 
 #define MMC_MODE_8BIT		BIT(30)
 #define MMC_MODE_4BIT		BIT(29)
@@ -82,6 +83,7 @@ struct bd_info;
 
 
 #define SD_DATA_4BIT	0x00040000
+#define SD_CMD23_SUPPORT	0x00000002
 
 #define IS_SD(x)	((x)->version & SD_VERSION_SD)
 #define IS_MMC(x)	((x)->version & MMC_VERSION_MMC)
@@ -493,6 +495,28 @@ struct dm_mmc_ops {
 	int (*execute_tuning)(struct udevice *dev, uint opcode);
 #endif
 
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+	/**
+	 * get_tuning() - Read back the result of the last tuning
+	 *
+	 * @dev:	Device to read from
+	 * @buf:	Buffer for the host specific tuning result
+	 * @size:	Size of @buf in bytes
+	 * @return number of bytes written to @buf, -ve on error
+	 */
+	int (*get_tuning)(struct udevice *dev, void *buf, int size);
+
+	/**
+	 * set_tuning() - Apply a tuning result read by get_tuning()
+	 *
+	 * @dev:	Device to configure
+	 * @buf:	Tuning result
+	 * @size:	Number of bytes in @buf
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*set_tuning)(struct udevice *dev, const void *buf, int size);
+#endif
+
 	/**
 	 * wait_dat0() - wait until dat0 is in the target state
 	 *		(CLK must be running during the wait)
@@ -548,6 +572,8 @@ int mmc_set_ios(struct mmc *mmc);
 int mmc_getcd(struct mmc *mmc);
 int mmc_getwp(struct mmc *mmc);
 int mmc_execute_tuning(struct mmc *mmc, uint opcode);
+int mmc_get_tuning(struct mmc *mmc, void *buf, int size);
+int mmc_set_tuning(struct mmc *mmc, const void *buf, int size);
 int mmc_wait_dat0(struct mmc *mmc, int state, int timeout_us);
 int mmc_set_enhanced_strobe(struct mmc *mmc);
 int mmc_host_power_cycle(struct mmc *mmc);
@@ -731,6 +757,10 @@ struct mmc {
 				  */
 	u32 quirks;
 	u8 hs400_tuning;
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+	const u8 *tuning_data;	/* cached tuning result to try first */
+	int tuning_len;
+#endif
 
 	enum bus_mode user_speed_mode; /* input speed mode from user */
 };
@@ -118,6 +118,22 @@ struct eth_pdata {
 	void *priv_pdata;
 };
 
+/**
+ * struct eth_rx_pkt - a packet returned by the recv_batch() operation
+ *
+ * @packet:	packet buffer; if @payload is set it only holds the headers
+ * @length:	length of the packet, including a payload placed elsewhere
+ * @payload:	UDP payload placed at the address provided by net_rx_dest(),
+ *		NULL if the packet is contiguous in @packet
+ * @csum_ok:	true if the driver has verified the checksums of the packet
+ */
+struct eth_rx_pkt {
+	uchar *packet;
+	int length;
+	void *payload;
+	bool csum_ok;
+};
+
 enum eth_recv_flags {
 	/*
 	 * Check hardware device for new packets (otherwise only return those
@@ -126,6 +142,19 @@ enum eth_recv_flags {
 	ETH_RECV_CHECK_DEVICE		= 1 << 0,
 };
 
+/**
+ * enum eth_caps - offload capabilities of Ethernet MAC controllers
+ *
+ * @ETH_CAP_RX_CSUM:	the hardware verifies the IP, UDP and TCP checksums of
+ *			all received packets and drops packets with a bad
+ *			checksum, so the network stack skips the software
+ *			verification. Drivers which can only verify some
+ *			packets report that per packet, see net_rx_csum_ok
+ */
+enum eth_caps {
+	ETH_CAP_RX_CSUM			= 1 << 0,
+};
+
 /**
  * struct eth_ops - functions of Ethernet MAC controllers
  *
@@ -136,6 +165,13 @@ enum eth_recv_flags {
  *	 indicate that the hardware receive FIFO is empty. If 0 is returned, the
  *	 network stack will not process the empty packet, but free_pkt() will be
  *	 called if supplied
+ * recv_batch: Return up to "count" received packets at once in the "pkts"
+ *	       array. Return the number of packets, 0 if there is none, or an
+ *	       error. The network stack processes all of them before calling
+ *	       free_pkt() for each packet. A driver which copies packets out of
+ *	       its receive ring may use net_rx_dest() to place UDP payloads at
+ *	       their final destination. Return -ENOSYS to have recv used
+ *	       instead - optional, recv is used if not provided
  * free_pkt: Give the driver an opportunity to manage its packet buffer memory
  *	     when the network stack is finished processing it. This will only be
  *	     called when no error was returned from recv - optional
@@ -152,17 +188,21 @@ enum eth_recv_flags {
  *		    to the network stack. This function should fill in the
  *		    eth_pdata::enetaddr field - optional
  * set_promisc: Enable or Disable promiscuous mode
+ * caps: Offload capabilities of the hardware, see enum eth_caps
  */
 struct eth_ops {
 	int (*start)(struct udevice *dev);
 	int (*send)(struct udevice *dev, void *packet, int length);
 	int (*recv)(struct udevice *dev, int flags, uchar **packetp);
+	int (*recv_batch)(struct udevice *dev, int flags,
+			  struct eth_rx_pkt *pkts, int count);
 	int (*free_pkt)(struct udevice *dev, uchar *packet, int length);
 	void (*stop)(struct udevice *dev);
 	int (*mcast)(struct udevice *dev, const u8 *enetaddr, int join);
 	int (*write_hwaddr)(struct udevice *dev);
 	int (*read_rom_hwaddr)(struct udevice *dev);
 	int (*set_promisc)(struct udevice *dev, bool enable);
+	u32 caps;
 };
 
 #define eth_get_ops(dev) ((struct eth_ops *)(dev)->driver->ops)
@@ -478,6 +518,8 @@ extern uchar		*net_tx_packet;		/* THE transmit packet */
 extern uchar		*net_rx_packets[PKTBUFSRX]; /* Receive packets */
 extern uchar		*net_rx_packet;		/* Current receive packet */
 extern int		net_rx_packet_len;	/* Current rx packet length */
+extern bool		net_rx_csum_ok;		/* Rx checksums verified */
+extern void		*net_rx_payload;	/* Rx payload placed by driver */
 extern const u8		net_bcast_ethaddr[ARP_HLEN];	/* Ethernet broadcast address */
 extern const u8		net_null_ethaddr[ARP_HLEN];
 
@@ -554,7 +596,7 @@ void net_set_udp_header(uchar *pkt, struct in_addr dest, int dport,
 /**
  * compute_ip_checksum() - Compute IP checksum
  *
- * @addr:	Address to check (must be 16-bit aligned)
+ * @addr:	Address to check, there is no alignment requirement
  * @nbytes:	Number of bytes to check (normally a multiple of 2)
  * Return: 16-bit IP checksum
  */
@@ -581,9 +623,45 @@ unsigned add_ip_checksums(unsigned offset, unsigned sum, unsigned new_sum);
  */
 int ip_checksum_ok(const void *addr, unsigned nbytes);
 
+/**
+ * rxhand_dest_f() - get the final destination of a UDP payload
+ *
+ * This is called by drivers through net_rx_dest() before the packet is
+ * processed. If a destination is returned, the driver places the payload
+ * there and the UDP handler finds it in net_rx_payload. It is only called
+ * for unfragmented packets for net_ip with a correct IP header checksum, so
+ * the handler only has to check the source and the ports.
+ *
+ * @ip:		IP/UDP header of the packet
+ * @pkt:	UDP payload
+ * @len:	length of the UDP payload
+ * @hdr_len:	returns the length of the protocol header before the data
+ * Return: destination of the data following the protocol header, or NULL
+ *	   to leave the packet in the packet buffer
+ */
+typedef void *rxhand_dest_f(struct ip_udp_hdr *ip, uchar *pkt,
+			    unsigned int len, unsigned int *hdr_len);
+
+/**
+ * net_rx_dest() - find the final destination of a received packet's payload
+ *
+ * Drivers call this while copying a packet out of their receive ring. If a
+ * destination is returned, the driver copies the first @hdr_lenp bytes of
+ * the packet to its packet buffer, and the rest of the packet to the
+ * destination.
+ *
+ * @pkt:	received packet, starting with the Ethernet header
+ * @len:	length of the packet
+ * @csum_ok:	true if the driver has verified the checksums of the packet
+ * @hdr_lenp:	returns the length of the headers before the payload
+ * Return: destination of the payload, or NULL to keep the packet contiguous
+ */
+void *net_rx_dest(uchar *pkt, int len, bool csum_ok, int *hdr_lenp);
+
 /* Callbacks */
 rxhand_f *net_get_udp_handler(void);	/* Get UDP RX packet handler */
 void net_set_udp_handler(rxhand_f *);	/* Set UDP RX packet handler */
+void net_set_udp_dest_handler(rxhand_dest_f *f); /* Set UDP RX placement */
 rxhand_f *net_get_arp_handler(void);	/* Get ARP RX packet handler */
 void net_set_arp_handler(rxhand_f *);	/* Set ARP RX packet handler */
 bool arp_is_waiting(void);		/* Waiting for ARP reply? */
@@ -349,6 +349,9 @@ struct sdhci_host {
 	dma_addr_t adma_addr;
 #if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
 	struct sdhci_adma_desc *adma_desc_table;
+	/* Transfer described by the ADMA table, to reuse it */
+	dma_addr_t adma_table_start;
+	uint adma_table_bytes;
 #endif
 };
 
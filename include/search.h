@@ -42,11 +42,35 @@ struct env_entry {
  * functions all work on a single internal hash table.
  */
 
-/* Data type for reentrant functions.  */
+/*
+ * Data type for reentrant functions.
+ *
+ * table:	Slots of the table, see hsearch_r()
+ * size:	Number of slots in table
+ * filled:	Number of entries, including those still in old_table
+ * deleted:	Number of slots in table whose entry was deleted
+ * old_table:	Table whose entries are being moved into table as the table
+ *		grows, or NULL if none
+ * old_size:	Number of slots in old_table
+ * old_pos:	Next slot of old_table to move
+ * sorted:	All entries, sorted by key up to sorted_count
+ * sorted_size:	Number of entries allocated in sorted
+ * sorted_count: Number of entries at the start of sorted which are in order
+ * busy:	Number of callbacks and walks running, during which entries
+ *		are not moved
+ */
 struct hsearch_data {
 	struct env_entry_node *table;
 	unsigned int size;
 	unsigned int filled;
+	unsigned int deleted;
+	struct env_entry_node *old_table;
+	unsigned int old_size;
+	unsigned int old_pos;
+	struct env_entry **sorted;
+	unsigned int sorted_size;
+	unsigned int sorted_count;
+	int busy;
 /*
  * Callback function which will check whether the given change for variable
  * "item" to "newval" may be applied or not, and possibly apply such change.
@@ -58,7 +82,10 @@ struct hsearch_data {
 			 enum env_op, int flag);
 };
 
-/* Create a new hash table which will contain at most "nel" elements.  */
+/*
+ * Create a new hash table with room for "nel" elements. The table grows
+ * when more are added.
+ */
 int hcreate_r(size_t nel, struct hsearch_data *htab);
 
 /* Destroy current internal hash table.  */
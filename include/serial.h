@@ -1,8 +1,11 @@
 #ifndef __SERIAL_H__
 #define __SERIAL_H__
 
+#include <membuff.h>
 #include <post.h>
 
+struct cyclic_info;
+
 struct serial_device {
 	/* enough bytes to match alignment of following func pointer */
 	char	name[16];
@@ -292,6 +295,11 @@ struct dm_serial_ops {
  * @buf:	Pointer to the RX buffer
  * @rd_ptr:	Read pointer in the RX buffer
  * @wr_ptr:	Write pointer in the RX buffer
+ *
+ * @txbuf:	TX buffer, unused (start is NULL) if output is not buffered
+ * @tx_hold:	Keep output in the TX buffer instead of sending it
+ * @tx_busy:	Output is being sent from the TX buffer
+ * @tx_cyclic:	Cyclic function which sends output from the TX buffer
  */
 struct serial_dev_priv {
 	struct stdio_dev *sdev;
@@ -299,6 +307,11 @@ struct serial_dev_priv {
 	char *buf;
 	int rd_ptr;
 	int wr_ptr;
+
+	struct membuff txbuf;
+	bool tx_hold;
+	bool tx_busy;
+	struct cyclic_info *tx_cyclic;
 };
 
 /* Access the serial operations for a device */
@@ -367,6 +380,36 @@ void serial_flush(void);
 #else
 static inline void serial_flush(void) {}
 #endif
+
+/**
+ * serial_tx_hold() - Hold back console output
+ *
+ * With CONFIG_SERIAL_TX_BUFFER, output is collected in a buffer for each
+ * serial device and sent while U-Boot waits for the UART. This stops it being
+ * sent, so that the buffer keeps the most recent output. Releasing the hold
+ * sends what the buffer holds, as does a key press on the device.
+ *
+ * @hold:	true to hold output, false to send it
+ */
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+void serial_tx_hold(bool hold);
+#else
+static inline void serial_tx_hold(bool hold) {}
+#endif
+
+/**
+ * serial_tx_stop() - Send buffered console output and stop buffering it
+ *
+ * With CONFIG_SERIAL_TX_BUFFER, this sends what is buffered or held for each
+ * serial device, waiting for the UART, and frees the buffers. Later output
+ * goes to the UART directly, so nothing is left in a buffer when the OS
+ * takes it over.
+ */
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+void serial_tx_stop(void);
+#else
+static inline void serial_tx_stop(void) {}
+#endif
 int serial_getc(void);
 int serial_tstc(void);
 
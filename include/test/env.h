@@ -12,4 +12,17 @@
 /* Declare a new environment test */
 #define ENV_TEST(_name, _flags)	UNIT_TEST(_name, _flags, env_test)
 
+/**
+ * env_test_run_restore() - run a test which changes the environment
+ *
+ * The environment and gd->env_valid are put back as they were afterwards,
+ * whether the test passes or not.
+ *
+ * @uts:	test state
+ * @func:	test to run
+ * Return:	result of @func
+ */
+int env_test_run_restore(struct unit_test_state *uts,
+			 int (*func)(struct unit_test_state *uts));
+
 #endif /* __TEST_ENV_H__ */
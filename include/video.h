@@ -67,6 +67,24 @@ enum video_format {
 	VIDEO_X2R10G10B10,
 };
 
+/* Number of separate damaged rectangles recorded for each device */
+#define VIDEO_DAMAGE_RECTS	4
+
+/**
+ * struct vid_rect - A rectangle within the frame buffer
+ *
+ * @xstart:	X start position in pixels from the left
+ * @ystart:	Y start position in pixels from the top
+ * @xend:	X end position in pixels from the left (exclusive)
+ * @yend:	Y end position in pixels from the top (exclusive)
+ */
+struct vid_rect {
+	int xstart;
+	int ystart;
+	int xend;
+	int yend;
+};
+
 /**
  * struct video_priv - Device information used by the video uclass
  *
@@ -91,6 +109,11 @@ enum video_format {
  *		the LCD is updated
  * @fg_col_idx:	Foreground color code (bit 3 = bold, bit 0-2 = color)
  * @bg_col_idx:	Background color code (bit 3 = bold, bit 0-2 = color)
+ * @damage:	Rectangles changed since the last video_sync(), which may
+ *		overlap
+ * @damage_count: Number of entries in @damage
+ * @sync_bytes:	Number of frame buffer bytes synced since the device was
+ *		probed, for measuring the effect of damage tracking
  */
 struct video_priv {
 	/* Things set up by the driver: */
@@ -115,6 +138,11 @@ struct video_priv {
 	bool flush_dcache;
 	u8 fg_col_idx;
 	u8 bg_col_idx;
+#ifdef CONFIG_VIDEO_DAMAGE
+	struct vid_rect damage[VIDEO_DAMAGE_RECTS];
+	int damage_count;
+	ulong sync_bytes;
+#endif
 };
 
 /**
@@ -213,9 +241,34 @@ int video_fill(struct udevice *dev, u32 colour);
  * Some frame buffers are cached or have a secondary frame buffer. This
  * function syncs these up so that the current contents of the U-Boot frame
  * buffer are displayed to the user.
+ *
+ * With CONFIG_VIDEO_DAMAGE only the parts recorded by video_damage() are
+ * synced, unless @force is true.
  */
 int video_sync(struct udevice *vid, bool force);
 
+#ifdef CONFIG_VIDEO_DAMAGE
+/**
+ * video_damage() - Record that part of the frame buffer has changed
+ *
+ * The next call to video_sync() copies and flushes the changed parts of the
+ * frame buffer. The rectangle is clipped to the display. Nearby rectangles
+ * are merged, so the area synced may be larger than the area changed.
+ *
+ * @vid:	Video device
+ * @x:		X position of the left edge, in pixels
+ * @y:		Y position of the top edge, in pixels
+ * @width:	Width in pixels
+ * @height:	Height in pixels
+ */
+void video_damage(struct udevice *vid, int x, int y, int width, int height);
+#else
+static inline void video_damage(struct udevice *vid, int x, int y, int width,
+				int height)
+{
+}
+#endif
+
 /**
  * video_sync_all() - Sync all devices' frame buffers with there hardware
  *
@@ -254,6 +307,24 @@ void video_bmp_get_info(void *bmp_image, ulong *widthp, ulong *heightp,
 int video_bmp_display(struct udevice *dev, ulong bmp_image, int x, int y,
 		      bool align);
 
+/**
+ * video_bmp_display_gzip() - Display a gzip-compressed BMP file
+ *
+ * The image is decompressed a row at a time straight into the frame buffer,
+ * so no buffer is needed for the whole image.
+ *
+ * @dev:	Device to display the bitmap on
+ * @addr:	Address of the compressed image
+ * @size:	Size of the compressed image in bytes
+ * @x:		X position in pixels from the left
+ * @y:		Y position in pixels from the top
+ * @align:	true to adjust the coordinates, see video_bmp_display()
+ * Return: 0 if OK, -EPROTONOSUPPORT if the image cannot be drawn a row at a
+ *	time (e.g. it is run-length encoded), other -ve on error
+ */
+int video_bmp_display_gzip(struct udevice *dev, ulong addr, ulong size, int x,
+			   int y, bool align);
+
 /**
  * video_get_xsize() - Get the width of the display in pixels
  *
@@ -302,6 +373,9 @@ int video_default_font_height(struct udevice *dev);
  * This ensures that the copy framebuffer has the same data as the framebuffer
  * for a particular region. It should be called after the framebuffer is updated
  *
+ * With CONFIG_VIDEO_DAMAGE this only checks the region, since video_sync()
+ * copies the regions recorded by video_damage()
+ *
  * @from and @to can be in either order. The region between them is synced.
  *
  * @dev: Vidconsole device being updated
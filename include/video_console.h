@@ -133,6 +133,26 @@ struct vidconsole_ops {
 	 * characters.
 	 */
 	int (*backspace)(struct udevice *dev);
+
+	/**
+	 * set_glyph_cache() - Enable or disable the glyph cache (optional)
+	 *
+	 * @dev:	Device to adjust
+	 * @enable:	true to keep rendered characters in the cache
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*set_glyph_cache)(struct udevice *dev, bool enable);
+
+	/**
+	 * get_glyph_stats() - Get the glyph cache statistics (optional)
+	 *
+	 * @dev:	Device to check
+	 * @hitsp:	Returns the number of characters drawn from the cache
+	 * @missesp:	Returns the number of characters which were rendered
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*get_glyph_stats)(struct udevice *dev, ulong *hitsp,
+			       ulong *missesp);
 };
 
 /* Get a pointer to the driver operations for a video console device */
@@ -256,6 +276,29 @@ int vidconsole_select_font(struct udevice *dev, const char *name, uint size);
  */
 const char *vidconsole_get_font(struct udevice *dev, uint *sizep);
 
+/**
+ * vidconsole_set_glyph_cache() - Enable or disable the glyph cache
+ *
+ * The TrueType console enables its cache by default. Disabling it drops all
+ * cached glyphs.
+ *
+ * @dev: vidconsole device
+ * @enable: true to keep rendered characters in the cache
+ * Return: 0 if OK, -ENOSYS if the console has no glyph cache
+ */
+int vidconsole_set_glyph_cache(struct udevice *dev, bool enable);
+
+/**
+ * vidconsole_get_glyph_stats() - Get the glyph cache statistics
+ *
+ * @dev: vidconsole device
+ * @hitsp: Returns the number of characters drawn from the cache
+ * @missesp: Returns the number of characters which were rendered
+ * Return: 0 if OK, -ENOSYS if the console has no glyph cache
+ */
+int vidconsole_get_glyph_stats(struct udevice *dev, ulong *hitsp,
+			       ulong *missesp);
+
 #ifdef CONFIG_VIDEO_COPY
 /**
  * vidconsole_sync_copy() - Sync back to the copy framebuffer
@@ -63,6 +63,10 @@ struct vring_desc_shadow {
 	u16 next;
 	/* Metadata about the descriptor. */
 	bool chain_head;
+	/* Indirect descriptor table of a chain head, NULL if none */
+	struct vring_desc *indir;
+	/* First buffer of an indirect chain, returned by virtqueue_get_buf() */
+	u64 indir_addr;
 };
 
 struct vring_avail {
@@ -101,6 +105,7 @@ struct vring {
  * @vring: actual memory layout for this queue
  * @vring_desc_shadow: guest-only copy of descriptors
  * @event: host publishes avail event idx
+ * @indirect: host supports indirect descriptor tables
  * @free_head: head of free buffer list
  * @num_added: number we've added since last sync
  * @last_used_idx: last used index we've seen
@@ -115,6 +120,7 @@ struct virtqueue {
 	struct vring vring;
 	struct vring_desc_shadow *vring_desc_shadow;
 	bool event;
+	bool indirect;
 	unsigned int free_head;
 	unsigned int num_added;
 	u16 last_used_idx;
@@ -182,6 +188,9 @@ struct virtio_sg;
  * @in_sgs:	the number of scatterlists which are writable
  *		(after readable ones)
  *
+ * If the host supports indirect descriptors, chains of more than two
+ * buffers take a single descriptor of the ring.
+ *
  * Caller must ensure we don't call this with other virtqueue operations
  * at the same time (except where noted).
  *
@@ -15,6 +15,7 @@
 #include <log.h>
 #include <malloc.h>
 #include <pe.h>
+#include <serial.h>
 #include <time.h>
 #include <u-boot/crc.h>
 #include <usb.h>
@@ -31,6 +32,43 @@ static efi_uintn_t efi_tpl = TPL_APPLICATION;
 /* This list contains all the EFI objects our payload has access to */
 LIST_HEAD(efi_obj_list);
 
+/* Hash table of all EFI objects, used to validate handles */
+#define EFI_OBJ_HASH_BITS	8
+static struct hlist_head efi_obj_hash[1 << EFI_OBJ_HASH_BITS];
+
+/* Sequence number of the last object added to efi_obj_list */
+static ulong efi_obj_seq;
+
+/**
+ * struct efi_protocol_index - handlers of a protocol GUID
+ *
+ * @link:	link in the protocol index hash table
+ * @guid:	GUID of the protocol
+ * @hash:	hash of @guid
+ * @handlers:	installed handlers, in the order of efi_obj_list
+ */
+struct efi_protocol_index {
+	struct hlist_node link;
+	efi_guid_t guid;
+	u32 hash;
+	struct list_head handlers;
+};
+
+/* Index from protocol GUID to the handles implementing the protocol */
+#define EFI_PROTOCOL_INDEX_BITS	6
+static struct hlist_head efi_protocol_index[1 << EFI_PROTOCOL_INDEX_BITS];
+
+#ifdef CONFIG_CMD_BOOTEFI_SELFTEST
+ulong efi_protocol_compares;
+
+static inline void efi_protocol_count_compare(void)
+{
+	++efi_protocol_compares;
+}
+#else
+static inline void efi_protocol_count_compare(void) {}
+#endif
+
 /* List of all events */
 __efi_runtime_data LIST_HEAD(efi_events);
 
@@ -492,6 +530,112 @@ static efi_status_t EFIAPI efi_free_pool_ext(void *buffer)
 	return EFI_EXIT(r);
 }
 
+/**
+ * efi_obj_hash_idx() - get bucket of a handle in the object hash table
+ *
+ * @handle:	handle
+ * Return:	index into efi_obj_hash
+ */
+static u32 efi_obj_hash_idx(const efi_handle_t handle)
+{
+	return ((u32)((uintptr_t)handle >> 3) * 0x61c88647) >>
+	       (32 - EFI_OBJ_HASH_BITS);
+}
+
+/**
+ * efi_guid_hash() - calculate hash of a GUID
+ *
+ * GUIDs passed by UEFI applications are not necessarily aligned, so the hash
+ * is built bytewise (FNV-1a).
+ *
+ * @guid:	GUID
+ * Return:	hash value
+ */
+static u32 efi_guid_hash(const efi_guid_t *guid)
+{
+	u32 hash = 0x811c9dc5;
+	int i;
+
+	for (i = 0; i < sizeof(guid->b); ++i)
+		hash = (hash ^ guid->b[i]) * 0x01000193;
+
+	return hash;
+}
+
+/**
+ * efi_protocol_index_find() - find the index entry of a protocol
+ *
+ * @protocol:	GUID of the protocol
+ * @hash:	hash of @protocol
+ * Return:	index entry or NULL if no handle implements the protocol
+ */
+static struct efi_protocol_index *
+efi_protocol_index_find(const efi_guid_t *protocol, u32 hash)
+{
+	struct hlist_head *head;
+	struct efi_protocol_index *entry;
+
+	head = &efi_protocol_index[hash >> (32 - EFI_PROTOCOL_INDEX_BITS)];
+	hlist_for_each_entry(entry, head, link) {
+		efi_protocol_count_compare();
+		if (entry->hash == hash && !guidcmp(&entry->guid, protocol))
+			return entry;
+	}
+
+	return NULL;
+}
+
+/**
+ * efi_protocol_index_add() - add a handler to the protocol index
+ *
+ * @handler:	handler with guid, hash and handle already set
+ * Return:	status code
+ */
+static efi_status_t efi_protocol_index_add(struct efi_handler *handler)
+{
+	struct efi_protocol_index *entry;
+	struct efi_handler *pos;
+
+	entry = efi_protocol_index_find(&handler->guid, handler->hash);
+	if (!entry) {
+		entry = calloc(1, sizeof(*entry));
+		if (!entry)
+			return EFI_OUT_OF_RESOURCES;
+		guidcpy(&entry->guid, &handler->guid);
+		entry->hash = handler->hash;
+		INIT_LIST_HEAD(&entry->handlers);
+		hlist_add_head(&entry->link,
+			       &efi_protocol_index[entry->hash >>
+						   (32 - EFI_PROTOCOL_INDEX_BITS)]);
+	}
+
+	/* Protocols are mostly installed on recently created handles */
+	list_for_each_entry_reverse(pos, &entry->handlers, index_link) {
+		if (pos->handle->seq < handler->handle->seq)
+			break;
+	}
+	list_add(&handler->index_link, &pos->index_link);
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * efi_protocol_index_del() - remove a handler from the protocol index
+ *
+ * @handler:	handler to remove
+ */
+static void efi_protocol_index_del(struct efi_handler *handler)
+{
+	struct efi_protocol_index *entry;
+
+	entry = efi_protocol_index_find(&handler->guid, handler->hash);
+	list_del(&handler->index_link);
+	if (entry && list_empty(&entry->handlers)) {
+		hlist_del(&entry->link);
+		free(entry);
+	}
+}
+
 /**
  * efi_add_handle() - add a new handle to the object list
  *
@@ -506,6 +650,9 @@ void efi_add_handle(efi_handle_t handle)
 		return;
 	INIT_LIST_HEAD(&handle->protocols);
 	list_add_tail(&handle->link, &efi_obj_list);
+	handle->seq = ++efi_obj_seq;
+	hlist_add_head(&handle->hash_link,
+		       &efi_obj_hash[efi_obj_hash_idx(handle)]);
 }
 
 /**
@@ -541,18 +688,19 @@ efi_status_t efi_search_protocol(const efi_handle_t handle,
 				 struct efi_handler **handler)
 {
 	struct efi_object *efiobj;
-	struct list_head *lhandle;
+	struct efi_handler *protocol;
+	u32 hash;
 
 	if (!handle || !protocol_guid)
 		return EFI_INVALID_PARAMETER;
 	efiobj = efi_search_obj(handle);
 	if (!efiobj)
 		return EFI_INVALID_PARAMETER;
-	list_for_each(lhandle, &efiobj->protocols) {
-		struct efi_handler *protocol;
-
-		protocol = list_entry(lhandle, struct efi_handler, link);
-		if (!guidcmp(&protocol->guid, protocol_guid)) {
+	hash = efi_guid_hash(protocol_guid);
+	list_for_each_entry(protocol, &efiobj->protocols, link) {
+		efi_protocol_count_compare();
+		if (protocol->hash == hash &&
+		    !guidcmp(&protocol->guid, protocol_guid)) {
 			if (handler)
 				*handler = protocol;
 			return EFI_SUCCESS;
@@ -581,6 +729,7 @@ efi_status_t efi_remove_protocol(const efi_handle_t handle,
 		return ret;
 	if (handler->protocol_interface != protocol_interface)
 		return EFI_NOT_FOUND;
+	efi_protocol_index_del(handler);
 	list_del(&handler->link);
 	free(handler);
 	return EFI_SUCCESS;
@@ -627,6 +776,7 @@ void efi_delete_handle(efi_handle_t handle)
 		return;
 	}
 
+	hlist_del(&handle->hash_link);
 	list_del(&handle->link);
 	free(handle);
 }
@@ -1068,7 +1218,8 @@ struct efi_object *efi_search_obj(const efi_handle_t handle)
 	if (!handle)
 		return NULL;
 
-	list_for_each_entry(efiobj, &efi_obj_list, link) {
+	hlist_for_each_entry(efiobj, &efi_obj_hash[efi_obj_hash_idx(handle)],
+			     hash_link) {
 		if (efiobj == handle)
 			return efiobj;
 	}
@@ -1138,7 +1289,14 @@ efi_status_t efi_add_protocol(const efi_handle_t handle,
 		return EFI_OUT_OF_RESOURCES;
 	memcpy((void *)&handler->guid, protocol, sizeof(efi_guid_t));
 	handler->protocol_interface = protocol_interface;
+	handler->handle = efiobj;
+	handler->hash = efi_guid_hash(protocol);
 	INIT_LIST_HEAD(&handler->open_infos);
+	ret = efi_protocol_index_add(handler);
+	if (ret != EFI_SUCCESS) {
+		free(handler);
+		return ret;
+	}
 	list_add_tail(&handler->link, &efiobj->protocols);
 
 	/* Notify registered events */
@@ -1148,6 +1306,7 @@ efi_status_t efi_add_protocol(const efi_handle_t handle,
 
 			notif = calloc(1, sizeof(*notif));
 			if (!notif) {
+				efi_protocol_index_del(handler);
 				list_del(&handler->link);
 				free(handler);
 				return EFI_OUT_OF_RESOURCES;
@@ -1395,10 +1554,8 @@ static efi_status_t EFIAPI efi_uninstall_protocol_interface
 		goto out;
 
 	/* If the last protocol has been removed, delete the handle. */
-	if (list_empty(&handle->protocols)) {
-		list_del(&handle->link);
-		free(handle);
-	}
+	if (list_empty(&handle->protocols))
+		efi_delete_handle(handle);
 out:
 	return EFI_EXIT(ret);
 }
@@ -1447,34 +1604,6 @@ out:
 	return EFI_EXIT(ret);
 }
 
-/**
- * efi_search() - determine if an EFI handle implements a protocol
- *
- * @search_type: selection criterion
- * @protocol:    GUID of the protocol
- * @handle:      handle
- *
- * See the documentation of the LocateHandle service in the UEFI specification.
- *
- * Return: 0 if the handle implements the protocol
- */
-static int efi_search(enum efi_locate_search_type search_type,
-		      const efi_guid_t *protocol, efi_handle_t handle)
-{
-	efi_status_t ret;
-
-	switch (search_type) {
-	case ALL_HANDLES:
-		return 0;
-	case BY_PROTOCOL:
-		ret = efi_search_protocol(handle, protocol, NULL);
-		return (ret != EFI_SUCCESS);
-	default:
-		/* Invalid search type */
-		return -1;
-	}
-}
-
 /**
  * efi_check_register_notify_event() - check if registration key is valid
  *
@@ -1519,6 +1648,8 @@ static efi_status_t efi_locate_handle(
 	efi_uintn_t size = 0;
 	struct efi_register_notify_event *event;
 	struct efi_protocol_notification *handle = NULL;
+	struct efi_protocol_index *entry = NULL;
+	struct efi_handler *handler;
 
 	/* Check parameters */
 	switch (search_type) {
@@ -1535,6 +1666,10 @@ static efi_status_t efi_locate_handle(
 	case BY_PROTOCOL:
 		if (!protocol)
 			return EFI_INVALID_PARAMETER;
+		entry = efi_protocol_index_find(protocol,
+						efi_guid_hash(protocol));
+		if (!entry)
+			return EFI_NOT_FOUND;
 		break;
 	default:
 		return EFI_INVALID_PARAMETER;
@@ -1549,11 +1684,12 @@ static efi_status_t efi_locate_handle(
 					  link);
 		efiobj = handle->handle;
 		size += sizeof(void *);
+	} else if (search_type == BY_PROTOCOL) {
+		list_for_each_entry(handler, &entry->handlers, index_link)
+			size += sizeof(void *);
 	} else {
-		list_for_each_entry(efiobj, &efi_obj_list, link) {
-			if (!efi_search(search_type, protocol, efiobj))
-				size += sizeof(void *);
-		}
+		list_for_each_entry(efiobj, &efi_obj_list, link)
+			size += sizeof(void *);
 		if (size == 0)
 			return EFI_NOT_FOUND;
 	}
@@ -1576,11 +1712,12 @@ static efi_status_t efi_locate_handle(
 	if (search_type == BY_REGISTER_NOTIFY) {
 		*buffer = efiobj;
 		list_del(&handle->link);
+	} else if (search_type == BY_PROTOCOL) {
+		list_for_each_entry(handler, &entry->handlers, index_link)
+			*buffer++ = handler->handle;
 	} else {
-		list_for_each_entry(efiobj, &efi_obj_list, link) {
-			if (!efi_search(search_type, protocol, efiobj))
-				*buffer++ = efiobj;
-		}
+		list_for_each_entry(efiobj, &efi_obj_list, link)
+			*buffer++ = efiobj;
 	}
 
 	return EFI_SUCCESS;
@@ -2170,6 +2307,8 @@ static efi_status_t EFIAPI efi_exit_boot_services(efi_handle_t image_handle,
 			list_del(&evt->link);
 	}
 
+	serial_tx_stop();
+	flush();
 	if (!efi_st_keep_devices) {
 		bootm_disable_interrupts();
 		if (IS_ENABLED(CONFIG_USB_DEVICE))
@@ -2600,10 +2739,15 @@ static efi_status_t EFIAPI efi_locate_protocol(const efi_guid_t *protocol,
 		if (ret == EFI_SUCCESS)
 			goto found;
 	} else {
-		list_for_each_entry(efiobj, &efi_obj_list, link) {
-			ret = efi_search_protocol(efiobj, protocol, &handler);
-			if (ret == EFI_SUCCESS)
-				goto found;
+		struct efi_protocol_index *entry;
+
+		entry = efi_protocol_index_find(protocol,
+						efi_guid_hash(protocol));
+		if (entry) {
+			handler = list_first_entry(&entry->handlers,
+						   struct efi_handler,
+						   index_link);
+			goto found;
 		}
 	}
 not_found:
@@ -2775,10 +2919,8 @@ efi_uninstall_multiple_protocol_interfaces_int(efi_handle_t handle,
 	}
 	if (ret == EFI_SUCCESS) {
 		/* If the last protocol has been removed, delete the handle. */
-		if (list_empty(&handle->protocols)) {
-			list_del(&handle->link);
-			free(handle);
-		}
+		if (list_empty(&handle->protocols))
+			efi_delete_handle(handle);
 		goto out;
 	}
 
@@ -18,12 +18,14 @@
 #include <log.h>
 #include <part.h>
 #include <malloc.h>
+#include <memalign.h>
 
 struct efi_system_partition efi_system_partition = {
 	.uclass_id = UCLASS_INVALID,
 };
 
 const efi_guid_t efi_block_io_guid = EFI_BLOCK_IO_PROTOCOL_GUID;
+const efi_guid_t efi_block_io2_guid = EFI_BLOCK_IO2_PROTOCOL_GUID;
 const efi_guid_t efi_system_partition_guid = PARTITION_SYSTEM_GUID;
 
 /**
@@ -31,6 +33,7 @@ const efi_guid_t efi_system_partition_guid = PARTITION_SYSTEM_GUID;
  *
  * @header:	EFI object header
  * @ops:	EFI disk I/O protocol interface
+ * @ops2:	EFI disk I/O 2 protocol interface
  * @dev_index:	device index of block device
  * @media:	block I/O media information
  * @dp:		device path to the block device
@@ -41,6 +44,7 @@ const efi_guid_t efi_system_partition_guid = PARTITION_SYSTEM_GUID;
 struct efi_disk_obj {
 	struct efi_object header;
 	struct efi_block_io ops;
+	struct efi_block_io2 ops2;
 	int dev_index;
 	struct efi_block_io_media media;
 	struct efi_device_path *dp;
@@ -102,6 +106,96 @@ enum efi_disk_direction {
 	EFI_DISK_WRITE,
 };
 
+/**
+ * efi_disk_blk_rw() - read or write blocks of the underlying device
+ *
+ * @dev:	block device or partition
+ * @lba:	starting logical block relative to @dev
+ * @blocks:	number of blocks
+ * @buffer:	data buffer
+ * @direction:	read or write
+ * Return:	number of blocks transferred
+ */
+static unsigned long efi_disk_blk_rw(struct udevice *dev, u64 lba,
+				     lbaint_t blocks, void *buffer,
+				     enum efi_disk_direction direction)
+{
+	struct blk_desc *desc;
+
+	if (CONFIG_IS_ENABLED(PARTITIONS) &&
+	    device_get_uclass_id(dev) == UCLASS_PARTITION) {
+		if (direction == EFI_DISK_READ)
+			return disk_blk_read(dev, lba, blocks, buffer);
+		else
+			return disk_blk_write(dev, lba, blocks, buffer);
+	}
+
+	/* dev is a block device (UCLASS_BLK) */
+	desc = dev_get_uclass_plat(dev);
+	if (direction == EFI_DISK_READ)
+		return blk_dread(desc, lba, blocks, buffer);
+	else
+		return blk_dwrite(desc, lba, blocks, buffer);
+}
+
+/**
+ * efi_disk_read_ahead() - serve a short read from the read-ahead window
+ *
+ * UEFI applications read files with many small sequential reads. If the
+ * requested blocks are not cached, read CONFIG_EFI_DISK_READAHEAD blocks
+ * and pass them as read-ahead window to the block cache.
+ *
+ * @diskobj:	disk object
+ * @lba:	starting logical block relative to the disk object
+ * @blocks:	number of blocks to read
+ * @buffer:	destination buffer
+ * Return:	true if the read has been served
+ */
+static bool efi_disk_read_ahead(struct efi_disk_obj *diskobj, u64 lba,
+				lbaint_t blocks, void *buffer)
+{
+	struct udevice *dev = diskobj->header.dev;
+	struct blk_desc *desc;
+	lbaint_t start = lba;
+	lbaint_t count;
+	void *window;
+
+	if (!CONFIG_EFI_DISK_READAHEAD || !IS_ENABLED(CONFIG_BLOCK_CACHE) ||
+	    blocks >= CONFIG_EFI_DISK_READAHEAD)
+		return false;
+
+	if (CONFIG_IS_ENABLED(PARTITIONS) &&
+	    device_get_uclass_id(dev) == UCLASS_PARTITION) {
+		struct disk_part *part = dev_get_uclass_plat(dev);
+
+		desc = dev_get_uclass_plat(dev_get_parent(dev));
+		start += part->gpt_part_info.start;
+	} else {
+		desc = dev_get_uclass_plat(dev);
+	}
+
+	if (blkcache_read(desc->uclass_id, desc->devnum, start, blocks,
+			  desc->blksz, buffer))
+		return true;
+
+	count = min_t(u64, CONFIG_EFI_DISK_READAHEAD,
+		      diskobj->media.last_block + 1 - lba);
+	window = malloc_cache_aligned(count * desc->blksz);
+	if (!window)
+		return false;
+
+	if (efi_disk_blk_rw(dev, lba, count, window, EFI_DISK_READ) != count) {
+		free(window);
+		return false;
+	}
+	memcpy(buffer, window, blocks * desc->blksz);
+	if (blkcache_fill_window(desc->uclass_id, desc->devnum, start, count,
+				 desc->blksz, window))
+		free(window);
+
+	return true;
+}
+
 static efi_status_t efi_disk_rw_blocks(struct efi_block_io *this,
 			u32 media_id, u64 lba, unsigned long buffer_size,
 			void *buffer, enum efi_disk_direction direction)
@@ -122,24 +216,12 @@ static efi_status_t efi_disk_rw_blocks(struct efi_block_io *this,
 	if (buffer_size & (blksz - 1))
 		return EFI_BAD_BUFFER_SIZE;
 
-	if (CONFIG_IS_ENABLED(PARTITIONS) &&
-	    device_get_uclass_id(diskobj->header.dev) == UCLASS_PARTITION) {
-		if (direction == EFI_DISK_READ)
-			n = disk_blk_read(diskobj->header.dev, lba, blocks,
-					  buffer);
-		else
-			n = disk_blk_write(diskobj->header.dev, lba, blocks,
-					   buffer);
-	} else {
-		/* dev is a block device (UCLASS_BLK) */
-		struct blk_desc *desc;
-
-		desc = dev_get_uclass_plat(diskobj->header.dev);
-		if (direction == EFI_DISK_READ)
-			n = blk_dread(desc, lba, blocks, buffer);
-		else
-			n = blk_dwrite(desc, lba, blocks, buffer);
-	}
+	if (direction == EFI_DISK_READ &&
+	    efi_disk_read_ahead(diskobj, lba, blocks, buffer))
+		n = blocks;
+	else
+		n = efi_disk_blk_rw(diskobj->header.dev, lba, blocks, buffer,
+				    direction);
 
 	/* We don't do interrupts, so check for timers cooperatively */
 	efi_timer_check();
@@ -312,6 +394,152 @@ static const struct efi_block_io block_io_disk_template = {
 	.flush_blocks = &efi_disk_flush_blocks,
 };
 
+/**
+ * efi_disk_complete() - complete a request of the EFI_BLOCK_IO2_PROTOCOL
+ *
+ * U-Boot's block devices are synchronous. Requests with a token are
+ * completed before returning by signaling the token's event.
+ *
+ * @token:	token of the request, may be NULL
+ * @ret:	status of the request
+ * Return:	status code to return to the caller
+ */
+static efi_status_t efi_disk_complete(struct efi_block_io2_token *token,
+				      efi_status_t ret)
+{
+	if (ret != EFI_SUCCESS || !token || !token->event)
+		return ret;
+
+	token->transaction_status = EFI_SUCCESS;
+	efi_signal_event(token->event);
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * efi_disk_reset_ex() - reset block device
+ *
+ * This function implements the Reset service of the EFI_BLOCK_IO2_PROTOCOL.
+ *
+ * See the Unified Extensible Firmware Interface (UEFI) specification for
+ * details.
+ *
+ * @this:			pointer to the BLOCK_IO2_PROTOCOL
+ * @extended_verification:	extended verification
+ * Return:			status code
+ */
+static efi_status_t EFIAPI efi_disk_reset_ex(struct efi_block_io2 *this,
+			char extended_verification)
+{
+	EFI_ENTRY("%p, %x", this, extended_verification);
+	return EFI_EXIT(EFI_SUCCESS);
+}
+
+/**
+ * efi_disk_read_blocks_ex() - reads blocks from device
+ *
+ * This function implements the ReadBlocksEx service of the
+ * EFI_BLOCK_IO2_PROTOCOL.
+ *
+ * See the Unified Extensible Firmware Interface (UEFI) specification for
+ * details.
+ *
+ * @this:			pointer to the BLOCK_IO2_PROTOCOL
+ * @media_id:			id of the medium to be read from
+ * @lba:			starting logical block for reading
+ * @token:			token of the request, may be NULL
+ * @buffer_size:		size of the read buffer
+ * @buffer:			pointer to the destination buffer
+ * Return:			status code
+ */
+static efi_status_t EFIAPI efi_disk_read_blocks_ex(struct efi_block_io2 *this,
+			u32 media_id, u64 lba,
+			struct efi_block_io2_token *token,
+			efi_uintn_t buffer_size, void *buffer)
+{
+	struct efi_disk_obj *diskobj;
+	efi_status_t ret;
+
+	EFI_ENTRY("%p, %x, %llx, %p, %zx, %p", this, media_id, lba, token,
+		  buffer_size, buffer);
+
+	if (!this)
+		return EFI_EXIT(EFI_INVALID_PARAMETER);
+
+	diskobj = container_of(this, struct efi_disk_obj, ops2);
+	ret = EFI_CALL(efi_disk_read_blocks(&diskobj->ops, media_id, lba,
+					    buffer_size, buffer));
+
+	return EFI_EXIT(efi_disk_complete(token, ret));
+}
+
+/**
+ * efi_disk_write_blocks_ex() - writes blocks to device
+ *
+ * This function implements the WriteBlocksEx service of the
+ * EFI_BLOCK_IO2_PROTOCOL.
+ *
+ * See the Unified Extensible Firmware Interface (UEFI) specification for
+ * details.
+ *
+ * @this:			pointer to the BLOCK_IO2_PROTOCOL
+ * @media_id:			id of the medium to be written to
+ * @lba:			starting logical block for writing
+ * @token:			token of the request, may be NULL
+ * @buffer_size:		size of the write buffer
+ * @buffer:			pointer to the source buffer
+ * Return:			status code
+ */
+static efi_status_t EFIAPI efi_disk_write_blocks_ex(struct efi_block_io2 *this,
+			u32 media_id, u64 lba,
+			struct efi_block_io2_token *token,
+			efi_uintn_t buffer_size, void *buffer)
+{
+	struct efi_disk_obj *diskobj;
+	efi_status_t ret;
+
+	EFI_ENTRY("%p, %x, %llx, %p, %zx, %p", this, media_id, lba, token,
+		  buffer_size, buffer);
+
+	if (!this)
+		return EFI_EXIT(EFI_INVALID_PARAMETER);
+
+	diskobj = container_of(this, struct efi_disk_obj, ops2);
+	ret = EFI_CALL(efi_disk_write_blocks(&diskobj->ops, media_id, lba,
+					     buffer_size, buffer));
+
+	return EFI_EXIT(efi_disk_complete(token, ret));
+}
+
+/**
+ * efi_disk_flush_blocks_ex() - flushes modified data to the device
+ *
+ * This function implements the FlushBlocksEx service of the
+ * EFI_BLOCK_IO2_PROTOCOL.
+ *
+ * As we always write synchronously only the token is signaled.
+ *
+ * See the Unified Extensible Firmware Interface (UEFI) specification for
+ * details.
+ *
+ * @this:			pointer to the BLOCK_IO2_PROTOCOL
+ * @token:			token of the request, may be NULL
+ * Return:			status code
+ */
+static efi_status_t EFIAPI efi_disk_flush_blocks_ex(struct efi_block_io2 *this,
+			struct efi_block_io2_token *token)
+{
+	EFI_ENTRY("%p, %p", this, token);
+	return EFI_EXIT(efi_disk_complete(token, EFI_SUCCESS));
+}
+
+static const struct efi_block_io2 block_io2_disk_template = {
+	.reset = &efi_disk_reset_ex,
+	.read_blocks_ex = &efi_disk_read_blocks_ex,
+	.write_blocks_ex = &efi_disk_write_blocks_ex,
+	.flush_blocks_ex = &efi_disk_flush_blocks_ex,
+};
+
 /**
  * efi_fs_from_path() - retrieve simple file system protocol
  *
@@ -462,6 +690,7 @@ static efi_status_t efi_disk_add_dev(
 					&handle,
 					&efi_guid_device_path, diskobj->dp,
 					&efi_block_io_guid, &diskobj->ops,
+					&efi_block_io2_guid, &diskobj->ops2,
 					/*
 					 * esp_guid must be last entry as it
 					 * can be NULL. Its interface is NULL.
@@ -501,6 +730,8 @@ static efi_status_t efi_disk_add_dev(
 	if (part)
 		diskobj->media.logical_partition = 1;
 	diskobj->ops.media = &diskobj->media;
+	diskobj->ops2 = block_io2_disk_template;
+	diskobj->ops2.media = &diskobj->media;
 	if (disk)
 		*disk = diskobj;
 
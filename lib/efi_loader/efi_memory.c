@@ -46,9 +46,10 @@ void *efi_bounce_buffer;
  * @checksum:	checksum
  * @data:	allocated pool memory
  *
- * U-Boot services each UEFI AllocatePool() request as a separate
- * (multiple) page allocation. We have to track the number of pages
- * to be able to free the correct amount later.
+ * U-Boot services each UEFI AllocatePool() request that does not fit into
+ * a slab (see struct efi_pool_slab) as a separate (multiple) page
+ * allocation. We have to track the number of pages to be able to free the
+ * correct amount later. For allocations from a slab num_pages is zero.
  *
  * The checksum calculated in function checksum() is used in FreePool() to avoid
  * freeing memory not allocated by AllocatePool() and duplicate freeing.
@@ -78,6 +79,192 @@ static u64 checksum(struct efi_pool_allocation *alloc)
 	return ret;
 }
 
+/* Magic number identifying a page used as pool slab */
+#define EFI_POOL_SLAB_MAGIC 0x5eb1ab3dc0ffee42
+
+/* Smallest and largest slot size served from slabs */
+#define EFI_POOL_SLAB_MIN_SHIFT	6
+#define EFI_POOL_SLAB_MAX_SHIFT	(EFI_PAGE_SHIFT - 2)
+#define EFI_POOL_SLAB_CLASSES	(EFI_POOL_SLAB_MAX_SHIFT - \
+				 EFI_POOL_SLAB_MIN_SHIFT + 1)
+
+/**
+ * struct efi_pool_slab - page used to serve small pool allocations
+ *
+ * @link:		link in the list of slabs with free slots
+ * @checksum:		checksum, see slab_checksum()
+ * @memory_type:	memory type of all allocations in this slab
+ * @slot_size:		size of each slot in bytes
+ * @in_use:		number of allocated slots
+ * @free:		first free slot
+ *
+ * Small AllocatePool() requests are served from page sized slabs. A slab
+ * only holds allocations of a single memory type and size class. So the
+ * memory map always reports the right memory type for pool memory, also
+ * when it is passed to the operating system at ExitBootServices().
+ *
+ * Each slot starts with a struct efi_pool_allocation header with num_pages
+ * set to zero. This keeps the checksum protection of FreePool() intact.
+ * Once the last slot of a slab is freed, the page is returned to the
+ * memory map.
+ */
+struct efi_pool_slab {
+	struct list_head link;
+	u64 checksum;
+	u32 memory_type;
+	u32 slot_size;
+	u32 in_use;
+	struct efi_pool_allocation *free;
+};
+
+/* Slabs with free slots per memory type and size class */
+static struct list_head efi_pool_slabs[EFI_MAX_MEMORY_TYPE]
+				      [EFI_POOL_SLAB_CLASSES];
+
+/**
+ * slab_checksum() - calculate checksum for a pool slab
+ *
+ * @slab:	slab header
+ * Return:	checksum, always non-zero
+ */
+static u64 slab_checksum(struct efi_pool_slab *slab)
+{
+	u64 addr = (uintptr_t)slab;
+	u64 ret = (addr >> 32) ^ (addr << 32) ^ EFI_POOL_SLAB_MAGIC ^
+		  ((u64)slab->memory_type << 32 | slab->slot_size);
+
+	if (!ret)
+		++ret;
+	return ret;
+}
+
+/**
+ * slab_first_slot() - offset of the first slot in a slab
+ *
+ * @slot_size:	size of a slot
+ * Return:	offset of the first slot from the start of the page
+ */
+static ulong slab_first_slot(ulong slot_size)
+{
+	return ALIGN(sizeof(struct efi_pool_slab), slot_size);
+}
+
+/**
+ * slab_list() - get list of slabs with free slots
+ *
+ * @pool_type:	memory type
+ * @shift:	log2 of the slot size
+ * Return:	list head
+ */
+static struct list_head *slab_list(enum efi_memory_type pool_type, int shift)
+{
+	struct list_head *head;
+
+	head = &efi_pool_slabs[pool_type][shift - EFI_POOL_SLAB_MIN_SHIFT];
+	if (!head->next)
+		INIT_LIST_HEAD(head);
+
+	return head;
+}
+
+/**
+ * efi_allocate_pool_slab() - allocate small block of memory from a slab
+ *
+ * @pool_type:	type of the pool from which memory is to be allocated
+ * @size:	number of bytes to be allocated, including the header
+ * @buffer:	allocated memory
+ * Return:	status code
+ */
+static efi_status_t efi_allocate_pool_slab(enum efi_memory_type pool_type,
+					   efi_uintn_t size, void **buffer)
+{
+	int shift = max_t(int, EFI_POOL_SLAB_MIN_SHIFT, fls_long(size - 1));
+	struct list_head *head = slab_list(pool_type, shift);
+	struct efi_pool_allocation *alloc;
+	struct efi_pool_slab *slab;
+
+	if (list_empty(head)) {
+		ulong slot_size = 1UL << shift;
+		efi_status_t r;
+		ulong offset;
+		u64 addr;
+
+		r = efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES, pool_type, 1,
+				       &addr);
+		if (r != EFI_SUCCESS)
+			return r;
+
+		slab = (struct efi_pool_slab *)(uintptr_t)addr;
+		slab->memory_type = pool_type;
+		slab->slot_size = slot_size;
+		slab->in_use = 0;
+		slab->free = NULL;
+		/* Build the free list so that the lowest slot comes first */
+		for (offset = EFI_PAGE_SIZE - slot_size;
+		     offset >= slab_first_slot(slot_size);
+		     offset -= slot_size) {
+			alloc = (void *)slab + offset;
+			alloc->checksum = 0;
+			*(void **)alloc->data = slab->free;
+			slab->free = alloc;
+		}
+		slab->checksum = slab_checksum(slab);
+		list_add(&slab->link, head);
+	}
+
+	slab = list_first_entry(head, struct efi_pool_slab, link);
+	alloc = slab->free;
+	slab->free = *(void **)alloc->data;
+	if (!slab->free)
+		list_del_init(&slab->link);
+	++slab->in_use;
+
+	alloc->num_pages = 0;
+	alloc->checksum = checksum(alloc);
+	*buffer = alloc->data;
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * efi_free_pool_slab() - return memory allocated from a slab
+ *
+ * The caller must already have verified the checksum of the allocation.
+ *
+ * @alloc:	allocation header
+ * Return:	status code
+ */
+static efi_status_t efi_free_pool_slab(struct efi_pool_allocation *alloc)
+{
+	struct efi_pool_slab *slab;
+	ulong offset;
+
+	slab = (void *)((uintptr_t)alloc & ~(uintptr_t)EFI_PAGE_MASK);
+	offset = (uintptr_t)alloc & EFI_PAGE_MASK;
+	if (slab->checksum != slab_checksum(slab) ||
+	    offset < slab_first_slot(slab->slot_size) ||
+	    offset & (slab->slot_size - 1) || !slab->in_use)
+		return EFI_INVALID_PARAMETER;
+
+	/* Avoid double free */
+	alloc->checksum = 0;
+
+	if (!slab->free)
+		list_add(&slab->link,
+			 slab_list(slab->memory_type, ffs(slab->slot_size) - 1));
+	*(void **)alloc->data = slab->free;
+	slab->free = alloc;
+
+	if (--slab->in_use)
+		return EFI_SUCCESS;
+
+	/* Return empty slab to the memory map */
+	list_del(&slab->link);
+	slab->checksum = 0;
+
+	return efi_free_pages((uintptr_t)slab, 1);
+}
+
 /*
  * Sorts the memory list from highest address to lowest address
  *
@@ -627,6 +814,15 @@ efi_status_t efi_allocate_pool(enum efi_memory_type pool_type, efi_uintn_t size,
 		return EFI_SUCCESS;
 	}
 
+	if (IS_ENABLED(CONFIG_EFI_LOADER_POOL_SLAB) &&
+	    pool_type < EFI_PERSISTENT_MEMORY_TYPE &&
+	    pool_type != EFI_CONVENTIONAL_MEMORY &&
+	    size <= (1UL << EFI_POOL_SLAB_MAX_SHIFT) -
+		    sizeof(struct efi_pool_allocation))
+		return efi_allocate_pool_slab(pool_type, size +
+					      sizeof(struct efi_pool_allocation),
+					      buffer);
+
 	r = efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES, pool_type, num_pages,
 			       &addr);
 	if (r == EFI_SUCCESS) {
@@ -660,11 +856,20 @@ efi_status_t efi_free_pool(void *buffer)
 	alloc = container_of(buffer, struct efi_pool_allocation, data);
 
 	/* Check that this memory was allocated by efi_allocate_pool() */
-	if (((uintptr_t)alloc & EFI_PAGE_MASK) ||
-	    alloc->checksum != checksum(alloc)) {
+	if (alloc->checksum != checksum(alloc) ||
+	    (alloc->num_pages && ((uintptr_t)alloc & EFI_PAGE_MASK))) {
 		printf("%s: illegal free 0x%p\n", __func__, buffer);
 		return EFI_INVALID_PARAMETER;
 	}
+
+	/* Allocations from a slab are marked by num_pages == 0 */
+	if (!alloc->num_pages) {
+		ret = efi_free_pool_slab(alloc);
+		if (ret != EFI_SUCCESS)
+			printf("%s: illegal free 0x%p\n", __func__, buffer);
+		return ret;
+	}
+
 	/* Avoid double free */
 	alloc->checksum = 0;
 
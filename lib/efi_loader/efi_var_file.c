@@ -26,6 +26,11 @@
 
 static const efi_guid_t shim_lock_guid = SHIM_LOCK_GUID;
 
+/* Length of the variables file, 0 if it must be rewritten on next change */
+static loff_t __maybe_unused efi_var_file_len;
+/* Length of the snapshot at the start of the variables file */
+static loff_t __maybe_unused efi_var_snapshot_len;
+
 /**
  * efi_set_blk_dev_to_system_partition() - select EFI system partition
  *
@@ -146,8 +151,13 @@ efi_status_t efi_var_to_file(void)
 		ret = EFI_DEVICE_ERROR;
 
 error:
-	if (ret != EFI_SUCCESS)
+	if (ret != EFI_SUCCESS) {
 		log_err("Failed to persist EFI variables\n");
+		efi_var_file_len = 0;
+	} else {
+		efi_var_file_len = len;
+		efi_var_snapshot_len = len;
+	}
 	free(buf);
 	return ret;
 #else
@@ -155,6 +165,93 @@ error:
 #endif
 }
 
+efi_status_t efi_var_journal(const u16 *name, const efi_guid_t *guid)
+{
+#ifdef CONFIG_EFI_VARIABLE_FILE_STORE
+	const size_t hdr_size = offsetof(struct efi_var_record, var.name);
+	struct efi_var_entry *var;
+	struct efi_var_record *rec;
+	size_t name_size, data_size = 0;
+	loff_t len, actlen;
+	efi_status_t ret;
+	int r;
+
+	name_size = (u16_strlen(name) + 1) * sizeof(u16);
+	var = efi_var_mem_find(guid, name, NULL);
+	if (var && var->attr & EFI_VARIABLE_NON_VOLATILE)
+		data_size = var->length;
+	else
+		var = NULL;
+	len = ALIGN(hdr_size + name_size + data_size, 8);
+
+	/* Compact the file if the journal is full */
+	if (!efi_var_file_len ||
+	    efi_var_file_len + len >
+	    efi_var_snapshot_len + CONFIG_EFI_VAR_JOURNAL_SIZE)
+		return efi_var_to_file();
+
+	rec = calloc(1, len);
+	if (!rec)
+		return EFI_OUT_OF_RESOURCES;
+	rec->magic = EFI_VAR_RECORD_MAGIC;
+	rec->length = len;
+	if (var) {
+		rec->var.attr = var->attr;
+		rec->var.time = var->time;
+		rec->var.length = data_size;
+		memcpy((u8 *)rec->var.name + name_size,
+		       (u8 *)var->name + name_size, data_size);
+	} else {
+		/* Deletion record */
+		rec->var.attr = EFI_VARIABLE_NON_VOLATILE;
+	}
+	guidcpy(&rec->var.guid, guid);
+	memcpy(rec->var.name, name, name_size);
+	rec->crc32 = crc32(0, (u8 *)&rec->var,
+			   len - offsetof(struct efi_var_record, var));
+
+	ret = efi_set_blk_dev_to_system_partition();
+	if (ret == EFI_SUCCESS) {
+		r = fs_write(EFI_VAR_FILE_NAME, map_to_sysmem(rec),
+			     efi_var_file_len, len, &actlen);
+		if (r || len != actlen)
+			ret = EFI_DEVICE_ERROR;
+	}
+	free(rec);
+
+	/* The file system might not support writing at an offset */
+	if (ret != EFI_SUCCESS)
+		return efi_var_to_file();
+
+	efi_var_file_len += len;
+
+	return EFI_SUCCESS;
+#else
+	return EFI_SUCCESS;
+#endif
+}
+
+/**
+ * efi_var_is_restorable() - check if a variable may be restored from a file
+ *
+ * Secure boot related and volatile variables shall only be restored from
+ * U-Boot's preseed.
+ *
+ * @var:	variable
+ * @safe:	restoring from tamper-resistant storage
+ * Return:	true if the variable may be restored
+ */
+static bool efi_var_is_restorable(struct efi_var_entry *var, bool safe)
+{
+	if (safe)
+		return true;
+
+	return efi_auth_var_get_type(var->name, &var->guid) ==
+	       EFI_AUTH_VAR_NONE &&
+	       guidcmp(&var->guid, &shim_lock_guid) &&
+	       var->attr & EFI_VARIABLE_NON_VOLATILE;
+}
+
 efi_status_t efi_var_restore(struct efi_var_file *buf, bool safe)
 {
 	struct efi_var_entry *var, *last_var;
@@ -175,15 +272,7 @@ efi_status_t efi_var_restore(struct efi_var_file *buf, bool safe)
 
 		data = var->name + u16_strlen(var->name) + 1;
 
-		/*
-		 * Secure boot related and volatile variables shall only be
-		 * restored from U-Boot's preseed.
-		 */
-		if (!safe &&
-		    (efi_auth_var_get_type(var->name, &var->guid) !=
-		     EFI_AUTH_VAR_NONE ||
-		     !guidcmp(&var->guid, &shim_lock_guid) ||
-		     !(var->attr & EFI_VARIABLE_NON_VOLATILE)))
+		if (!efi_var_is_restorable(var, safe))
 			continue;
 		if (!var->length)
 			continue;
@@ -198,6 +287,72 @@ efi_status_t efi_var_restore(struct efi_var_file *buf, bool safe)
 	return EFI_SUCCESS;
 }
 
+/**
+ * efi_var_replay_record() - apply a journal record
+ *
+ * @rec:	record with valid length and checksum
+ */
+static void efi_var_replay_record(struct efi_var_record *rec)
+{
+	struct efi_var_entry *var = &rec->var;
+	struct efi_var_entry *old;
+	size_t max_len;
+	u16 *data;
+	efi_status_t ret;
+
+	max_len = (rec->length - offsetof(struct efi_var_record, var.name)) /
+		  sizeof(u16);
+	if (u16_strnlen(var->name, max_len) == max_len)
+		return;
+	data = var->name + u16_strlen(var->name) + 1;
+	if ((uintptr_t)data + var->length > (uintptr_t)rec + rec->length)
+		return;
+	if (!efi_var_is_restorable(var, false))
+		return;
+
+	old = efi_var_mem_find(&var->guid, var->name, NULL);
+	if (old)
+		efi_var_mem_del(old);
+	if (!var->length)
+		return;
+	ret = efi_var_mem_ins(var->name, &var->guid, var->attr, var->length,
+			      data, 0, NULL, var->time);
+	if (ret != EFI_SUCCESS)
+		log_err("Failed to set EFI variable %ls\n", var->name);
+}
+
+efi_status_t efi_var_replay(struct efi_var_file *buf, loff_t len,
+			    loff_t *validp)
+{
+	const size_t hdr_size = offsetof(struct efi_var_record, var.name);
+	efi_status_t ret;
+	loff_t pos;
+
+	if (len < sizeof(struct efi_var_file) || buf->length > len)
+		return EFI_INVALID_PARAMETER;
+	ret = efi_var_restore(buf, false);
+	if (ret != EFI_SUCCESS)
+		return ret;
+
+	for (pos = buf->length; pos + hdr_size <= len;) {
+		struct efi_var_record *rec = (void *)buf + pos;
+
+		/* Stop at a record torn by a power loss */
+		if (rec->magic != EFI_VAR_RECORD_MAGIC || rec->reserved ||
+		    rec->length & 7 || rec->length < hdr_size ||
+		    rec->length > len - pos ||
+		    rec->crc32 != crc32(0, (u8 *)&rec->var,
+					rec->length -
+					offsetof(struct efi_var_record, var)))
+			break;
+		efi_var_replay_record(rec);
+		pos += rec->length;
+	}
+	*validp = pos;
+
+	return EFI_SUCCESS;
+}
+
 /**
  * efi_var_from_file() - read variables from file
  *
@@ -212,12 +367,13 @@ efi_status_t efi_var_restore(struct efi_var_file *buf, bool safe)
 efi_status_t efi_var_from_file(void)
 {
 #ifdef CONFIG_EFI_VARIABLE_FILE_STORE
+	const loff_t size = EFI_VAR_BUF_SIZE + CONFIG_EFI_VAR_JOURNAL_SIZE;
 	struct efi_var_file *buf;
-	loff_t len;
+	loff_t len, valid;
 	efi_status_t ret;
 	int r;
 
-	buf = calloc(1, EFI_VAR_BUF_SIZE);
+	buf = calloc(1, size);
 	if (!buf) {
 		log_err("Out of memory\n");
 		return EFI_OUT_OF_RESOURCES;
@@ -226,14 +382,18 @@ efi_status_t efi_var_from_file(void)
 	ret = efi_set_blk_dev_to_system_partition();
 	if (ret != EFI_SUCCESS)
 		goto error;
-	r = fs_read(EFI_VAR_FILE_NAME, map_to_sysmem(buf), 0, EFI_VAR_BUF_SIZE,
-		    &len);
+	r = fs_read(EFI_VAR_FILE_NAME, map_to_sysmem(buf), 0, size, &len);
 	if (r || len < sizeof(struct efi_var_file)) {
 		log_err("Failed to load EFI variables\n");
 		goto error;
 	}
-	if (buf->length != len || efi_var_restore(buf, false) != EFI_SUCCESS)
+	if (efi_var_replay(buf, len, &valid) != EFI_SUCCESS) {
 		log_err("Invalid EFI variables file\n");
+	} else if (valid == len) {
+		/* Append further changes, else compact on the next change */
+		efi_var_file_len = len;
+		efi_var_snapshot_len = buf->length;
+	}
 error:
 	free(buf);
 #endif
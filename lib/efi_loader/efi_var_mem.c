@@ -19,6 +19,103 @@
 static struct efi_var_file __efi_runtime_data *efi_var_buf;
 static struct efi_var_entry __efi_runtime_data *efi_current_var;
 
+/*
+ * The variables are indexed by a hash table with open addressing placed
+ * directly after the variable buffer in the same runtime memory. Slots hold
+ * the offset of a variable relative to efi_var_buf, so the index needs no
+ * conversion in SetVirtualAddressMap(). 0 marks an empty slot. If the table
+ * gets too full, efi_var_mem_find() falls back to a linear search.
+ */
+#define EFI_VAR_INDEX_OFFSET	ALIGN(EFI_VAR_BUF_SIZE, 8)
+#define EFI_VAR_INDEX_SLOTS	(EFI_VAR_BUF_SIZE / 32)
+#define EFI_VAR_INDEX_MAX	(EFI_VAR_INDEX_SLOTS / 4 * 3)
+#define EFI_VAR_INDEX_SIZE	(EFI_VAR_INDEX_SLOTS * sizeof(u32))
+
+/* Number of indexed variables, exceeds EFI_VAR_INDEX_MAX on overflow */
+static u32 __efi_runtime_data efi_var_index_count;
+
+/**
+ * efi_var_index() - get the variable index
+ *
+ * Return:	array of EFI_VAR_INDEX_SLOTS offsets
+ */
+static inline u32 __efi_runtime *efi_var_index(void)
+{
+	return (u32 *)((uintptr_t)efi_var_buf + EFI_VAR_INDEX_OFFSET);
+}
+
+/**
+ * efi_var_hash() - calculate hash of a variable name and GUID (FNV-1a)
+ *
+ * @guid:	GUID of the variable
+ * @name:	name of the variable
+ * Return:	hash value
+ */
+static u32 __efi_runtime efi_var_hash(const efi_guid_t *guid, const u16 *name)
+{
+	const u8 *pos = (const u8 *)guid;
+	u32 hash = 0x811c9dc5;
+	int i;
+
+	for (i = 0; i < sizeof(efi_guid_t); ++i)
+		hash = (hash ^ pos[i]) * 0x01000193;
+	for (; *name; ++name)
+		hash = (hash ^ *name) * 0x01000193;
+
+	return hash;
+}
+
+/**
+ * efi_var_index_add() - add a variable to the index
+ *
+ * @var:	variable in efi_var_buf
+ */
+static void __efi_runtime efi_var_index_add(struct efi_var_entry *var)
+{
+	u32 *index = efi_var_index();
+	u32 slot;
+
+	if (efi_var_index_count >= EFI_VAR_INDEX_MAX) {
+		efi_var_index_count = EFI_VAR_INDEX_MAX + 1;
+		return;
+	}
+	++efi_var_index_count;
+
+	for (slot = efi_var_hash(&var->guid, var->name) % EFI_VAR_INDEX_SLOTS;
+	     index[slot]; slot = (slot + 1) % EFI_VAR_INDEX_SLOTS)
+		;
+	index[slot] = (uintptr_t)var - (uintptr_t)efi_var_buf;
+}
+
+/**
+ * efi_var_index_rebuild() - rebuild the index of all variables
+ *
+ * This is needed when variables are moved inside efi_var_buf.
+ */
+static void __efi_runtime efi_var_index_rebuild(void)
+{
+	struct efi_var_entry *var, *last;
+	u32 *index = efi_var_index();
+	u32 slot;
+
+	for (slot = 0; slot < EFI_VAR_INDEX_SLOTS; ++slot)
+		index[slot] = 0;
+	efi_var_index_count = 0;
+
+	last = (struct efi_var_entry *)
+	       ((uintptr_t)efi_var_buf + efi_var_buf->length);
+	for (var = efi_var_buf->var; var < last;) {
+		u16 *data;
+
+		efi_var_index_add(var);
+		for (data = var->name; *data; ++data)
+			;
+		++data;
+		var = (struct efi_var_entry *)
+		      ALIGN((uintptr_t)data + var->length, 8);
+	}
+}
+
 /**
  * efi_var_mem_compare() - compare GUID and name with a variable
  *
@@ -84,6 +181,25 @@ struct efi_var_entry __efi_runtime
 		return efi_current_var;
 	}
 
+	if (efi_var_index_count <= EFI_VAR_INDEX_MAX) {
+		u32 *index = efi_var_index();
+		u32 slot;
+
+		for (slot = efi_var_hash(guid, name) % EFI_VAR_INDEX_SLOTS;
+		     index[slot]; slot = (slot + 1) % EFI_VAR_INDEX_SLOTS) {
+			var = (struct efi_var_entry *)
+			      ((uintptr_t)efi_var_buf + index[slot]);
+			if (efi_var_mem_compare(var, guid, name, next)) {
+				if (next && *next >= last)
+					*next = NULL;
+				return var;
+			}
+		}
+		if (next)
+			*next = NULL;
+		return NULL;
+	}
+
 	var = efi_var_buf->var;
 	if (var < last) {
 		for (; var;) {
@@ -131,6 +247,8 @@ void __efi_runtime efi_var_mem_del(struct efi_var_entry *var)
 	efi_var_buf->crc32 = crc32(0, (u8 *)efi_var_buf->var,
 				   efi_var_buf->length -
 				   sizeof(struct efi_var_file));
+	/* All following variables have moved */
+	efi_var_index_rebuild();
 }
 
 efi_status_t __efi_runtime efi_var_mem_ins(
@@ -162,6 +280,7 @@ efi_status_t __efi_runtime efi_var_mem_ins(
 			   sizeof(u16) * var_name_len);
 	efi_memcpy_runtime(data, data1, size1);
 	efi_memcpy_runtime((u8 *)data + size1, data2, size2);
+	efi_var_index_add(var);
 
 	var = (struct efi_var_entry *)
 	      ALIGN((uintptr_t)data + var->length, 8);
@@ -247,12 +366,13 @@ efi_status_t efi_var_mem_init(void)
 
 	ret = efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES,
 				 EFI_RUNTIME_SERVICES_DATA,
-				 efi_size_in_pages(EFI_VAR_BUF_SIZE),
+				 efi_size_in_pages(EFI_VAR_INDEX_OFFSET +
+						   EFI_VAR_INDEX_SIZE),
 				 &memory);
 	if (ret != EFI_SUCCESS)
 		return ret;
 	efi_var_buf = (struct efi_var_file *)(uintptr_t)memory;
-	memset(efi_var_buf, 0, EFI_VAR_BUF_SIZE);
+	memset(efi_var_buf, 0, EFI_VAR_INDEX_OFFSET + EFI_VAR_INDEX_SIZE);
 	efi_var_buf->magic = EFI_VAR_FILE_MAGIC;
 	efi_var_buf->length = (uintptr_t)efi_var_buf->var -
 			      (uintptr_t)efi_var_buf;
@@ -348,4 +468,6 @@ efi_get_next_variable_name_mem(efi_uintn_t *variable_name_size,
 void efi_var_buf_update(struct efi_var_file *var_buf)
 {
 	memcpy(efi_var_buf, var_buf, EFI_VAR_BUF_SIZE);
+	efi_current_var = NULL;
+	efi_var_index_rebuild();
 }
@@ -0,0 +1,498 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * efi_selftest_block_io2
+ *
+ * This test checks the read-ahead window and the EFI_BLOCK_IO2_PROTOCOL of
+ * the block IO devices created by U-Boot.
+ * A disk image is created in memory and connected as in the block device
+ * test. The block IO protocol of the disk counts the blocks read from it.
+ * A short read of the partition must fill the read-ahead window so that the
+ * following block is read from memory. A write must discard the window.
+ * ReadBlocksEx() with a token must signal the token's event.
+ */
+
+#include <efi_selftest.h>
+#include "efi_selftest_disk_image.h"
+#include <asm/cache.h>
+
+/* Block size of compressed disk image */
+#define COMPRESSED_DISK_IMAGE_BLOCK_SIZE 8
+
+/* Binary logarithm of the block size */
+#define LB_BLOCK_SIZE 9
+
+/* Block of the partition used by the test, it holds hello.txt */
+#define TEST_LBA 0x27
+
+static struct efi_boot_services *boottime;
+
+static const efi_guid_t block_io_protocol_guid = EFI_BLOCK_IO_PROTOCOL_GUID;
+static const efi_guid_t block_io2_protocol_guid = EFI_BLOCK_IO2_PROTOCOL_GUID;
+static const efi_guid_t guid_device_path = EFI_DEVICE_PATH_PROTOCOL_GUID;
+static efi_guid_t guid_vendor =
+	EFI_GUID(0x5e8a0d31, 0x94c2, 0x4b77,
+		 0xa3, 0x1f, 0x6d, 0x02, 0xe9, 0x58, 0xc4, 0x1b);
+
+static struct efi_device_path *dp;
+
+/* One 8 byte block of the compressed disk image */
+struct line {
+	size_t addr;
+	char *line;
+};
+
+/* Compressed disk image */
+struct compressed_disk_image {
+	size_t length;
+	struct line lines[];
+};
+
+static const struct compressed_disk_image img = EFI_ST_DISK_IMG;
+
+/* Decompressed disk image */
+static u8 *image;
+
+/* Number of blocks read from the disk image */
+static u64 blocks_read;
+
+/*
+ * Reset service of the block IO protocol.
+ *
+ * @this	block IO protocol
+ * Return:	status code
+ */
+static efi_status_t EFIAPI reset(
+			struct efi_block_io *this,
+			char extended_verification)
+{
+	return EFI_SUCCESS;
+}
+
+/*
+ * Read service of the block IO protocol.
+ *
+ * @this	block IO protocol
+ * @media_id	media id
+ * @lba		start of the read in logical blocks
+ * @buffer_size	number of bytes to read
+ * @buffer	target buffer
+ * Return:	status code
+ */
+static efi_status_t EFIAPI read_blocks(
+			struct efi_block_io *this, u32 media_id, u64 lba,
+			efi_uintn_t buffer_size, void *buffer)
+{
+	u8 *start;
+
+	if ((lba << LB_BLOCK_SIZE) + buffer_size > img.length)
+		return EFI_INVALID_PARAMETER;
+	start = image + (lba << LB_BLOCK_SIZE);
+
+	boottime->copy_mem(buffer, start, buffer_size);
+	blocks_read += buffer_size >> LB_BLOCK_SIZE;
+
+	return EFI_SUCCESS;
+}
+
+/*
+ * Write service of the block IO protocol.
+ *
+ * @this	block IO protocol
+ * @media_id	media id
+ * @lba		start of the write in logical blocks
+ * @buffer_size	number of bytes to read
+ * @buffer	source buffer
+ * Return:	status code
+ */
+static efi_status_t EFIAPI write_blocks(
+			struct efi_block_io *this, u32 media_id, u64 lba,
+			efi_uintn_t buffer_size, void *buffer)
+{
+	u8 *start;
+
+	if ((lba << LB_BLOCK_SIZE) + buffer_size > img.length)
+		return EFI_INVALID_PARAMETER;
+	start = image + (lba << LB_BLOCK_SIZE);
+
+	boottime->copy_mem(start, buffer, buffer_size);
+
+	return EFI_SUCCESS;
+}
+
+/*
+ * Flush service of the block IO protocol.
+ *
+ * @this	block IO protocol
+ * Return:	status code
+ */
+static efi_status_t EFIAPI flush_blocks(struct efi_block_io *this)
+{
+	return EFI_SUCCESS;
+}
+
+/*
+ * Decompress the disk image.
+ *
+ * @image	decompressed disk image
+ * Return:	status code
+ */
+static efi_status_t decompress(u8 **image)
+{
+	u8 *buf;
+	size_t i;
+	size_t addr;
+	size_t len;
+	efi_status_t ret;
+
+	ret = boottime->allocate_pool(EFI_LOADER_DATA, img.length,
+				      (void **)&buf);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Out of memory\n");
+		return ret;
+	}
+	boottime->set_mem(buf, img.length, 0);
+
+	for (i = 0; ; ++i) {
+		if (!img.lines[i].line)
+			break;
+		addr = img.lines[i].addr;
+		len = COMPRESSED_DISK_IMAGE_BLOCK_SIZE;
+		if (addr + len > img.length)
+			len = img.length - addr;
+		boottime->copy_mem(buf + addr, img.lines[i].line, len);
+	}
+	*image = buf;
+	return ret;
+}
+
+static struct efi_block_io_media media;
+
+static struct efi_block_io block_io = {
+	.media = &media,
+	.reset = reset,
+	.read_blocks = read_blocks,
+	.write_blocks = write_blocks,
+	.flush_blocks = flush_blocks,
+};
+
+/* Handle for the block IO device */
+static efi_handle_t disk_handle;
+
+/*
+ * Setup unit test.
+ *
+ * @handle:	handle of the loaded image
+ * @systable:	system table
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int setup(const efi_handle_t handle,
+		 const struct efi_system_table *systable)
+{
+	efi_status_t ret;
+	struct efi_device_path_vendor vendor_node;
+	struct efi_device_path end_node;
+
+	boottime = systable->boottime;
+
+	if (decompress(&image) != EFI_SUCCESS)
+		return EFI_ST_FAILURE;
+
+	block_io.media->block_size = 1 << LB_BLOCK_SIZE;
+	block_io.media->last_block = (img.length >> LB_BLOCK_SIZE) - 1;
+
+	ret = boottime->install_protocol_interface(
+				&disk_handle, &block_io_protocol_guid,
+				EFI_NATIVE_INTERFACE, &block_io);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to install block I/O protocol\n");
+		return EFI_ST_FAILURE;
+	}
+
+	ret = boottime->allocate_pool(EFI_LOADER_DATA,
+				      sizeof(struct efi_device_path_vendor) +
+				      sizeof(struct efi_device_path),
+				      (void **)&dp);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Out of memory\n");
+		return EFI_ST_FAILURE;
+	}
+	vendor_node.dp.type = DEVICE_PATH_TYPE_HARDWARE_DEVICE;
+	vendor_node.dp.sub_type = DEVICE_PATH_SUB_TYPE_VENDOR;
+	vendor_node.dp.length = sizeof(struct efi_device_path_vendor);
+
+	boottime->copy_mem(&vendor_node.guid, &guid_vendor,
+			   sizeof(efi_guid_t));
+	boottime->copy_mem(dp, &vendor_node,
+			   sizeof(struct efi_device_path_vendor));
+	end_node.type = DEVICE_PATH_TYPE_END;
+	end_node.sub_type = DEVICE_PATH_SUB_TYPE_END;
+	end_node.length = sizeof(struct efi_device_path);
+
+	boottime->copy_mem((char *)dp + sizeof(struct efi_device_path_vendor),
+			   &end_node, sizeof(struct efi_device_path));
+	ret = boottime->install_protocol_interface(&disk_handle,
+						   &guid_device_path,
+						   EFI_NATIVE_INTERFACE,
+						   dp);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("InstallProtocolInterface failed\n");
+		return EFI_ST_FAILURE;
+	}
+	return EFI_ST_SUCCESS;
+}
+
+/*
+ * Tear down unit test.
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int teardown(void)
+{
+	efi_status_t r = EFI_ST_SUCCESS;
+
+	if (disk_handle) {
+		r = boottime->uninstall_protocol_interface(disk_handle,
+							   &guid_device_path,
+							   dp);
+		if (r != EFI_SUCCESS) {
+			efi_st_error("Uninstall device path failed\n");
+			return EFI_ST_FAILURE;
+		}
+		r = boottime->uninstall_protocol_interface(
+				disk_handle, &block_io_protocol_guid,
+				&block_io);
+		if (r != EFI_SUCCESS) {
+			efi_st_error(
+				"Failed to uninstall block I/O protocol\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+
+	if (image) {
+		r = boottime->free_pool(image);
+		if (r != EFI_SUCCESS) {
+			efi_st_error("Failed to free image\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+	return r;
+}
+
+/*
+ * Get length of device path without end tag.
+ *
+ * @dp		device path
+ * Return:	length of device path in bytes
+ */
+static efi_uintn_t dp_size(struct efi_device_path *dp)
+{
+	struct efi_device_path *pos = dp;
+
+	while (pos->type != DEVICE_PATH_TYPE_END)
+		pos = (struct efi_device_path *)((char *)pos + pos->length);
+	return (char *)pos - (char *)dp;
+}
+
+/*
+ * Find the handle of the partition created by ConnectController().
+ *
+ * Return:	partition handle or NULL
+ */
+static efi_handle_t find_partition(void)
+{
+	efi_status_t ret;
+	efi_uintn_t no_handles, i, len;
+	efi_handle_t *handles;
+	efi_handle_t handle_partition = NULL;
+	struct efi_device_path *dp_partition;
+
+	ret = boottime->locate_handle_buffer(
+				BY_PROTOCOL, &guid_device_path, NULL,
+				&no_handles, &handles);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to locate handles\n");
+		return NULL;
+	}
+	len = dp_size(dp);
+	for (i = 0; i < no_handles; ++i) {
+		ret = boottime->open_protocol(handles[i], &guid_device_path,
+					      (void **)&dp_partition,
+					      NULL, NULL,
+					      EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+		if (ret != EFI_SUCCESS)
+			continue;
+		if (len >= dp_size(dp_partition))
+			continue;
+		if (memcmp(dp, dp_partition, len))
+			continue;
+		handle_partition = handles[i];
+		break;
+	}
+	boottime->free_pool(handles);
+
+	return handle_partition;
+}
+
+/*
+ * Execute unit test.
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int execute(void)
+{
+	efi_status_t ret;
+	efi_handle_t handle_partition;
+	struct efi_block_io *bio;
+	struct efi_block_io2 *bio2;
+	struct efi_block_io2_token token;
+	struct efi_event *event;
+	u32 part_start;
+	u64 count;
+	u8 *disk_block;
+	u8 buf[1 << LB_BLOCK_SIZE] __aligned(ARCH_DMA_MINALIGN);
+	u8 pattern[1 << LB_BLOCK_SIZE] __aligned(ARCH_DMA_MINALIGN);
+
+	/* Connect controller to virtual disk */
+	ret = boottime->connect_controller(disk_handle, NULL, NULL, 1);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to connect controller\n");
+		return EFI_ST_FAILURE;
+	}
+	handle_partition = find_partition();
+	if (!handle_partition) {
+		efi_st_error("Partition handle not found\n");
+		return EFI_ST_FAILURE;
+	}
+	ret = boottime->open_protocol(handle_partition,
+				      &block_io_protocol_guid,
+				      (void **)&bio, NULL, NULL,
+				      EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to open block IO protocol\n");
+		return EFI_ST_FAILURE;
+	}
+	ret = boottime->open_protocol(handle_partition,
+				      &block_io2_protocol_guid,
+				      (void **)&bio2, NULL, NULL,
+				      EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to open block IO2 protocol\n");
+		return EFI_ST_FAILURE;
+	}
+	/* Get start of first MBR partition */
+	memcpy(&part_start, image + 0x1c6, sizeof(u32));
+	disk_block = image + ((part_start + TEST_LBA + 1) << LB_BLOCK_SIZE);
+
+	/* A write discards all cached blocks of the device */
+	boottime->set_mem(pattern, sizeof(pattern), 0xa5);
+	ret = bio->write_blocks(bio, bio->media->media_id, TEST_LBA,
+				sizeof(pattern), pattern);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("WriteBlocks failed\n");
+		return EFI_ST_FAILURE;
+	}
+
+	/* A short read fills the read-ahead window */
+	blocks_read = 0;
+	ret = bio->read_blocks(bio, bio->media->media_id, TEST_LBA,
+			       sizeof(buf), buf);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("ReadBlocks failed\n");
+		return EFI_ST_FAILURE;
+	}
+	if (memcmp(buf, pattern, sizeof(buf))) {
+		efi_st_error("ReadBlocks returned stale data after a write\n");
+		return EFI_ST_FAILURE;
+	}
+	if (!blocks_read) {
+		efi_st_error("ReadBlocks did not read the disk\n");
+		return EFI_ST_FAILURE;
+	}
+
+	/* The next block is read from the window */
+	count = blocks_read;
+	ret = bio->read_blocks(bio, bio->media->media_id, TEST_LBA + 1,
+			       sizeof(buf), buf);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("ReadBlocks failed\n");
+		return EFI_ST_FAILURE;
+	}
+	if (memcmp(buf, disk_block, sizeof(buf))) {
+		efi_st_error("Unexpected block content\n");
+		return EFI_ST_FAILURE;
+	}
+#if defined(CONFIG_BLOCK_CACHE) && CONFIG_EFI_DISK_READAHEAD > 1
+	if (blocks_read != count) {
+		efi_st_error("Read-ahead window not used\n");
+		return EFI_ST_FAILURE;
+	}
+#else
+	efi_st_todo("Read-ahead is disabled\n");
+#endif
+
+	/* A write to a block in the window must be visible when read back */
+	boottime->set_mem(pattern, sizeof(pattern), 0x5a);
+	ret = bio->write_blocks(bio, bio->media->media_id, TEST_LBA + 1,
+				sizeof(pattern), pattern);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("WriteBlocks failed\n");
+		return EFI_ST_FAILURE;
+	}
+	if (memcmp(disk_block, pattern, sizeof(pattern))) {
+		efi_st_error("WriteBlocks did not write the disk\n");
+		return EFI_ST_FAILURE;
+	}
+	ret = bio->read_blocks(bio, bio->media->media_id, TEST_LBA + 1,
+			       sizeof(buf), buf);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("ReadBlocks failed\n");
+		return EFI_ST_FAILURE;
+	}
+	if (memcmp(buf, pattern, sizeof(buf))) {
+		efi_st_error("ReadBlocks returned stale data after a write\n");
+		return EFI_ST_FAILURE;
+	}
+
+	/* ReadBlocksEx() with a token signals the token's event */
+	ret = boottime->create_event(0, TPL_CALLBACK, NULL, NULL, &event);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Could not create event\n");
+		return EFI_ST_FAILURE;
+	}
+	token.event = event;
+	token.transaction_status = EFI_NOT_READY;
+	boottime->set_mem(buf, sizeof(buf), 0);
+	ret = bio2->read_blocks_ex(bio2, bio2->media->media_id, TEST_LBA + 1,
+				   &token, sizeof(buf), buf);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("ReadBlocksEx failed\n");
+		return EFI_ST_FAILURE;
+	}
+	if (token.transaction_status != EFI_SUCCESS) {
+		efi_st_error("ReadBlocksEx did not complete the token\n");
+		return EFI_ST_FAILURE;
+	}
+	if (boottime->check_event(event) != EFI_SUCCESS) {
+		efi_st_error("ReadBlocksEx did not signal the event\n");
+		return EFI_ST_FAILURE;
+	}
+	if (memcmp(buf, pattern, sizeof(buf))) {
+		efi_st_error("Unexpected block content\n");
+		return EFI_ST_FAILURE;
+	}
+	ret = boottime->close_event(event);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Could not close event\n");
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+EFI_UNIT_TEST(blkio2) = {
+	.name = "block io2",
+	.phase = EFI_EXECUTE_BEFORE_BOOTTIME_EXIT,
+	.setup = setup,
+	.execute = execute,
+	.teardown = teardown,
+};
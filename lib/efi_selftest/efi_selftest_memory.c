@@ -5,7 +5,7 @@
  * Copyright (c) 2018 Heinrich Schuchardt <xypron.glpk@gmx.de>
  *
  * This unit test checks the following boottime services:
- * AllocatePages, FreePages, GetMemoryMap
+ * AllocatePages, FreePages, AllocatePool, FreePool, GetMemoryMap
  *
  * The memory type used for the device tree is checked.
  */
@@ -13,6 +13,7 @@
 #include <efi_selftest.h>
 
 #define EFI_ST_NUM_PAGES 8
+#define EFI_ST_POOL_SIZE 24
 
 static const efi_guid_t fdt_guid = EFI_FDT_GUID;
 static struct efi_boot_services *boottime;
@@ -102,6 +103,7 @@ static int execute(void)
 {
 	u64 p1;
 	u64 p2;
+	void *p3;
 	efi_uintn_t map_size = 0;
 	efi_uintn_t map_key;
 	efi_uintn_t desc_size;
@@ -125,6 +127,18 @@ static int execute(void)
 		return EFI_ST_FAILURE;
 	}
 
+	/* Small pool allocations must be reported with their memory type */
+	ret = boottime->allocate_pool(EFI_RUNTIME_SERVICES_DATA,
+				      EFI_ST_POOL_SIZE, &p3);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("AllocatePool did not return EFI_SUCCESS\n");
+		return EFI_ST_FAILURE;
+	}
+	if ((uintptr_t)p3 & 7) {
+		efi_st_error("AllocatePool returned unaligned memory\n");
+		return EFI_ST_FAILURE;
+	}
+
 	/* Load memory map */
 	ret = boottime->get_memory_map(&map_size, NULL, &map_key, &desc_size,
 				       &desc_version);
@@ -155,6 +169,10 @@ static int execute(void)
 	if (find_in_memory_map(map_size, memory_map, desc_size, p2,
 			       EFI_RUNTIME_SERVICES_DATA) != EFI_ST_SUCCESS)
 		return EFI_ST_FAILURE;
+	if (find_in_memory_map(map_size, memory_map, desc_size,
+			       (uintptr_t)p3, EFI_RUNTIME_SERVICES_DATA) !=
+	    EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
 
 	/* Free memory */
 	ret = boottime->free_pages(p1, EFI_ST_NUM_PAGES);
@@ -167,6 +185,11 @@ static int execute(void)
 		efi_st_error("FreePages did not return EFI_SUCCESS\n");
 		return EFI_ST_FAILURE;
 	}
+	ret = boottime->free_pool(p3);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("FreePool did not return EFI_SUCCESS\n");
+		return EFI_ST_FAILURE;
+	}
 	ret = boottime->free_pool(memory_map);
 	if (ret != EFI_SUCCESS) {
 		efi_st_error("FreePool did not return EFI_SUCCESS\n");
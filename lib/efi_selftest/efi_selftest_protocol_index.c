@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * efi_selftest_protocol_index
+ *
+ * This unit test checks the protocol services LocateProtocol, LocateHandle,
+ * and HandleProtocol, which use the protocol index, with many handles
+ * implementing one protocol and a single handle implementing another.
+ * The number of GUID comparisons per lookup must not grow with the number
+ * of handles.
+ */
+
+#include <efi_loader.h>
+#include <efi_selftest.h>
+
+#define EFI_ST_HANDLES 256
+#define EFI_ST_LOOKUPS 100
+#define EFI_ST_MAX_COMPARES 16
+
+static struct efi_boot_services *boottime;
+static efi_guid_t guid_common =
+	EFI_GUID(0x1f5e2bcd, 0x3a07, 0x4e0c,
+		 0x9b, 0x61, 0x02, 0x8e, 0x43, 0xd7, 0xa5, 0x19);
+static efi_guid_t guid_rare =
+	EFI_GUID(0x7c2d9e41, 0x55b8, 0x4a3f,
+		 0x86, 0x1a, 0xe4, 0x30, 0x9c, 0x5d, 0x27, 0xb2);
+static efi_handle_t handles[EFI_ST_HANDLES];
+static efi_handle_t handle_rare;
+static int interface_common;
+static int interface_rare;
+
+/**
+ * setup() - setup unit test
+ *
+ * Create many handles implementing a common protocol and a single handle
+ * implementing a rare protocol.
+ *
+ * @handle:	handle of the loaded image
+ * @systable:	system table
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int setup(const efi_handle_t handle,
+		 const struct efi_system_table *systable)
+{
+	efi_status_t ret;
+	size_t i;
+
+	boottime = systable->boottime;
+
+	for (i = 0; i < EFI_ST_HANDLES; ++i) {
+		ret = boottime->install_protocol_interface(&handles[i],
+							   &guid_common,
+							   EFI_NATIVE_INTERFACE,
+							   &interface_common);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("InstallProtocolInterface failed\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+	ret = boottime->install_protocol_interface(&handle_rare, &guid_rare,
+						   EFI_NATIVE_INTERFACE,
+						   &interface_rare);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("InstallProtocolInterface failed\n");
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * teardown() - tear down unit test
+ *
+ * Uninstalling the last protocol of a handle deletes the handle.
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int teardown(void)
+{
+	efi_status_t ret;
+	size_t i;
+
+	for (i = 0; i < EFI_ST_HANDLES; ++i) {
+		if (!handles[i])
+			continue;
+		ret = boottime->uninstall_protocol_interface(handles[i],
+							     &guid_common,
+							     &interface_common);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("UninstallProtocolInterface failed\n");
+			return EFI_ST_FAILURE;
+		}
+		handles[i] = NULL;
+	}
+	if (handle_rare) {
+		ret = boottime->uninstall_protocol_interface(handle_rare,
+							     &guid_rare,
+							     &interface_rare);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("UninstallProtocolInterface failed\n");
+			return EFI_ST_FAILURE;
+		}
+		handle_rare = NULL;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * execute() - execute unit test
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int execute(void)
+{
+	efi_handle_t buffer[EFI_ST_HANDLES];
+	efi_uintn_t buffer_size;
+	ulong compares;
+	void *interface;
+	efi_status_t ret;
+	size_t i;
+
+	/* LocateHandle() must return the handles in creation order */
+	buffer_size = sizeof(buffer);
+	ret = boottime->locate_handle(BY_PROTOCOL, &guid_common, NULL,
+				      &buffer_size, buffer);
+	if (ret != EFI_SUCCESS || buffer_size != sizeof(buffer)) {
+		efi_st_error("LocateHandle failed\n");
+		return EFI_ST_FAILURE;
+	}
+	for (i = 0; i < EFI_ST_HANDLES; ++i) {
+		if (buffer[i] != handles[i]) {
+			efi_st_error("LocateHandle returned wrong order\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+
+	efi_protocol_compares = 0;
+	for (i = 0; i < EFI_ST_LOOKUPS; ++i) {
+		ret = boottime->locate_protocol(&guid_rare, NULL, &interface);
+		if (ret != EFI_SUCCESS || interface != &interface_rare) {
+			efi_st_error("LocateProtocol failed\n");
+			return EFI_ST_FAILURE;
+		}
+		ret = boottime->handle_protocol(handle_rare, &guid_rare,
+						&interface);
+		if (ret != EFI_SUCCESS || interface != &interface_rare) {
+			efi_st_error("HandleProtocol failed\n");
+			return EFI_ST_FAILURE;
+		}
+		buffer_size = sizeof(buffer);
+		ret = boottime->locate_handle(BY_PROTOCOL, &guid_rare, NULL,
+					      &buffer_size, buffer);
+		if (ret != EFI_SUCCESS || buffer_size != sizeof(efi_handle_t) ||
+		    buffer[0] != handle_rare) {
+			efi_st_error("LocateHandle failed\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+	compares = efi_protocol_compares / (3 * EFI_ST_LOOKUPS);
+	if (compares > EFI_ST_MAX_COMPARES) {
+		efi_st_error("Protocol lookup does not use the index\n");
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+EFI_UNIT_TEST(protindex) = {
+	.name = "protocol index",
+	.phase = EFI_EXECUTE_BEFORE_BOOTTIME_EXIT,
+	.setup = setup,
+	.execute = execute,
+	.teardown = teardown,
+};
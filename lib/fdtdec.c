@@ -25,6 +25,7 @@
 #include <asm/sections.h>
 #include <dm/ofnode.h>
 #include <dm/of_extra.h>
+#include <dm/of_index.h>
 #include <linux/ctype.h>
 #include <linux/lzo.h>
 #include <linux/ioport.h>
@@ -635,7 +636,8 @@ int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 	if (!phandle)
 		return -FDT_ERR_NOTFOUND;
 
-	lookup = fdt_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
+	lookup = of_index_node_offset_by_phandle(blob,
+						 fdt32_to_cpu(*phandle));
 	return lookup;
 }
 
@@ -766,8 +768,8 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 			 * below.
 			 */
 			if (cells_name || cur_index == index) {
-				node = fdt_node_offset_by_phandle(blob,
-								  phandle);
+				node = of_index_node_offset_by_phandle(blob,
+								       phandle);
 				if (node < 0) {
 					debug("%s: could not find phandle\n",
 					      fdt_get_name(blob, src_node,
@@ -1306,6 +1308,8 @@ int fdtdec_add_reserved_memory(void *blob, const char *basename,
 	fdt_size_t size;
 	char name[64];
 
+	of_index_drop(blob);
+
 	/* create an empty /reserved-memory node if one doesn't exist */
 	parent = fdt_path_offset(blob, "/reserved-memory");
 	if (parent < 0) {
@@ -1466,7 +1470,7 @@ int fdtdec_get_carveout(const void *blob, const char *node,
 
 	phandle = fdt32_to_cpu(prop[index]);
 
-	offset = fdt_node_offset_by_phandle(blob, phandle);
+	offset = of_index_node_offset_by_phandle(blob, phandle);
 	if (offset < 0) {
 		debug("failed to find node for phandle %u\n", phandle);
 		return offset;
@@ -1544,6 +1548,7 @@ int fdtdec_set_carveout(void *blob, const char *node, const char *prop_name,
 	fdt32_t value;
 	void *prop;
 
+	of_index_drop(blob);
 	err = fdtdec_add_reserved_memory(blob, name, carveout, compatibles,
 					 count, &phandle, flags);
 	if (err < 0) {
@@ -54,11 +54,25 @@
  * which describes the current status.
  */
 
+/**
+ * struct env_entry_node - A slot in the hash table
+ *
+ * @used:	USED_FREE, USED_DELETED, or 1 if the slot holds an entry
+ * @hash:	Hash of the key, see hstring()
+ * @entry:	Entry in this slot, allocated together with its key so that it
+ *		does not move when the table grows
+ */
 struct env_entry_node {
 	int used;
-	struct env_entry entry;
+	unsigned int hash;
+	struct env_entry *entry;
 };
 
+/*
+ * Number of slots of the old table moved into the new one on each change,
+ * which must be enough to empty the old table before the new one fills up
+ */
+#define HTAB_MIGRATE	8
 
 static void _hdelete(const char *key, struct hsearch_data *htab,
 		     struct env_entry *ep, int idx);
@@ -85,6 +99,19 @@ static int isprime(unsigned int number)
 	return number % div != 0;
 }
 
+/* Get the first prime number not smaller than nel */
+static unsigned int hprime(size_t nel)
+{
+	/* The second hash function needs at least three slots */
+	if (nel < 5)
+		nel = 5;
+	nel |= 1;		/* make odd */
+	while (!isprime(nel))
+		nel += 2;
+
+	return nel;
+}
+
 /*
  * Before using the hash table we must allocate memory for it.
  * Test for an existing table are done. We allocate one element
@@ -92,6 +119,9 @@ static int isprime(unsigned int number)
  * indexing as explained in the comment for the hsearch function.
  * The contents of the table is zeroed, especially the field used
  * becomes zero.
+ *
+ * The table grows when it is three-quarters full, so "nel" is only the
+ * number of elements it starts with.
  */
 
 int hcreate_r(size_t nel, struct hsearch_data *htab)
@@ -108,13 +138,16 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
 		return 0;
 	}
 
-	/* Change nel to the first prime number not smaller as nel. */
-	nel |= 1;		/* make odd */
-	while (!isprime(nel))
-		nel += 2;
-
-	htab->size = nel;
+	htab->size = hprime(nel);
 	htab->filled = 0;
+	htab->deleted = 0;
+	htab->old_table = NULL;
+	htab->old_size = 0;
+	htab->old_pos = 0;
+	htab->sorted = NULL;
+	htab->sorted_size = 0;
+	htab->sorted_count = 0;
+	htab->busy = 0;
 
 	/* allocate memory and zero out */
 	htab->table = (struct env_entry_node *)calloc(htab->size + 1,
@@ -138,10 +171,21 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
  * be freed and the local static variable can be marked as not used.
  */
 
-void hdestroy_r(struct hsearch_data *htab)
+static void hfree_table(struct env_entry_node *table, unsigned int size)
 {
 	int i;
 
+	for (i = 1; i <= size; ++i) {
+		if (table[i].used > 0) {
+			free(table[i].entry->data);
+			free(table[i].entry);
+		}
+	}
+	free(table);
+}
+
+void hdestroy_r(struct hsearch_data *htab)
+{
 	/* Test for correct arguments.  */
 	if (htab == NULL) {
 		__set_errno(EINVAL);
@@ -149,18 +193,289 @@ void hdestroy_r(struct hsearch_data *htab)
 	}
 
 	/* free used memory */
-	for (i = 1; i <= htab->size; ++i) {
-		if (htab->table[i].used > 0) {
-			struct env_entry *ep = &htab->table[i].entry;
+	hfree_table(htab->table, htab->size);
+	if (htab->old_table)
+		hfree_table(htab->old_table, htab->old_size);
+	free(htab->sorted);
+	htab->old_table = NULL;
+	htab->sorted = NULL;
+	htab->sorted_size = 0;
+	htab->sorted_count = 0;
 
-			free((void *)ep->key);
-			free(ep->data);
+	/* the sign for an existing table is an value != NULL in htable */
+	htab->table = NULL;
+}
+
+/*
+ * Growing the table
+ */
+
+/*
+ * When the table is three-quarters full (counting deleted slots, which
+ * also lengthen searches) a new table is allocated with room for twice the
+ * number of entries. Rather than moving all entries at once, each following
+ * change moves HTAB_MIGRATE slots of the old table, so no single call
+ * takes long. Until the old table is empty, searches look in both tables.
+ *
+ * Indexes returned by hsearch_r() and hmatch_r() above the size of the
+ * new table refer to the old table.
+ */
+
+static struct env_entry_node *hnode(struct hsearch_data *htab,
+				    unsigned int idx)
+{
+	if (idx > htab->size)
+		return &htab->old_table[idx - htab->size];
+
+	return &htab->table[idx];
+}
+
+/* Compute a value for the given string, which is kept in its node */
+static unsigned int hstring(const char *key)
+{
+	unsigned int hval = 5381;
+
+	while (*key)
+		hval = hval * 33 + (unsigned char)*key++;
+
+	return hval;
+}
+
+/**
+ * hprobe() - Search one table for a key
+ *
+ * This uses double hashing with open addressing, see hsearch_r().
+ *
+ * @table:	Table to search
+ * @size:	Number of slots in @table, which is a prime
+ * @key:	Key to search for, or NULL to find a slot for a new entry
+ * @hash:	Hash of the key
+ * @slotp:	If not NULL, returns the first free or deleted slot which
+ *		was seen, or 0 if the table is full
+ * Return:	index of the entry with this key, or 0 if not found
+ */
+static unsigned int hprobe(const struct env_entry_node *table,
+			   unsigned int size, const char *key,
+			   unsigned int hash, unsigned int *slotp)
+{
+	unsigned int hval, hval2, idx, slot = 0;
+
+	/*
+	 * First hash function:
+	 * simply take the modul but prevent zero.
+	 */
+	hval = hash % size;
+	if (hval == 0)
+		++hval;
+
+	/*
+	 * Second hash function:
+	 * as suggested in [Knuth]
+	 */
+	hval2 = 1 + hval % (size - 2);
+
+	idx = hval;
+	do {
+		const struct env_entry_node *node = &table[idx];
+
+		if (node->used == USED_FREE) {
+			if (!slot)
+				slot = idx;
+			break;
+		} else if (node->used == USED_DELETED) {
+			if (!slot)
+				slot = idx;
+		} else if (key && node->hash == hash &&
+			   !strcmp(key, node->entry->key)) {
+			return idx;
+		}
+
+		/*
+		 * Because SIZE is prime this guarantees to
+		 * step through all available indices.
+		 */
+		if (idx <= hval2)
+			idx = size + idx - hval2;
+		else
+			idx -= hval2;
+	} while (idx != hval);
+
+	if (slotp)
+		*slotp = slot;
+
+	return 0;
+}
+
+/* Move some slots of the old table into the new one */
+static void hmigrate(struct hsearch_data *htab, unsigned int count)
+{
+	struct env_entry_node *node;
+	unsigned int slot;
+
+	while (htab->old_table && count--) {
+		node = &htab->old_table[htab->old_pos];
+		if (node->used > 0) {
+			hprobe(htab->table, htab->size, NULL, node->hash, &slot);
+			if (htab->table[slot].used == USED_DELETED)
+				--htab->deleted;
+			htab->table[slot] = *node;
+			node->used = USED_DELETED;
+		}
+		if (++htab->old_pos > htab->old_size) {
+			free(htab->old_table);
+			htab->old_table = NULL;
 		}
 	}
-	free(htab->table);
+}
 
-	/* the sign for an existing table is an value != NULL in htable */
-	htab->table = NULL;
+/* Make sure there is room for another entry, growing the table if needed */
+static void hmaintain(struct hsearch_data *htab)
+{
+	struct env_entry_node *table;
+	unsigned int size;
+
+	/* Entries must stay where they are while callbacks run */
+	if (htab->busy)
+		return;
+
+	hmigrate(htab, HTAB_MIGRATE);
+	if ((htab->filled + htab->deleted + 1) * 4 <= htab->size * 3)
+		return;
+
+	/* The previous table must be empty before starting again */
+	hmigrate(htab, htab->old_size);
+
+	size = hprime(max(htab->filled * 2, htab->size));
+	table = calloc(size + 1, sizeof(struct env_entry_node));
+	if (!table) {
+		/* Carry on with the current table until it is full */
+		debug("hashtable: cannot grow to %u entries\n", size);
+		return;
+	}
+	debug("hashtable: growing from %u to %u entries\n", htab->size, size);
+	htab->old_table = htab->table;
+	htab->old_size = htab->size;
+	htab->old_pos = 1;
+	htab->table = table;
+	htab->size = size;
+	htab->deleted = 0;
+	hmigrate(htab, HTAB_MIGRATE);
+}
+
+/*
+ * Sorted list of entries
+ */
+
+/*
+ * All entries are also kept in a list sorted by key, so that hexport_r()
+ * does not need to sort them each time. Entries which arrive in order, as
+ * when importing an exported environment, are added at the end. Others are
+ * put in an unsorted tail, which is merged into the list when it is next
+ * needed: one at a time if there are a few, otherwise by sorting the whole
+ * list once rather than moving it for every entry.
+ */
+
+/* Largest unsorted tail which is merged one entry at a time */
+#define HTAB_SORT_TAIL	8
+
+static int hcmp_entry(const void *p1, const void *p2)
+{
+	struct env_entry *e1 = *(struct env_entry **)p1;
+	struct env_entry *e2 = *(struct env_entry **)p2;
+
+	return strcmp(e1->key, e2->key);
+}
+
+/**
+ * hsorted_pos() - Find the position of a key in the sorted list
+ *
+ * @htab:	Hash table
+ * @key:	Key to search for
+ * @count:	Number of entries at the start of the list to search
+ * Return:	position of the key, or where it would be inserted
+ */
+static unsigned int hsorted_pos(struct hsearch_data *htab, const char *key,
+				unsigned int count)
+{
+	unsigned int lo = 0, hi = count;
+
+	while (lo < hi) {
+		unsigned int mid = (lo + hi) / 2;
+
+		if (strcmp(htab->sorted[mid]->key, key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* Merge the unsorted tail into the sorted list */
+static void hsorted_flush(struct hsearch_data *htab)
+{
+	unsigned int pos, count = htab->sorted_count;
+	struct env_entry *ep;
+
+	if (htab->filled - count > HTAB_SORT_TAIL) {
+		qsort(htab->sorted, htab->filled, sizeof(*htab->sorted),
+		      hcmp_entry);
+		htab->sorted_count = htab->filled;
+		return;
+	}
+	for (; count < htab->filled; count++) {
+		ep = htab->sorted[count];
+		pos = hsorted_pos(htab, ep->key, count);
+		memmove(&htab->sorted[pos + 1], &htab->sorted[pos],
+			(count - pos) * sizeof(*htab->sorted));
+		htab->sorted[pos] = ep;
+	}
+	htab->sorted_count = count;
+}
+
+/* Add a new entry to the sorted list, before it is counted in filled */
+static int hsorted_add(struct hsearch_data *htab, struct env_entry *ep)
+{
+	unsigned int count = htab->sorted_count;
+
+	if (htab->filled == htab->sorted_size) {
+		unsigned int size = max(htab->sorted_size * 2, 16U);
+		struct env_entry **sorted;
+
+		/*
+		 * Not realloc(), which SPL may not have with a simple malloc()
+		 * and which fails before relocation once the list has grown
+		 */
+		sorted = malloc(size * sizeof(*sorted));
+		if (!sorted)
+			return -ENOMEM;
+		if (htab->filled)
+			memcpy(sorted, htab->sorted,
+			       htab->filled * sizeof(*sorted));
+		free(htab->sorted);
+		htab->sorted = sorted;
+		htab->sorted_size = size;
+	}
+	htab->sorted[htab->filled] = ep;
+	if (count == htab->filled &&
+	    (!count || strcmp(htab->sorted[count - 1]->key, ep->key) < 0))
+		htab->sorted_count++;
+
+	return 0;
+}
+
+/* Remove an entry from the sorted list, before it is uncounted in filled */
+static void hsorted_remove(struct hsearch_data *htab, struct env_entry *ep)
+{
+	unsigned int pos;
+
+	hsorted_flush(htab);
+	pos = hsorted_pos(htab, ep->key, htab->filled);
+	if (pos < htab->filled && htab->sorted[pos] == ep) {
+		memmove(&htab->sorted[pos], &htab->sorted[pos + 1],
+			(htab->filled - pos - 1) * sizeof(*htab->sorted));
+		htab->sorted_count--;
+	}
 }
 
 /*
@@ -170,17 +485,14 @@ void hdestroy_r(struct hsearch_data *htab)
 /*
  * This is the search function. It uses double hashing with open addressing.
  * The argument item.key has to be a pointer to an zero terminated, most
- * probably strings of chars. The function for generating a number of the
- * strings is simple but fast. It can be replaced by a more complex function
- * like ajw (see [Aho,Sethi,Ullman]) if the needs are shown.
+ * probably strings of chars. The hash of each key is computed once and
+ * kept in its slot, where it serves as a first fast comparison for equality
+ * of the stored and the parameter value. This helps to prevent unnecessary
+ * expensive calls of strcmp.
  *
- * We use an trick to speed up the lookup. The table is created by hcreate
- * with one more element available. This enables us to use the index zero
- * special. This index will never be used because we store the first hash
- * index in the field used where zero means not used. Every other value
- * means used. The used field can be used as a first fast comparison for
- * equality of the stored and the parameter value. This helps to prevent
- * unnecessary expensive calls of strcmp.
+ * The table is created by hcreate with one more element available. This
+ * enables us to use the index zero special. This index will never be used
+ * so that an index can be returned where zero means not found.
  *
  * This implementation differs from the standard library version of
  * this function in a number of ways:
@@ -198,19 +510,24 @@ void hdestroy_r(struct hsearch_data *htab)
  *   internal hash table, which is also guaranteed to be positive.
  *   This allows us direct access to the found hash table slot for
  *   example for functions like hdelete().
+ * - The table grows as needed, see hmaintain().
  */
 
 int hmatch_r(const char *match, int last_idx, struct env_entry **retval,
 	     struct hsearch_data *htab)
 {
-	unsigned int idx;
+	unsigned int idx, end = htab->size;
 	size_t key_len = strlen(match);
 
-	for (idx = last_idx + 1; idx < htab->size; ++idx) {
-		if (htab->table[idx].used <= 0)
+	if (htab->old_table)
+		end += htab->old_size;
+	for (idx = last_idx + 1; idx <= end; ++idx) {
+		struct env_entry_node *node = hnode(htab, idx);
+
+		if (node->used <= 0)
 			continue;
-		if (!strncmp(match, htab->table[idx].entry.key, key_len)) {
-			*retval = &htab->table[idx].entry;
+		if (!strncmp(match, node->entry->key, key_len)) {
+			*retval = node->entry;
 			return idx;
 		}
 	}
@@ -221,145 +538,102 @@ int hmatch_r(const char *match, int last_idx, struct env_entry **retval,
 }
 
 static int
-do_callback(const struct env_entry *e, const char *name, const char *value,
-	    enum env_op op, int flags)
+do_callback(struct hsearch_data *htab, const struct env_entry *e,
+	    const char *name, const char *value, enum env_op op, int flags)
 {
+	int ret = 0;
+
 #ifndef CONFIG_SPL_BUILD
-	if (e->callback)
-		return e->callback(name, value, op, flags);
+	if (e->callback) {
+		htab->busy++;
+		ret = e->callback(name, value, op, flags);
+		htab->busy--;
+	}
 #endif
-	return 0;
+	return ret;
+}
+
+static int
+do_change_ok(struct hsearch_data *htab, const struct env_entry *e,
+	     const char *value, enum env_op op, int flags)
+{
+	int ret;
+
+	if (!htab->change_ok)
+		return 0;
+	htab->busy++;
+	ret = htab->change_ok(e, value, op, flags);
+	htab->busy--;
+
+	return ret;
 }
 
 /*
- * Compare an existing entry with the desired key, and overwrite if the action
- * is ENV_ENTER.  This is simply a helper function for hsearch_r().
+ * Overwrite an existing entry if the action is ENV_ENTER.  This is simply
+ * a helper function for hsearch_r().
  */
-static inline int _compare_and_overwrite_entry(struct env_entry item,
+static inline int _overwrite_entry(struct env_entry item,
 		enum env_action action, struct env_entry **retval,
-		struct hsearch_data *htab, int flag, unsigned int hval,
-		unsigned int idx)
+		struct hsearch_data *htab, int flag, unsigned int idx)
 {
-	if (htab->table[idx].used == hval
-	    && strcmp(item.key, htab->table[idx].entry.key) == 0) {
-		/* Overwrite existing value? */
-		if (action == ENV_ENTER && item.data) {
-			/* check for permission */
-			if (htab->change_ok != NULL && htab->change_ok(
-			    &htab->table[idx].entry, item.data,
-			    env_op_overwrite, flag)) {
-				debug("change_ok() rejected setting variable "
-					"%s, skipping it!\n", item.key);
-				__set_errno(EPERM);
-				*retval = NULL;
-				return 0;
-			}
+	struct env_entry *ep = hnode(htab, idx)->entry;
 
-			/* If there is a callback, call it */
-			if (do_callback(&htab->table[idx].entry, item.key,
-					item.data, env_op_overwrite, flag)) {
-				debug("callback() rejected setting variable "
-					"%s, skipping it!\n", item.key);
-				__set_errno(EINVAL);
-				*retval = NULL;
-				return 0;
-			}
+	/* Overwrite existing value? */
+	if (action == ENV_ENTER && item.data) {
+		/* check for permission */
+		if (do_change_ok(htab, ep, item.data, env_op_overwrite,
+				 flag)) {
+			debug("change_ok() rejected setting variable "
+				"%s, skipping it!\n", item.key);
+			__set_errno(EPERM);
+			*retval = NULL;
+			return 0;
+		}
 
-			free(htab->table[idx].entry.data);
-			htab->table[idx].entry.data = strdup(item.data);
-			if (!htab->table[idx].entry.data) {
-				__set_errno(ENOMEM);
-				*retval = NULL;
-				return 0;
-			}
+		/* If there is a callback, call it */
+		if (do_callback(htab, ep, item.key, item.data,
+				env_op_overwrite, flag)) {
+			debug("callback() rejected setting variable "
+				"%s, skipping it!\n", item.key);
+			__set_errno(EINVAL);
+			*retval = NULL;
+			return 0;
+		}
+
+		free(ep->data);
+		ep->data = strdup(item.data);
+		if (!ep->data) {
+			__set_errno(ENOMEM);
+			*retval = NULL;
+			return 0;
 		}
-		/* return found entry */
-		*retval = &htab->table[idx].entry;
-		return idx;
 	}
-	/* keep searching */
-	return -1;
+	/* return found entry */
+	*retval = ep;
+	return idx;
 }
 
 int hsearch_r(struct env_entry item, enum env_action action,
 	      struct env_entry **retval, struct hsearch_data *htab, int flag)
 {
-	unsigned int hval;
-	unsigned int count;
+	unsigned int hval = hstring(item.key);
 	unsigned int len = strlen(item.key);
-	unsigned int idx;
-	unsigned int first_deleted = 0;
-	int ret;
-
-	/* Compute an value for the given string. Perhaps use a better method. */
-	hval = len;
-	count = len;
-	while (count-- > 0) {
-		hval <<= 4;
-		hval += item.key[count];
-	}
-
-	/*
-	 * First hash function:
-	 * simply take the modul but prevent zero.
-	 */
-	hval %= htab->size;
-	if (hval == 0)
-		++hval;
-
-	/* The first index tried. */
-	idx = hval;
-
-	if (htab->table[idx].used) {
-		/*
-		 * Further action might be required according to the
-		 * action value.
-		 */
-		unsigned hval2;
-
-		if (htab->table[idx].used == USED_DELETED)
-			first_deleted = idx;
-
-		ret = _compare_and_overwrite_entry(item, action, retval, htab,
-			flag, hval, idx);
-		if (ret != -1)
-			return ret;
-
-		/*
-		 * Second hash function:
-		 * as suggested in [Knuth]
-		 */
-		hval2 = 1 + hval % (htab->size - 2);
-
-		do {
-			/*
-			 * Because SIZE is prime this guarantees to
-			 * step through all available indices.
-			 */
-			if (idx <= hval2)
-				idx = htab->size + idx - hval2;
-			else
-				idx -= hval2;
-
-			/*
-			 * If we visited all entries leave the loop
-			 * unsuccessfully.
-			 */
-			if (idx == hval)
-				break;
-
-			if (htab->table[idx].used == USED_DELETED
-			    && !first_deleted)
-				first_deleted = idx;
-
-			/* If entry is found use it. */
-			ret = _compare_and_overwrite_entry(item, action, retval,
-				htab, flag, hval, idx);
-			if (ret != -1)
-				return ret;
-		}
-		while (htab->table[idx].used != USED_FREE);
+	struct env_entry_node *node;
+	struct env_entry *ep;
+	unsigned int idx, slot = 0;
+
+	if (action == ENV_ENTER)
+		hmaintain(htab);
+
+	idx = hprobe(htab->table, htab->size, item.key, hval, &slot);
+	if (!idx && htab->old_table) {
+		idx = hprobe(htab->old_table, htab->old_size, item.key, hval,
+			     NULL);
+		if (idx)
+			idx += htab->size;
 	}
+	if (idx)
+		return _overwrite_entry(item, action, retval, htab, flag, idx);
 
 	/* An empty bucket has been found. */
 	if (action == ENV_ENTER) {
@@ -367,7 +641,7 @@ int hsearch_r(struct env_entry item, enum env_action action,
 		 * If table is full and another entry should be
 		 * entered return with error.
 		 */
-		if (htab->filled == htab->size) {
+		if (!slot) {
 			__set_errno(ENOMEM);
 			*retval = NULL;
 			return 0;
@@ -377,50 +651,60 @@ int hsearch_r(struct env_entry item, enum env_action action,
 		 * Create new entry;
 		 * create copies of item.key and item.data
 		 */
-		if (first_deleted)
-			idx = first_deleted;
-
-		htab->table[idx].used = hval;
-		htab->table[idx].entry.key = strdup(item.key);
-		htab->table[idx].entry.data = strdup(item.data);
-		if (!htab->table[idx].entry.key ||
-		    !htab->table[idx].entry.data) {
+		ep = calloc(1, sizeof(*ep) + len + 1);
+		if (!ep) {
+			__set_errno(ENOMEM);
+			*retval = NULL;
+			return 0;
+		}
+		memcpy(ep + 1, item.key, len + 1);
+		ep->key = (char *)(ep + 1);
+		ep->data = strdup(item.data);
+		if (!ep->data || hsorted_add(htab, ep)) {
+			free(ep->data);
+			free(ep);
 			__set_errno(ENOMEM);
 			*retval = NULL;
 			return 0;
 		}
 
+		idx = slot;
+		node = &htab->table[idx];
+		if (node->used == USED_DELETED)
+			--htab->deleted;
+		node->used = 1;
+		node->hash = hval;
+		node->entry = ep;
 		++htab->filled;
 
 		/* This is a new entry, so look up a possible callback */
-		env_callback_init(&htab->table[idx].entry);
+		env_callback_init(ep);
 		/* Also look for flags */
-		env_flags_init(&htab->table[idx].entry);
+		env_flags_init(ep);
 
 		/* check for permission */
-		if (htab->change_ok != NULL && htab->change_ok(
-		    &htab->table[idx].entry, item.data, env_op_create, flag)) {
+		if (do_change_ok(htab, ep, item.data, env_op_create, flag)) {
 			debug("change_ok() rejected setting variable "
 				"%s, skipping it!\n", item.key);
-			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
+			_hdelete(item.key, htab, ep, idx);
 			__set_errno(EPERM);
 			*retval = NULL;
 			return 0;
 		}
 
 		/* If there is a callback, call it */
-		if (do_callback(&htab->table[idx].entry, item.key, item.data,
-				env_op_create, flag)) {
+		if (do_callback(htab, ep, item.key, item.data, env_op_create,
+				flag)) {
 			debug("callback() rejected setting variable "
 				"%s, skipping it!\n", item.key);
-			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
+			_hdelete(item.key, htab, ep, idx);
 			__set_errno(EINVAL);
 			*retval = NULL;
 			return 0;
 		}
 
 		/* return new entry */
-		*retval = &htab->table[idx].entry;
+		*retval = ep;
 		return 1;
 	}
 
@@ -445,10 +729,12 @@ static void _hdelete(const char *key, struct hsearch_data *htab,
 {
 	/* free used entry */
 	debug("hdelete: DELETING key \"%s\"\n", key);
-	free((void *)ep->key);
+	hsorted_remove(htab, ep);
+	hnode(htab, idx)->used = USED_DELETED;
+	if (idx <= htab->size)
+		++htab->deleted;
 	free(ep->data);
-	ep->flags = 0;
-	htab->table[idx].used = USED_DELETED;
+	free(ep);
 
 	--htab->filled;
 }
@@ -469,8 +755,7 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 	}
 
 	/* Check for permission */
-	if (htab->change_ok != NULL &&
-	    htab->change_ok(ep, NULL, env_op_delete, flag)) {
+	if (do_change_ok(htab, ep, NULL, env_op_delete, flag)) {
 		debug("change_ok() rejected deleting variable "
 			"%s, skipping it!\n", key);
 		__set_errno(EPERM);
@@ -478,8 +763,7 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 	}
 
 	/* If there is a callback, call it */
-	if (do_callback(&htab->table[idx].entry, key, NULL,
-			env_op_delete, flag)) {
+	if (do_callback(htab, ep, key, NULL, env_op_delete, flag)) {
 		debug("callback() rejected deleting variable "
 			"%s, skipping it!\n", key);
 		__set_errno(EINVAL);
@@ -487,6 +771,7 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 	}
 
 	_hdelete(key, htab, ep, idx);
+	hmigrate(htab, htab->busy ? 0 : HTAB_MIGRATE);
 
 	return 0;
 }
@@ -509,7 +794,7 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
  * for later re-import.
  *
  * The entries in the result list will be sorted by ascending key
- * values.
+ * values, taken from the list which is kept sorted with the table.
  *
  * If the separator character is different from NUL, then any
  * separator characters and backslash characters in the values will
@@ -534,14 +819,6 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
  *		bytes in the string will be '\0'-padded.
  */
 
-static int cmpkey(const void *p1, const void *p2)
-{
-	struct env_entry *e1 = *(struct env_entry **)p1;
-	struct env_entry *e2 = *(struct env_entry **)p2;
-
-	return (strcmp(e1->key, e2->key));
-}
-
 static int match_string(int flag, const char *str, const char *pat, void *priv)
 {
 	switch (flag & H_MATCH_METHOD) {
@@ -604,7 +881,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		 char **resp, size_t size,
 		 int argc, char *const argv[])
 {
-	struct env_entry *list[htab->size];
+	struct env_entry **list;
 	char *res, *p;
 	size_t totlen;
 	int i, n;
@@ -617,61 +894,57 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 
 	debug("EXPORT  table = %p, htab.size = %d, htab.filled = %d, size = %lu\n",
 	      htab, htab->size, htab->filled, (ulong)size);
+
+	hsorted_flush(htab);
+
+	/* Entries which are not exported are set to NULL */
+	list = calloc(htab->filled + 1, sizeof(*list));
+	if (!list) {
+		__set_errno(ENOMEM);
+		return (-1);
+	}
+
 	/*
 	 * Pass 1:
 	 * search used entries,
 	 * save addresses and compute total length
 	 */
-	for (i = 1, n = 0, totlen = 0; i <= htab->size; ++i) {
-
-		if (htab->table[i].used > 0) {
-			struct env_entry *ep = &htab->table[i].entry;
-			int found = match_entry(ep, flag, argc, argv);
+	for (i = 0, n = htab->filled, totlen = 0; i < n; ++i) {
+		struct env_entry *ep = htab->sorted[i];
+		int found = match_entry(ep, flag, argc, argv);
 
-			if ((argc > 0) && (found == 0))
-				continue;
+		if ((argc > 0) && (found == 0))
+			continue;
 
-			if ((flag & H_HIDE_DOT) && ep->key[0] == '.')
-				continue;
+		if ((flag & H_HIDE_DOT) && ep->key[0] == '.')
+			continue;
 
-			list[n++] = ep;
+		list[i] = ep;
 
-			totlen += strlen(ep->key);
+		totlen += strlen(ep->key);
 
-			if (sep == '\0') {
-				totlen += strlen(ep->data);
-			} else {	/* check if escapes are needed */
-				char *s = ep->data;
+		if (sep == '\0') {
+			totlen += strlen(ep->data);
+		} else {	/* check if escapes are needed */
+			char *s = ep->data;
 
-				while (*s) {
+			while (*s) {
+				++totlen;
+				/* add room for needed escape chars */
+				if ((*s == sep) || (*s == '\\'))
 					++totlen;
-					/* add room for needed escape chars */
-					if ((*s == sep) || (*s == '\\'))
-						++totlen;
-					++s;
-				}
+				++s;
 			}
-			totlen += 2;	/* for '=' and 'sep' char */
 		}
+		totlen += 2;	/* for '=' and 'sep' char */
 	}
 
-#ifdef DEBUG
-	/* Pass 1a: print unsorted list */
-	printf("Unsorted: n=%d\n", n);
-	for (i = 0; i < n; ++i) {
-		printf("\t%3d: %p ==> %-10s => %s\n",
-		       i, list[i], list[i]->key, list[i]->data);
-	}
-#endif
-
-	/* Sort list by keys */
-	qsort(list, n, sizeof(struct env_entry *), cmpkey);
-
 	/* Check if the user supplied buffer size is sufficient */
 	if (size) {
 		if (size < totlen + 1) {	/* provided buffer too small */
 			printf("Env export buffer too small: %lu, but need %lu\n",
 			       (ulong)size, (ulong)totlen + 1);
+			free(list);
 			__set_errno(ENOMEM);
 			return (-1);
 		}
@@ -688,6 +961,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		/* no, allocate and clear one */
 		*resp = res = calloc(1, size);
 		if (res == NULL) {
+			free(list);
 			__set_errno(ENOMEM);
 			return (-1);
 		}
@@ -699,6 +973,8 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 	for (i = 0, p = res; i < n; ++i) {
 		const char *s;
 
+		if (!list[i])
+			continue;
 		s = list[i]->key;
 		while (*s)
 			*p++ = *s++;
@@ -714,6 +990,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		*p++ = sep;
 	}
 	*p = '\0';		/* terminate result */
+	free(list);
 
 	return size;
 }
@@ -993,16 +1270,22 @@ end:
  */
 int hwalk_r(struct hsearch_data *htab, int (*callback)(struct env_entry *entry))
 {
-	int i;
-	int retval;
-
-	for (i = 1; i <= htab->size; ++i) {
-		if (htab->table[i].used > 0) {
-			retval = callback(&htab->table[i].entry);
+	struct env_entry_node *node;
+	unsigned int i, end;
+	int retval = 0;
+
+	/* Entries must stay where they are until the walk is done */
+	htab->busy++;
+	end = htab->size + (htab->old_table ? htab->old_size : 0);
+	for (i = 1; i <= end; ++i) {
+		node = hnode(htab, i);
+		if (node->used > 0) {
+			retval = callback(node->entry);
 			if (retval)
-				return retval;
+				break;
 		}
 	}
+	htab->busy--;
 
-	return 0;
+	return retval;
 }
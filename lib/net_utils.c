@@ -169,25 +169,58 @@ void string_to_enetaddr(const char *addr, uint8_t *enetaddr)
 
 uint compute_ip_checksum(const void *vptr, uint nbytes)
 {
-	int sum, oddbyte;
-	const unsigned short *ptr = vptr;
+	const u8 *ptr = vptr;
+	bool odd = (ulong)ptr & 1;
+	u64 sum = 0;
+	u16 word;
+
+	/*
+	 * The one's complement sum does not depend on the byte order. Data
+	 * starting at an odd address is summed with aligned accesses, pairing
+	 * the bytes the other way round, and the result is swapped at the end.
+	 */
+	if (odd && nbytes) {
+		word = 0;
+		((u8 *)&word)[1] = *ptr++;
+		sum = word;
+		nbytes--;
+	}
+	if (nbytes >= 2 && ((ulong)ptr & 2)) {
+		sum += *(const u16 *)ptr;
+		ptr += 2;
+		nbytes -= 2;
+	}
+
+	/* Accumulate 32-bit words in 64 bits so that no carry is lost */
+	while (nbytes >= 16) {
+		const u32 *p32 = (const u32 *)ptr;
 
-	sum = 0;
-	while (nbytes > 1) {
-		sum += *ptr++;
+		sum += (u64)p32[0] + p32[1] + p32[2] + p32[3];
+		ptr += 16;
+		nbytes -= 16;
+	}
+	while (nbytes >= 4) {
+		sum += *(const u32 *)ptr;
+		ptr += 4;
+		nbytes -= 4;
+	}
+	if (nbytes >= 2) {
+		sum += *(const u16 *)ptr;
+		ptr += 2;
 		nbytes -= 2;
 	}
-	if (nbytes == 1) {
-		oddbyte = 0;
-		((u8 *)&oddbyte)[0] = *(u8 *)ptr;
-		((u8 *)&oddbyte)[1] = 0;
-		sum += oddbyte;
+	if (nbytes) {
+		word = 0;
+		((u8 *)&word)[0] = *ptr;
+		sum += word;
 	}
-	sum = (sum >> 16) + (sum & 0xffff);
-	sum += (sum >> 16);
-	sum = ~sum & 0xffff;
 
-	return sum;
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	if (odd)
+		sum = ((sum >> 8) & 0xff) | ((sum << 8) & 0xff00);
+
+	return ~sum & 0xffff;
 }
 
 uint add_ip_checksums(uint offset, uint sum, uint new)
@@ -11,6 +11,7 @@
 
 #include <common.h>
 #include <hang.h>
+#include <serial.h>
 #if !defined(CONFIG_PANIC_HANG)
 #include <command.h>
 #endif
@@ -21,6 +22,8 @@ static void panic_finish(void) __attribute__ ((noreturn));
 static void panic_finish(void)
 {
 	putc('\n');
+	serial_tx_hold(false);
+	flush();
 #if defined(CONFIG_PANIC_HANG)
 	hang();
 #else
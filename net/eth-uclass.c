@@ -382,6 +382,38 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+/**
+ * eth_rx_batch() - receive and process a batch of packets
+ *
+ * @dev:	Ethernet device, which implements recv_batch()
+ * Return:	number of packets, or -ve on error
+ */
+static int eth_rx_batch(struct udevice *dev)
+{
+	struct eth_ops *ops = eth_get_ops(dev);
+	struct eth_rx_pkt pkts[ETH_PACKETS_BATCH_RECV];
+	int count;
+	int i;
+
+	count = ops->recv_batch(dev, ETH_RECV_CHECK_DEVICE, pkts,
+				ETH_PACKETS_BATCH_RECV);
+	for (i = 0; i < count; i++) {
+		if (pkts[i].length <= 0)
+			continue;
+		net_rx_csum_ok = pkts[i].csum_ok ||
+				 (ops->caps & ETH_CAP_RX_CSUM);
+		net_rx_payload = pkts[i].payload;
+		net_process_received_packet(pkts[i].packet, pkts[i].length);
+	}
+	net_rx_csum_ok = false;
+	net_rx_payload = NULL;
+
+	for (i = 0; i < count && ops->free_pkt; i++)
+		ops->free_pkt(dev, pkts[i].packet, pkts[i].length);
+
+	return count;
+}
+
 int eth_rx(void)
 {
 	struct udevice *current;
@@ -397,13 +429,28 @@ int eth_rx(void)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
+	if (eth_get_ops(current)->recv_batch) {
+		ret = eth_rx_batch(current);
+		if (ret == -EAGAIN)
+			ret = 0;
+		if (ret < 0 && ret != -ENOSYS)
+			debug("%s: recv_batch() returned error %d\n", __func__,
+			      ret);
+		if (ret != -ENOSYS)
+			return ret;
+	}
+
 	/* Process up to 32 packets at one time */
 	flags = ETH_RECV_CHECK_DEVICE;
 	for (i = 0; i < ETH_PACKETS_BATCH_RECV; i++) {
+		/* The driver sets net_rx_csum_ok if it verified the checksums */
 		ret = eth_get_ops(current)->recv(current, flags, &packet);
 		flags = 0;
+		if (eth_get_ops(current)->caps & ETH_CAP_RX_CSUM)
+			net_rx_csum_ok = true;
 		if (ret > 0)
 			net_process_received_packet(packet, ret);
+		net_rx_csum_ok = false;
 		if (ret >= 0 && eth_get_ops(current)->free_pkt)
 			eth_get_ops(current)->free_pkt(current, packet, ret);
 		if (ret <= 0)
@@ -548,6 +595,8 @@ static int eth_post_probe(struct udevice *dev)
 			ops->send += gd->reloc_off;
 		if (ops->recv)
 			ops->recv += gd->reloc_off;
+		if (ops->recv_batch)
+			ops->recv_batch += gd->reloc_off;
 		if (ops->free_pkt)
 			ops->free_pkt += gd->reloc_off;
 		if (ops->stop)
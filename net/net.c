@@ -149,6 +149,10 @@ struct in_addr	net_server_ip;
 uchar *net_rx_packet;
 /* Current rx packet length */
 int		net_rx_packet_len;
+/* Driver has verified the checksums of the current rx packet */
+bool		net_rx_csum_ok;
+/* Payload of the current rx packet if the driver placed it elsewhere */
+void		*net_rx_payload;
 /* IP packet ID */
 static unsigned	net_ip_id;
 /* Ethernet bcast address */
@@ -186,6 +190,8 @@ static uchar net_pkt_buf[(PKTBUFSRX+1) * PKTSIZE_ALIGN + PKTALIGN];
 uchar *net_rx_packets[PKTBUFSRX];
 /* Current UDP RX packet handler */
 static rxhand_f *udp_packet_handler;
+/* Current UDP payload placement handler */
+static rxhand_dest_f *udp_dest_handler;
 /* Current ARP RX packet handler */
 static rxhand_f *arp_packet_handler;
 #ifdef CONFIG_CMD_TFTPPUT
@@ -379,6 +385,7 @@ static int net_init_loop(void)
 static void net_clear_handlers(void)
 {
 	net_set_udp_handler(NULL);
+	net_set_udp_dest_handler(NULL);
 	net_set_arp_handler(NULL);
 	net_set_timeout_handler(0, NULL);
 }
@@ -822,6 +829,53 @@ void net_set_udp_handler(rxhand_f *f)
 		udp_packet_handler = f;
 }
 
+void net_set_udp_dest_handler(rxhand_dest_f *f)
+{
+	udp_dest_handler = f;
+}
+
+void *net_rx_dest(uchar *pkt, int len, bool csum_ok, int *hdr_lenp)
+{
+	struct ethernet_hdr *et = (struct ethernet_hdr *)pkt;
+	struct ip_udp_hdr *ip = (struct ip_udp_hdr *)(pkt + ETHER_HDR_SIZE);
+	unsigned int udp_len, hdr_len;
+	void *dest;
+
+	if (!udp_dest_handler || len < ETHER_HDR_SIZE + IP_UDP_HDR_SIZE)
+		return NULL;
+	if (ntohs(et->et_protlen) != PROT_IP || ip->ip_hl_v != 0x45 ||
+	    ip->ip_p != IPPROTO_UDP)
+		return NULL;
+	/*
+	 * Nothing is written to the destination unless the packet would be
+	 * passed to the UDP handler, see net_process_received_packet()
+	 */
+	if (!ip_checksum_ok((uchar *)ip, IP_HDR_SIZE) || !net_ip.s_addr ||
+	    net_read_ip(&ip->ip_dst).s_addr != net_ip.s_addr)
+		return NULL;
+	/* Fragments are reassembled from the packet buffer */
+	if (ntohs(ip->ip_off) & (IP_OFFS | IP_FLAGS_MFRAG))
+		return NULL;
+	/* The software checksum needs the packet to be contiguous */
+	if (IS_ENABLED(CONFIG_UDP_CHECKSUM) && ip->udp_xsum && !csum_ok)
+		return NULL;
+	/* Padded frames are left alone so that the payload ends the packet */
+	udp_len = ntohs(ip->udp_len);
+	if (udp_len < UDP_HDR_SIZE ||
+	    ntohs(ip->ip_len) != IP_HDR_SIZE + udp_len ||
+	    ETHER_HDR_SIZE + IP_HDR_SIZE + udp_len != len)
+		return NULL;
+
+	hdr_len = 0;
+	dest = udp_dest_handler(ip, (uchar *)ip + IP_UDP_HDR_SIZE,
+				udp_len - UDP_HDR_SIZE, &hdr_len);
+	if (!dest || hdr_len > udp_len - UDP_HDR_SIZE)
+		return NULL;
+	*hdr_lenp = ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + hdr_len;
+
+	return dest;
+}
+
 rxhand_f *net_get_arp_handler(void)
 {
 	return arp_packet_handler;
@@ -1372,9 +1426,9 @@ void net_process_received_packet(uchar *in_packet, int len)
 			   "received UDP (to=%pI4, from=%pI4, len=%d)\n",
 			   &dst_ip, &src_ip, len);
 
-		if (IS_ENABLED(CONFIG_UDP_CHECKSUM) && ip->udp_xsum != 0) {
+		if (IS_ENABLED(CONFIG_UDP_CHECKSUM) && ip->udp_xsum != 0 &&
+		    !net_rx_csum_ok) {
 			ulong   xsum;
-			u8 *sumptr;
 			ushort  sumlen;
 
 			xsum  = ip->ip_p;
@@ -1384,17 +1438,10 @@ void net_process_received_packet(uchar *in_packet, int len)
 			xsum += (ntohl(ip->ip_dst.s_addr) >> 16) & 0x0000ffff;
 			xsum += (ntohl(ip->ip_dst.s_addr) >>  0) & 0x0000ffff;
 
+			/* The sum does not depend on the byte order */
 			sumlen = ntohs(ip->udp_len);
-			sumptr = (u8 *)&ip->udp_src;
-
-			while (sumlen > 1) {
-				/* inlined ntohs() to avoid alignment errors */
-				xsum += (sumptr[0] << 8) + sumptr[1];
-				sumptr += 2;
-				sumlen -= 2;
-			}
-			if (sumlen > 0)
-				xsum += (sumptr[0] << 8) + sumptr[0];
+			xsum += ntohs(~compute_ip_checksum(&ip->udp_src,
+							   sumlen) & 0xffff);
 			while ((xsum >> 16) != 0) {
 				xsum = (xsum & 0x0000ffff) +
 				       ((xsum >> 16) & 0x0000ffff);
@@ -661,7 +661,8 @@ void rxhand_tcp_f(union tcp_build_pkt *b, unsigned int pkt_len)
 	/* Build pseudo header and verify TCP header */
 	tcp_rx_xsum = b->ip.hdr.tcp_xsum;
 	b->ip.hdr.tcp_xsum = 0;
-	if (tcp_rx_xsum != tcp_set_pseudo_header((uchar *)b, b->ip.hdr.ip_src,
+	if (!net_rx_csum_ok &&
+	    tcp_rx_xsum != tcp_set_pseudo_header((uchar *)b, b->ip.hdr.ip_src,
 						 b->ip.hdr.ip_dst, tcp_len,
 						 pkt_len)) {
 		debug_cond(DEBUG_DEV_PKT,
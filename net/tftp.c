@@ -153,13 +153,19 @@ static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = CONFIG_TFTP_BLOCKSIZE;
 static unsigned short tftp_window_size_option = TFTP_WINDOWSIZE;
 
-static inline int store_block(int block, uchar *src, unsigned int len)
+/**
+ * tftp_store_addr() - get the address a block is stored at
+ *
+ * @block:	block number, including wraps
+ * @len:	length of the block data
+ * @addrp:	returns the address
+ * Return:	0 if OK, -ERANGE if the block must not be stored
+ */
+static int tftp_store_addr(int block, unsigned int len, ulong *addrp)
 {
 	ulong offset = block * tftp_block_size + tftp_block_wrap_offset -
 			tftp_block_size;
-	ulong newsize = offset + len;
 	ulong store_addr = tftp_load_addr + offset;
-	void *ptr;
 
 #ifdef CONFIG_LMB
 	ulong end_addr = tftp_load_addr + tftp_load_size;
@@ -168,14 +174,31 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 		end_addr = ULONG_MAX;
 
 	if (store_addr < tftp_load_addr ||
-	    store_addr + len > end_addr) {
+	    store_addr + len > end_addr)
+		return -ERANGE;
+#endif
+	*addrp = store_addr;
+
+	return 0;
+}
+
+static inline int store_block(int block, uchar *src, unsigned int len)
+{
+	ulong offset = block * tftp_block_size + tftp_block_wrap_offset -
+			tftp_block_size;
+	ulong newsize = offset + len;
+	ulong store_addr;
+	void *ptr;
+
+	if (tftp_store_addr(block, len, &store_addr)) {
 		puts("\nTFTP error: ");
 		puts("trying to overwrite reserved memory...\n");
 		return -1;
 	}
-#endif
 	ptr = map_sysmem(store_addr, len);
-	memcpy(ptr, src, len);
+	/* The driver may have placed the data already, see tftp_rx_dest() */
+	if (ptr != src)
+		memcpy(ptr, src, len);
 	unmap_sysmem(ptr);
 
 	if (net_boot_file_size < newsize)
@@ -454,6 +477,46 @@ static void icmp_handler(unsigned type, unsigned code, unsigned dest,
 }
 #endif
 
+/**
+ * tftp_rx_dest() - place received data blocks directly at the load address
+ *
+ * Only blocks of the current window are placed. A block which turns out to
+ * be unexpected is overwritten when the expected block arrives.
+ *
+ * @ip:		IP/UDP header of the packet
+ * @pkt:	TFTP packet
+ * @len:	length of the TFTP packet
+ * @hdr_len:	returns the length of the TFTP header
+ * Return:	destination of the data, NULL if it is not a data block
+ */
+static void *tftp_rx_dest(struct ip_udp_hdr *ip, uchar *pkt, unsigned int len,
+			  unsigned int *hdr_len)
+{
+	ulong block, store_addr;
+
+	if (tftp_state != STATE_DATA || len < 4 ||
+	    net_read_ip(&ip->ip_src).s_addr != tftp_remote_ip.s_addr ||
+	    ntohs(ip->udp_dst) != tftp_our_port ||
+	    ntohs(ip->udp_src) != tftp_remote_port ||
+	    ntohs(*(__be16 *)pkt) != TFTP_DATA)
+		return NULL;
+#ifdef CONFIG_CMD_TFTPPUT
+	if (tftp_put_active)
+		return NULL;
+#endif
+	len -= 4;
+	block = ntohs(*(__be16 *)(pkt + 2));
+	/* Blocks after a wrap of the block number are copied as usual */
+	if (block <= tftp_cur_block ||
+	    block > tftp_cur_block + tftp_windowsize || len > tftp_block_size)
+		return NULL;
+	if (tftp_store_addr(block, len, &store_addr))
+		return NULL;
+	*hdr_len = 4;
+
+	return map_sysmem(store_addr, len);
+}
+
 static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			 unsigned src, unsigned len)
 {
@@ -642,7 +705,9 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		timeout_count_max = tftp_timeout_count_max;
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 
-		if (store_block(tftp_cur_block, pkt + 2, len)) {
+		if (store_block(tftp_cur_block,
+				net_rx_payload ? net_rx_payload : pkt + 2,
+				len)) {
 			eth_halt();
 			net_set_state(NETLOOP_FAIL);
 			break;
@@ -919,6 +984,7 @@ void tftp_start(enum proto_t protocol)
 
 	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 	net_set_udp_handler(tftp_handler);
+	net_set_udp_dest_handler(tftp_rx_dest);
 #ifdef CONFIG_CMD_TFTPPUT
 	net_set_icmp_handler(icmp_handler);
 #endif
@@ -986,6 +1052,7 @@ void tftp_start_server(void)
 
 	tftp_state = STATE_RECV_WRQ;
 	net_set_udp_handler(tftp_handler);
+	net_set_udp_dest_handler(tftp_rx_dest);
 
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
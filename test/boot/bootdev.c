@@ -13,6 +13,7 @@
 #include <bootflow.h>
 #include <mapmem.h>
 #include <os.h>
+#include <dm/uclass-internal.h>
 #include <test/suites.h>
 #include <test/ut.h>
 #include "bootstd_common.h"
@@ -124,6 +125,7 @@ static int bootdev_test_order(struct unit_test_state *uts)
 {
 	struct bootflow_iter iter;
 	struct bootflow bflow;
+	int i;
 
 	/*
 	 * First try the order set by the bootdev-order property
@@ -169,6 +171,8 @@ static int bootdev_test_order(struct unit_test_state *uts)
 	iter.dev_order[0]->seq_ = 0;
 	iter.dev_order[1]->seq_ = 3;
 	iter.dev_order[2]->seq_ = 2;
+	for (i = 0; i < 3; i++)
+		uclass_reindex_device(iter.dev_order[i]);
 	bootflow_iter_uninit(&iter);
 
 	ut_assertok(bootflow_scan_first(&iter, 0, &bflow));
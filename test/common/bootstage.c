@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for bootstage spans and the trace export
+ */
+
+#include <common.h>
+#include <bootstage.h>
+#include <malloc.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define TRACE_SIZE	0x10000
+
+/* Test that nested spans are exported with their parent */
+static int common_test_bootstage_span(struct unit_test_state *uts)
+{
+	int outer, inner;
+	char *buf;
+	int len;
+
+	outer = bootstage_span_begin("ut_outer", "test");
+	inner = bootstage_span_begin("ut \"inner\"", "test");
+	bootstage_span_end(inner);
+	bootstage_span_end(outer);
+
+	/* Spans are not recorded once the table is full */
+	if (inner < 0)
+		return -EAGAIN;
+
+	buf = malloc(TRACE_SIZE);
+	ut_assertnonnull(buf);
+	len = bootstage_export_trace(buf, TRACE_SIZE);
+	ut_assert(len > 0);
+	ut_asserteq(len, strlen(buf));
+
+	ut_asserteq_strn("{\"traceEvents\":[\n", buf);
+	ut_asserteq_str("\n]}\n", buf + len - 4);
+	ut_assertnonnull(strstr(buf, "{\"name\":\"reset\",\"cat\":\"mark\""));
+	ut_assertnonnull(strstr(buf, "{\"name\":\"ut_outer\",\"cat\":\"test\","
+				"\"ph\":\"X\""));
+	ut_assertnonnull(strstr(buf, "{\"name\":\"ut \\\"inner\\\"\""));
+	ut_assertnonnull(strstr(buf, "\"args\":{\"parent\":\"ut_outer\"}}"));
+
+	/* The trace is not truncated silently */
+	ut_asserteq(-ENOSPC, bootstage_export_trace(buf, len));
+	free(buf);
+
+	return 0;
+}
+COMMON_TEST(common_test_bootstage_span, 0);
@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test of the cache of hush parse trees
+ *
+ * A cached tree is run many times, so running it must leave it unchanged,
+ * including when a loop is left early. The distro boot scripts, which run
+ * each other in loops, must give the same result with and without the
+ * cache.
+ */
+
+#include <common.h>
+#include <cli_hush.h>
+#include <command.h>
+#include <env.h>
+#include <env_internal.h>
+#include <search.h>
+#include <test/common.h>
+#include <test/env.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define BOOT_TARGET_DEVICES(func) \
+	func(HOST, host, 0) \
+	func(HOST, host, 1) \
+	func(HOST, host, 2) \
+	func(HOST, host, 3)
+#include <config_distro_bootcmd.h>
+
+/*
+ * Number of runs of distro_bootcmd with and without the cache. With the
+ * cache, the second run uses the trees parsed by the first.
+ */
+#define BOOT_ROUNDS	2
+
+static const char distro_env[] = BOOTENV;
+
+/* Run a script twice, checking what it adds to $out each time */
+static int run_twice(struct unit_test_state *uts, const char *script,
+		     const char *out)
+{
+	char expect[40];
+
+	ut_assertok(env_set("script", script));
+	ut_assertok(env_set("out", NULL));
+	ut_assertok(run_command("run script", 0));
+	ut_asserteq_str(out, env_get("out"));
+	ut_assertok(run_command("run script", 0));
+	snprintf(expect, sizeof(expect), "%s%s", out, out);
+	ut_asserteq_str(expect, env_get("out"));
+
+	return 0;
+}
+
+static int hush_test_cache(struct unit_test_state *uts)
+{
+	int i;
+
+	ut_assertok(run_twice(uts,
+			      "for i in a b c; do setenv out ${out}${i}; done",
+			      "abc"));
+
+	/* Leaving a loop early must not change the tree */
+	ut_assertok(run_twice(uts,
+			      "for i in a b c; do setenv out ${out}${i}; "
+			      "if test $i = b; then exit; fi; done", "ab"));
+
+	/* Nor may an assignment in front of a command */
+	ut_assertok(env_set("val", "x"));
+	ut_assertok(env_set("script", "v=${val} setenv out ${v}"));
+	for (i = 0; i < 3; i++) {
+		ut_assertok(env_set("out", NULL));
+		ut_assertok(run_command("run script", 0));
+		ut_asserteq_str("x", env_get("out"));
+	}
+
+	/* A script which runs itself does not share its tree */
+	ut_assertok(env_set("out", NULL));
+	ut_assertok(env_set("script", "setenv out ${out}r; "
+			    "if test ${out} != rrr; then run script; fi"));
+	run_command("run script", 0);
+	ut_asserteq_str("rrr", env_get("out"));
+
+	/* A changed script is parsed again */
+	ut_assertok(env_set("script", "setenv out 1"));
+	ut_assertok(run_command("run script", 0));
+	ut_asserteq_str("1", env_get("out"));
+	ut_assertok(env_set("script", "setenv out 2"));
+	ut_assertok(run_command("run script", 0));
+	ut_asserteq_str("2", env_get("out"));
+
+	/* So is every script when IFS changes */
+	ut_assertok(run_twice(uts, "for i in a:b; do setenv out ${out}${i}; done",
+			      "a:b"));
+	ut_assertok(env_set("IFS", " \t\n:"));
+	ut_assertok(run_twice(uts, "for i in a:b; do setenv out ${out}${i}; done",
+			      "ab"));
+	ut_assertok(env_set("IFS", NULL));
+
+	return 0;
+}
+
+static int test_hush_cache(struct unit_test_state *uts)
+{
+	return env_test_run_restore(uts, hush_test_cache);
+}
+COMMON_TEST(test_hush_cache, 0);
+
+/**
+ * boot_rounds() - run distro_bootcmd BOOT_ROUNDS times
+ *
+ * @uts:	test state
+ * Return:	0 if OK, -ve on error
+ */
+static int boot_rounds(struct unit_test_state *uts)
+{
+	int i;
+
+	for (i = 0; i < BOOT_ROUNDS; i++) {
+		ut_assertok(env_set("scanned", NULL));
+		run_command("run distro_bootcmd", 0);
+		ut_asserteq_str("0123", env_get("scanned"));
+	}
+
+	return 0;
+}
+
+static int hush_test_cache_distro(struct unit_test_state *uts)
+{
+	ut_assert(himport_r(&env_htab, distro_env, sizeof(distro_env), '\0',
+			    H_NOCLEAR, 0, 0, NULL));
+	/* Scan each device as if it had a partition without boot files */
+	ut_assertok(env_set("host_boot",
+			    "devtype=host; run scan_dev_for_boot_part; "
+			    "distro_bootpart=1; run scan_dev_for_boot; "
+			    "setenv scanned ${scanned}${devnum}"));
+
+	hush_cache_enable(false);
+	ut_assertok(boot_rounds(uts));
+	hush_cache_enable(true);
+	ut_assertok(boot_rounds(uts));
+
+	return 0;
+}
+
+/**
+ * hush_run() - run a test, then restore the environment and the cache
+ *
+ * @uts:	test state
+ * @func:	test to run
+ * Return:	result of @func
+ */
+static int hush_run(struct unit_test_state *uts,
+		    int (*func)(struct unit_test_state *uts))
+{
+	int ret;
+
+	ret = env_test_run_restore(uts, func);
+	hush_cache_enable(true);
+
+	return ret;
+}
+
+static int test_hush_cache_distro(struct unit_test_state *uts)
+{
+	return hush_run(uts, hush_test_cache_distro);
+}
+COMMON_TEST(test_hush_cache_distro, 0);
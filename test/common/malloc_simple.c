@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for reuse of memory freed in the pre-relocation malloc() pool
+ * and for its statistics
+ *
+ * The tests run after relocation, so they point the pool at a buffer of
+ * their own and call the simple allocator directly.
+ */
+
+#include <common.h>
+#include <console.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <asm/global_data.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define POOL_SIZE	0x2000
+#define BLOCKS		64
+
+/**
+ * check_free() - allocate and free blocks in an empty pool
+ *
+ * @uts:	test state
+ * @pool:	memory of the pool
+ * Return:	0 if OK
+ */
+static int check_free(struct unit_test_state *uts, void *pool)
+{
+	void *blk[BLOCKS], *big;
+	ulong start, top;
+	int i;
+
+	/* The first allocation may set up the table of callers */
+	free_simple(malloc_simple(1));
+	start = gd->malloc_ptr;
+
+	for (i = 0; i < BLOCKS; i++) {
+		blk[i] = malloc_simple(40 + i);
+		ut_assertnonnull(blk[i]);
+		memset(blk[i], i, 40 + i);
+	}
+
+	/* Every other block is free, none can hold a large block */
+	for (i = 0; i < BLOCKS; i += 2)
+		free_simple(blk[i]);
+	top = gd->malloc_ptr;
+	big = malloc_simple(200);
+	ut_assertnonnull(big);
+	ut_assert(gd->malloc_ptr > top);
+	free_simple(big);
+	ut_asserteq(top, gd->malloc_ptr);
+
+	/* Small blocks reuse the holes, aligned ones too */
+	blk[0] = malloc_simple(16);
+	ut_assertnonnull(blk[0]);
+	blk[2] = memalign_simple(32, 8);
+	ut_assertnonnull(blk[2]);
+	ut_asserteq(0, map_to_sysmem(blk[2]) & 31);
+	ut_asserteq(top, gd->malloc_ptr);
+	for (i = 1; i < BLOCKS; i += 2)
+		ut_asserteq(i, *(u8 *)blk[i]);
+
+	/* Freeing the rest merges everything back into the unused part */
+	free_simple(blk[0]);
+	free_simple(blk[2]);
+	for (i = 1; i < BLOCKS; i += 2)
+		free_simple(blk[i]);
+	ut_asserteq(start, gd->malloc_ptr);
+	ut_asserteq(0, gd->malloc_free);
+	ut_assert(gd->malloc_peak > top);
+
+	/* Memory from elsewhere is ignored */
+	free_simple(NULL);
+	free_simple(pool + POOL_SIZE);
+	ut_asserteq(start, gd->malloc_ptr);
+
+	return 0;
+}
+
+/**
+ * check_info() - check the space left and the statistics of an empty pool
+ *
+ * @uts:	test state
+ * @pool:	memory of the pool
+ * Return:	0 if OK
+ */
+static int check_info(struct unit_test_state *uts, void *pool)
+{
+	void *caller = (void *)0x1234;
+	ulong avail, used;
+	void *ptr;
+
+	/* The rest of the pool can be allocated in one go */
+	avail = malloc_simple_avail();
+	ut_assert(avail > 0 && avail < POOL_SIZE);
+	ptr = malloc_simple_from(avail, caller);
+	ut_assertnonnull(ptr);
+	used = gd->malloc_ptr;
+	ut_asserteq(POOL_SIZE, used);
+	ut_asserteq(0, malloc_simple_avail());
+	ut_assertnull(malloc_simple(1));
+	free_simple(ptr);
+	ut_asserteq(avail, malloc_simple_avail());
+
+	console_record_reset_enable();
+	malloc_simple_info();
+	ut_assert_nextline("malloc_simple: %lx bytes used, %lx remain",
+			   gd->malloc_ptr, avail);
+	ut_assert_nextline("malloc_simple: %lx bytes peak, 0 free below top",
+			   used);
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_F_STATS))
+		ut_assert_nextline("  %08lx: %lx bytes in 1 calls",
+				   (ulong)caller, used - gd->malloc_ptr);
+	ut_assert_console_end();
+
+	return 0;
+}
+
+/**
+ * run_in_pool() - run a check with the pool pointing to a buffer
+ *
+ * @uts:	test state
+ * @check:	check to run
+ * Return:	0 if OK
+ */
+static int run_in_pool(struct unit_test_state *uts,
+		       int (*check)(struct unit_test_state *uts, void *pool))
+{
+	ulong base, limit, ptr, list, peak;
+	void *pool;
+	int ret;
+
+	pool = memalign(16, POOL_SIZE);
+	ut_assertnonnull(pool);
+	base = gd->malloc_base;
+	limit = gd->malloc_limit;
+	ptr = gd->malloc_ptr;
+	list = gd->malloc_free;
+	peak = gd->malloc_peak;
+	gd->malloc_base = map_to_sysmem(pool);
+	gd->malloc_limit = POOL_SIZE;
+	gd->malloc_ptr = 0;
+	gd->malloc_free = 0;
+	gd->malloc_peak = 0;
+
+	ret = check(uts, pool);
+
+	gd->malloc_base = base;
+	gd->malloc_limit = limit;
+	gd->malloc_ptr = ptr;
+	gd->malloc_free = list;
+	gd->malloc_peak = peak;
+	free(pool);
+
+	return ret;
+}
+
+/* Test that freed blocks are merged and reused */
+static int common_test_malloc_simple_free(struct unit_test_state *uts)
+{
+	return run_in_pool(uts, check_free);
+}
+COMMON_TEST(common_test_malloc_simple_free, 0);
+
+/* Test the space left in the pool and the statistics of its callers */
+static int common_test_malloc_simple_info(struct unit_test_state *uts)
+{
+	return run_in_pool(uts, check_info);
+}
+COMMON_TEST(common_test_malloc_simple_info, UT_TESTF_CONSOLE_REC);
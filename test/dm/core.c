@@ -13,6 +13,7 @@
 #include <malloc.h>
 #include <asm/global_data.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -1263,6 +1264,131 @@ static int dm_test_uclass_find_device(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_uclass_find_device, UT_TESTF_SCAN_FDT);
 
+#define INDEX_DEVS	64
+
+/* Test lookups in a uclass with many devices and count the compares */
+static int dm_test_uclass_index(struct unit_test_state *uts)
+{
+	struct udevice *devs[INDEX_DEVS], *dev;
+	int base, i, n, phandle, seq;
+	ulong linear, start;
+	ofnode node;
+
+	/* Bind a test device to each top-level node */
+	base = uclass_id_count(UCLASS_TEST);
+	n = 0;
+	ofnode_for_each_subnode(node, ofnode_root()) {
+		if (n == INDEX_DEVS)
+			break;
+		ut_assertok(device_bind(dm_root(), DM_DRIVER_GET(test_drv),
+					ofnode_get_name(node), NULL, node,
+					&devs[n]));
+		n++;
+	}
+	ut_asserteq(INDEX_DEVS, n);
+
+	/* A list walk compares each device up to the one found */
+	linear = 0;
+	start = uclass_find_compares;
+	for (i = 0; i < n; i++) {
+		ut_assertok(uclass_find_device_by_seq(UCLASS_TEST,
+						      dev_seq(devs[i]), &dev));
+		ut_asserteq_ptr(devs[i], dev);
+		ut_assertok(uclass_find_device_by_ofnode(UCLASS_TEST,
+							 dev_ofnode(devs[i]),
+							 &dev));
+		ut_asserteq_ptr(devs[i], dev);
+		linear += 2 * (base + i + 1);
+
+		phandle = dev_read_phandle(devs[i]);
+		if (phandle <= 0)
+			continue;
+		ut_assertok(uclass_find_device_by_phandle_id(UCLASS_TEST,
+							     phandle, &dev));
+		ut_asserteq_ptr(devs[i], dev);
+		linear += base + i + 1;
+	}
+	if (CONFIG_IS_ENABLED(DM_UCLASS_INDEX))
+		ut_assert((uclass_find_compares - start) * 4 < linear);
+
+	/* A device is found under its new sequence number once reindexed */
+	seq = uclass_find_next_free_seq(devs[1]->uclass);
+	devs[1]->seq_ = seq;
+	uclass_reindex_device(devs[1]);
+	ut_assertok(uclass_find_device_by_seq(UCLASS_TEST, seq, &dev));
+	ut_asserteq_ptr(devs[1], dev);
+
+	/* Unbound devices and unknown keys are not found */
+	ut_asserteq(-ENODEV, uclass_find_device_by_seq(UCLASS_TEST, 1000,
+						       &dev));
+	node = dev_ofnode(devs[0]);
+	ut_assertok(device_unbind(devs[0]));
+	ut_asserteq(-ENODEV, uclass_find_device_by_ofnode(UCLASS_TEST, node,
+							  &dev));
+
+	return 0;
+}
+DM_TEST(dm_test_uclass_index, UT_TESTF_SCAN_PDATA);
+
+/**
+ * ref_lookup_compat() - find the driver for a compatible string by a walk
+ *
+ * @compat:	compatible string
+ * @idp:	returns the matching entry of the of_match list
+ * Return:	first driver which is compatible, or NULL if none
+ */
+static struct driver *ref_lookup_compat(const char *compat,
+					const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct driver *entry;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++) {
+			if (!strcmp(id->compatible, compat)) {
+				*idp = id;
+				return entry;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* Test finding the driver for each compatible string */
+static int dm_test_lists_compat(struct unit_test_state *uts)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id, *ref_id, *found_id;
+	struct driver *entry;
+
+	/* The first driver in the linker list wins, as with a walk */
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++) {
+			const char *compat = id->compatible;
+
+			ut_asserteq_ptr(ref_lookup_compat(compat, &ref_id),
+					lists_driver_lookup_compat(compat,
+								   &found_id));
+			ut_asserteq_ptr(ref_id, found_id);
+		}
+	}
+	ut_assertnull(lists_driver_lookup_compat("u-boot,no-such-device",
+						 &found_id));
+
+	/* The table is built again after a reset */
+	lists_compat_reset();
+	ut_assertnonnull(lists_driver_lookup_compat("denx,u-boot-fdt-test",
+						    &found_id));
+	ut_asserteq_str("denx,u-boot-fdt-test", found_id->compatible);
+
+	return 0;
+}
+DM_TEST(dm_test_lists_compat, 0);
+
 /* Test getting information about tags attached to devices */
 static int dm_test_dev_get_attach(struct unit_test_state *uts)
 {
@@ -10,11 +10,14 @@
 #include <dm.h>
 #include <env.h>
 #include <fdtdec.h>
+#include <image.h>
 #include <log.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <net.h>
 #include <net6.h>
 #include <asm/eth.h>
+#include <asm/unaligned.h>
 #include <dm/test.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
@@ -607,3 +610,246 @@ static int dm_test_eth_async_ping_reply(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_eth_async_ping_reply, UT_TESTF_SCAN_FDT);
+
+#define TEST_RX_PORT	4242
+#define TEST_RX_HDR	4
+#define TEST_RX_DATA	1024
+#define TEST_RX_SLOTS	64
+
+static uchar *test_rx_buf;
+static int test_rx_count;
+static int test_rx_in_place;
+
+/* Place the payload in the slot selected by the sequence number */
+static void *sb_rx_dest(struct ip_udp_hdr *ip, uchar *pkt, unsigned int len,
+			unsigned int *hdr_len)
+{
+	if (ntohs(ip->udp_dst) != TEST_RX_PORT ||
+	    len != TEST_RX_HDR + TEST_RX_DATA)
+		return NULL;
+	*hdr_len = TEST_RX_HDR;
+
+	return test_rx_buf +
+	       get_unaligned_be32(pkt) % TEST_RX_SLOTS * TEST_RX_DATA;
+}
+
+/* Store the payload like a download protocol would do */
+static void sb_rx_handler(uchar *pkt, unsigned int dport,
+			  struct in_addr sip, unsigned int sport,
+			  unsigned int len)
+{
+	uchar *src = net_rx_payload ? net_rx_payload : pkt + TEST_RX_HDR;
+	uchar *dst;
+
+	if (dport != TEST_RX_PORT)
+		return;
+	dst = test_rx_buf +
+	      get_unaligned_be32(pkt) % TEST_RX_SLOTS * TEST_RX_DATA;
+	if (dst == src)
+		test_rx_in_place++;
+	else
+		memcpy(dst, src, len - TEST_RX_HDR);
+	test_rx_count++;
+}
+
+/* Queue a UDP packet with a sequence number in the sandbox driver */
+static void sb_queue_udp(struct udevice *dev, u32 seq)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth;
+	uchar *pkt;
+
+	eth = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth->et_dest, net_ethaddr, ARP_HLEN);
+	memcpy(eth->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+	pkt = (uchar *)eth + ETHER_HDR_SIZE;
+	net_set_udp_header(pkt, net_ip, TEST_RX_PORT, TEST_RX_PORT,
+			   TEST_RX_HDR + TEST_RX_DATA);
+	pkt += IP_UDP_HDR_SIZE;
+	put_unaligned_be32(seq, pkt);
+	memset(pkt + TEST_RX_HDR, seq, TEST_RX_DATA);
+
+	priv->recv_packet_length[priv->recv_packets++] = ETHER_HDR_SIZE +
+		IP_UDP_HDR_SIZE + TEST_RX_HDR + TEST_RX_DATA;
+}
+
+/**
+ * sb_rx_check() - receive a batch of packets and check the stored payloads
+ *
+ * @uts:	test state
+ * @dev:	sandbox Ethernet device
+ * @place:	true to let the driver place the payload
+ * Return:	0 if OK
+ */
+static int sb_rx_check(struct unit_test_state *uts, struct udevice *dev,
+		       bool place)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	u32 seq = 0;
+	int i, j;
+
+	net_set_udp_dest_handler(place ? sb_rx_dest : NULL);
+	test_rx_count = 0;
+	test_rx_in_place = 0;
+	memset(test_rx_buf, 0xff, TEST_RX_SLOTS * TEST_RX_DATA);
+	for (j = 0; j < PKTBUFSRX; j++)
+		sb_queue_udp(dev, seq++);
+	ut_assertok(eth_rx());
+	ut_asserteq(0, priv->recv_packets);
+
+	ut_asserteq(seq, test_rx_count);
+	ut_asserteq(place ? seq : 0, test_rx_in_place);
+	for (i = 0; i < TEST_RX_SLOTS && i < seq; i++) {
+		j = (seq - 1) - ((seq - 1 - i) % TEST_RX_SLOTS);
+		ut_asserteq((u8)j, test_rx_buf[i * TEST_RX_DATA]);
+		ut_asserteq((u8)j, test_rx_buf[(i + 1) * TEST_RX_DATA - 1]);
+	}
+
+	return 0;
+}
+
+/* Test batched receive and payload placement */
+static int dm_test_eth_recv_batch(struct unit_test_state *uts)
+{
+	struct in_addr old_ip = net_ip;
+	struct udevice *dev;
+
+	env_set("ethact", "eth@10002000");
+	ut_assertok(net_init());
+	ut_assertok(eth_init());
+	dev = eth_get_dev();
+	ut_assertnonnull(dev);
+	net_ip = string_to_ip("1.1.2.1");
+	net_set_udp_handler(sb_rx_handler);
+	test_rx_buf = malloc(TEST_RX_SLOTS * TEST_RX_DATA);
+	ut_assertnonnull(test_rx_buf);
+
+	ut_assertok(sb_rx_check(uts, dev, false));
+	ut_assertok(sb_rx_check(uts, dev, true));
+
+	/* Drivers without recv_batch() receive one packet at a time */
+	sandbox_eth_disable_batch(0, true);
+	ut_assertok(sb_rx_check(uts, dev, false));
+	sandbox_eth_disable_batch(0, false);
+
+	free(test_rx_buf);
+	net_set_udp_dest_handler(NULL);
+	net_set_udp_handler(NULL);
+	net_ip = old_ip;
+	eth_halt();
+
+	return 0;
+}
+DM_TEST(dm_test_eth_recv_batch, UT_TESTF_SCAN_FDT);
+
+#define TEST_TFTP_PORT	1069
+#define TEST_TFTP_BLOCK	512
+#define TEST_TFTP_SIZE	1300
+
+/* Answer the read request and each ACK with the next block of the file */
+static int sb_tftp_handler(struct udevice *dev, void *packet,
+			   unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	struct ethernet_hdr *eth_recv;
+	struct ip_udp_hdr *ip_recv;
+	uchar *tftp = (uchar *)ip + IP_UDP_HDR_SIZE;
+	uint block, offset, size, i;
+	uchar *data;
+
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len))
+		return 0;
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP ||
+	    priv->recv_packets >= PKTBUFSRX)
+		return 0;
+	switch (get_unaligned_be16(tftp)) {
+	case 1:		/* RRQ */
+		block = 1;
+		break;
+	case 4:		/* ACK */
+		block = get_unaligned_be16(tftp + 2) + 1;
+		break;
+	default:
+		return 0;
+	}
+	offset = (block - 1) * TEST_TFTP_BLOCK;
+	if (offset > TEST_TFTP_SIZE)
+		return 0;
+	size = min(TEST_TFTP_SIZE - offset, (uint)TEST_TFTP_BLOCK);
+
+	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth_recv->et_dest, eth->et_src, ARP_HLEN);
+	memcpy(eth_recv->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_recv->et_protlen = htons(PROT_IP);
+	ip_recv = (void *)eth_recv + ETHER_HDR_SIZE;
+	net_set_ip_header((uchar *)ip_recv, net_ip, priv->fake_host_ipaddr,
+			  IP_UDP_HDR_SIZE + 4 + size, IPPROTO_UDP);
+	ip_recv->udp_src = htons(TEST_TFTP_PORT);
+	ip_recv->udp_dst = ip->udp_src;
+	ip_recv->udp_len = htons(UDP_HDR_SIZE + 4 + size);
+	ip_recv->udp_xsum = 0;
+	data = (uchar *)ip_recv + IP_UDP_HDR_SIZE;
+	put_unaligned_be16(3, data);	/* DATA */
+	put_unaligned_be16(block, data + 2);
+	for (i = 0; i < size; i++)
+		data[4 + i] = (offset + i) * 7;
+	priv->recv_packet_length[priv->recv_packets++] = ETHER_HDR_SIZE +
+		IP_UDP_HDR_SIZE + 4 + size;
+
+	return 0;
+}
+
+/* Load a file with TFTP to address 0, which is a valid load address */
+static int sb_tftp_load(struct unit_test_state *uts)
+{
+	ulong old_addr = image_load_addr;
+	uchar *buf;
+	int i, ret;
+
+	image_load_addr = 0;
+	buf = map_sysmem(0, TEST_TFTP_SIZE);
+	memset(buf, '\0', TEST_TFTP_SIZE);
+	net_boot_file_size = 0;
+	copy_filename(net_boot_file_name, "file", sizeof(net_boot_file_name));
+	ret = net_loop(TFTPGET);
+	image_load_addr = old_addr;
+	ut_asserteq(TEST_TFTP_SIZE, ret);
+	ut_asserteq(TEST_TFTP_SIZE, net_boot_file_size);
+	for (i = 0; i < TEST_TFTP_SIZE; i++)
+		ut_asserteq((u8)(i * 7), buf[i]);
+	unmap_sysmem(buf);
+
+	return 0;
+}
+
+static int dm_test_eth_tftp(struct unit_test_state *uts)
+{
+	char *ipaddr = strdup(env_get("ipaddr") ?: "");
+	char *serverip = strdup(env_get("serverip") ?: "");
+	int ret;
+
+	sandbox_eth_set_tx_handler(0, sb_tftp_handler);
+	env_set("ethact", "eth@10002000");
+	env_set("ipaddr", "1.1.2.1");
+	env_set("serverip", "1.1.2.2");
+
+	ret = sb_tftp_load(uts);
+	if (!ret) {
+		/* The same through recv(), without payload placement */
+		sandbox_eth_disable_batch(0, true);
+		ret = sb_tftp_load(uts);
+		sandbox_eth_disable_batch(0, false);
+	}
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("ipaddr", *ipaddr ? ipaddr : NULL);
+	env_set("serverip", *serverip ? serverip : NULL);
+	free(ipaddr);
+	free(serverip);
+
+	return ret;
+}
+DM_TEST(dm_test_eth_tftp, UT_TESTF_SCAN_FDT);
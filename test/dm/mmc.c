@@ -5,8 +5,10 @@
 
 #include <common.h>
 #include <dm.h>
+#include <malloc.h>
 #include <mmc.h>
 #include <part.h>
+#include <asm/test.h>
 #include <dm/test.h>
 #include <test/test.h>
 #include <test/ut.h>
@@ -52,3 +54,146 @@ static int dm_test_mmc_blk(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_mmc_blk, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Number of CMD1 for which the emulated eMMC is busy powering up */
+#define EMMC_BUSY_POLLS	10
+
+/**
+ * mmc_test_start_init() - start the card again, as 'mmc rescan' would
+ *
+ * Without CONFIG_MMC_DEFERRED_INIT, the device is marked for preinit so that
+ * mmc_init_device() starts it.
+ *
+ * @uts:	test state
+ * @dev:	MMC device
+ * Return:	0 if OK
+ */
+static int mmc_test_start_init(struct unit_test_state *uts,
+			       struct udevice *dev)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+
+	mmc->has_init = 0;
+	if (!CONFIG_IS_ENABLED(MMC_DEFERRED_INIT))
+		mmc_set_preinit(mmc, 1);
+	ut_assertok(mmc_init_device(dev_seq(dev)));
+	ut_asserteq(1, mmc->init_in_progress);
+	ut_asserteq(0, mmc->has_init);
+
+	return 0;
+}
+
+/* Test that a card started early is completed on first access */
+static int dm_test_mmc_deferred_init(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	char buf[512];
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assertok(mmc_test_start_init(uts, dev));
+
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	ut_asserteq(0, mmc->init_in_progress);
+	ut_asserteq(1, mmc->has_init);
+	ut_asserteq(1, blk_dread(dev_desc, 0, 1, buf));
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_deferred_init, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test that the eMMC power-up continues on first access without a CMD0 */
+static int dm_test_mmc_deferred_init_emmc(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	char buf[512];
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	sandbox_mmc_set_emmc(dev, EMMC_BUSY_POLLS);
+	ut_assertok(mmc_test_start_init(uts, dev));
+
+	/* Starting only checks that the card accepts the voltage window */
+	ut_asserteq(1, mmc->op_cond_pending);
+	ut_asserteq(2, sandbox_mmc_get_op_conds(dev));
+
+	/* A CMD0 here would restart the power-up and add more polls */
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	ut_asserteq(0, mmc->init_in_progress);
+	ut_asserteq(1, mmc->has_init);
+	ut_assert(!IS_SD(mmc));
+	ut_asserteq(EMMC_BUSY_POLLS + 1, sandbox_mmc_get_op_conds(dev));
+	ut_asserteq(1, blk_dread(dev_desc, 0, 1, buf));
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_deferred_init_emmc,
+	UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+#define STREAM_BLOCKS	2048
+#define STREAM_CHUNK	32
+
+/**
+ * mmc_stream_time() - read the card in chunks and return the bus time
+ *
+ * @uts:	test state
+ * @dev:	MMC device
+ * @dev_desc:	block device of the MMC device
+ * @buf:	buffer for the whole card
+ * @usp:	returns the simulated bus time in microseconds
+ * Return:	0 if OK
+ */
+static int mmc_stream_time(struct unit_test_state *uts, struct udevice *dev,
+			   struct blk_desc *dev_desc, char *buf, ulong *usp)
+{
+	ulong start = sandbox_mmc_get_bus_time(dev);
+	int i;
+
+	for (i = 0; i < STREAM_BLOCKS; i += STREAM_CHUNK)
+		ut_asserteq(STREAM_CHUNK,
+			    blk_dread(dev_desc, i, STREAM_CHUNK,
+				      buf + i * dev_desc->blksz));
+	*usp = sandbox_mmc_get_bus_time(dev) - start;
+
+	return 0;
+}
+
+/* Compare multi-block reads with and without SET_BLOCK_COUNT */
+static int dm_test_mmc_cmd23(struct unit_test_state *uts)
+{
+	ulong sbc_us, stop_us;
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	char *buf, *ref;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assert(mmc->card_caps & mmc->host_caps & MMC_CAP_CMD23);
+
+	buf = malloc(STREAM_BLOCKS * dev_desc->blksz);
+	ref = malloc(STREAM_BLOCKS * dev_desc->blksz);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(ref);
+
+	ut_assertok(mmc_stream_time(uts, dev, dev_desc, buf, &sbc_us));
+
+	mmc->host_caps &= ~MMC_CAP_CMD23;
+	ut_assertok(mmc_stream_time(uts, dev, dev_desc, ref, &stop_us));
+	mmc->host_caps |= MMC_CAP_CMD23;
+
+	ut_asserteq_mem(ref, buf, STREAM_BLOCKS * dev_desc->blksz);
+	/* CMD23 saves the STOP_TRANSMISSION and its busy wait per chunk */
+	ut_assert(sbc_us < stop_us);
+
+	free(ref);
+	free(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_cmd23, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
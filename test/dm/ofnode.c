@@ -22,7 +22,9 @@
 #include <of_live.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
+#include <dm/of_access.h>
 #include <dm/of_extra.h>
+#include <dm/of_index.h>
 #include <dm/root.h>
 #include <dm/test.h>
 #include <dm/uclass-internal.h>
@@ -148,6 +150,110 @@ static int dm_test_ofnode_get_by_phandle_ot(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_ofnode_get_by_phandle_ot, UT_TESTF_OTHER_FDT);
 
+/**
+ * check_flat_index() - check the index against libfdt for all nodes
+ *
+ * @uts:	test state
+ * @blob:	control FDT
+ * Return:	0 if OK
+ */
+static int check_flat_index(struct unit_test_state *uts, const void *blob)
+{
+	static const char *const names[] = {
+		"compatible", "status", "reg", "clocks", "int-value",
+	};
+	const void *ref, *val;
+	int offset, ref_len, len, i;
+	u32 phandle;
+
+	for (offset = 0; offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL)) {
+		phandle = fdt_get_phandle(blob, offset);
+		if (phandle)
+			ut_asserteq(fdt_node_offset_by_phandle(blob, phandle),
+				    of_index_node_offset_by_phandle(blob,
+								    phandle));
+		for (i = 0; i < ARRAY_SIZE(names); i++) {
+			ref = fdt_getprop(blob, offset, names[i], &ref_len);
+			val = of_index_getprop(blob, offset, names[i], &len);
+			ut_asserteq_ptr(ref, val);
+			ut_asserteq(ref_len, len);
+		}
+	}
+
+	return 0;
+}
+
+/* Test that the devicetree index gives the same results as a tree walk */
+static int dm_test_ofnode_index(struct unit_test_state *uts)
+{
+	const void *blob = gd->fdt_blob;
+	u32 phandle, max = 0;
+	int offset;
+	ofnode node;
+
+	if (of_live_active()) {
+		struct device_node *np;
+
+		for_each_of_allnodes(np) {
+			if (np->phandle)
+				ut_asserteq_ptr(np,
+						of_find_node_by_phandle(NULL,
+									np->phandle));
+		}
+		ut_assertnull(of_find_node_by_phandle(NULL, 0x1000000));
+
+		return 0;
+	}
+
+	ut_assertok(check_flat_index(uts, blob));
+	ut_asserteq(-FDT_ERR_NOTFOUND,
+		    of_index_node_offset_by_phandle(blob, 0x1000000));
+
+	/* Changing the tree moves properties, which must not be returned */
+	node = ofnode_path("/usb@2");
+	ut_assert(!ofnode_is_enabled(node));
+	ut_assertok(ofnode_set_enabled(node, true));
+	if (IS_ENABLED(CONFIG_OF_INDEX))
+		ut_assertnull(gd->of_index);
+	ut_assert(ofnode_is_enabled(node));
+	ut_assertok(check_flat_index(uts, blob));
+	ut_assertok(ofnode_set_enabled(node, false));
+	ut_assertok(of_index_init());
+
+	/*
+	 * Changes made with libfdt do not drop the index. Shrink one node and
+	 * grow another by the same amount, so the size stays the same but the
+	 * nodes between them move.
+	 */
+	offset = fdt_path_offset(blob, "/usb@0");
+	ut_assert(offset >= 0);
+	ut_assertok(fdt_setprop_string((void *)blob, offset, "status", "okay"));
+	offset = fdt_path_offset(blob, "/usb@2");
+	ut_assert(offset >= 0);
+	ut_assertok(fdt_setprop_string((void *)blob, offset, "compatible",
+				       "sandbox,usbx"));
+	ut_assertok(check_flat_index(uts, blob));
+
+	ut_assertok(fdt_setprop_string((void *)blob, offset, "compatible",
+				       "sandbox,usb"));
+	offset = fdt_path_offset(blob, "/usb@0");
+	ut_assertok(fdt_setprop_string((void *)blob, offset, "status",
+				       "disabled"));
+	ut_assertok(of_index_init());
+
+	for (offset = 0; offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL))
+		max = max(max, fdt_get_phandle(blob, offset));
+
+	for (phandle = 1; phandle <= max; phandle++)
+		ut_asserteq(fdt_node_offset_by_phandle(blob, phandle),
+			    of_index_node_offset_by_phandle(blob, phandle));
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_index, UT_TESTF_SCAN_FDT);
+
 static int check_prop_values(struct unit_test_state *uts, ofnode start,
 			     const char *propname, const char *propval,
 			     int expect_count)
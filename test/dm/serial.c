@@ -7,11 +7,14 @@
 #include <log.h>
 #include <serial.h>
 #include <dm.h>
+#include <asm/global_data.h>
 #include <asm/serial.h>
 #include <dm/test.h>
 #include <test/test.h>
 #include <test/ut.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 static const char test_message[] =
 	"This is a test message\n"
 	"consisting of multiple lines\n";
@@ -89,3 +92,91 @@ static int dm_test_serial(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_serial, UT_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+/* Number of times test_message is written in a burst */
+#define BURST_COUNT	20
+
+/**
+ * serial_test_tx_buffer() - test the TX buffer with output going to @dev
+ *
+ * @uts:	test state
+ * @dev:	serial device
+ * Return:	0 if OK, -ve on error
+ */
+static int serial_test_tx_buffer(struct unit_test_state *uts,
+				 struct udevice *dev)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct sandbox_serial_priv *priv = dev_get_priv(dev);
+	/* Each newline is sent as \r\n */
+	const int msg_len = sizeof(test_message) - 1 + 2;
+	size_t start;
+	int size, i;
+
+	ut_assertnonnull(upriv->txbuf.start);
+	size = membuff_size(&upriv->txbuf) - 1;
+
+	/* Held output is not sent, even by a flush */
+	serial_tx_hold(true);
+	start = sandbox_serial_written();
+	serial_puts(test_message);
+	serial_flush();
+	ut_asserteq(start, sandbox_serial_written());
+	serial_tx_hold(false);
+	ut_asserteq(msg_len, sandbox_serial_written() - start);
+
+	/* The buffer keeps the most recent output when it overflows */
+	serial_tx_hold(true);
+	for (i = 0; i <= size / msg_len; i++)
+		serial_puts(test_message);
+	ut_asserteq(size, membuff_avail(&upriv->txbuf));
+
+	/* A key press sends it */
+	start = sandbox_serial_written();
+	ut_asserteq(1, membuff_put(&priv->buf, "x", 1));
+	ut_asserteq('x', serial_getc());
+	ut_asserteq(size, sandbox_serial_written() - start);
+	ut_assert(membuff_isempty(&upriv->txbuf));
+
+	/* Output is sent in bursts while the FIFO of a slow UART drains */
+	sandbox_serial_set_fifo(16, 115200 / 10);
+	start = sandbox_serial_written();
+	for (i = 0; i < BURST_COUNT; i++)
+		serial_puts(test_message);
+	ut_assert(sandbox_serial_written() - start < BURST_COUNT * msg_len);
+	serial_flush();
+	ut_asserteq(BURST_COUNT * msg_len, sandbox_serial_written() - start);
+
+	/* Stopping sends held output, after which output is not buffered */
+	sandbox_serial_set_fifo(0, 0);
+	serial_tx_hold(true);
+	start = sandbox_serial_written();
+	serial_puts(test_message);
+	serial_tx_stop();
+	ut_asserteq(msg_len, sandbox_serial_written() - start);
+	ut_assertnull(upriv->txbuf.start);
+	serial_puts(test_message);
+	ut_asserteq(2 * msg_len, sandbox_serial_written() - start);
+
+	return 0;
+}
+
+static int dm_test_serial_tx_buffer(struct unit_test_state *uts)
+{
+	struct udevice *dev, *old = gd->cur_serial_dev;
+	int ret;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_SERIAL, "serial", &dev));
+	gd->cur_serial_dev = dev;
+	sandbox_serial_endisable(false);
+	ret = serial_test_tx_buffer(uts, dev);
+	sandbox_serial_set_fifo(0, 0);
+	serial_tx_hold(false);
+	sandbox_serial_endisable(true);
+	gd->cur_serial_dev = old;
+
+	return ret;
+}
+DM_TEST(dm_test_serial_tx_buffer, UT_TESTF_SCAN_FDT);
+#endif
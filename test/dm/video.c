@@ -83,6 +83,8 @@ static int compress_frame_buffer(struct unit_test_state *uts,
 
 	/* Check here that the copy frame buffer is working correctly */
 	if (IS_ENABLED(CONFIG_VIDEO_COPY)) {
+		/* Damaged regions are only copied when the display is synced */
+		ut_assertok(video_sync(dev, false));
 		ut_assertf(!memcmp(uc_priv->fb, uc_priv->copy_fb,
 				   uc_priv->fb_size),
 				   "Copy framebuffer does not match fb");
@@ -191,6 +193,67 @@ static int dm_test_video_chars(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_video_chars, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
 
+#ifdef CONFIG_VIDEO_DAMAGE
+/* Test that only the changed parts of the display are synced */
+static int dm_test_video_damage(struct unit_test_state *uts)
+{
+	const char *text = "Some text for the console\n";
+	struct video_priv *priv;
+	struct udevice *dev, *con;
+	ulong bytes;
+	int i;
+
+	ut_assertok(select_vidconsole(uts, "vidconsole0"));
+	ut_assertok(video_get_nologo(uts, &dev));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
+	priv = dev_get_uclass_priv(dev);
+	ut_asserteq(0, priv->damage_count);
+
+	/* Each character damages its own cell */
+	vidconsole_putc_xy(con, VID_TO_POS(16), 32, 'a');
+	ut_asserteq(1, priv->damage_count);
+	ut_asserteq(16, priv->damage[0].xstart);
+	ut_asserteq(32, priv->damage[0].ystart);
+	ut_asserteq(24, priv->damage[0].xend);
+	ut_asserteq(48, priv->damage[0].yend);
+
+	/* The next one extends the rectangle, a distant one gets its own */
+	vidconsole_putc_xy(con, VID_TO_POS(24), 32, 'b');
+	vidconsole_putc_xy(con, VID_TO_POS(800), 700, 'c');
+	ut_asserteq(2, priv->damage_count);
+	ut_asserteq(32, priv->damage[0].xend);
+
+	bytes = priv->sync_bytes;
+	ut_assertok(video_sync(dev, false));
+	ut_asserteq(0, priv->damage_count);
+	ut_asserteq(3 * 8 * 16 * 2, priv->sync_bytes - bytes);
+
+	/* When there are too many rectangles, they are merged */
+	for (i = 0; i <= VIDEO_DAMAGE_RECTS; i++)
+		vidconsole_putc_xy(con, VID_TO_POS(i * 200), i * 100, 'x');
+	ut_asserteq(VIDEO_DAMAGE_RECTS, priv->damage_count);
+	ut_assertok(video_sync(dev, false));
+	if (IS_ENABLED(CONFIG_VIDEO_COPY))
+		ut_asserteq_mem(priv->fb, priv->copy_fb, priv->fb_size);
+
+	/* A full sync copies everything */
+	bytes = priv->sync_bytes;
+	video_sync_all();
+	ut_asserteq(priv->fb_size, priv->sync_bytes - bytes);
+
+	/* Writing lines of text only syncs the characters, without scrolling */
+	vidconsole_position_cursor(con, 0, 0);
+	bytes = priv->sync_bytes;
+	for (i = 0; i < 40; i++)
+		vidconsole_put_string(con, text);
+	bytes = priv->sync_bytes - bytes;
+	ut_asserteq(40 * (strlen(text) - 1) * 8 * 16 * 2, bytes);
+
+	return 0;
+}
+DM_TEST(dm_test_video_damage, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+#endif
+
 #ifdef CONFIG_VIDEO_ANSI
 #define ANSI_ESC "\x1b"
 /* Test handling of ANSI escape sequences */
@@ -434,6 +497,61 @@ static int dm_test_video_bmp24_32(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_video_bmp24_32, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
 
+/**
+ * check_bmp_gzip() - Check streaming a gzipped bitmap file
+ *
+ * The image is drawn from a buffer and then decompressed straight into the
+ * frame buffer. Both must give the same result.
+ *
+ * @uts:	Test state
+ * @dev:	Video device to draw on
+ * @fname:	Name of the gzipped bitmap file
+ * Return:	0 if OK, -ve on error
+ */
+static int check_bmp_gzip(struct unit_test_state *uts, struct udevice *dev,
+			  const char *fname)
+{
+	struct video_priv *priv = dev_get_uclass_priv(dev);
+	ulong src, src_len = ~0UL;
+	uint dst_len = ~0U;
+	ulong dst = 0x20000;
+	void *expect;
+
+	ut_assertok(read_file(uts, fname, &src));
+	expect = malloc(priv->fb_size);
+	ut_assertnonnull(expect);
+
+	ut_assertok(gunzip(map_sysmem(dst, 0), dst_len, map_sysmem(src, 0),
+			   &src_len));
+	ut_assertok(video_bmp_display(dev, dst, 0, 0, false));
+	memcpy(expect, priv->fb, priv->fb_size);
+
+	ut_assertok(video_clear(dev));
+	ut_assertok(video_bmp_display_gzip(dev, src, 100000, 0, 0, false));
+	ut_asserteq_mem(expect, priv->fb, priv->fb_size);
+	free(expect);
+
+	return 0;
+}
+
+/* Test drawing a gzipped bitmap file without decompressing it to memory */
+static int dm_test_video_bmp_gzip(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+
+	ut_assertok(uclass_find_first_device(UCLASS_VIDEO, &dev));
+	ut_assertnonnull(dev);
+	ut_assertok(sandbox_sdl_set_bpp(dev, VIDEO_BPP16));
+	ut_assertok(check_bmp_gzip(uts, dev, "tools/logos/denx-16bpp.bmp.gz"));
+	ut_assertok(check_bmp_gzip(uts, dev, "tools/logos/denx-24bpp.bmp.gz"));
+
+	ut_assertok(sandbox_sdl_set_bpp(dev, VIDEO_BPP32));
+	ut_assertok(check_bmp_gzip(uts, dev, "tools/logos/denx-24bpp.bmp.gz"));
+
+	return 0;
+}
+DM_TEST(dm_test_video_bmp_gzip, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
 /* Test drawing a bitmap file on a 32bpp display */
 static int dm_test_video_bmp32(struct unit_test_state *uts)
 {
@@ -521,6 +639,61 @@ static int dm_test_video_truetype(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_video_truetype, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
 
+/**
+ * fill_screen() - Write lines of text over the whole TrueType console
+ *
+ * @con:	Console device
+ */
+static void fill_screen(struct udevice *con)
+{
+	struct vidconsole_priv *priv = dev_get_uclass_priv(con);
+	const char *text = "Boot Menu: 1. Ubuntu  2. Recovery  3. Exit\n";
+	int i;
+
+	vidconsole_position_cursor(con, 0, 0);
+	for (i = 0; i < priv->rows - 1; i++)
+		vidconsole_put_string(con, text);
+}
+
+/* Test that the TrueType glyph cache draws the same as rendering */
+static int dm_test_video_truetype_cache(struct unit_test_state *uts)
+{
+	ulong hits, misses, old_misses;
+	struct video_priv *priv;
+	struct udevice *dev, *con;
+	void *expect;
+
+	ut_assertok(video_get_nologo(uts, &dev));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
+	priv = dev_get_uclass_priv(dev);
+	expect = malloc(priv->fb_size);
+	ut_assertnonnull(expect);
+
+	ut_assertok(vidconsole_set_glyph_cache(con, false));
+	fill_screen(con);
+	memcpy(expect, priv->fb, priv->fb_size);
+
+	/* Cached characters must look the same as rendered ones */
+	ut_assertok(vidconsole_set_glyph_cache(con, true));
+	ut_assertok(video_clear(dev));
+	fill_screen(con);
+	ut_asserteq_mem(expect, priv->fb, priv->fb_size);
+
+	/* Now every character is in the cache */
+	ut_assertok(vidconsole_get_glyph_stats(con, &hits, &old_misses));
+	ut_assertok(video_clear(dev));
+	fill_screen(con);
+	ut_asserteq_mem(expect, priv->fb, priv->fb_size);
+	free(expect);
+
+	ut_assertok(vidconsole_get_glyph_stats(con, &hits, &misses));
+	ut_asserteq(old_misses, misses);
+	ut_assert(hits > 0);
+
+	return 0;
+}
+DM_TEST(dm_test_video_truetype_cache, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
 /* Test scrolling TrueType console */
 static int dm_test_video_truetype_scroll(struct unit_test_state *uts)
 {
@@ -193,3 +193,67 @@ static int dm_test_virtio_ring(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_virtio_ring, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test indirect descriptors of the virtio ring */
+static int dm_test_virtio_ring_indirect(struct unit_test_state *uts)
+{
+	struct udevice *bus, *dev;
+	struct virtio_dev_priv *uc_priv;
+	struct vring_desc *indir;
+	struct virtqueue *vq;
+	struct virtio_sg sg[3];
+	struct virtio_sg *sgs[3];
+	unsigned int num, len;
+	u8 buffer[3][32];
+	int i;
+
+	ut_assertok(uclass_first_device_err(UCLASS_VIRTIO, &bus));
+	ut_assertok(device_find_first_child(bus, &dev));
+	uc_priv = dev_get_uclass_priv(bus);
+	uc_priv->vdev = dev;
+
+	for (i = 0; i < 3; i++) {
+		sg[i].addr = buffer[i];
+		sg[i].length = sizeof(buffer[i]);
+		sgs[i] = &sg[i];
+	}
+
+	ut_assertok(virtio_find_vqs(dev, 1, &vq));
+	num = virtqueue_get_vring_size(vq);
+	vq->indirect = true;
+
+	/* a chain of three buffers takes a single descriptor */
+	ut_assertok(virtqueue_add(vq, sgs, 1, 2));
+	ut_asserteq(num - 1, vq->num_free);
+	ut_asserteq(VRING_DESC_F_INDIRECT,
+		    virtio16_to_cpu(dev, vq->vring.desc[0].flags));
+	ut_asserteq(3 * sizeof(*indir),
+		    virtio32_to_cpu(dev, vq->vring.desc[0].len));
+	indir = (void *)(uintptr_t)virtio64_to_cpu(dev, vq->vring.desc[0].addr);
+	ut_asserteq_ptr(buffer[0],
+			(void *)(uintptr_t)virtio64_to_cpu(dev, indir[0].addr));
+	ut_asserteq(VRING_DESC_F_NEXT, virtio16_to_cpu(dev, indir[0].flags));
+	ut_asserteq(VRING_DESC_F_NEXT | VRING_DESC_F_WRITE,
+		    virtio16_to_cpu(dev, indir[1].flags));
+	ut_asserteq(VRING_DESC_F_WRITE, virtio16_to_cpu(dev, indir[2].flags));
+
+	/* a chain of two buffers does not */
+	ut_assertok(virtqueue_add(vq, sgs, 1, 1));
+	ut_asserteq(num - 3, vq->num_free);
+
+	/* the first buffer is returned and the descriptors are freed */
+	vq->vring.used->idx = 2;
+	vq->vring.used->ring[0].id = 0;
+	vq->vring.used->ring[0].len = 64;
+	vq->vring.used->ring[1].id = 1;
+	vq->vring.used->ring[1].len = 32;
+	ut_asserteq_ptr(buffer, virtqueue_get_buf(vq, &len));
+	ut_asserteq(64, len);
+	ut_asserteq_ptr(buffer, virtqueue_get_buf(vq, &len));
+	ut_asserteq(32, len);
+	ut_asserteq(num, vq->num_free);
+	ut_assertok(virtio_del_vqs(dev));
+
+	return 0;
+}
+DM_TEST(dm_test_virtio_ring_indirect, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
@@ -7,6 +7,7 @@
 #include <common.h>
 #include <command.h>
 #include <log.h>
+#include <malloc.h>
 #include <search.h>
 #include <stdio.h>
 #include <test/env.h>
@@ -14,6 +15,10 @@
 
 #define SIZE 32
 #define ITERATIONS 10000
+/* Number of entries added to a table created with room for SIZE */
+#define GROW_SIZE 2000
+/* Number of variables in a large board environment */
+#define LARGE_VARS 1000
 
 static int htab_fill(struct unit_test_state *uts,
 		     struct hsearch_data *htab, size_t size)
@@ -124,3 +129,96 @@ static int env_test_htab_deletes(struct unit_test_state *uts)
 }
 
 ENV_TEST(env_test_htab_deletes, 0);
+
+/* Check that an export lists each entry once, in ascending order of key */
+static int htab_check_export(struct unit_test_state *uts,
+			     struct hsearch_data *htab, int count)
+{
+	char *res = NULL, *p, *prev = NULL;
+	int n = 0;
+
+	ut_assert(hexport_r(htab, '\n', 0, &res, 0, 0, NULL) > 0);
+	for (p = strtok(res, "\n"); p; p = strtok(NULL, "\n")) {
+		*strchr(p, '=') = '\0';
+		if (prev)
+			ut_assert(strcmp(prev, p) < 0);
+		prev = p;
+		n++;
+	}
+	ut_asserteq(count, n);
+	free(res);
+
+	return 0;
+}
+
+/* Fill the hashtable far beyond its initial size, then delete half */
+static int env_test_htab_grow(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+	char key[20];
+	int i;
+
+	memset(&htab, 0, sizeof(htab));
+	ut_asserteq(1, hcreate_r(SIZE, &htab));
+
+	ut_assertok(htab_fill(uts, &htab, GROW_SIZE));
+	ut_assertok(htab_check_fill(uts, &htab, GROW_SIZE));
+	ut_asserteq(GROW_SIZE, htab.filled);
+	ut_assert(htab.size > GROW_SIZE);
+	ut_assertok(htab_check_export(uts, &htab, GROW_SIZE));
+
+	for (i = 0; i < GROW_SIZE; i += 2) {
+		sprintf(key, "%d", i);
+		ut_assertok(hdelete_r(key, &htab, 0));
+	}
+	ut_asserteq(GROW_SIZE / 2, htab.filled);
+	ut_assertok(htab_check_export(uts, &htab, GROW_SIZE / 2));
+
+	/* Deleted slots are reused, with the table growing no further */
+	ut_assertok(htab_create_delete(uts, &htab, ITERATIONS));
+	ut_asserteq(GROW_SIZE / 2, htab.filled);
+	ut_assert(htab.size < GROW_SIZE * 4);
+
+	hdestroy_r(&htab);
+	return 0;
+}
+
+ENV_TEST(env_test_htab_grow, 0);
+
+/* Test importing, looking up and exporting a large environment */
+static int env_test_htab_large(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+	struct env_entry item, *ritem;
+	char *env, *p;
+	char key[20];
+	int i;
+
+	/* Variables out of order, with values like short scripts */
+	env = malloc(LARGE_VARS * 64);
+	ut_assertnonnull(env);
+	for (i = 0, p = env; i < LARGE_VARS; i++) {
+		p += sprintf(p, "var%d=setenv bootargs ${bootargs} opt%d",
+			     i * 7919 % LARGE_VARS, i) + 1;
+	}
+
+	memset(&htab, 0, sizeof(htab));
+	ut_asserteq(1, himport_r(&htab, env, p - env, '\0', 0, 0, 0, NULL));
+	ut_asserteq(LARGE_VARS, htab.filled);
+
+	for (i = 0; i < LARGE_VARS; i++) {
+		sprintf(key, "var%d", i);
+		item.key = key;
+		item.data = NULL;
+		hsearch_r(item, ENV_FIND, &ritem, &htab, 0);
+		ut_assertnonnull(ritem);
+	}
+	ut_assertok(htab_check_export(uts, &htab, LARGE_VARS));
+
+	hdestroy_r(&htab);
+	free(env);
+
+	return 0;
+}
+
+ENV_TEST(env_test_htab_large, 0);
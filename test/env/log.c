@@ -0,0 +1,357 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test of the environment stored as a log of changes
+ *
+ * The log is kept in RAM which behaves like SPI flash: a write can only
+ * clear bits and an erase sets all of them. A power loss is simulated by
+ * stopping a write part of the way through and failing everything after it,
+ * then loading the log again as a reset would.
+ */
+
+#include <common.h>
+#include <env.h>
+#include <env_internal.h>
+#include <malloc.h>
+#include <search.h>
+#include <test/env.h>
+#include <test/ut.h>
+#include <asm/global_data.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Number of variables in the test environment */
+#define LOG_VARS	40
+
+/**
+ * struct log_dev - RAM holding the copies of the environment area
+ *
+ * @elog:	log stored in this device
+ * @copy:	contents of each copy
+ * @nor:	writes can only clear bits, and the copies have to be erased
+ * @budget:	number of bytes which can be written before the power is
+ *		lost, -1 for no limit
+ * @lost:	the power was lost, so writes and erases fail
+ * @written:	number of bytes written
+ * @erases:	number of erases
+ */
+struct log_dev {
+	struct env_log elog;
+	u8 *copy[2];
+	bool nor;
+	long budget;
+	bool lost;
+	ulong written;
+	int erases;
+};
+
+static int log_dev_read(struct env_log *elog, int copy, ulong offset,
+			ulong size, void *buf)
+{
+	struct log_dev *dev = container_of(elog, struct log_dev, elog);
+
+	memcpy(buf, dev->copy[copy] + offset, size);
+
+	return 0;
+}
+
+static int log_dev_write(struct env_log *elog, int copy, ulong offset,
+			 ulong size, const void *buf)
+{
+	struct log_dev *dev = container_of(elog, struct log_dev, elog);
+	u8 *dst = dev->copy[copy] + offset;
+	const u8 *src = buf;
+	ulong i, todo = size;
+
+	if (dev->lost)
+		return -EIO;
+	if (dev->budget >= 0 && size > dev->budget) {
+		todo = dev->budget;
+		dev->lost = true;
+	}
+	for (i = 0; i < todo; i++)
+		dst[i] = dev->nor ? dst[i] & src[i] : src[i];
+	if (dev->budget >= 0)
+		dev->budget -= todo;
+	dev->written += todo;
+
+	return dev->lost ? -EIO : 0;
+}
+
+static int log_dev_erase(struct env_log *elog, int copy)
+{
+	struct log_dev *dev = container_of(elog, struct log_dev, elog);
+
+	if (dev->lost)
+		return -EIO;
+	memset(dev->copy[copy], 0xff, CONFIG_ENV_SIZE);
+	dev->erases++;
+
+	return 0;
+}
+
+static int log_dev_init(struct unit_test_state *uts, struct log_dev *dev,
+			int copies, bool nor, uint align)
+{
+	int i;
+
+	memset(dev, '\0', sizeof(*dev));
+	dev->elog.read = log_dev_read;
+	dev->elog.write = log_dev_write;
+	dev->elog.erase = nor ? log_dev_erase : NULL;
+	dev->elog.copies = copies;
+	dev->elog.align = align;
+	dev->nor = nor;
+	dev->budget = -1;
+	for (i = 0; i < copies; i++) {
+		dev->copy[i] = malloc(CONFIG_ENV_SIZE);
+		ut_assertnonnull(dev->copy[i]);
+		memset(dev->copy[i], nor ? 0xff : 0, CONFIG_ENV_SIZE);
+	}
+
+	return 0;
+}
+
+static void log_dev_free(struct log_dev *dev)
+{
+	free(dev->elog.saved);
+	free(dev->copy[1]);
+	free(dev->copy[0]);
+}
+
+/* Load the log after a reset, with the power back */
+static int log_reload(struct unit_test_state *uts, struct log_dev *dev)
+{
+	dev->lost = false;
+	dev->budget = -1;
+	ut_assertok(env_log_load(&dev->elog, 0));
+
+	return 0;
+}
+
+/* Set up an environment with only the test variables */
+static int log_set_vars(struct unit_test_state *uts)
+{
+	char name[20], value[40];
+	int i;
+
+	himport_r(&env_htab, "", 0, '\0', 0, 0, 0, NULL);
+	for (i = 0; i < LOG_VARS; i++) {
+		snprintf(name, sizeof(name), "log%02d", i);
+		snprintf(value, sizeof(value), "value of variable %d", i);
+		ut_assertok(env_set(name, value));
+	}
+	ut_assertok(env_set("bootcount", "0"));
+
+	return 0;
+}
+
+static int log_check_vars(struct unit_test_state *uts, const char *bootcount)
+{
+	char name[20], value[40];
+	int i;
+
+	for (i = 0; i < LOG_VARS; i++) {
+		snprintf(name, sizeof(name), "log%02d", i);
+		snprintf(value, sizeof(value), "value of variable %d", i);
+		ut_asserteq_str(value, env_get(name));
+	}
+	ut_asserteq_str(bootcount, env_get("bootcount"));
+
+	return 0;
+}
+
+static int log_test_save(struct unit_test_state *uts)
+{
+	struct log_dev dev;
+	ulong written;
+	char count[12];
+	int i;
+
+	ut_assertok(log_dev_init(uts, &dev, 2, true, 16));
+
+	/* An erased device gives the default environment */
+	ut_asserteq(-ENOMSG, env_log_load(&dev.elog, 0));
+
+	/* The first save then writes all variables to the first copy */
+	ut_assertok(log_set_vars(uts));
+	ut_assertok(env_log_save(&dev.elog));
+	ut_asserteq(1, dev.erases);
+	ut_asserteq(ENV_VALID, gd->env_valid);
+
+	/* Changing one variable appends a small record */
+	written = dev.written;
+	ut_assertok(env_set("bootcount", "1"));
+	ut_assertok(env_log_save(&dev.elog));
+	ut_assert(dev.written - written <= 64);
+	ut_asserteq(1, dev.erases);
+
+	/* Saving without changes writes nothing */
+	written = dev.written;
+	ut_assertok(env_log_save(&dev.elog));
+	ut_asserteq(written, dev.written);
+
+	ut_assertok(env_set("newvar", "new"));
+	ut_assertok(env_log_save(&dev.elog));
+	ut_assertok(log_reload(uts, &dev));
+	ut_assertok(log_check_vars(uts, "1"));
+	ut_asserteq_str("new", env_get("newvar"));
+
+	ut_assertok(env_set("newvar", NULL));
+	ut_assertok(env_log_save(&dev.elog));
+	ut_assertok(log_reload(uts, &dev));
+	ut_assertok(log_check_vars(uts, "1"));
+	ut_assertnull(env_get("newvar"));
+	ut_asserteq(1, dev.erases);
+
+	/* A value ending in '=', e.g. base64, is not a deletion */
+	ut_assertok(env_set("key", "YWJj="));
+	ut_assertok(env_log_save(&dev.elog));
+	ut_assertok(log_reload(uts, &dev));
+	ut_asserteq_str("YWJj=", env_get("key"));
+	ut_assertok(env_set("key", NULL));
+	ut_assertok(env_log_save(&dev.elog));
+	ut_asserteq(1, dev.erases);
+
+	/* The log is compacted into the other copy when it grows too long */
+	for (i = 2; dev.erases == 1; i++) {
+		ut_assert(i < 1000);
+		snprintf(count, sizeof(count), "%d", i);
+		ut_assertok(env_set("bootcount", count));
+		ut_assertok(env_log_save(&dev.elog));
+	}
+	ut_asserteq(ENV_REDUND, gd->env_valid);
+	ut_asserteq(1, dev.elog.copy);
+	ut_assertok(log_reload(uts, &dev));
+	ut_assertok(log_check_vars(uts, count));
+	ut_asserteq(ENV_REDUND, gd->env_valid);
+	log_dev_free(&dev);
+
+	return 0;
+}
+
+static int env_test_log_save(struct unit_test_state *uts)
+{
+	return env_test_run_restore(uts, log_test_save);
+}
+ENV_TEST(env_test_log_save, 0);
+
+/**
+ * log_power_loss() - cut the power at each point of a save
+ *
+ * After each reset, the environment must be that before or after the save,
+ * and the next save must work.
+ *
+ * @uts:	test state
+ * @dev:	device holding a log with bootcount=1
+ * @compact:	make the save write a full record
+ * Return:	0 if OK, -ve on error
+ */
+static int log_power_loss(struct unit_test_state *uts, struct log_dev *dev,
+			  bool compact)
+{
+	u8 *copy[2];
+	int i, budget, done = 0;
+	const char *val;
+
+	for (i = 0; i < dev->elog.copies; i++) {
+		copy[i] = malloc(CONFIG_ENV_SIZE);
+		ut_assertnonnull(copy[i]);
+		memcpy(copy[i], dev->copy[i], CONFIG_ENV_SIZE);
+	}
+
+	for (budget = 0; !done; budget++) {
+		for (i = 0; i < dev->elog.copies; i++)
+			memcpy(dev->copy[i], copy[i], CONFIG_ENV_SIZE);
+		ut_assertok(log_reload(uts, dev));
+		ut_assertok(log_check_vars(uts, "1"));
+
+		ut_assertok(env_set("bootcount", "2"));
+		dev->elog.compact = compact;
+		dev->budget = budget;
+		done = !env_log_save(&dev->elog);
+
+		ut_assertok(log_reload(uts, dev));
+		val = env_get("bootcount");
+		ut_assertnonnull(val);
+		ut_assert(!strcmp(val, "1") || !strcmp(val, "2"));
+		ut_assertok(log_check_vars(uts, val));
+		if (done)
+			ut_asserteq_str("2", val);
+
+		ut_assertok(env_set("bootcount", "3"));
+		ut_assertok(env_log_save(&dev->elog));
+		ut_assertok(log_reload(uts, dev));
+		ut_assertok(log_check_vars(uts, "3"));
+	}
+	for (i = 0; i < dev->elog.copies; i++) {
+		memcpy(dev->copy[i], copy[i], CONFIG_ENV_SIZE);
+		free(copy[i]);
+	}
+
+	return 0;
+}
+
+static int log_test_power_loss(struct unit_test_state *uts)
+{
+	struct log_dev dev;
+
+	/* SPI flash with a redundant copy */
+	ut_assertok(log_dev_init(uts, &dev, 2, true, 16));
+	ut_assertok(log_set_vars(uts));
+	ut_assertok(env_set("bootcount", "1"));
+	ut_assertok(env_log_save(&dev.elog));
+	ut_assertok(log_power_loss(uts, &dev, false));
+	ut_assertok(log_power_loss(uts, &dev, true));
+	log_dev_free(&dev);
+
+	/* MMC without a redundant copy, where only appending is safe */
+	ut_assertok(log_dev_init(uts, &dev, 1, false, 512));
+	ut_assertok(log_set_vars(uts));
+	ut_assertok(env_set("bootcount", "1"));
+	ut_assertok(env_log_save(&dev.elog));
+	ut_assertok(log_power_loss(uts, &dev, false));
+	log_dev_free(&dev);
+
+	return 0;
+}
+
+static int env_test_log_power_loss(struct unit_test_state *uts)
+{
+	return env_test_run_restore(uts, log_test_power_loss);
+}
+ENV_TEST(env_test_log_power_loss, 0);
+
+/* An environment saved without a log is converted by the next save */
+static int log_test_legacy(struct unit_test_state *uts)
+{
+	struct log_dev dev;
+
+	ut_assertok(log_dev_init(uts, &dev, 2, true, 16));
+	ut_assertok(log_set_vars(uts));
+	ut_assertok(env_set("bootcount", "1"));
+	ut_assertok(env_export((env_t *)dev.copy[0]));
+
+	ut_assertok(log_set_vars(uts));
+	ut_assertok(log_reload(uts, &dev));
+	ut_assertok(log_check_vars(uts, "1"));
+	ut_asserteq(ENV_VALID, gd->env_valid);
+
+	/* The old copy is kept until the log is written */
+	ut_assertok(env_set("bootcount", "2"));
+	ut_assertok(env_log_save(&dev.elog));
+	ut_asserteq(ENV_REDUND, gd->env_valid);
+	ut_assertok(env_import((char *)dev.copy[0], 1, 0));
+	ut_assertok(log_check_vars(uts, "1"));
+
+	ut_assertok(log_reload(uts, &dev));
+	ut_assertok(log_check_vars(uts, "2"));
+	log_dev_free(&dev);
+
+	return 0;
+}
+
+static int env_test_log_legacy(struct unit_test_state *uts)
+{
+	return env_test_run_restore(uts, log_test_legacy);
+}
+ENV_TEST(env_test_log_legacy, 0);
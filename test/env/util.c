@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Helpers for tests which change the environment
+ */
+
+#include <common.h>
+#include <env.h>
+#include <env_internal.h>
+#include <malloc.h>
+#include <search.h>
+#include <test/env.h>
+#include <test/ut.h>
+#include <asm/global_data.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+int env_test_run_restore(struct unit_test_state *uts,
+			 int (*func)(struct unit_test_state *uts))
+{
+	int env_valid = gd->env_valid;
+	char *saved;
+	int ret;
+
+	saved = malloc(ENV_SIZE);
+	ut_assertnonnull(saved);
+	ut_assert(hexport_r(&env_htab, '\0', 0, &saved, ENV_SIZE, 0,
+			    NULL) >= 0);
+	ret = func(uts);
+	ut_assert(himport_r(&env_htab, saved, ENV_SIZE, '\0', 0, 0, 0, NULL));
+	gd->env_valid = env_valid;
+	free(saved);
+
+	return ret;
+}
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test of the IP checksum
+ *
+ * The checksum is accumulated in words, so regions with every alignment and
+ * with lengths which are not a multiple of the word size are tested.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <net.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Number of different alignment values */
+#define SWEEP		8
+/* Length of a full sized Ethernet payload */
+#define PKT_LEN		1500
+#define BUF_LEN		(SWEEP + PKT_LEN)
+
+/**
+ * ref_checksum() - compute the IP checksum one byte pair at a time
+ *
+ * @ptr:	data
+ * @nbytes:	length of the data
+ * Return:	16-bit IP checksum
+ */
+static uint ref_checksum(const u8 *ptr, uint nbytes)
+{
+	ulong sum = 0;
+	uint i;
+
+	/* Sum in network byte order, padding an odd length with zero */
+	for (i = 0; i + 1 < nbytes; i += 2)
+		sum += (ptr[i] << 8) | ptr[i + 1];
+	if (i < nbytes)
+		sum += ptr[i] << 8;
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return htons(~sum & 0xffff);
+}
+
+static int lib_test_ip_checksum(struct unit_test_state *uts)
+{
+	uint len;
+	int align, i;
+	u8 *buf;
+
+	buf = memalign(8, BUF_LEN);
+	ut_assertnonnull(buf);
+	for (i = 0; i < BUF_LEN; i++)
+		buf[i] = (i * 37) ^ (i >> 3) ^ 0xa5;
+	/* Create carries in the sum */
+	memset(buf + 64, 0xff, 32);
+
+	for (align = 0; align < SWEEP; align++) {
+		for (len = 0; len <= 80; len++)
+			ut_asserteq(ref_checksum(buf + align, len),
+				    compute_ip_checksum(buf + align, len));
+		ut_asserteq(ref_checksum(buf + align, PKT_LEN),
+			    compute_ip_checksum(buf + align, PKT_LEN));
+	}
+
+	/* A region including its checksum sums up to zero */
+	*(u16 *)(buf + 20) = 0;
+	*(u16 *)(buf + 20) = compute_ip_checksum(buf, PKT_LEN);
+	ut_assert(ip_checksum_ok(buf, PKT_LEN));
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_ip_checksum, 0);
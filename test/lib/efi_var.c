@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test UEFI variable store index and file journal
+ */
+
+#include <common.h>
+#include <charset.h>
+#include <efi_loader.h>
+#include <efi_variable.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <u-boot/crc.h>
+
+#define TEST_VARS 64
+#define TEST_ATTR (EFI_VARIABLE_NON_VOLATILE | \
+		   EFI_VARIABLE_BOOTSERVICE_ACCESS)
+
+static const efi_guid_t guid_test =
+	EFI_GUID(0x3b0fd53c, 0x1e0a, 0x4d12,
+		 0x8a, 0x9e, 0x6c, 0x52, 0x07, 0xd1, 0x4f, 0x38);
+
+/**
+ * put_var() - write a variable entry
+ *
+ * @var:	entry to fill
+ * @name:	variable name
+ * @data:	variable value, NULL to create a deletion record
+ * Return:	size of the entry including alignment
+ */
+static size_t put_var(struct efi_var_entry *var, const u16 *name,
+		      const char *data)
+{
+	size_t name_size = (u16_strlen(name) + 1) * sizeof(u16);
+	size_t len = data ? strlen(data) : 0;
+
+	var->length = len;
+	var->attr = TEST_ATTR;
+	var->time = 0;
+	guidcpy(&var->guid, &guid_test);
+	memcpy(var->name, name, name_size);
+	memcpy((u8 *)var->name + name_size, data, len);
+
+	return ALIGN(offsetof(struct efi_var_entry, name) + name_size + len,
+		     8);
+}
+
+/**
+ * put_record() - append a journal record
+ *
+ * @buf:	start of the file
+ * @pos:	offset of the record
+ * @name:	variable name
+ * @data:	variable value, NULL to create a deletion record
+ * Return:	offset after the record
+ */
+static loff_t put_record(u8 *buf, loff_t pos, const u16 *name,
+			 const char *data)
+{
+	struct efi_var_record *rec = (void *)buf + pos;
+	size_t len;
+
+	len = offsetof(struct efi_var_record, var) +
+	      put_var(&rec->var, name, data);
+	rec->magic = EFI_VAR_RECORD_MAGIC;
+	rec->length = len;
+	rec->reserved = 0;
+	rec->crc32 = crc32(0, (u8 *)&rec->var,
+			   len - offsetof(struct efi_var_record, var));
+
+	return pos + len;
+}
+
+/**
+ * check_var() - check the value of a variable
+ *
+ * @uts:	test state
+ * @name:	variable name
+ * @data:	expected value, NULL if the variable must not exist
+ * Return:	0 if OK
+ */
+static int check_var(struct unit_test_state *uts, const u16 *name,
+		     const char *data)
+{
+	efi_uintn_t size = 16;
+	char buf[16];
+	efi_status_t ret;
+
+	ret = efi_get_variable_mem(name, &guid_test, NULL, &size, buf, NULL);
+	if (!data) {
+		ut_asserteq_64(EFI_NOT_FOUND, ret);
+		return 0;
+	}
+	ut_asserteq_64(EFI_SUCCESS, ret);
+	ut_asserteq(strlen(data), size);
+	ut_asserteq_mem(data, buf, size);
+
+	return 0;
+}
+
+/**
+ * delete_var() - delete a test variable from memory if it exists
+ *
+ * @name:	variable name
+ */
+static void delete_var(const u16 *name)
+{
+	efi_var_mem_del(efi_var_mem_find(&guid_test, name, NULL));
+}
+
+/* Test replay of the journal including a record torn by a power loss */
+static int lib_test_efi_var_replay(struct unit_test_state *uts)
+{
+	struct efi_var_file *file;
+	loff_t pos, torn, valid;
+	u8 *buf;
+
+	ut_asserteq_64(EFI_SUCCESS, efi_init_obj_list());
+	buf = calloc(1, 1024);
+	ut_assertnonnull(buf);
+	file = (struct efi_var_file *)buf;
+
+	/* Snapshot */
+	pos = offsetof(struct efi_var_file, var);
+	pos += put_var((void *)buf + pos, u"UtVarA", "alpha");
+	pos += put_var((void *)buf + pos, u"UtVarB", "bravo");
+	file->magic = EFI_VAR_FILE_MAGIC;
+	file->length = pos;
+	file->crc32 = crc32(0, (u8 *)file->var,
+			    pos - sizeof(struct efi_var_file));
+
+	/* Journal */
+	pos = put_record(buf, pos, u"UtVarC", "charlie");
+	pos = put_record(buf, pos, u"UtVarA", NULL);
+	pos = put_record(buf, pos, u"UtVarB", "beta");
+	torn = pos;
+	pos = put_record(buf, pos, u"UtVarD", "delta");
+
+	/* Lose the last bytes of the last record */
+	ut_asserteq_64(EFI_SUCCESS, efi_var_replay(file, pos - 8, &valid));
+	ut_asserteq_64(torn, valid);
+	ut_assertok(check_var(uts, u"UtVarA", NULL));
+	ut_assertok(check_var(uts, u"UtVarB", "beta"));
+	ut_assertok(check_var(uts, u"UtVarC", "charlie"));
+	ut_assertok(check_var(uts, u"UtVarD", NULL));
+	delete_var(u"UtVarB");
+	delete_var(u"UtVarC");
+
+	/* A record with a corrupted checksum stops the replay */
+	buf[torn - 1] ^= 0xff;
+	ut_asserteq_64(EFI_SUCCESS, efi_var_replay(file, pos, &valid));
+	ut_assert(valid < torn);
+	ut_assertok(check_var(uts, u"UtVarA", NULL));
+	ut_assertok(check_var(uts, u"UtVarB", "bravo"));
+	ut_assertok(check_var(uts, u"UtVarC", "charlie"));
+	delete_var(u"UtVarB");
+	delete_var(u"UtVarC");
+
+	/* A corrupted snapshot is rejected */
+	buf[sizeof(struct efi_var_file)] ^= 0xff;
+	ut_asserteq_64(EFI_INVALID_PARAMETER,
+		       efi_var_replay(file, pos, &valid));
+	ut_assertok(check_var(uts, u"UtVarB", NULL));
+
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_efi_var_replay, 0);
+
+/* Test lookup of variables after insertions and deletions */
+static int lib_test_efi_var_index(struct unit_test_state *uts)
+{
+	u16 name[16];
+	char data[16];
+	int i;
+
+	ut_asserteq_64(EFI_SUCCESS, efi_init_obj_list());
+
+	for (i = 0; i < TEST_VARS; ++i) {
+		efi_create_indexed_name(name, sizeof(name), "UtIdx", i);
+		snprintf(data, sizeof(data), "value%d", i);
+		ut_asserteq_64(EFI_SUCCESS,
+			       efi_var_mem_ins(name, &guid_test, TEST_ATTR,
+					       strlen(data), data, 0, NULL,
+					       0));
+	}
+
+	/* Deleting moves all following variables */
+	for (i = 0; i < TEST_VARS; i += 2) {
+		efi_create_indexed_name(name, sizeof(name), "UtIdx", i);
+		delete_var(name);
+	}
+
+	for (i = 0; i < TEST_VARS; ++i) {
+		efi_create_indexed_name(name, sizeof(name), "UtIdx", i);
+		snprintf(data, sizeof(data), "value%d", i);
+		ut_assertok(check_var(uts, name, i & 1 ? data : NULL));
+		delete_var(name);
+	}
+
+	return 0;
+}
+LIB_TEST(lib_test_efi_var_index, 0);
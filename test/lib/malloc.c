@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test of the slab front end of malloc()
+ *
+ * Small requests are served from size-class slabs and larger ones from the
+ * dlmalloc bins. Both must behave the same to callers, so the tests cover
+ * sizes on either side of each class boundary.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Largest request size tested, beyond the largest slab class */
+#define MAX_SIZE	2200
+/* Number of live allocations during the churn test */
+#define CHURN_SLOTS	512
+/* Number of free/malloc pairs in the churn test */
+#define CHURN_ROUNDS	20000
+
+/* Test that allocations of each size can be used, resized and freed */
+static int lib_test_malloc_sizes(struct unit_test_state *uts)
+{
+	ulong start = ut_check_free();
+	u8 *ptr, *new;
+	size_t size;
+	int i;
+
+	for (size = 0; size <= MAX_SIZE; size++) {
+		ptr = malloc(size);
+		ut_assertnonnull(ptr);
+		ut_asserteq(0, (ulong)ptr & (2 * sizeof(size_t) - 1));
+		ut_assert(malloc_usable_size(ptr) >= size);
+		memset(ptr, size & 0xff, malloc_usable_size(ptr));
+
+		/* Growing keeps the contents */
+		new = realloc(ptr, size + 100);
+		ut_assertnonnull(new);
+		for (i = 0; i < size; i++)
+			ut_asserteq(size & 0xff, new[i]);
+		free(new);
+
+		/* Memory freed with other contents is cleared by calloc() */
+		ptr = calloc(1, size);
+		ut_assertnonnull(ptr);
+		for (i = 0; i < size; i++)
+			ut_asserteq(0, ptr[i]);
+		free(ptr);
+	}
+
+	/* memalign() splits chunks, so it must not use a slab */
+	ptr = memalign(64, 100);
+	ut_assertnonnull(ptr);
+	ut_asserteq(0, (ulong)ptr & 63);
+	free(ptr);
+
+	ut_asserteq(0, ut_check_delta(start));
+
+	return 0;
+}
+LIB_TEST(lib_test_malloc_sizes, 0);
+
+/**
+ * churn() - free and allocate blocks of random sizes
+ *
+ * @ptrs:	live allocations, all NULL on entry and on exit
+ * Return:	0 if OK, -ENOMEM if an allocation failed
+ */
+static int churn(void **ptrs)
+{
+	u32 seed = 1;
+	int i, slot;
+
+	for (i = 0; i < CHURN_ROUNDS; i++) {
+		seed = seed * 1103515245 + 12345;
+		slot = (seed >> 8) % CHURN_SLOTS;
+		free(ptrs[slot]);
+		/* Mostly small blocks, like devices, strings and packets */
+		ptrs[slot] = malloc(((seed >> 20) & 0xff) << ((seed >> 18) & 3));
+		if (!ptrs[slot])
+			break;
+	}
+	for (slot = 0; slot < CHURN_SLOTS; slot++) {
+		free(ptrs[slot]);
+		ptrs[slot] = NULL;
+	}
+
+	return i == CHURN_ROUNDS ? 0 : -ENOMEM;
+}
+
+/*
+ * Compare allocation churn with and without the slab front end, using the
+ * work done in the bins rather than the time taken
+ */
+static int lib_test_malloc_churn(struct unit_test_state *uts)
+{
+	ulong start = ut_check_free();
+	ulong bins_steps, slab_steps;
+	void **ptrs;
+
+	ptrs = calloc(CHURN_SLOTS, sizeof(*ptrs));
+	ut_assertnonnull(ptrs);
+
+	malloc_enable_slab(false);
+	bins_steps = malloc_bin_steps;
+	ut_assertok(churn(ptrs));
+	bins_steps = malloc_bin_steps - bins_steps;
+	malloc_enable_slab(true);
+	ut_assert(bins_steps >= CHURN_ROUNDS);
+
+	slab_steps = malloc_bin_steps;
+	ut_assertok(churn(ptrs));
+	slab_steps = malloc_bin_steps - slab_steps;
+	free(ptrs);
+
+	/* Only new slab pages come from the bins */
+	if (IS_ENABLED(CONFIG_SYS_MALLOC_SLAB))
+		ut_assert(slab_steps * 10 < bins_steps);
+
+	ut_asserteq(0, ut_check_delta(start));
+
+	return 0;
+}
+LIB_TEST(lib_test_malloc_churn, 0);
@@ -85,8 +85,10 @@ static void usage(void)
 		"\n"
 		"Commands\n"
 		"   dump-ftrace\t\tDump out textual data in ftrace format\n"
+		"   dump-chrome\t\tDump out Chrome trace events (JSON)\n"
 		"\n"
 		"Options:\n"
+		"   -b <file>\tMerge 'bootstage trace' output into dump-chrome\n"
 		"   -m <map>\tSpecify Systen.map file\n"
 		"   -t <trace>\tSpecific trace data file (from U-Boot)\n"
 		"   -v <0-4>\tSpecify verbosity\n");
@@ -532,9 +534,89 @@ static int make_ftrace(void)
 	return 0;
 }
 
+/**
+ * merge_bootstage() - copy the events of a bootstage trace
+ *
+ * The output of 'bootstage trace' holds one event per line between the line
+ * opening and the line closing the event array.
+ *
+ * @fname:	file written by 'bootstage trace'
+ * Return:	number of events copied, -1 on error
+ */
+static int merge_bootstage(const char *fname)
+{
+	char buff[MAX_LINE_LEN];
+	int count = 0;
+	FILE *fin;
+
+	fin = fopen(fname, "r");
+	if (!fin) {
+		error("Cannot open bootstage trace file '%s'\n", fname);
+		return -1;
+	}
+	while (fgets(buff, sizeof(buff), fin)) {
+		int len = strcspn(buff, "\r\n");
+
+		if (strncmp(buff, "{\"name\":", 8))
+			continue;
+		if (len && buff[len - 1] == ',')
+			len--;
+		printf(",\n%.*s", len, buff);
+		count++;
+	}
+	fclose(fin);
+
+	return count;
+}
+
+/*
+ * Chrome trace event format as understood by chrome://tracing and Perfetto,
+ * function calls are on thread 2, bootstage marks and spans on thread 1:
+ *
+ * {"traceEvents":[
+ * {"name":"initr_dm","ph":"B","ts":3659598,"pid":1,"tid":2},
+ * {"name":"initr_dm","ph":"E","ts":3660112,"pid":1,"tid":2}
+ * ]}
+ */
+static int make_chrome(const char *bootstage_fname)
+{
+	struct trace_call *call;
+	const char *sep = "";
+	int i;
+
+	printf("{\"traceEvents\":[\n");
+	for (i = 0, call = call_list; i < call_count; i++, call++) {
+		struct func_info *func = find_func_by_offset(call->func);
+		ulong time = call->flags & FUNCF_TIMESTAMP_MASK;
+
+		if (TRACE_CALL_TYPE(call) != FUNCF_ENTRY &&
+		    TRACE_CALL_TYPE(call) != FUNCF_EXIT)
+			continue;
+		if (!func || !(func->flags & FUNCF_TRACE))
+			continue;
+
+		printf("%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu,"
+		       "\"pid\":1,\"tid\":2}", sep, func->name,
+		       TRACE_CALL_TYPE(call) == FUNCF_ENTRY ? 'B' : 'E', time);
+		sep = ",\n";
+	}
+	if (bootstage_fname) {
+		/* merge_bootstage() adds a separator before each event */
+		if (!*sep)
+			printf("{\"name\":\"trace\",\"ph\":\"i\",\"ts\":0,"
+			       "\"pid\":1,\"tid\":2}");
+		if (merge_bootstage(bootstage_fname) < 0)
+			return -1;
+	}
+	printf("\n]}\n");
+
+	return 0;
+}
+
 static int prof_tool(int argc, char *const argv[],
 		     const char *prof_fname, const char *map_fname,
-		     const char *trace_config_fname)
+		     const char *trace_config_fname,
+		     const char *bootstage_fname)
 {
 	int err = 0;
 
@@ -552,6 +634,8 @@ static int prof_tool(int argc, char *const argv[],
 
 		if (0 == strcmp(cmd, "dump-ftrace"))
 			err = make_ftrace();
+		else if (0 == strcmp(cmd, "dump-chrome"))
+			err = make_chrome(bootstage_fname);
 		else
 			warn("Unknown command '%s'\n", cmd);
 	}
@@ -564,11 +648,16 @@ int main(int argc, char *argv[])
 	const char *map_fname = "System.map";
 	const char *prof_fname = NULL;
 	const char *trace_config_fname = NULL;
+	const char *bootstage_fname = NULL;
 	int opt;
 
 	verbose = 2;
-	while ((opt = getopt(argc, argv, "m:p:t:v:")) != -1) {
+	while ((opt = getopt(argc, argv, "b:m:p:t:v:")) != -1) {
 		switch (opt) {
+		case 'b':
+			bootstage_fname = optarg;
+			break;
+
 		case 'm':
 			map_fname = optarg;
 			break;
@@ -595,5 +684,5 @@ int main(int argc, char *argv[])
 
 	debug("Debug enabled\n");
 	return prof_tool(argc, argv, prof_fname, map_fname,
-			 trace_config_fname);
+			 trace_config_fname, bootstage_fname);
 }